@@ -0,0 +1,364 @@
+// Тест выделений памяти на кадр в настоящем пути кадра: FrameCapture (MJPEG
+// по HTTP) -> NumberPlateRecognizer::processFrame (декодирование, детектор
+// Хаара, вырезки с выравниванием) -> AsyncOCRClient (JPEG вырезок в пул и
+// постановка в очередь клиента). Камера и OCR-сервер - synthetic_cameras и
+// stub_ocr_server из каталога сборки, как у load_test.
+//
+//   alloc_bench [--frames 300] [--seconds N] [--width 1280] [--height 720] [--fps 25]
+//               [--max-allocs 300] [--max-kb 512] [--cascade path]
+//               [--camera-port 18180] [--ocr-port 15180] [--verbose]
+//
+// Выделения считаются подменой malloc/calloc/realloc/posix_memalign (glibc):
+// через них идут и operator new, и cv::fastMalloc, и данные QByteArray.
+// Считаются только поток захвата и шаг камеры; сетевой поток клиента (объекты
+// запросов Qt) и процессы-помощники не считаются. Первые кадры прогревают
+// пулы и в счет не входят. С --seconds путь крутится заданное время (часовой
+// прогон - --seconds 3600), RSS печатается раз в минуту.
+//
+// Бюджет на кадр (--max-allocs, --max-kb) оставлен под небольшие выделения,
+// которые от размера кадра не зависят: рабочая память libjpeg на каждый
+// imencode/imdecode, внутренние списки каскада и очередь вызова Qt. Буфер
+// размером с кадр или вырезку в нем не помещается, так что вернувшееся
+// выделение кадра ловится. Промахи пулов после прогрева - провал всегда.
+//
+// Код возврата: 0 - в бюджете, 1 - бюджет превышен или пулы промахивались,
+// 2 - тест не запустился (нет помощников, каскада, кадров).
+
+#include <opencv2/opencv.hpp>
+
+#include <QCoreApplication>
+#include <QThread>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include "NumberPlateRecognizer.h"
+#include "async_ocr_client.h"
+#include "helper_process.h"
+#include "plate_detector.h"
+#include "stream_config.h"
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+}
+
+// Поток, чьи выделения считаются: захват и шаг камеры - отдельно
+enum ThreadRole { OtherThread, CaptureThread, StepThread, RoleCount };
+
+static thread_local int threadRole = OtherThread;
+static std::atomic<uint64_t> allocations[RoleCount];
+static std::atomic<uint64_t> allocatedBytes[RoleCount];
+
+static void countAllocation(size_t size)
+{
+    const int role = threadRole;
+    allocations[role].fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes[role].fetch_add(size, std::memory_order_relaxed);
+}
+
+extern "C" void *malloc(size_t size)
+{
+    countAllocation(size);
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    countAllocation(count * size);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *pointer, size_t size)
+{
+    countAllocation(size);
+    return __libc_realloc(pointer, size);
+}
+
+extern "C" int posix_memalign(void **pointer, size_t alignment, size_t size)
+{
+    countAllocation(size);
+    *pointer = __libc_memalign(alignment, size);
+    return *pointer ? 0 : ENOMEM;
+}
+
+extern "C" void *aligned_alloc(size_t alignment, size_t size)
+{
+    countAllocation(size);
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" void *memalign(size_t alignment, size_t size)
+{
+    countAllocation(size);
+    return __libc_memalign(alignment, size);
+}
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+const int kWarmupFrames = 50;
+const int kStartTimeoutMs = 15000;
+
+struct AllocConfig
+{
+    int frames = 300;
+    int seconds = 0;
+    int width = 1280;
+    int height = 720;
+    int fps = 25;
+    int maxAllocs = 300;
+    int maxKb = 512;
+    std::string cascade = "haarcascade_russian_plate_number.xml";
+    int cameraPort = 18180;
+    int ocrPort = 15180;
+    bool verbose = false;
+};
+
+double rssMb()
+{
+    std::ifstream statm("/proc/self/statm");
+    long pages = 0, resident = 0;
+    statm >> pages >> resident;
+    return resident * static_cast<double>(sysconf(_SC_PAGESIZE)) / (1024.0 * 1024.0);
+}
+
+// Счетчики в момент времени: выделения по потокам, кадры и промахи пулов
+struct Counters
+{
+    uint64_t allocations[RoleCount] = {};
+    uint64_t bytes[RoleCount] = {};
+    uint64_t processed = 0;
+    uint64_t captured = 0;
+    uint64_t submitted = 0;
+    uint64_t misses = 0;
+
+    static Counters take(NumberPlateRecognizer &recognizer, const AsyncOCRClient &client,
+                         uint64_t processed)
+    {
+        Counters c;
+        for (int r = 0; r < RoleCount; ++r) {
+            c.allocations[r] = ::allocations[r].load(std::memory_order_relaxed);
+            c.bytes[r] = allocatedBytes[r].load(std::memory_order_relaxed);
+        }
+        const StreamStats &stats = recognizer.stats();
+        c.processed = processed;
+        c.captured = stats.framesCaptured.load(std::memory_order_relaxed);
+        c.submitted = stats.framesSubmitted.load(std::memory_order_relaxed);
+        c.misses = stats.bufferPoolMisses.load(std::memory_order_relaxed)
+                   + client.encodePoolMisses();
+        return c;
+    }
+};
+
+bool parseArgs(int argc, char *argv[], AllocConfig &config)
+{
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--verbose")) {
+            config.verbose = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Invalid option " << argv[i] << std::endl;
+            return false;
+        }
+        const char *value = argv[++i];
+        int *number = nullptr;
+        if (!std::strcmp(argv[i - 1], "--cascade")) {
+            config.cascade = value;
+            continue;
+        } else if (!std::strcmp(argv[i - 1], "--frames")) {
+            number = &config.frames;
+        } else if (!std::strcmp(argv[i - 1], "--seconds")) {
+            number = &config.seconds;
+        } else if (!std::strcmp(argv[i - 1], "--width")) {
+            number = &config.width;
+        } else if (!std::strcmp(argv[i - 1], "--height")) {
+            number = &config.height;
+        } else if (!std::strcmp(argv[i - 1], "--fps")) {
+            number = &config.fps;
+        } else if (!std::strcmp(argv[i - 1], "--max-allocs")) {
+            number = &config.maxAllocs;
+        } else if (!std::strcmp(argv[i - 1], "--max-kb")) {
+            number = &config.maxKb;
+        } else if (!std::strcmp(argv[i - 1], "--camera-port")) {
+            number = &config.cameraPort;
+        } else if (!std::strcmp(argv[i - 1], "--ocr-port")) {
+            number = &config.ocrPort;
+        }
+        if (!number || std::atoi(value) < 0) {
+            std::cerr << "Invalid option " << argv[i - 1] << std::endl;
+            return false;
+        }
+        *number = std::atoi(value);
+    }
+    return config.frames > 0 && config.width >= 320 && config.height >= 240 && config.fps > 0;
+}
+
+// Выделения одного потока на кадр и проверка бюджета
+bool checkThread(const char *name, const AllocConfig &config, const Counters &begin,
+                 const Counters &end, int role, uint64_t frames)
+{
+    const double perFrame =
+        static_cast<double>(end.allocations[role] - begin.allocations[role]) / frames;
+    const double kbPerFrame = (end.bytes[role] - begin.bytes[role]) / 1024.0 / frames;
+    const bool passed = perFrame <= config.maxAllocs && kbPerFrame <= config.maxKb;
+    std::cout << std::setw(8) << name << ": " << perFrame << " allocs/frame, " << kbPerFrame
+              << " KB/frame over " << frames << " frames" << (passed ? "" : "  OVER BUDGET")
+              << std::endl;
+    return passed;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    AllocConfig config;
+    if (!parseArgs(argc, argv, config)) {
+        return 2;
+    }
+
+    // Потоки OpenCV выделяют свое; полосы и тайлы идут в шаге камеры
+    cv::setNumThreads(1);
+
+    std::unique_ptr<QProcess> camera =
+        startHelper("synthetic_cameras",
+                    {"--port", QString::number(config.cameraPort), "--cameras", "1", "--width",
+                     QString::number(config.width), "--height", QString::number(config.height),
+                     "--fps", QString::number(config.fps)},
+                    config.verbose);
+    std::unique_ptr<QProcess> ocrServer =
+        startHelper("stub_ocr_server",
+                    {"--port", QString::number(config.ocrPort), "--latency", "fixed:5"},
+                    config.verbose);
+    auto stopHelpers = [&]() {
+        stopHelper(camera.get());
+        stopHelper(ocrServer.get());
+    };
+    if (!camera || !ocrServer || !waitForPort(config.cameraPort, kStartTimeoutMs)
+        || !waitForPort(config.ocrPort, kStartTimeoutMs)) {
+        std::cerr << "Alloc test helpers did not start" << std::endl;
+        stopHelpers();
+        return 2;
+    }
+
+    PlateDetector detector;
+    if (!detector.load(config.cascade)) {
+        std::cerr << "Cannot load cascade " << config.cascade << std::endl;
+        stopHelpers();
+        return 2;
+    }
+
+    // Клиент в своем сетевом потоке, как в StreamEngine
+    OcrClientConfig ocrConfig;
+    ocrConfig.serviceUrl = QString("http://127.0.0.1:%1/recognize").arg(config.ocrPort);
+    QThread networkThread;
+    AsyncOCRClient *client = new AsyncOCRClient(ocrConfig);
+    client->moveToThread(&networkThread);
+    QObject::connect(&networkThread, &QThread::finished, client, &QObject::deleteLater);
+    networkThread.start();
+
+    // Каждый кадр - на распознавание: детектор, вырезки с выравниванием, JPEG
+    StreamConfig stream;
+    stream.url = QString("http://127.0.0.1:%1/video/0").arg(config.cameraPort);
+    stream.ocrIntervalMs = 0;
+    stream.gateMode = GateMode::On;
+    stream.deskew = true;
+    NumberPlateRecognizer recognizer(stream, &detector, nullptr, client);
+    QObject::connect(
+        client, &AsyncOCRClient::plateRecognized, client,
+        [&recognizer](const OcrResult &result) { recognizer.onOCRResultReceived(result); },
+        Qt::DirectConnection);
+
+    std::atomic<bool> finished{false};
+    recognizer.startProcessing([]() { threadRole = CaptureThread; },
+                               [&finished]() { finished = true; });
+
+    // Шаг камеры - в этом потоке, по одному свежему кадру
+    threadRole = StepThread;
+    uint64_t processed = 0;
+    auto step = [&]() {
+        if (recognizer.processLatest()) {
+            ++processed;
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+
+    const auto warmupUntil = Clock::now() + std::chrono::milliseconds(kStartTimeoutMs);
+    while (processed < kWarmupFrames && !finished && Clock::now() < warmupUntil) {
+        step();
+    }
+    if (processed < kWarmupFrames) {
+        std::cerr << "Camera delivered " << processed << " frames, alloc test did not run"
+                  << std::endl;
+        recognizer.stopProcessing();
+        networkThread.quit();
+        networkThread.wait();
+        stopHelpers();
+        return 2;
+    }
+
+    const Counters begin = Counters::take(recognizer, *client, processed);
+    const double rssStart = rssMb();
+    const auto start = Clock::now();
+    auto nextReport = start + std::chrono::minutes(1);
+    while (!finished) {
+        if (config.seconds > 0 ? Clock::now() - start >= std::chrono::seconds(config.seconds)
+                               : processed - begin.processed >= uint64_t(config.frames)) {
+            break;
+        }
+        step();
+        if (config.seconds > 0 && Clock::now() >= nextReport) {
+            nextReport += std::chrono::minutes(1);
+            const auto minutes =
+                std::chrono::duration_cast<std::chrono::minutes>(Clock::now() - start).count();
+            std::cout << "  " << minutes << " min: " << processed - begin.processed
+                      << " frames, RSS " << rssMb() << " MB" << std::endl;
+        }
+    }
+    const Counters end = Counters::take(recognizer, *client, processed);
+    const double rssEnd = rssMb();
+
+    threadRole = OtherThread;
+    recognizer.stopProcessing();
+    networkThread.quit();
+    networkThread.wait();
+    stopHelpers();
+
+    const uint64_t frames = end.processed - begin.processed;
+    const uint64_t captured = end.captured - begin.captured;
+    if (finished || frames == 0 || captured == 0) {
+        std::cerr << "Camera stopped during the alloc test" << std::endl;
+        return 2;
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Frame " << config.width << "x" << config.height << ", " << frames
+              << " frames processed, " << captured << " captured, "
+              << end.submitted - begin.submitted << " crops sent, RSS " << rssStart << " -> "
+              << rssEnd << " MB" << std::endl;
+    std::cout << "budget: " << config.maxAllocs << " allocs, " << config.maxKb
+              << " KB per frame" << std::endl;
+    bool passed = checkThread("step", config, begin, end, StepThread, frames);
+    passed = checkThread("capture", config, begin, end, CaptureThread, captured) && passed;
+    const uint64_t misses = end.misses - begin.misses;
+    std::cout << "pool misses after warmup: " << misses << std::endl;
+    passed = passed && misses == 0;
+
+    std::cout << (passed ? "PASS" : "FAIL") << std::endl;
+    return passed ? 0 : 1;
+}
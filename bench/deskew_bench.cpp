@@ -0,0 +1,138 @@
+// Сравнение PlateDeskew с прежним correct_skew (полный поворот на каждый угол)
+// по точности и времени на синтетических номерах с известным наклоном.
+//
+//   deskew_bench [--plates N] [--width px] [--seed N]
+//
+// Прежний метод получает готовую бинаризованную вырезку, PlateDeskew - серую
+// и бинаризует ее сам (это входит в его время). Ошибка - разница между
+// найденным углом и углом, который исправляет наклон.
+
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "plate_deskew.h"
+#include "synthetic_plates.h"
+
+using Clock = std::chrono::steady_clock;
+
+// Прежняя реализация NumberPlateRecognizer::correct_skew без финального поворота
+static double referenceSkew(const cv::Mat &image, double delta = 1.0, int limit = 5)
+{
+    auto determine_score = [](const cv::Mat &arr, double angle) -> double {
+        cv::Point2f center(arr.cols / 2.0f, arr.rows / 2.0f);
+        cv::Mat rotation_matrix = cv::getRotationMatrix2D(center, angle, 1.0);
+
+        cv::Mat data;
+        cv::warpAffine(arr, data, rotation_matrix, arr.size(), cv::INTER_NEAREST,
+                       cv::BORDER_CONSTANT, cv::Scalar(0));
+
+        cv::Mat histogram;
+        cv::reduce(data, histogram, 1, cv::REDUCE_SUM, CV_64F);
+
+        double score = 0.0;
+        for (int i = 1; i < histogram.rows; i++) {
+            double diff = histogram.at<double>(i) - histogram.at<double>(i - 1);
+            score += diff * diff;
+        }
+        return score;
+    };
+
+    double bestAngle = 0.0;
+    double bestScore = -1.0;
+    for (double angle = -limit; angle <= limit + delta; angle += delta) {
+        double score = determine_score(image, angle);
+        if (score > bestScore) {
+            bestScore = score;
+            bestAngle = angle;
+        }
+    }
+    return bestAngle;
+}
+
+struct MethodStats
+{
+    std::vector<double> errors;
+    double totalUs = 0.0;
+
+    void print(const char *name) const
+    {
+        std::vector<double> sorted = errors;
+        std::sort(sorted.begin(), sorted.end());
+        double mean = 0.0;
+        for (double e : sorted) {
+            mean += e;
+        }
+        mean /= sorted.size();
+        std::cout << std::setw(10) << name << ": " << totalUs / errors.size()
+                  << " us/plate, error mean " << mean << " deg, p95 "
+                  << sorted[sorted.size() * 95 / 100] << " deg, max " << sorted.back() << " deg"
+                  << std::endl;
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    int plates = 300;
+    int width = 160;
+    uint64 seed = 12345;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--plates")) {
+            plates = std::max(1, std::atoi(argv[i + 1]));
+        } else if (!std::strcmp(argv[i], "--width")) {
+            width = std::max(32, std::atoi(argv[i + 1]));
+        } else if (!std::strcmp(argv[i], "--seed")) {
+            seed = std::strtoull(argv[i + 1], nullptr, 10);
+        }
+    }
+
+    // Дает однопоточное время: сравниваются алгоритмы, а не распараллеливание OpenCV
+    cv::setNumThreads(1);
+    cv::RNG rng(seed);
+
+    std::vector<cv::Mat> grays;
+    std::vector<cv::Mat> binaries;
+    std::vector<double> tilts;
+    for (int i = 0; i < plates; ++i) {
+        const std::string text = makePlateText(rng, false);
+        double tilt = rng.uniform(-4.5, 4.5);
+
+        cv::Mat gray, binary;
+        cv::cvtColor(makePlateCrop(text, tilt, width, rng), gray, cv::COLOR_BGR2GRAY);
+        cv::threshold(gray, binary, 0, 255, cv::THRESH_BINARY_INV | cv::THRESH_OTSU);
+        grays.push_back(gray);
+        binaries.push_back(binary);
+        tilts.push_back(tilt);
+    }
+
+    // Наклон tilt исправляется поворотом на -tilt
+    MethodStats reference, fast;
+    PlateDeskew deskew;
+    for (int i = 0; i < plates; ++i) {
+        auto start = Clock::now();
+        double angle = referenceSkew(binaries[i]);
+        reference.totalUs += std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        reference.errors.push_back(std::abs(angle + tilts[i]));
+
+        start = Clock::now();
+        angle = deskew.estimateAngle(grays[i]);
+        fast.totalUs += std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        fast.errors.push_back(std::abs(angle + tilts[i]));
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Plates: " << plates << ", width " << width << " px, tilt within +-4.5 deg"
+              << std::endl;
+    reference.print("reference");
+    fast.print("deskew");
+    std::cout << "speedup: " << reference.totalUs / fast.totalUs << "x" << std::endl;
+    return 0;
+}
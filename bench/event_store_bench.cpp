@@ -0,0 +1,218 @@
+// Хранилище событий PlateEventStore: скорость записи и задержка поиска на
+// большом архиве.
+//
+//   event_store_bench [--events N] [--plates N] [--cameras N] [--days N]
+//                     [--queries N] [--segment N] [--dir path] [--keep]
+//
+// Пишется --events синтетических событий (по умолчанию 10 млн; архив из
+// требования - --events 100000000, это 6.4 ГБ записей плюс индексы),
+// равномерно за --days дней по --cameras камерам. Разных номеров --plates,
+// часть машин приезжает много чаще остальных, как постоянные у шлагбаума.
+// Вырезки не пишутся: это один pwrite JPEG на событие, от размера архива он
+// не зависит. Затем каталог открывается заново (индексы закрытых сегментов
+// с диска, текущий собирается по записям) и меряются запросы за весь период:
+// точный номер, префикс, фрагмент, час по времени и номер на одной камере.
+
+#include <QDir>
+#include <QString>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "plate_event_store.h"
+#include "synthetic_plates.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+// Номер машины: квадрат равномерного числа - первые номера встречаются чаще
+size_t pickPlate(std::mt19937_64 &rng, size_t plates)
+{
+    const double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+    return std::min(plates - 1, static_cast<size_t>(u * u * plates));
+}
+
+double directoryGb(const std::string &path)
+{
+    uintmax_t bytes = 0;
+    for (const auto &entry : std::filesystem::directory_iterator(path)) {
+        bytes += entry.file_size();
+    }
+    return bytes / (1024.0 * 1024.0 * 1024.0);
+}
+
+struct Latency
+{
+    std::vector<double> ms;
+    uint64_t results = 0;
+
+    void print(const char *name)
+    {
+        std::sort(ms.begin(), ms.end());
+        auto at = [&](double q) { return ms[std::min(ms.size() - 1, size_t(q * ms.size()))]; };
+        std::cout << std::setw(10) << name << ": p50 " << at(0.5) << " ms, p99 " << at(0.99)
+                  << " ms, max " << ms.back() << " ms, " << double(results) / ms.size()
+                  << " events/query\n";
+    }
+};
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    uint64_t events = 10000000;
+    size_t plates = 0; // 0 - events / 20
+    int cameras = 16;
+    int days = 30;
+    int queries = 200;
+    uint32_t segment = 1 << 20;
+    std::string dir = QDir::tempPath().toStdString() + "/lpr_event_store_bench";
+    bool keep = false;
+    for (int i = 1; i < argc; ++i) {
+        const bool hasValue = i + 1 < argc;
+        if (!std::strcmp(argv[i], "--keep")) {
+            keep = true;
+        } else if (!std::strcmp(argv[i], "--events") && hasValue) {
+            events = std::max(1LL, std::atoll(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--plates") && hasValue) {
+            plates = std::max(1LL, std::atoll(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--cameras") && hasValue) {
+            cameras = std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--days") && hasValue) {
+            days = std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--queries") && hasValue) {
+            queries = std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--segment") && hasValue) {
+            segment = static_cast<uint32_t>(std::max(1024, std::atoi(argv[++i])));
+        } else if (!std::strcmp(argv[i], "--dir") && hasValue) {
+            dir = argv[++i];
+        }
+    }
+    if (plates == 0) {
+        plates = std::max<uint64_t>(1, events / 20);
+    }
+
+    std::filesystem::remove_all(dir);
+
+    std::mt19937_64 rng(12345);
+    std::vector<std::string> plateTexts(plates);
+    for (std::string &plate : plateTexts) {
+        plate = makePlateText(rng);
+    }
+
+    PlateEventStoreConfig config;
+    config.directory = QString::fromStdString(dir);
+    config.segmentEvents = segment;
+    config.retentionDays = 0;
+    config.storeCrops = false;
+
+    const int64_t nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                              std::chrono::system_clock::now().time_since_epoch())
+                              .count();
+    const int64_t spanMs = static_cast<int64_t>(days) * 86400000;
+    const int64_t startMs = nowMs - spanMs;
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Events " << events << ", plates " << plates << ", cameras " << cameras
+              << ", " << days << " days, segment " << segment << " events, " << dir << std::endl;
+
+    // Запись
+    {
+        PlateEventStore store(config);
+        QString error;
+        if (!store.open(error)) {
+            std::cerr << error.toStdString() << std::endl;
+            return 1;
+        }
+
+        uint64_t queueFull = 0;
+        const auto start = Clock::now();
+        for (uint64_t i = 0; i < events; ++i) {
+            PlateEventRecord record;
+            record.seenMs = startMs + static_cast<int64_t>(i * spanMs / events);
+            record.firstSeenMs = record.seenMs - 2000;
+            record.streamId = static_cast<uint16_t>(rng() % cameras);
+            record.confidence = 0.9f;
+            record.observations = 4;
+            PlateEventStore::setPlate(record, plateTexts[pickPlate(rng, plates)]);
+            // Бенчмарк не теряет события: при полной очереди ждем поток записи
+            while (!store.append(record)) {
+                ++queueFull;
+                std::this_thread::yield();
+            }
+        }
+        store.flush();
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << "ingest: " << events / seconds / 1e6 << " M events/s (" << seconds
+                  << " s), queue full " << queueFull << " times, segments "
+                  << store.segmentCount() << ", on disk " << directoryGb(dir) << " GB"
+                  << std::endl;
+    }
+
+    // Поиск по открытому заново каталогу
+    PlateEventStore store(config);
+    QString error;
+    const auto openStart = Clock::now();
+    if (!store.open(error)) {
+        std::cerr << error.toStdString() << std::endl;
+        return 1;
+    }
+    std::cout << "open: " << std::chrono::duration<double>(Clock::now() - openStart).count()
+              << " s" << std::endl;
+
+    Latency exact, prefix, contains, hour, camera;
+    auto measure = [&](Latency &latency, const PlateQuery &query) {
+        const auto start = Clock::now();
+        latency.results += store.find(query).size();
+        latency.ms.push_back(
+            std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    };
+    for (int q = 0; q < queries; ++q) {
+        const std::string &plate = plateTexts[pickPlate(rng, plates)];
+
+        PlateQuery query;
+        query.limit = 100;
+        query.plate = QString::fromStdString(plate);
+        measure(exact, query);
+
+        query.streamId = static_cast<int>(rng() % cameras);
+        measure(camera, query);
+        query.streamId = -1;
+
+        // Буква и три цифры; фрагмент - цифры и две буквы после них
+        query.match = PlateMatch::Prefix;
+        query.plate = QString::fromStdString(plate).left(4);
+        measure(prefix, query);
+
+        query.match = PlateMatch::Contains;
+        query.plate = QString::fromStdString(plate).mid(1, 5);
+        measure(contains, query);
+
+        query.plate.clear();
+        query.limit = 1000;
+        query.fromMs = startMs + static_cast<int64_t>(rng() % (spanMs - 3600000));
+        query.toMs = query.fromMs + 3600000;
+        measure(hour, query);
+    }
+
+    std::cout << "queries over " << days << " days (" << queries << " each):\n";
+    exact.print("exact");
+    camera.print("camera");
+    prefix.print("prefix");
+    contains.print("contains");
+    hour.print("hour");
+
+    if (!keep) {
+        store.close();
+        std::filesystem::remove_all(dir);
+    }
+    return 0;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+// Вспомогательные процессы тестов (synthetic_cameras, stub_ocr_server): лежат
+// в каталоге сборки рядом с тестом, запускаются и останавливаются им самим.
+
+#include <QCoreApplication>
+#include <QProcess>
+#include <QStringList>
+#include <QTcpSocket>
+#include <QThread>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+
+// Ждет, пока процесс начнет слушать порт на 127.0.0.1
+inline bool waitForPort(int port, int timeoutMs)
+{
+    const auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (std::chrono::steady_clock::now() < until) {
+        QTcpSocket socket;
+        socket.connectToHost("127.0.0.1", static_cast<quint16>(port));
+        if (socket.waitForConnected(200)) {
+            return true;
+        }
+        QThread::msleep(100);
+    }
+    return false;
+}
+
+inline std::unique_ptr<QProcess> startHelper(const QString &name, const QStringList &args,
+                                             bool verbose)
+{
+    auto process = std::make_unique<QProcess>();
+    process->setProcessChannelMode(verbose ? QProcess::ForwardedChannels
+                                           : QProcess::ForwardedErrorChannel);
+    process->start(QCoreApplication::applicationDirPath() + "/" + name, args);
+    if (!process->waitForStarted(5000)) {
+        std::cerr << "Cannot start " << name.toStdString() << ": "
+                  << process->errorString().toStdString() << std::endl;
+        return nullptr;
+    }
+    return process;
+}
+
+inline void stopHelper(QProcess *process)
+{
+    if (process && process->state() != QProcess::NotRunning) {
+        process->terminate();
+        if (!process->waitForFinished(3000)) {
+            process->kill();
+            process->waitForFinished(1000);
+        }
+    }
+}
@@ -0,0 +1,672 @@
+// Микробенчмарки покадровых ядер конвейера: детектор номеров, выравнивание
+// наклона, увеличение вырезки, вырезка ROI со сжатием в JPEG, сборка запросов
+// и разбор ответов OCR-сервера. Каждый случай гоняется на 1..N потоках
+// одновременно (у потока свое состояние, общие объекты - как в движке).
+//
+//   kernel_bench [--kernels detect,deskew,enlarge,encode,ocr_request,ocr_reply]
+//                [--threads 1,4] [--cv-threads 1] [--min-time 0.5]
+//                [--cascade haarcascade_russian_plate_number.xml] [--images dir]
+//                [--seed 12345] [--label rev] [--output result.json|result.csv]
+//                [--compare previous.json] [--tolerance 0.10]
+//
+// Входные данные детерминированы: синтетические кадры (дорога, машины с
+// номерами) и вырезки с известным наклоном из фиксированного seed, поэтому
+// результаты разных коммитов на одной машине сравнимы. --images подменяет
+// синтетические кадры снимками из каталога (приводятся к размерам случаев).
+// --cv-threads 1 по умолчанию: внутренняя параллельность OpenCV не смешивается
+// с потоками бенчмарка.
+//
+// --compare сравнивает p50 с JSON прошлого прогона; код возврата 1 - какой-то
+// случай медленнее больше чем на tolerance или случай прошлого прогона (тех же
+// ядер и чисел потоков) не найден в этом, 2 - ошибка запуска или файл для
+// сравнения не JSON kernel_bench (CSV, обрезан, нет results).
+
+#include <opencv2/opencv.hpp>
+
+#include <QFile>
+#include <QHash>
+#include <QHttpMultiPart>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "NumberPlateRecognizer.h"
+#include "async_ocr_client.h"
+#include "buffer_pool.h"
+#include "plate_deskew.h"
+#include "plate_detector.h"
+#include "synthetic_plates.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+struct BenchConfig
+{
+    std::vector<std::string> kernels;
+    std::vector<int> threads;
+    int cvThreads = 1;
+    double minTime = 0.5;
+    std::string cascade = "haarcascade_russian_plate_number.xml";
+    std::string images;
+    uint64 seed = 12345;
+    std::string label;
+    std::string output;
+    std::string compare;
+    double tolerance = 0.10;
+};
+
+// Один вызов ядра; создается на каждый поток, входы перебираются по кругу
+using Worker = std::function<void()>;
+
+struct Case
+{
+    std::string kernel;
+    std::string name;
+    std::function<Worker()> makeWorker;
+};
+
+struct Row
+{
+    std::string kernel;
+    std::string name;
+    int threads = 1;
+    uint64_t calls = 0;
+    double meanUs = 0.0;
+    double p50Us = 0.0;
+    double p99Us = 0.0;
+    double callsPerSecond = 0.0;
+};
+
+// Кадр 1920x1080: асфальт с шумом, разметка и две-три машины с номерами
+cv::Mat makeFrame(cv::RNG &rng)
+{
+    const int w = 1920;
+    const int h = 1080;
+    cv::Mat frame(h, w, CV_8UC3, cv::Scalar(90, 90, 90));
+    cv::Mat noise(h, w, CV_8UC3);
+    rng.fill(noise, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(30));
+    frame += noise;
+    for (int x = w / 3; x < w; x += w / 3) {
+        for (int y = 0; y < h; y += h / 8) {
+            cv::rectangle(frame, cv::Rect(x - 4, y, 8, h / 16), cv::Scalar(230, 230, 230), -1);
+        }
+    }
+
+    const int cars = rng.uniform(2, 4);
+    for (int lane = 0; lane < cars; ++lane) {
+        const int carW = w / 5;
+        const int carH = h / 3;
+        const int x = lane * w / 3 + (w / 3 - carW) / 2;
+        const int y = rng.uniform(0, h - carH);
+        const cv::Scalar color(rng.uniform(30, 200), rng.uniform(30, 200), rng.uniform(30, 200));
+        cv::rectangle(frame, cv::Rect(x, y, carW, carH), color, -1);
+        const int plateW = carW * 2 / 3;
+        const int plateH = plateW * 112 / 520;
+        const cv::Rect plate(x + (carW - plateW) / 2, y + carH - plateH * 2, plateW, plateH);
+        drawPlate(frame, plate, makePlateText(rng, false));
+    }
+    return frame;
+}
+
+std::vector<cv::Mat> resizeAll(const std::vector<cv::Mat> &frames, const cv::Size &size)
+{
+    std::vector<cv::Mat> resized(frames.size());
+    for (size_t i = 0; i < frames.size(); ++i) {
+        cv::resize(frames[i], resized[i], size, 0, 0, cv::INTER_AREA);
+    }
+    return resized;
+}
+
+// Ответ сервера на одно изображение: {"plates": [...]}
+QJsonArray makePlates(int count, cv::RNG &rng)
+{
+    QJsonArray plates;
+    for (int i = 0; i < count; ++i) {
+        QJsonObject plate;
+        plate["text"] = QString::fromStdString(makePlateText(rng, false));
+        plate["confidence"] = rng.uniform(0.5, 1.0);
+        QJsonArray box;
+        for (int k = 0; k < 4; ++k) {
+            box.append(rng.uniform(0, 1000));
+        }
+        plate["box"] = box;
+        plates.append(plate);
+    }
+    return plates;
+}
+
+QByteArray makeReply(int plates, cv::RNG &rng)
+{
+    QJsonObject reply;
+    reply["plates"] = makePlates(plates, rng);
+    return QJsonDocument(reply).toJson(QJsonDocument::Compact);
+}
+
+QByteArray makeBatchReply(int images, cv::RNG &rng)
+{
+    QJsonArray results;
+    for (int i = 0; i < images; ++i) {
+        QJsonObject item;
+        item["id"] = QString::number(i);
+        item["plates"] = makePlates(i % 4 == 3 ? 0 : 1, rng);
+        results.append(item);
+    }
+    QJsonObject reply;
+    reply["results"] = results;
+    return QJsonDocument(reply).toJson(QJsonDocument::Compact);
+}
+
+// Не дает компилятору выбросить вызов: адрес результата уходит в пустую
+// asm-вставку, которая для компилятора читает и пишет всю память. Временный
+// результат (keep(f(x))) живет до конца выражения, то есть и внутри keep
+template <typename T>
+void keep(const T &value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+std::vector<Case> makeCases(const BenchConfig &config, const std::vector<cv::Mat> &frames)
+{
+    std::vector<Case> cases;
+    cv::RNG rng(config.seed);
+    auto wanted = [&](const char *kernel) {
+        return config.kernels.empty()
+               || std::find(config.kernels.begin(), config.kernels.end(), kernel)
+                      != config.kernels.end();
+    };
+
+    // Детектор: размеры кадра x параметры detectMultiScale. Детектор общий
+    // для потоков, как в движке (каскады берутся из его пула)
+    PlateDetector probe;
+    if (wanted("detect") && !probe.load(config.cascade)) {
+        std::cerr << "Cannot load cascade " << config.cascade << ", detect skipped" << std::endl;
+    } else if (wanted("detect")) {
+        const cv::Size sizes[] = {{640, 360}, {1280, 720}, {1920, 1080}};
+        const double scaleFactors[] = {1.05, 1.1, 1.2};
+        const int neighbors[] = {3, 10};
+        for (const cv::Size &size : sizes) {
+            auto images = std::make_shared<std::vector<cv::Mat>>(resizeAll(frames, size));
+            for (double scaleFactor : scaleFactors) {
+                for (int minNeighbors : neighbors) {
+                    PlateDetectorConfig detectorConfig;
+                    detectorConfig.scaleFactor = scaleFactor;
+                    detectorConfig.minNeighbors = minNeighbors;
+                    auto detector = std::make_shared<PlateDetector>();
+                    detector->load(config.cascade, detectorConfig);
+                    std::ostringstream name;
+                    name << size.width << "x" << size.height << " sf=" << scaleFactor
+                         << " mn=" << minNeighbors;
+                    cases.push_back({"detect", name.str(), [images, detector]() -> Worker {
+                                         auto next = std::make_shared<size_t>(0);
+                                         return [images, detector, next]() {
+                                             keep(detector->detect(
+                                                 (*images)[(*next)++ % images->size()]));
+                                         };
+                                     }});
+                }
+            }
+        }
+    }
+
+    // Выравнивание наклона: вырезки 160 px с наклоном из диапазона, PlateDeskew
+    // у каждого потока свой (у него рабочие буферы)
+    if (wanted("deskew")) {
+        const double ranges[][2] = {{0.0, 1.0}, {1.0, 3.0}, {3.0, 5.0}};
+        for (const auto &range : ranges) {
+            auto crops = std::make_shared<std::vector<cv::Mat>>();
+            for (int i = 0; i < 32; ++i) {
+                const double tilt = rng.uniform(range[0], range[1]);
+                const std::string text = makePlateText(rng, false);
+                crops->push_back(makePlateCrop(text, i % 2 ? tilt : -tilt, 160, rng));
+            }
+            std::ostringstream name;
+            name << "160px |a| " << range[0] << "-" << range[1];
+            cases.push_back({"deskew", name.str(), [crops]() -> Worker {
+                                 auto deskew = std::make_shared<PlateDeskew>();
+                                 auto corrected = std::make_shared<cv::Mat>();
+                                 auto next = std::make_shared<size_t>(0);
+                                 return [crops, deskew, corrected, next]() {
+                                     deskew->apply((*crops)[(*next)++ % crops->size()],
+                                                   *corrected);
+                                 };
+                             }});
+        }
+    }
+
+    if (wanted("enlarge")) {
+        auto crops = std::make_shared<std::vector<cv::Mat>>();
+        for (int i = 0; i < 32; ++i) {
+            crops->push_back(makePlateCrop(makePlateText(rng, false), 0.0, 120, rng));
+        }
+        for (int percent : {150, 200, 300}) {
+            cases.push_back({"enlarge", "120px x" + std::to_string(percent) + "%",
+                             [crops, percent]() -> Worker {
+                                 auto next = std::make_shared<size_t>(0);
+                                 return [crops, percent, next]() {
+                                     keep(NumberPlateRecognizer::enlarge_img(
+                                         (*crops)[(*next)++ % crops->size()], percent));
+                                 };
+                             }});
+        }
+    }
+
+    // Вырезка ROI из кадра 1280x720 (вид без копии, как в движке) и сжатие в
+    // буфер общего пула
+    if (wanted("encode")) {
+        auto images = std::make_shared<std::vector<cv::Mat>>(resizeAll(frames, {1280, 720}));
+        const cv::Rect rois[] = {{560, 500, 160, 40}, {320, 180, 640, 360}, {0, 0, 1280, 720}};
+        for (const cv::Rect &roi : rois) {
+            for (int quality : {50, 70, 90}) {
+                auto pool = std::make_shared<BufferPool<QByteArray>>(64);
+                std::ostringstream name;
+                name << roi.width << "x" << roi.height << " q" << quality;
+                cases.push_back({"encode", name.str(), [images, pool, roi, quality]() -> Worker {
+                                     auto next = std::make_shared<size_t>(0);
+                                     return [images, pool, roi, quality, next]() {
+                                         const cv::Mat &frame =
+                                             (*images)[(*next)++ % images->size()];
+                                         keep(encodeJpeg(frame(roi), quality, *pool));
+                                     };
+                                 }});
+            }
+        }
+    }
+
+    // Сборка запросов: одиночный (сжатие идет в encode) и пакет /recognize_batch
+    // из уже сжатых вырезок или из несжатых, которые сжимаются при сборке
+    if (wanted("ocr_request")) {
+        auto pool = std::make_shared<BufferPool<QByteArray>>(64);
+        auto crops = std::make_shared<std::vector<OcrImage>>();
+        for (int i = 0; i < 16; ++i) {
+            OcrImage image;
+            image.request.kind = OcrRequestKind::PlateCrop;
+            image.image = makePlateCrop(makePlateText(rng, false), 0.0, 160, rng);
+            crops->push_back(image);
+        }
+        auto encoded = std::make_shared<std::vector<OcrImage>>(*crops);
+        for (OcrImage &image : *encoded) {
+            image.jpeg = encodeJpeg(image.image, image.request.jpegQuality, *pool);
+            image.image.release();
+        }
+
+        cases.push_back({"ocr_request", "single", []() -> Worker {
+                             return []() {
+                                 keep(AsyncOCRClient::singleRequest(
+                                     "http://127.0.0.1:5000/recognize",
+                                     OcrRequestKind::PlateCrop));
+                             };
+                         }});
+        auto batch = [pool](std::shared_ptr<std::vector<OcrImage>> images, int size) {
+            return [pool, images, size]() -> Worker {
+                return [pool, images, size]() {
+                    QHttpMultiPart multiPart(QHttpMultiPart::FormDataType);
+                    for (int i = 0; i < size; ++i) {
+                        multiPart.append(AsyncOCRClient::batchPart(
+                            i, (*images)[i % images->size()], *pool));
+                    }
+                };
+            };
+        };
+        cases.push_back({"ocr_request", "batch8 jpeg", batch(encoded, 8)});
+        cases.push_back({"ocr_request", "batch8 raw", batch(crops, 8)});
+    }
+
+    // Разбор ответов: одиночный без номера и с номером, пакеты, Server-Timing
+    if (wanted("ocr_reply")) {
+        auto reply = [](QByteArray body) {
+            return [body]() -> Worker {
+                return [body]() {
+                    OcrResult result;
+                    AsyncOCRClient::parseReply(body, result);
+                    keep(result);
+                };
+            };
+        };
+        cases.push_back({"ocr_reply", "single empty", reply(makeReply(0, rng))});
+        cases.push_back({"ocr_reply", "single plate", reply(makeReply(1, rng))});
+        for (int size : {8, 16}) {
+            const QByteArray body = makeBatchReply(size, rng);
+            cases.push_back({"ocr_reply", "batch" + std::to_string(size), [body]() -> Worker {
+                                 return [body]() {
+                                     keep(AsyncOCRClient::parseBatchReply(body));
+                                 };
+                             }});
+        }
+        cases.push_back({"ocr_reply", "server-timing", []() -> Worker {
+                             return []() {
+                                 keep(AsyncOCRClient::parseServerTiming(
+                                     "inference;dur=12.345, queue;dur=0.8"));
+                             };
+                         }});
+    }
+    return cases;
+}
+
+// Все потоки стартуют вместе и вызывают ядро, пока не пройдет minTime
+Row runCase(const Case &benchCase, int threads, double minTime)
+{
+    std::vector<Worker> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.push_back(benchCase.makeWorker());
+    }
+    // Прогрев: пулы буферов и каскадов заполняются до замеров
+    for (Worker &worker : workers) {
+        worker();
+    }
+
+    std::vector<std::vector<double>> samples(threads);
+    std::vector<double> elapsed(threads, 0.0);
+    std::atomic<int> ready{0};
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t]() {
+            ready.fetch_add(1);
+            while (ready.load() < threads) {
+                std::this_thread::yield();
+            }
+            const auto begin = Clock::now();
+            auto now = begin;
+            do {
+                const auto start = Clock::now();
+                workers[t]();
+                now = Clock::now();
+                samples[t].push_back(std::chrono::duration<double, std::micro>(now - start)
+                                         .count());
+            } while (std::chrono::duration<double>(now - begin).count() < minTime
+                     || samples[t].size() < 3);
+            elapsed[t] = std::chrono::duration<double>(now - begin).count();
+        });
+    }
+    for (std::thread &thread : pool) {
+        thread.join();
+    }
+
+    std::vector<double> all;
+    for (const std::vector<double> &thread : samples) {
+        all.insert(all.end(), thread.begin(), thread.end());
+    }
+    std::sort(all.begin(), all.end());
+    double sum = 0.0;
+    for (double us : all) {
+        sum += us;
+    }
+
+    Row row;
+    row.kernel = benchCase.kernel;
+    row.name = benchCase.name;
+    row.threads = threads;
+    row.calls = all.size();
+    row.meanUs = sum / all.size();
+    row.p50Us = all[all.size() / 2];
+    row.p99Us = all[std::min(all.size() - 1, all.size() * 99 / 100)];
+    row.callsPerSecond = all.size() / *std::max_element(elapsed.begin(), elapsed.end());
+    return row;
+}
+
+std::string cpuModel()
+{
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        if (line.compare(0, 10, "model name") == 0) {
+            const size_t colon = line.find(':');
+            return colon == std::string::npos ? line : line.substr(colon + 2);
+        }
+    }
+    return "unknown";
+}
+
+QString rowKey(const QString &kernel, const QString &name, int threads)
+{
+    return kernel + "/" + name + "/" + QString::number(threads);
+}
+
+bool writeOutput(const BenchConfig &config, const std::vector<Row> &rows)
+{
+    const bool csv = config.output.size() > 4
+                     && config.output.compare(config.output.size() - 4, 4, ".csv") == 0;
+    QByteArray data;
+    if (csv) {
+        data = "kernel,case,threads,calls,mean_us,p50_us,p99_us,calls_per_s\n";
+        for (const Row &row : rows) {
+            std::ostringstream line;
+            line << row.kernel << ",\"" << row.name << "\"," << row.threads << "," << row.calls
+                 << "," << row.meanUs << "," << row.p50Us << "," << row.p99Us << ","
+                 << row.callsPerSecond << "\n";
+            data += QByteArray::fromStdString(line.str());
+        }
+    } else {
+        QJsonObject meta;
+        meta["label"] = QString::fromStdString(config.label);
+        meta["cpu"] = QString::fromStdString(cpuModel());
+        meta["cores"] = static_cast<int>(std::thread::hardware_concurrency());
+        meta["opencv"] = CV_VERSION;
+        meta["cv_threads"] = config.cvThreads;
+        meta["seed"] = QString::number(config.seed);
+        meta["min_time"] = config.minTime;
+        QJsonArray results;
+        for (const Row &row : rows) {
+            QJsonObject item;
+            item["kernel"] = QString::fromStdString(row.kernel);
+            item["case"] = QString::fromStdString(row.name);
+            item["threads"] = row.threads;
+            item["calls"] = static_cast<double>(row.calls);
+            item["mean_us"] = row.meanUs;
+            item["p50_us"] = row.p50Us;
+            item["p99_us"] = row.p99Us;
+            item["calls_per_s"] = row.callsPerSecond;
+            results.append(item);
+        }
+        QJsonObject root;
+        root["meta"] = meta;
+        root["results"] = results;
+        data = QJsonDocument(root).toJson(QJsonDocument::Indented);
+    }
+
+    QFile file(QString::fromStdString(config.output));
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size()) {
+        std::cerr << "Cannot write " << config.output << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// 0 - не медленнее прошлого прогона, 1 - есть ухудшения или пропавшие случаи,
+// 2 - файл не читается или в нем нет результатов
+int compareWith(const BenchConfig &config, const std::vector<Row> &rows)
+{
+    QFile file(QString::fromStdString(config.compare));
+    if (!file.open(QIODevice::ReadOnly)) {
+        std::cerr << "Cannot read " << config.compare << std::endl;
+        return 2;
+    }
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll());
+    const QJsonArray previousRows = document.object()["results"].toArray();
+    if (!document.isObject() || previousRows.isEmpty()) {
+        std::cerr << config.compare << " is not a kernel_bench JSON result (--output x.json)"
+                  << std::endl;
+        return 2;
+    }
+    const QJsonObject previous = document.object();
+    const QString cpu = previous["meta"].toObject()["cpu"].toString();
+    if (cpu != QString::fromStdString(cpuModel())) {
+        std::cerr << "Warning: previous run was on " << cpu.toStdString()
+                  << ", timings are not comparable" << std::endl;
+    }
+
+    // Прошлые случаи тех ядер и чисел потоков, что гонялись сейчас
+    QHash<QString, double> p50;
+    for (const QJsonValue &value : previousRows) {
+        const QJsonObject item = value.toObject();
+        const std::string kernel = item["kernel"].toString().toStdString();
+        const int threads = item["threads"].toInt();
+        const bool ran = std::any_of(rows.begin(), rows.end(), [&](const Row &row) {
+            return row.kernel == kernel && row.threads == threads;
+        });
+        if (ran) {
+            p50.insert(rowKey(item["kernel"].toString(), item["case"].toString(), threads),
+                       item["p50_us"].toDouble());
+        }
+    }
+
+    int regressions = 0;
+    for (const Row &row : rows) {
+        const QString key = rowKey(QString::fromStdString(row.kernel),
+                                   QString::fromStdString(row.name), row.threads);
+        const auto it = p50.find(key);
+        if (it == p50.end()) {
+            continue;
+        }
+        const double previousUs = it.value();
+        p50.erase(it);
+        if (previousUs <= 0.0) {
+            continue;
+        }
+        const double change = row.p50Us / previousUs - 1.0;
+        if (change > config.tolerance) {
+            std::cout << "REGRESSION " << key.toStdString() << ": p50 " << previousUs << " -> "
+                      << row.p50Us << " us (+" << change * 100.0 << "%)" << std::endl;
+            regressions++;
+        }
+    }
+
+    // Случай переименован или пропал - сравнить его не с чем, это тоже провал
+    for (auto it = p50.constBegin(); it != p50.constEnd(); ++it) {
+        std::cout << "MISSING " << it.key().toStdString() << ": not in this run" << std::endl;
+    }
+    std::cout << regressions << " regressions, " << p50.size() << " missing against "
+              << config.compare << std::endl;
+    return regressions || !p50.isEmpty() ? 1 : 0;
+}
+
+std::vector<std::string> splitList(const char *list)
+{
+    std::vector<std::string> items;
+    std::istringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    BenchConfig config;
+    const int cores = std::max(1u, std::thread::hardware_concurrency());
+    config.threads = cores > 1 ? std::vector<int>{1, cores} : std::vector<int>{1};
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 >= argc) {
+            std::cerr << "Invalid option " << argv[i] << std::endl;
+            return 2;
+        }
+        const char *value = argv[++i];
+        if (!std::strcmp(argv[i - 1], "--kernels")) {
+            config.kernels = splitList(value);
+        } else if (!std::strcmp(argv[i - 1], "--threads")) {
+            config.threads.clear();
+            for (const std::string &item : splitList(value)) {
+                config.threads.push_back(std::max(1, std::atoi(item.c_str())));
+            }
+        } else if (!std::strcmp(argv[i - 1], "--cv-threads")) {
+            config.cvThreads = std::atoi(value);
+        } else if (!std::strcmp(argv[i - 1], "--min-time")) {
+            config.minTime = std::max(0.01, std::atof(value));
+        } else if (!std::strcmp(argv[i - 1], "--cascade")) {
+            config.cascade = value;
+        } else if (!std::strcmp(argv[i - 1], "--images")) {
+            config.images = value;
+        } else if (!std::strcmp(argv[i - 1], "--seed")) {
+            config.seed = std::strtoull(value, nullptr, 10);
+        } else if (!std::strcmp(argv[i - 1], "--label")) {
+            config.label = value;
+        } else if (!std::strcmp(argv[i - 1], "--output")) {
+            config.output = value;
+        } else if (!std::strcmp(argv[i - 1], "--compare")) {
+            config.compare = value;
+        } else if (!std::strcmp(argv[i - 1], "--tolerance")) {
+            config.tolerance = std::atof(value);
+        } else {
+            std::cerr << "Invalid option " << argv[i - 1] << std::endl;
+            return 2;
+        }
+    }
+    if (config.threads.empty()) {
+        std::cerr << "No thread counts in --threads" << std::endl;
+        return 2;
+    }
+    cv::setNumThreads(config.cvThreads);
+
+    std::vector<cv::Mat> frames;
+    if (!config.images.empty()) {
+        std::vector<std::string> paths;
+        cv::glob(config.images + "/*", paths);
+        std::sort(paths.begin(), paths.end());
+        for (const std::string &path : paths) {
+            cv::Mat image = cv::imread(path, cv::IMREAD_COLOR);
+            if (!image.empty()) {
+                frames.push_back(image);
+            }
+        }
+        if (frames.empty()) {
+            std::cerr << "No images in " << config.images << std::endl;
+            return 2;
+        }
+    } else {
+        cv::RNG rng(config.seed);
+        for (int i = 0; i < 8; ++i) {
+            frames.push_back(makeFrame(rng));
+        }
+    }
+
+    const std::vector<Case> cases = makeCases(config, frames);
+    if (cases.empty()) {
+        std::cerr << "Nothing to run" << std::endl;
+        return 2;
+    }
+
+    std::cout << "CPU " << cpuModel() << ", " << cores << " cores, OpenCV " << CV_VERSION
+              << ", cv threads " << config.cvThreads << ", "
+              << (config.images.empty() ? "synthetic frames" : config.images) << std::endl;
+    std::cout << std::left << std::setw(12) << "kernel" << std::setw(26) << "case"
+              << std::right << std::setw(8) << "threads" << std::setw(10) << "calls"
+              << std::setw(12) << "mean us" << std::setw(12) << "p50 us" << std::setw(12)
+              << "p99 us" << std::setw(12) << "calls/s" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    std::vector<Row> rows;
+    for (const Case &benchCase : cases) {
+        for (int threads : config.threads) {
+            const Row row = runCase(benchCase, threads, config.minTime);
+            std::cout << std::left << std::setw(12) << row.kernel << std::setw(26) << row.name
+                      << std::right << std::setw(8) << row.threads << std::setw(10) << row.calls
+                      << std::setw(12) << row.meanUs << std::setw(12) << row.p50Us
+                      << std::setw(12) << row.p99Us << std::setw(12) << row.callsPerSecond
+                      << std::endl;
+            rows.push_back(row);
+        }
+    }
+
+    if (!config.output.empty() && !writeOutput(config, rows)) {
+        return 2;
+    }
+    return config.compare.empty() ? 0 : compareWith(config, rows);
+}
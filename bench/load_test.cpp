@@ -0,0 +1,460 @@
+// Нагрузочный тест всего конвейера без камер и сервера распознавания:
+// поднимает synthetic_cameras и stub_ocr_server (рядом с этим файлом в
+// каталоге сборки), запускает StreamEngine в процессе на N потоков и
+// печатает пропускную способность, долю потерь и процентили задержки.
+//
+//   load_test [--streams 4] [--width 1280] [--height 720] [--fps 10]
+//             [--duration 30] [--warmup 5]
+//             [--ocr-latency fixed:20] [--ocr-workers 0] [--ocr-errors k] [--ocr-stalls k]
+//             [--ocr-servers N] [--batch on|off]
+//             [--engine "опции движка"] [--stream "опции камеры"]
+//             [--output result.json] [--baseline file.json] [--save-baseline file.json]
+//             [--tolerance 0.15] [--max-drop k] [--max-p99 ms] [--verbose]
+//
+// --engine и --stream передаются parseEngineArgs как есть: первые - движку,
+// вторые - после URL каждой камеры (например "--gate on --trigger motion").
+// Задержка - от захвата кадра до ответа, по каждому ответу сервера после
+// прогрева; потери - кадры, пропущенные захватом, и запросы без ответа.
+//
+// Код возврата: 0 - в пределах, 1 - хуже базовой линии или порогов --max-*,
+// 2 - тест не запустился. Базовая линия - JSON прошлого прогона (--save-baseline)
+// того же сценария на той же машине; метрика считается ухудшенной, если ушла
+// в худшую сторону больше чем на tolerance от базовой и на абсолютный допуск.
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QTimer>
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "helper_process.h"
+#include "stream_config.h"
+#include "stream_engine.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+struct LoadTestConfig
+{
+    int streams = 4;
+    int width = 1280;
+    int height = 720;
+    int fps = 10;
+    int durationS = 30;
+    int warmupS = 5;
+    QString ocrLatency = "fixed:20";
+    int ocrWorkers = 0;
+    double ocrErrors = 0.0;
+    double ocrStalls = 0.0;
+    int ocrServers = 1;
+    bool batch = false;
+    QString engineOptions;
+    QString streamOptions;
+    int cameraPort = 18080;
+    int ocrPort = 15000;
+    QString output;
+    QString baseline;
+    QString saveBaseline;
+    double tolerance = 0.15;
+    double maxDrop = -1.0;
+    double maxP99Ms = -1.0;
+    bool verbose = false;
+};
+
+// Счетчики всех камер в момент времени
+struct Totals
+{
+    uint64_t captured = 0;
+    uint64_t dropped = 0;
+    uint64_t submitted = 0;
+    uint64_t results = 0;
+    uint64_t plates = 0;
+    uint64_t vehicles = 0;
+    uint64_t coalesced = 0;
+    uint64_t timedOut = 0;
+    uint64_t failed = 0;
+    double cpuS = 0.0;
+    Clock::time_point time;
+};
+
+Totals takeTotals(const StreamEngine &engine)
+{
+    Totals totals;
+    for (int i = 0; i < engine.streamCount(); ++i) {
+        const StreamStats &stats = engine.stream(i)->stats();
+        totals.captured += stats.framesCaptured.load(std::memory_order_relaxed);
+        totals.dropped += stats.framesDropped.load(std::memory_order_relaxed);
+        totals.submitted += stats.framesSubmitted.load(std::memory_order_relaxed);
+        totals.results += stats.resultsReceived.load(std::memory_order_relaxed);
+        totals.plates += stats.platesRecognized.load(std::memory_order_relaxed);
+        totals.vehicles += stats.vehiclesReported.load(std::memory_order_relaxed);
+        totals.coalesced += stats.requestsCoalesced.load(std::memory_order_relaxed);
+        totals.timedOut += stats.requestsTimedOut.load(std::memory_order_relaxed);
+        totals.failed += stats.requestsFailed.load(std::memory_order_relaxed);
+    }
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        totals.cpuS = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+                      + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+    }
+    totals.time = Clock::now();
+    return totals;
+}
+
+// Направление метрики для сравнения с базовой линией и абсолютный допуск,
+// чтобы почти нулевые доли и задержки не срабатывали на шуме
+struct MetricRule
+{
+    const char *name;
+    bool higherIsBetter;
+    double slack;
+};
+
+const MetricRule kMetricRules[] = {
+    {"captured_fps", true, 0.5},     {"source_ratio", true, 0.02},
+    {"ocr_rps", true, 0.5},          {"result_rps", true, 0.5},
+    {"drop_rate", false, 0.005},     {"timeout_rate", false, 0.005},
+    {"failure_rate", false, 0.005},  {"latency_p50_ms", false, 5.0},
+    {"latency_p95_ms", false, 10.0}, {"latency_p99_ms", false, 20.0},
+    {"cpu_cores", false, 0.25},
+};
+
+// Параметры сценария: с базовой линией другого сценария сравнивать нельзя
+const char *kScenarioKeys[] = {"streams", "width", "height", "fps", "ocr_latency",
+                                "ocr_workers", "ocr_errors", "ocr_stalls", "ocr_servers",
+                                "batch", "engine", "stream"};
+
+double percentileMs(std::vector<double> &ms, double q)
+{
+    if (ms.empty()) {
+        return 0.0;
+    }
+    const size_t rank = std::min(ms.size() - 1, static_cast<size_t>(q * ms.size()));
+    std::nth_element(ms.begin(), ms.begin() + rank, ms.end());
+    return ms[rank];
+}
+
+bool parseArgs(int argc, char *argv[], LoadTestConfig &config)
+{
+    for (int i = 1; i < argc; ++i) {
+        const QString arg = argv[i];
+        if (arg == "--verbose") {
+            config.verbose = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << argv[i] << std::endl;
+            return false;
+        }
+        const QString value = argv[++i];
+        bool ok = true;
+        if (arg == "--streams") {
+            config.streams = value.toInt(&ok);
+        } else if (arg == "--width") {
+            config.width = value.toInt(&ok);
+        } else if (arg == "--height") {
+            config.height = value.toInt(&ok);
+        } else if (arg == "--fps") {
+            config.fps = value.toInt(&ok);
+        } else if (arg == "--duration") {
+            config.durationS = value.toInt(&ok);
+        } else if (arg == "--warmup") {
+            config.warmupS = value.toInt(&ok);
+        } else if (arg == "--ocr-latency") {
+            config.ocrLatency = value;
+        } else if (arg == "--ocr-workers") {
+            config.ocrWorkers = value.toInt(&ok);
+        } else if (arg == "--ocr-errors") {
+            config.ocrErrors = value.toDouble(&ok);
+        } else if (arg == "--ocr-stalls") {
+            config.ocrStalls = value.toDouble(&ok);
+        } else if (arg == "--ocr-servers") {
+            config.ocrServers = value.toInt(&ok);
+        } else if (arg == "--batch") {
+            ok = value == "on" || value == "off";
+            config.batch = value == "on";
+        } else if (arg == "--engine") {
+            config.engineOptions = value;
+        } else if (arg == "--stream") {
+            config.streamOptions = value;
+        } else if (arg == "--camera-port") {
+            config.cameraPort = value.toInt(&ok);
+        } else if (arg == "--ocr-port") {
+            config.ocrPort = value.toInt(&ok);
+        } else if (arg == "--output") {
+            config.output = value;
+        } else if (arg == "--baseline") {
+            config.baseline = value;
+        } else if (arg == "--save-baseline") {
+            config.saveBaseline = value;
+        } else if (arg == "--tolerance") {
+            config.tolerance = value.toDouble(&ok);
+        } else if (arg == "--max-drop") {
+            config.maxDrop = value.toDouble(&ok);
+        } else if (arg == "--max-p99") {
+            config.maxP99Ms = value.toDouble(&ok);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::cerr << "Invalid option " << argv[i - 1] << " " << argv[i] << std::endl;
+            return false;
+        }
+    }
+    if (config.streams < 1 || config.fps < 1 || config.durationS < 1 || config.warmupS < 0
+        || config.ocrServers < 1) {
+        std::cerr << "Invalid load test parameters" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Опции из одной строки через пробелы
+QStringList splitOptions(const QString &options)
+{
+    QStringList list;
+    for (const QString &option : options.simplified().split(' ')) {
+        if (!option.isEmpty()) {
+            list << option;
+        }
+    }
+    return list;
+}
+
+// Сравнение с базовой линией и порогами; печатает каждую ухудшенную метрику.
+// 0 - в пределах, 1 - ухудшение, 2 - базовую линию нельзя использовать
+int checkResult(const LoadTestConfig &config, const QJsonObject &result)
+{
+    bool passed = true;
+    if (config.maxDrop >= 0.0 && result["drop_rate"].toDouble() > config.maxDrop) {
+        std::cout << "FAIL drop_rate " << result["drop_rate"].toDouble() << " > "
+                  << config.maxDrop << std::endl;
+        passed = false;
+    }
+    if (config.maxP99Ms >= 0.0 && result["latency_p99_ms"].toDouble() > config.maxP99Ms) {
+        std::cout << "FAIL latency_p99_ms " << result["latency_p99_ms"].toDouble() << " > "
+                  << config.maxP99Ms << std::endl;
+        passed = false;
+    }
+    if (config.baseline.isEmpty()) {
+        return passed ? 0 : 1;
+    }
+
+    QFile file(config.baseline);
+    if (!file.open(QIODevice::ReadOnly)) {
+        std::cerr << "Cannot read baseline " << config.baseline.toStdString() << std::endl;
+        return 2;
+    }
+    const QJsonObject baseline = QJsonDocument::fromJson(file.readAll()).object();
+    for (const char *key : kScenarioKeys) {
+        if (baseline[key] != result[key]) {
+            std::cerr << "Baseline " << config.baseline.toStdString()
+                      << " is for another scenario (" << key << ")" << std::endl;
+            return 2;
+        }
+    }
+    for (const MetricRule &rule : kMetricRules) {
+        if (!baseline.contains(rule.name)) {
+            continue;
+        }
+        const double base = baseline[rule.name].toDouble();
+        const double value = result[rule.name].toDouble();
+        const double allowed = std::abs(base) * config.tolerance + rule.slack;
+        const double worse = rule.higherIsBetter ? base - value : value - base;
+        if (worse > allowed) {
+            std::cout << "FAIL " << rule.name << " " << value << " vs baseline " << base
+                      << " (allowed " << (rule.higherIsBetter ? base - allowed : base + allowed)
+                      << ")" << std::endl;
+            passed = false;
+        }
+    }
+    return passed ? 0 : 1;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    LoadTestConfig config;
+    if (!parseArgs(argc, argv, config)) {
+        return 2;
+    }
+
+    std::unique_ptr<QProcess> cameras =
+        startHelper("synthetic_cameras",
+                    {"--port", QString::number(config.cameraPort), "--cameras",
+                     QString::number(config.streams), "--width", QString::number(config.width),
+                     "--height", QString::number(config.height), "--fps",
+                     QString::number(config.fps)},
+                    config.verbose);
+    std::unique_ptr<QProcess> ocrServer =
+        startHelper("stub_ocr_server",
+                    {"--port", QString::number(config.ocrPort), "--ports",
+                     QString::number(config.ocrServers), "--latency", config.ocrLatency,
+                     "--workers", QString::number(config.ocrWorkers), "--errors",
+                     QString::number(config.ocrErrors), "--stalls",
+                     QString::number(config.ocrStalls)},
+                    config.verbose);
+    auto stopHelpers = [&]() {
+        stopHelper(cameras.get());
+        stopHelper(ocrServer.get());
+    };
+    bool ready = cameras && ocrServer && waitForPort(config.cameraPort, 15000);
+    for (int i = 0; ready && i < config.ocrServers; ++i) {
+        ready = waitForPort(config.ocrPort + i, 5000);
+    }
+    if (!ready) {
+        std::cerr << "Load test helpers did not start" << std::endl;
+        stopHelpers();
+        return 2;
+    }
+
+    // Командная строка движка, как у lpr --headless
+    const QString ocrBase = "http://127.0.0.1:";
+    QStringList args = {"--headless", "--stats", "0"};
+    args << splitOptions(config.engineOptions);
+    if (config.ocrServers > 1) {
+        QStringList backends;
+        for (int i = 0; i < config.ocrServers; ++i) {
+            backends << ocrBase + QString::number(config.ocrPort + i);
+        }
+        args << "--ocr-backends" << backends.join(',');
+    } else {
+        args << "--ocr-url" << ocrBase + QString::number(config.ocrPort) + "/recognize";
+    }
+    if (config.batch) {
+        args << "--ocr-batch-url"
+             << ocrBase + QString::number(config.ocrPort) + "/recognize_batch";
+    }
+    for (int i = 0; i < config.streams; ++i) {
+        args << QString("http://127.0.0.1:%1/video/%2").arg(config.cameraPort).arg(i);
+        args << splitOptions(config.streamOptions);
+    }
+    EngineConfig engineConfig;
+    QString error;
+    if (!parseEngineArgs(args, engineConfig, error)) {
+        std::cerr << error.toStdString() << std::endl;
+        stopHelpers();
+        return 2;
+    }
+
+    StreamEngine engine(engineConfig);
+
+    // Точные процентили по каждому ответу; гистограмма StreamStats для этого грубая
+    std::mutex latencyMutex;
+    std::vector<double> latencyMs;
+    std::atomic<bool> measuring{false};
+    QObject::connect(
+        engine.ocr(), &AsyncOCRClient::plateRecognized, engine.ocr(),
+        [&](const OcrResult &result) {
+            if (result.status == OcrStatus::Ok && measuring.load(std::memory_order_relaxed)) {
+                const double ms =
+                    std::chrono::duration<double, std::milli>(result.latency()).count();
+                std::lock_guard<std::mutex> lock(latencyMutex);
+                latencyMs.push_back(ms);
+            }
+        },
+        Qt::DirectConnection);
+
+    // Камеры закончились раньше срока - тест не состоялся
+    QObject::connect(&engine, &StreamEngine::finished, &app, &QCoreApplication::quit);
+
+    Totals begin;
+    Totals end;
+    QTimer::singleShot(config.warmupS * 1000, [&]() {
+        begin = takeTotals(engine);
+        measuring = true;
+    });
+    QTimer::singleShot((config.warmupS + config.durationS) * 1000, [&]() {
+        measuring = false;
+        end = takeTotals(engine);
+        engine.stop();
+        app.quit();
+    });
+    std::cout << "Load test: " << config.streams << " streams " << config.width << "x"
+              << config.height << " @ " << config.fps << " fps, OCR "
+              << config.ocrLatency.toStdString() << ", warmup " << config.warmupS << " s, run "
+              << config.durationS << " s" << std::endl;
+    engine.start();
+    app.exec();
+    engine.stop();
+    stopHelpers();
+
+    const double seconds = std::chrono::duration<double>(end.time - begin.time).count();
+    if (seconds <= 0.0) {
+        std::cerr << "Load test did not run" << std::endl;
+        return 2;
+    }
+    const double captured = static_cast<double>(end.captured - begin.captured);
+    const double dropped = static_cast<double>(end.dropped - begin.dropped);
+    const double submitted = static_cast<double>(end.submitted - begin.submitted);
+    const double requests = std::max(1.0, submitted);
+    std::vector<double> ms;
+    {
+        std::lock_guard<std::mutex> lock(latencyMutex);
+        ms.swap(latencyMs);
+    }
+
+    QJsonObject result;
+    result["streams"] = config.streams;
+    result["width"] = config.width;
+    result["height"] = config.height;
+    result["fps"] = config.fps;
+    result["ocr_latency"] = config.ocrLatency;
+    result["ocr_workers"] = config.ocrWorkers;
+    result["ocr_errors"] = config.ocrErrors;
+    result["ocr_stalls"] = config.ocrStalls;
+    result["ocr_servers"] = config.ocrServers;
+    result["batch"] = config.batch;
+    result["engine"] = config.engineOptions;
+    result["stream"] = config.streamOptions;
+    result["duration_s"] = seconds;
+
+    result["captured_fps"] = captured / seconds;
+    result["source_ratio"] = captured / seconds / (config.streams * config.fps);
+    result["drop_rate"] = captured > 0.0 ? dropped / captured : 0.0;
+    result["ocr_rps"] = submitted / seconds;
+    result["result_rps"] = (end.results - begin.results) / seconds;
+    result["plates_per_s"] = (end.plates - begin.plates) / seconds;
+    result["vehicles"] = static_cast<double>(end.vehicles - begin.vehicles);
+    result["timeout_rate"] = (end.timedOut - begin.timedOut) / requests;
+    result["failure_rate"] = (end.failed - begin.failed) / requests;
+    result["coalesced_rate"] = (end.coalesced - begin.coalesced) / requests;
+    result["latency_samples"] = static_cast<double>(ms.size());
+    result["latency_p50_ms"] = percentileMs(ms, 0.50);
+    result["latency_p95_ms"] = percentileMs(ms, 0.95);
+    result["latency_p99_ms"] = percentileMs(ms, 0.99);
+    result["latency_max_ms"] = ms.empty() ? 0.0 : *std::max_element(ms.begin(), ms.end());
+    result["cpu_cores"] = (end.cpuS - begin.cpuS) / seconds;
+
+    const QByteArray json = QJsonDocument(result).toJson(QJsonDocument::Indented);
+    std::cout << json.constData();
+    for (const QString &path : {config.output, config.saveBaseline}) {
+        QFile file(path);
+        if (!path.isEmpty() && (!file.open(QIODevice::WriteOnly) || file.write(json) < 0)) {
+            std::cerr << "Cannot write " << path.toStdString() << std::endl;
+            return 2;
+        }
+    }
+
+    if (ms.empty() || captured == 0.0) {
+        std::cout << "FAIL no frames or no OCR results" << std::endl;
+        return 1;
+    }
+    const int status = checkResult(config, result);
+    std::cout << (status == 0 ? "PASS" : status == 1 ? "REGRESSION" : "NO BASELINE") << std::endl;
+    return status;
+}
@@ -0,0 +1,96 @@
+#!/bin/bash
+# Сценарии нагрузочного теста (load_test) с проверкой по базовым линиям.
+# Запускается из каталога сборки с -DBUILD_BENCHMARKS=ON:
+#
+#   ../bench/load_test.sh              все сценарии; код 1 - какой-то хуже базовой линии
+#   ../bench/load_test.sh faults       один сценарий
+#   ../bench/load_test.sh --save       перезаписать базовые линии текущими результатами
+#   ../bench/load_test.sh --sweep      сколько камер 720p выдерживает машина
+#
+# Базовые линии - load_test_baselines/<сценарий>.json в каталоге сборки: они
+# зависят от машины, поэтому в репозиторий не входят. Сценарий без базовой
+# линии при первом прогоне ее создает.
+
+set -u
+BUILD=${LPR_BUILD:-.}
+BASELINES="$BUILD/load_test_baselines"
+DURATION=${LOAD_TEST_DURATION:-30}
+mkdir -p "$BASELINES"
+
+declare -A SCENARIOS=(
+    # 4 камеры 720p, сервер отвечает за 20 мс
+    [basic]="--streams 4 --width 1280 --height 720 --fps 10 --ocr-latency fixed:20"
+    # 8 камер 1080p: детектор и OCR по движению, сервер на 4 потоках с хвостом задержки
+    [gate]="--streams 8 --width 1920 --height 1080 --fps 15 --ocr-latency lognormal:15:60 \
+            --ocr-workers 4 --stream '--gate on --trigger motion'"
+    # 16 камер, ошибки и зависшие запросы сервера: окно на камеру и срок ответа
+    [faults]="--streams 16 --width 1280 --height 720 --fps 10 --ocr-latency lognormal:20:120 \
+              --ocr-errors 0.02 --ocr-stalls 0.01 --engine '--max-in-flight 2 --ocr-timeout 1000'"
+    # вырезки всех камер пакетами /recognize_batch
+    [batch]="--streams 8 --width 1280 --height 720 --fps 10 --ocr-latency fixed:25 --batch on \
+             --engine '--batch-window 15 --batch-size 16' --stream '--gate on'"
+    # пул из двух серверов с дублированием медленных ответов
+    [pool]="--streams 8 --width 1280 --height 720 --fps 10 --ocr-latency lognormal:20:200 \
+            --ocr-workers 2 --ocr-servers 2 --engine '--hedge-after 100'"
+)
+ORDER="basic gate faults batch pool"
+
+run_scenario() {
+    local name=$1 save=$2
+    local baseline="$BASELINES/$name.json"
+    local args=(--duration "$DURATION" --output "$BASELINES/$name.last.json")
+    if [ "$save" = 1 ] || [ ! -f "$baseline" ]; then
+        args+=(--save-baseline "$baseline")
+    else
+        args+=(--baseline "$baseline")
+    fi
+    echo "=== $name"
+    eval "\"$BUILD/load_test\" ${SCENARIOS[$name]} \"\${args[@]}\""
+}
+
+sweep() {
+    # Камер 720p 10 fps, пока потери до 1% и p99 до 500 мс
+    local streams=2 best=0
+    while [ $streams -le 256 ]; do
+        echo "=== $streams streams"
+        if "$BUILD/load_test" --streams $streams --fps 10 --ocr-latency lognormal:20:80 \
+            --duration "$DURATION" --max-drop 0.01 --max-p99 500; then
+            best=$streams
+            streams=$((streams * 2))
+        else
+            break
+        fi
+    done
+    echo "max streams: $best"
+    [ $best -gt 0 ]
+}
+
+save=0
+selected=()
+for arg in "$@"; do
+    case $arg in
+        --save) save=1 ;;
+        --sweep) sweep; exit $? ;;
+        *)
+            if [ -z "${SCENARIOS[$arg]+x}" ]; then
+                echo "Unknown scenario $arg (known: $ORDER)" >&2
+                exit 2
+            fi
+            selected+=("$arg")
+            ;;
+    esac
+done
+[ ${#selected[@]} -eq 0 ] && read -r -a selected <<< "$ORDER"
+
+status=0
+failed=()
+for name in "${selected[@]}"; do
+    run_scenario "$name" $save
+    code=$?
+    if [ $code -ne 0 ]; then
+        failed+=("$name")
+        [ $code -gt $status ] && status=$code
+    fi
+done
+[ ${#failed[@]} -gt 0 ] && echo "Failed: ${failed[*]}"
+exit $status
@@ -0,0 +1,223 @@
+// Сравнение двух путей распознавания вырезок номеров на одних и тех же картинках:
+// локальный CRNN через cv::dnn (PlateOcrEngine) и OCR-сервер через AsyncOCRClient.
+//
+//   ocr_bench <вырезка.jpg | каталог с вырезками> [--model crnn_ocr.onnx]
+//             [--url http://127.0.0.1:5000/recognize] [--plates N] [--batch N]
+//             [--in-flight N] [--batch-window ms]
+//
+// Для каждого пути печатается задержка на один номер (запросы по одному,
+// последовательно) и пропускная способность: для локального CRNN - батчами
+// по --batch, для сервера - с --in-flight запросами в сети одновременно.
+
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QStringList>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include "async_ocr_client.h"
+#include "plate_ocr_engine.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions
+{
+    std::string platesPath;
+    PlateOcrConfig native;
+    OcrClientConfig remote;
+    int plates = 200;
+    int batch = 16;
+    int inFlight = 4;
+};
+
+static double elapsedMs(Clock::time_point since)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+static std::vector<cv::Mat> loadPlates(const std::string &path)
+{
+    std::vector<cv::String> files;
+    cv::Mat single = cv::imread(path);
+    if (!single.empty()) {
+        return {single};
+    }
+
+    cv::glob(path, files, false);
+    std::vector<cv::Mat> plates;
+    for (const cv::String &file : files) {
+        cv::Mat image = cv::imread(file);
+        if (!image.empty()) {
+            plates.push_back(image);
+        }
+    }
+    return plates;
+}
+
+static void printLatency(const char *name, std::vector<double> samples)
+{
+    if (samples.empty()) {
+        return;
+    }
+    std::sort(samples.begin(), samples.end());
+    double avg = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    std::cout << name << " latency/plate: avg " << avg << " ms, p50 "
+              << samples[samples.size() / 2] << " ms, p95 " << samples[samples.size() * 95 / 100]
+              << " ms, max " << samples.back() << " ms" << std::endl;
+}
+
+static void benchNative(const std::vector<cv::Mat> &plates, const BenchOptions &options)
+{
+    PlateOcrEngine engine;
+    if (!engine.load(options.native)) {
+        std::cout << "native: skipped, model not loaded" << std::endl;
+        return;
+    }
+
+    // Прогрев: первая отработка сети выделяет память слоев
+    engine.recognize({plates[0]});
+
+    std::vector<double> latency;
+    for (int i = 0; i < options.plates; ++i) {
+        auto start = Clock::now();
+        engine.recognize({plates[i % plates.size()]});
+        latency.push_back(elapsedMs(start));
+    }
+    printLatency("native", latency);
+
+    std::vector<cv::Mat> batch;
+    auto start = Clock::now();
+    for (int i = 0; i < options.plates; ++i) {
+        batch.push_back(plates[i % plates.size()]);
+        if (static_cast<int>(batch.size()) == options.batch || i + 1 == options.plates) {
+            engine.recognize(batch);
+            batch.clear();
+        }
+    }
+    std::cout << "native throughput (batch " << options.batch
+              << "): " << options.plates * 1000.0 / elapsedMs(start) << " plates/s" << std::endl;
+}
+
+static void benchRemote(const std::vector<cv::Mat> &plates, const BenchOptions &options)
+{
+    OcrClientConfig config = options.remote;
+    config.maxInFlightPerStream = std::max(1, options.inFlight);
+    config.timeoutMs = 60000;
+    AsyncOCRClient client(config);
+
+    int submitted = 0;
+    int received = 0;
+    int failed = 0;
+    bool keepWindowFull = false;
+    QEventLoop loop;
+
+    auto submitNext = [&]() {
+        OcrRequest request;
+        request.streamId = 0;
+        request.frameId = static_cast<uint64_t>(submitted);
+        request.kind = OcrRequestKind::PlateCrop;
+        request.captureTime = Clock::now();
+        client.submitFrameForRecognition(request, plates[submitted % plates.size()]);
+        submitted++;
+    };
+
+    QObject::connect(&client, &AsyncOCRClient::plateRecognized, &loop,
+                     [&](const OcrResult &result) {
+                         received++;
+                         if (result.status != OcrStatus::Ok) {
+                             failed++;
+                         }
+                         // Замкнутый цикл: ответ освобождает место для следующего запроса
+                         if (keepWindowFull && submitted < options.plates) {
+                             submitNext();
+                         }
+                         loop.quit();
+                     });
+
+    std::vector<double> latency;
+    for (int i = 0; i < options.plates; ++i) {
+        auto start = Clock::now();
+        submitNext();
+        while (received < submitted) {
+            loop.exec();
+        }
+        latency.push_back(elapsedMs(start));
+    }
+    printLatency("remote", latency);
+
+    submitted = 0;
+    received = 0;
+    keepWindowFull = true;
+    auto start = Clock::now();
+    while (submitted < std::min(config.maxInFlightPerStream, options.plates)) {
+        submitNext();
+    }
+    while (received < options.plates) {
+        loop.exec();
+    }
+    std::cout << "remote throughput (in flight " << config.maxInFlightPerStream
+              << "): " << options.plates * 1000.0 / elapsedMs(start) << " plates/s";
+    if (failed > 0) {
+        std::cout << ", failed " << failed;
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+
+    BenchOptions options;
+    for (int i = 1; i < args.size(); ++i) {
+        const QString &arg = args[i];
+        if (!arg.startsWith("--")) {
+            options.platesPath = arg.toStdString();
+            continue;
+        }
+        if (i + 1 >= args.size()) {
+            std::cerr << "Missing value for " << arg.toStdString() << std::endl;
+            return 1;
+        }
+        const QString value = args[++i];
+        if (arg == "--model") {
+            options.native.modelPath = value.toStdString();
+        } else if (arg == "--url") {
+            options.remote.serviceUrl = value;
+        } else if (arg == "--plates") {
+            options.plates = std::max(1, value.toInt());
+        } else if (arg == "--batch") {
+            options.batch = std::max(1, value.toInt());
+            options.native.maxBatchSize = options.batch;
+        } else if (arg == "--in-flight") {
+            options.inFlight = value.toInt();
+        } else if (arg == "--batch-window") {
+            options.remote.batchWindowMs = value.toInt();
+        } else {
+            std::cerr << "Unknown option: " << arg.toStdString() << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<cv::Mat> plates = loadPlates(options.platesPath);
+    if (plates.empty()) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <plate image | dir> [--model path.onnx] [--url url] [--plates N]"
+                     " [--batch N] [--in-flight N] [--batch-window ms]"
+                  << std::endl;
+        return 1;
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Plates: " << plates.size() << " images, " << options.plates << " requests per run"
+              << std::endl;
+
+    benchNative(plates, options);
+    benchRemote(plates, options);
+    return 0;
+}
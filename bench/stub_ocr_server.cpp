@@ -0,0 +1,363 @@
+// Заглушка OCR-сервера для нагрузочного теста (load_test): протокол
+// ocr_server.py без модели, изображения не декодируются.
+//   POST /recognize[?crop=1]  -> {"plates": [{"text": ..., "confidence": ...}]}
+//   POST /recognize_batch     -> {"results": [{"id": <имя части>, "plates": [...]}, ...]}
+//   GET  /health              -> {"status": "healthy"}
+// Ответ с заголовком Server-Timing, как у настоящего сервера.
+//
+//   stub_ocr_server [--port 15000] [--ports N] [--latency spec] [--workers N]
+//                   [--batch-cost k] [--errors k] [--stalls k] [--empty k] [--seed N]
+//
+// --latency - время распознавания одного запроса, мс:
+//   fixed:20, uniform:10:40, exp:20 (среднее), lognormal:20:80 (медиана и p99)
+// --workers - сколько запросов распознаются одновременно (0 - без ограничения),
+// остальные ждут в очереди, как у сервера с пулом потоков. Пакет из n
+// изображений занимает исполнителя на время (1 + batch-cost * (n - 1)) одного
+// запроса. --errors - доля ответов 500, --stalls - доля запросов без ответа
+// (клиент отменит их по сроку), --empty - доля ответов без номера.
+// --ports N - слушать N портов подряд (пул серверов для --ocr-backends).
+
+#include <QCoreApplication>
+#include <QHash>
+#include <QPointer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "synthetic_plates.h"
+
+namespace {
+struct LatencyModel
+{
+    enum Kind
+    {
+        Fixed,
+        Uniform,
+        Exponential,
+        LogNormal
+    } kind = Fixed;
+    double a = 20.0;
+    double b = 0.0;
+
+    bool parse(const QString &spec)
+    {
+        const QStringList parts = spec.split(':');
+        bool ok = parts.size() >= 2;
+        a = ok ? parts[1].toDouble(&ok) : 0.0;
+        if (ok && parts.size() == 3) {
+            b = parts[2].toDouble(&ok);
+        }
+        if (!ok || a < 0.0) {
+            return false;
+        }
+        if (parts[0] == "fixed" && parts.size() == 2) {
+            kind = Fixed;
+        } else if (parts[0] == "exp" && parts.size() == 2) {
+            kind = Exponential;
+        } else if (parts[0] == "uniform" && parts.size() == 3 && b >= a) {
+            kind = Uniform;
+        } else if (parts[0] == "lognormal" && parts.size() == 3 && a > 0.0 && b >= a) {
+            kind = LogNormal;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    double sample(std::mt19937_64 &rng) const
+    {
+        switch (kind) {
+        case Uniform:
+            return std::uniform_real_distribution<double>(a, b)(rng);
+        case Exponential:
+            return a > 0.0 ? std::exponential_distribution<double>(1.0 / a)(rng) : 0.0;
+        case LogNormal:
+            // b - 99-й процентиль: z(0.99) = 2.326
+            return std::lognormal_distribution<double>(std::log(a), std::log(b / a) / 2.326)(rng);
+        case Fixed:
+            break;
+        }
+        return a;
+    }
+};
+
+struct StubConfig
+{
+    LatencyModel latency;
+    int workers = 0;
+    double batchCost = 0.2;
+    double errors = 0.0;
+    double stalls = 0.0;
+    double empty = 0.3;
+};
+
+class StubServer
+{
+public:
+    StubServer(const StubConfig &config, uint64_t seed)
+        : config(config)
+        , rng(seed)
+    {
+        // Номера машин, которые "видит" сервер; трекер камеры собирает их в события
+        for (int i = 0; i < 64; ++i) {
+            plates.push_back(QByteArray::fromStdString(makePlateText(rng)));
+        }
+        QObject::connect(&statsTimer, &QTimer::timeout, [this]() { printStats(); });
+        statsTimer.start(5000);
+    }
+
+    bool listen(quint16 port)
+    {
+        auto server = std::make_unique<QTcpServer>();
+        if (!server->listen(QHostAddress::Any, port)) {
+            std::cerr << "Cannot listen on port " << port << ": "
+                      << server->errorString().toStdString() << std::endl;
+            return false;
+        }
+        QTcpServer *raw = server.get();
+        QObject::connect(raw, &QTcpServer::newConnection, [this, raw]() {
+            while (QTcpSocket *socket = raw->nextPendingConnection()) {
+                connections.insert(socket, Connection());
+                QObject::connect(socket, &QTcpSocket::readyRead, [this, socket]() {
+                    connections[socket].buffer += socket->readAll();
+                    parse(socket);
+                });
+                QObject::connect(socket, &QTcpSocket::disconnected, [this, socket]() {
+                    connections.remove(socket);
+                    socket->deleteLater();
+                });
+            }
+        });
+        servers.push_back(std::move(server));
+        return true;
+    }
+
+private:
+    struct Connection
+    {
+        QByteArray buffer;
+        bool busy = false; // клиент Qt не шлет следующий запрос до ответа на этот
+    };
+
+    struct Job
+    {
+        QPointer<QTcpSocket> socket;
+        bool batch = false;
+        QList<QByteArray> ids; // части пакета по порядку
+    };
+
+    // Очередной полный запрос из буфера соединения
+    void parse(QTcpSocket *socket)
+    {
+        Connection &connection = connections[socket];
+        if (connection.busy) {
+            return;
+        }
+        const int headersEnd = connection.buffer.indexOf("\r\n\r\n");
+        if (headersEnd < 0) {
+            return;
+        }
+        const QByteArray head = connection.buffer.left(headersEnd);
+        int contentLength = 0;
+        for (const QByteArray &line : head.split('\n')) {
+            const QByteArray lower = line.trimmed().toLower();
+            if (lower.startsWith("content-length:")) {
+                contentLength = lower.mid(15).trimmed().toInt();
+            }
+        }
+        if (connection.buffer.size() < headersEnd + 4 + contentLength) {
+            return;
+        }
+        const QByteArray body = connection.buffer.mid(headersEnd + 4, contentLength);
+        connection.buffer.remove(0, headersEnd + 4 + contentLength);
+
+        const QList<QByteArray> requestLine = head.left(head.indexOf('\r')).split(' ');
+        const QByteArray path = requestLine.size() >= 2 ? requestLine[1] : QByteArray();
+        if (path.startsWith("/health")) {
+            reply(socket, 200, "{\"status\": \"healthy\"}", -1.0);
+            return;
+        }
+        Job job;
+        job.socket = socket;
+        if (path.startsWith("/recognize_batch")) {
+            job.batch = true;
+            // Имя части - id запроса: Content-Disposition: form-data; name="5"; filename="crop"
+            const QByteArray marker = "name=\"";
+            for (int pos = body.indexOf("Content-Disposition"); pos >= 0;
+                 pos = body.indexOf("Content-Disposition", pos + 1)) {
+                const int start = body.indexOf(marker, pos);
+                const int end = start >= 0 ? body.indexOf('"', start + marker.size()) : -1;
+                if (end > start) {
+                    job.ids << body.mid(start + marker.size(), end - start - marker.size());
+                }
+            }
+        } else if (!path.startsWith("/recognize")) {
+            reply(socket, 404, "{\"error\": \"not found\"}", -1.0);
+            return;
+        }
+
+        connection.busy = true;
+        requests++;
+        images += job.batch ? job.ids.size() : 1;
+        if (std::uniform_real_distribution<double>(0.0, 1.0)(rng) < config.stalls) {
+            stalls++; // соединение занято, пока клиент не отменит запрос
+            return;
+        }
+        waiting.push_back(job);
+        maxQueue = std::max(maxQueue, waiting.size());
+        startJobs();
+    }
+
+    void startJobs()
+    {
+        while (!waiting.empty() && (config.workers <= 0 || busyWorkers < config.workers)) {
+            Job job = waiting.front();
+            waiting.pop_front();
+            busyWorkers++;
+            const int count = job.batch ? std::max(1, static_cast<int>(job.ids.size())) : 1;
+            const double ms =
+                config.latency.sample(rng) * (1.0 + config.batchCost * (count - 1));
+            QTimer::singleShot(static_cast<int>(std::lround(ms)), Qt::PreciseTimer,
+                               [this, job, ms]() { finish(job, ms); });
+        }
+    }
+
+    QByteArray platesJson()
+    {
+        if (std::uniform_real_distribution<double>(0.0, 1.0)(rng) < config.empty) {
+            return "[]";
+        }
+        const double confidence = std::uniform_real_distribution<double>(0.8, 0.99)(rng);
+        return "[{\"text\": \"" + plates[rng() % plates.size()] + "\", \"confidence\": "
+               + QByteArray::number(confidence, 'f', 3) + "}]";
+    }
+
+    void finish(const Job &job, double ms)
+    {
+        busyWorkers--;
+        startJobs();
+        if (!job.socket) {
+            return;
+        }
+        if (std::uniform_real_distribution<double>(0.0, 1.0)(rng) < config.errors) {
+            errors++;
+            reply(job.socket, 500, "{\"error\": \"stub error\"}", ms);
+            return;
+        }
+        QByteArray body;
+        if (job.batch) {
+            body = "{\"results\": [";
+            for (int i = 0; i < job.ids.size(); ++i) {
+                body += (i ? ", " : "") + QByteArray("{\"id\": \"") + job.ids[i]
+                        + "\", \"plates\": " + platesJson() + "}";
+            }
+            body += "]}";
+        } else {
+            body = "{\"plates\": " + platesJson() + "}";
+        }
+        reply(job.socket, 200, body, ms);
+    }
+
+    void reply(QTcpSocket *socket, int status, const QByteArray &body, double ms)
+    {
+        QByteArray response = "HTTP/1.1 " + QByteArray::number(status)
+                              + (status == 200 ? " OK" : status == 404 ? " Not Found" : " Error")
+                              + "\r\nContent-Type: application/json\r\nContent-Length: "
+                              + QByteArray::number(body.size()) + "\r\n";
+        if (ms >= 0.0) {
+            response += "Server-Timing: inference;dur=" + QByteArray::number(ms, 'f', 1) + "\r\n";
+        }
+        socket->write(response + "Connection: keep-alive\r\n\r\n" + body);
+        auto it = connections.find(socket);
+        if (it != connections.end()) {
+            it->busy = false;
+            parse(socket);
+        }
+    }
+
+    void printStats()
+    {
+        std::cout << "requests " << requests << ", images " << images << ", errors " << errors
+                  << ", stalls " << stalls << ", connections " << connections.size()
+                  << ", busy " << busyWorkers << ", queued " << waiting.size()
+                  << ", max queue " << maxQueue << std::endl;
+        maxQueue = waiting.size();
+    }
+
+    StubConfig config;
+    std::mt19937_64 rng;
+    std::vector<QByteArray> plates;
+    std::vector<std::unique_ptr<QTcpServer>> servers;
+    QHash<QTcpSocket *, Connection> connections;
+    std::deque<Job> waiting;
+    int busyWorkers = 0;
+    QTimer statsTimer;
+
+    uint64_t requests = 0;
+    uint64_t images = 0;
+    uint64_t errors = 0;
+    uint64_t stalls = 0;
+    size_t maxQueue = 0;
+};
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    StubConfig config;
+    int port = 15000;
+    int ports = 1;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        const bool hasValue = i + 1 < argc;
+        bool ok = hasValue;
+        if (!std::strcmp(argv[i], "--port") && hasValue) {
+            port = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--ports") && hasValue) {
+            ports = std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--latency") && hasValue) {
+            ok = config.latency.parse(QString(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--workers") && hasValue) {
+            config.workers = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--batch-cost") && hasValue) {
+            config.batchCost = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--errors") && hasValue) {
+            config.errors = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--stalls") && hasValue) {
+            config.stalls = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--empty") && hasValue) {
+            config.empty = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--seed") && hasValue) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::cerr << "Invalid option " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    StubServer server(config, seed);
+    for (int i = 0; i < ports; ++i) {
+        if (!server.listen(static_cast<quint16>(port + i))) {
+            return 1;
+        }
+    }
+    std::cout << "Stub OCR server on ports " << port << ".." << port + ports - 1 << ", workers "
+              << config.workers << ", errors " << config.errors << ", stalls " << config.stalls
+              << std::endl;
+    return app.exec();
+}
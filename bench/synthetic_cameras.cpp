@@ -0,0 +1,262 @@
+// Синтетические камеры для нагрузочного теста (load_test): N потоков MJPEG по
+// HTTP, как у IP-камер, без сети и записей.
+//
+//   synthetic_cameras [--port 18080] [--cameras N] [--width 1280] [--height 720]
+//                     [--fps 10] [--loop-seconds 6] [--quality 80]
+//
+// Камера i - http://127.0.0.1:<port>/video/<i> (/video - камера 0). Кадры
+// одного цикла рисуются заранее и сжимаются один раз: дорога с разметкой и
+// машина с белым номером, которая проезжает кадр за первую половину цикла,
+// вторая половина - пустая дорога (детектор движения и трекер видят отдельные
+// машины). Камеры идут со сдвигом по циклу и по фазе таймера, чтобы кадры не
+// приходили всем одновременно. Клиенту, который не успевает забирать кадры,
+// кадр пропускается; пропуски печатаются в сводке.
+
+#include <opencv2/opencv.hpp>
+
+#include <QCoreApplication>
+#include <QHash>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "synthetic_plates.h"
+
+namespace {
+// Клиент, у которого в очереди на отправку столько байт, кадр пропускает
+const qint64 kMaxPendingBytes = 4 * 1024 * 1024;
+
+struct SourceConfig
+{
+    int cameras = 4;
+    int width = 1280;
+    int height = 720;
+    int fps = 10;
+    int loopSeconds = 6;
+    int quality = 80;
+};
+
+// Кадры цикла, уже готовыми частями multipart
+std::vector<QByteArray> renderLoop(const SourceConfig &config)
+{
+    const int count = std::max(2, config.fps * config.loopSeconds);
+    const int w = config.width;
+    const int h = config.height;
+    std::mt19937 rng(7);
+
+    cv::Mat road(h, w, CV_8UC3, cv::Scalar(90, 90, 90));
+    // Шум асфальта, чтобы JPEG был похож по размеру на кадр камеры
+    cv::Mat noise(h, w, CV_8UC3);
+    cv::randu(noise, cv::Scalar::all(0), cv::Scalar::all(30));
+    road += noise;
+    for (int x = w / 3; x < w; x += w / 3) {
+        for (int y = 0; y < h; y += h / 8) {
+            cv::rectangle(road, cv::Rect(x - 4, y, 8, h / 16), cv::Scalar(230, 230, 230), -1);
+        }
+    }
+
+    std::vector<QByteArray> parts;
+    std::vector<uchar> buffer;
+    std::string plate;
+    for (int i = 0; i < count; ++i) {
+        cv::Mat frame = road.clone();
+        const int pass = count / 2;
+        if (i < pass) {
+            if (i == 0) {
+                plate = makePlateText(rng);
+            }
+            // Машина едет сверху вниз по средней полосе
+            const int carW = w / 4;
+            const int carH = h / 3;
+            const int x = w / 2 - carW / 2;
+            const int y = -carH + (h + carH) * i / pass;
+            cv::rectangle(frame, cv::Rect(x, y, carW, carH), cv::Scalar(40, 40, 140), -1);
+            cv::rectangle(frame, cv::Rect(x + carW / 8, y + carH / 10, carW * 3 / 4, carH / 4),
+                          cv::Scalar(60, 50, 40), -1);
+
+            const int plateW = carW * 2 / 3;
+            const int plateH = plateW * 112 / 520;
+            const cv::Rect plateRect(x + (carW - plateW) / 2, y + carH - plateH * 2, plateW,
+                                     plateH);
+            drawPlate(frame, plateRect, plate);
+        }
+        cv::imencode(".jpg", frame, buffer, {cv::IMWRITE_JPEG_QUALITY, config.quality});
+        QByteArray part = "--frame\r\nContent-Type: image/jpeg\r\nContent-Length: "
+                          + QByteArray::number(static_cast<int>(buffer.size())) + "\r\n\r\n";
+        part.append(reinterpret_cast<const char *>(buffer.data()),
+                    static_cast<int>(buffer.size()));
+        part += "\r\n";
+        parts.push_back(part);
+    }
+    return parts;
+}
+
+class CameraServer
+{
+public:
+    CameraServer(const SourceConfig &config, std::vector<QByteArray> frames)
+        : config(config)
+        , frames(std::move(frames))
+        , cameras(config.cameras)
+    {
+        QObject::connect(&server, &QTcpServer::newConnection, [this]() {
+            while (QTcpSocket *socket = server.nextPendingConnection()) {
+                QObject::connect(socket, &QTcpSocket::readyRead, [this, socket]() {
+                    onReadyRead(socket);
+                });
+                QObject::connect(socket, &QTcpSocket::disconnected, [this, socket]() {
+                    for (Camera &camera : cameras) {
+                        camera.clients.removeAll(socket);
+                    }
+                    socket->deleteLater();
+                });
+            }
+        });
+
+        const int period = 1000 / std::max(1, config.fps);
+        for (int i = 0; i < config.cameras; ++i) {
+            Camera &camera = cameras[i];
+            camera.position = (i * 7) % static_cast<int>(this->frames.size());
+            camera.timer = std::make_unique<QTimer>();
+            camera.timer->setTimerType(Qt::PreciseTimer);
+            QObject::connect(camera.timer.get(), &QTimer::timeout, [this, i]() { sendFrame(i); });
+            // Старты камер разнесены по периоду кадра
+            QTimer::singleShot(period * i / std::max(1, config.cameras), [this, i, period]() {
+                cameras[i].timer->start(period);
+            });
+        }
+        QObject::connect(&statsTimer, &QTimer::timeout, [this]() { printStats(); });
+        statsTimer.start(5000);
+    }
+
+    bool listen(quint16 port)
+    {
+        if (!server.listen(QHostAddress::Any, port)) {
+            std::cerr << "Cannot listen on port " << port << ": "
+                      << server.errorString().toStdString() << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    struct Camera
+    {
+        int position = 0;
+        std::unique_ptr<QTimer> timer;
+        QList<QTcpSocket *> clients;
+    };
+
+    void onReadyRead(QTcpSocket *socket)
+    {
+        // Нужна только строка запроса
+        if (!socket->canReadLine() || socket->property("camera").isValid()) {
+            socket->readAll();
+            return;
+        }
+        const QList<QByteArray> request = socket->readLine().trimmed().split(' ');
+        const QByteArray path = request.size() >= 2 ? request[1] : QByteArray();
+        bool ok = path == "/video";
+        const int index = ok ? 0 : path.startsWith("/video/") ? path.mid(7).toInt(&ok) : -1;
+        socket->readAll();
+        if (!ok || index < 0 || index >= config.cameras) {
+            socket->write("HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+            socket->disconnectFromHost();
+            return;
+        }
+        socket->setProperty("camera", index);
+        socket->write("HTTP/1.0 200 OK\r\nCache-Control: no-cache\r\n"
+                      "Content-Type: multipart/x-mixed-replace; boundary=frame\r\n\r\n");
+        cameras[index].clients << socket;
+    }
+
+    void sendFrame(int index)
+    {
+        Camera &camera = cameras[index];
+        const QByteArray &part = frames[camera.position];
+        camera.position = (camera.position + 1) % static_cast<int>(frames.size());
+        for (QTcpSocket *socket : camera.clients) {
+            if (socket->bytesToWrite() > kMaxPendingBytes) {
+                skipped++;
+                continue;
+            }
+            socket->write(part);
+            sent++;
+        }
+    }
+
+    void printStats()
+    {
+        int clients = 0;
+        for (const Camera &camera : cameras) {
+            clients += camera.clients.size();
+        }
+        std::cout << "clients " << clients << ", frames sent " << sent << ", skipped "
+                  << skipped << std::endl;
+    }
+
+    SourceConfig config;
+    std::vector<QByteArray> frames;
+    std::vector<Camera> cameras;
+    QTcpServer server;
+    QTimer statsTimer;
+    uint64_t sent = 0;
+    uint64_t skipped = 0;
+};
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    SourceConfig config;
+    int port = 18080;
+    for (int i = 1; i < argc; ++i) {
+        const bool hasValue = i + 1 < argc;
+        int *value = nullptr;
+        if (!std::strcmp(argv[i], "--port")) {
+            value = &port;
+        } else if (!std::strcmp(argv[i], "--cameras")) {
+            value = &config.cameras;
+        } else if (!std::strcmp(argv[i], "--width")) {
+            value = &config.width;
+        } else if (!std::strcmp(argv[i], "--height")) {
+            value = &config.height;
+        } else if (!std::strcmp(argv[i], "--fps")) {
+            value = &config.fps;
+        } else if (!std::strcmp(argv[i], "--loop-seconds")) {
+            value = &config.loopSeconds;
+        } else if (!std::strcmp(argv[i], "--quality")) {
+            value = &config.quality;
+        }
+        if (!value || !hasValue || std::atoi(argv[i + 1]) <= 0) {
+            std::cerr << "Invalid option " << argv[i] << std::endl;
+            return 1;
+        }
+        *value = std::atoi(argv[++i]);
+    }
+
+    std::vector<QByteArray> frames = renderLoop(config);
+    size_t bytes = 0;
+    for (const QByteArray &frame : frames) {
+        bytes += frame.size();
+    }
+    const size_t frameBytes = bytes / frames.size();
+    CameraServer server(config, std::move(frames));
+    if (!server.listen(static_cast<quint16>(port))) {
+        return 1;
+    }
+    std::cout << config.cameras << " cameras " << config.width << "x" << config.height << " @ "
+              << config.fps << " fps on http://127.0.0.1:" << port << "/video/<i>, "
+              << frameBytes / 1024 << " KB/frame" << std::endl;
+    return app.exec();
+}
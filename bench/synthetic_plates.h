@@ -0,0 +1,84 @@
+#pragma once
+
+// Синтетические номера для бенчмарков и нагрузочного теста: текст российского
+// номера латиницей (как его выдает CRNN) и его картинка - на кадре или
+// отдельной вырезкой с известным наклоном. Генератор один на все бенчмарки,
+// чтобы их входные данные не расходились.
+
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <string>
+
+const char kPlateLetters[] = "ABEKMHOPCTYX";
+const int kPlateLetterCount = 12;
+
+// Случайное число из [0, n): cv::RNG или генератор из <random>
+inline int plateRandom(cv::RNG &rng, int n)
+{
+    return rng.uniform(0, n);
+}
+
+template <typename Engine>
+int plateRandom(Engine &rng, int n)
+{
+    return static_cast<int>(rng() % n);
+}
+
+// A123BC, с region - еще код региона из 2-3 цифр (A123BC77, A123BC777)
+template <typename Rng>
+std::string makePlateText(Rng &rng, bool region = true)
+{
+    auto letter = [&rng]() { return kPlateLetters[plateRandom(rng, kPlateLetterCount)]; };
+    auto digits = [&rng](std::string &text, int count) {
+        for (int i = 0; i < count; ++i) {
+            text += static_cast<char>('0' + plateRandom(rng, 10));
+        }
+    };
+    std::string text(1, letter());
+    digits(text, 3);
+    text += letter();
+    text += letter();
+    if (region) {
+        digits(text, plateRandom(rng, 3) == 0 ? 3 : 2);
+    }
+    return text;
+}
+
+// Номер на кадре: белый прямоугольник с рамкой и символами
+inline void drawPlate(cv::Mat &frame, const cv::Rect &rect, const std::string &text)
+{
+    cv::rectangle(frame, rect, cv::Scalar(245, 245, 245), -1);
+    cv::rectangle(frame, rect, cv::Scalar(20, 20, 20), std::max(1, rect.height / 20));
+    cv::putText(frame, text, rect.tl() + cv::Point(rect.height / 5, rect.height * 4 / 5),
+                cv::FONT_HERSHEY_SIMPLEX, rect.height / 30.0, cv::Scalar(10, 10, 10),
+                std::max(1, rect.height / 12));
+}
+
+// Вырезка номера шириной width: номер 520x112 с шумом и полями 30 px,
+// повернутый на tilt градусов (исправляется поворотом на -tilt)
+inline cv::Mat makePlateCrop(const std::string &text, double tilt, int width, cv::RNG &rng)
+{
+    cv::Mat plate(112, 520, CV_8UC3);
+    drawPlate(plate, cv::Rect(0, 0, plate.cols, plate.rows), text);
+
+    // Шум со знаком, иначе насыщение uchar срежет отрицательную половину
+    cv::Mat noisy, noise(plate.size(), CV_16SC3);
+    rng.fill(noise, cv::RNG::NORMAL, cv::Scalar::all(0), cv::Scalar::all(12));
+    plate.convertTo(noisy, CV_16SC3);
+    noisy += noise;
+    noisy.convertTo(plate, CV_8UC3);
+
+    cv::Mat padded;
+    cv::copyMakeBorder(plate, padded, 30, 30, 30, 30, cv::BORDER_CONSTANT,
+                       cv::Scalar(120, 120, 120));
+    const cv::Point2f center(padded.cols / 2.0f, padded.rows / 2.0f);
+    const cv::Mat M = cv::getRotationMatrix2D(center, tilt, 1.0);
+    cv::Mat rotated;
+    cv::warpAffine(padded, rotated, M, padded.size(), cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+
+    cv::Mat crop;
+    cv::resize(rotated, crop, cv::Size(width, rotated.rows * width / rotated.cols), 0, 0,
+               cv::INTER_AREA);
+    return crop;
+}
@@ -0,0 +1,214 @@
+// Проверка прочтений по спискам номеров (PlateWatchlist): задержка поиска в
+// зависимости от размера списка и пауза проверок при перечитывании файла.
+//
+//   watchlist_bench [--sizes 10000,100000,1000000,10000000] [--queries N]
+//                   [--distance k] [--dir path]
+//
+// Для каждого размера пишется файл случайных номеров вида A123BC77(7),
+// индекс собирается из файла, затем прочтения пяти видов: номер из списка
+// как есть, с путаницей OCR (O/0, B/8 ...), с пропущенным символом, с чужой
+// заменой и номер не из списка. Последним идет перечитывание самого большого
+// списка, пока второй поток непрерывно проверяет номера: максимум задержки
+// проверки за это время показывает, что подмена индекса проверки не держит.
+
+#include <QDir>
+#include <QString>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "plate_watchlist.h"
+#include "synthetic_plates.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+const char kSymbols[] = "0123456789ABCEHKMOPTXY";
+
+// Типичная путаница CRNN в одном символе; номер без таких символов - как есть
+std::string confuse(std::string plate, std::mt19937_64 &rng)
+{
+    static const char *kPairs[] = {"0O", "O0", "8B", "B8", "4A", "A4", "7T", "T7"};
+    const size_t start = rng() % plate.size();
+    for (size_t k = 0; k < plate.size(); ++k) {
+        const size_t i = (start + k) % plate.size();
+        for (const char *pair : kPairs) {
+            if (plate[i] == pair[0]) {
+                plate[i] = pair[1];
+                return plate;
+            }
+        }
+    }
+    return plate;
+}
+
+struct Latency
+{
+    std::vector<double> us;
+    uint64_t results = 0;
+
+    void print(const char *name)
+    {
+        std::sort(us.begin(), us.end());
+        auto at = [&](double q) { return us[std::min(us.size() - 1, size_t(q * us.size()))]; };
+        std::cout << "    " << std::setw(10) << name << ": p50 " << at(0.5) << " us, p99 "
+                  << at(0.99) << " us, max " << us.back() << " us, "
+                  << double(results) / us.size() << " hits/query\n";
+    }
+};
+
+double elapsedUs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::vector<size_t> sizes = {10000, 100000, 1000000, 10000000};
+    int queries = 20000;
+    double distance = 1.0;
+    std::string dir = QDir::tempPath().toStdString() + "/lpr_watchlist_bench";
+    for (int i = 1; i < argc; ++i) {
+        const bool hasValue = i + 1 < argc;
+        if (!std::strcmp(argv[i], "--sizes") && hasValue) {
+            sizes.clear();
+            for (const QString &size : QString(argv[++i]).split(',')) {
+                if (size.toLongLong() > 0) {
+                    sizes.push_back(size.toLongLong());
+                }
+            }
+        } else if (!std::strcmp(argv[i], "--queries") && hasValue) {
+            queries = std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--distance") && hasValue) {
+            distance = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--dir") && hasValue) {
+            dir = argv[++i];
+        }
+    }
+    if (sizes.empty()) {
+        std::cerr << "No list sizes" << std::endl;
+        return 1;
+    }
+    std::sort(sizes.begin(), sizes.end());
+    std::filesystem::create_directories(dir);
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Queries " << queries << " per kind, distance " << distance << std::endl;
+
+    std::mt19937_64 rng(12345);
+    std::string lastPath;
+    WatchlistConfig lastConfig;
+    for (size_t size : sizes) {
+        const std::string path = dir + "/watchlist_" + std::to_string(size) + ".txt";
+        std::vector<std::string> sample; // номера из списка для запросов
+        {
+            std::ofstream file(path);
+            const size_t every = std::max<size_t>(1, size / queries);
+            for (size_t i = 0; i < size; ++i) {
+                const std::string plate = makePlateText(rng);
+                file << plate << "\n";
+                if (i % every == 0) {
+                    sample.push_back(plate);
+                }
+            }
+        }
+
+        WatchlistConfig config;
+        config.files << QString::fromStdString(path);
+        config.maxDistance = distance;
+        PlateWatchlist watchlist(config);
+        QString error;
+        const auto loadStart = Clock::now();
+        if (!watchlist.load(error)) {
+            std::cerr << error.toStdString() << std::endl;
+            return 1;
+        }
+        std::cout << "list " << size << ": " << watchlist.size() << " plates, load "
+                  << elapsedUs(loadStart) / 1e6 << " s, file "
+                  << std::filesystem::file_size(path) / (1024.0 * 1024.0) << " MB" << std::endl;
+
+        Latency exact, confused, dropped, replaced, missing, lookup;
+        for (int q = 0; q < queries; ++q) {
+            const std::string &plate = sample[q % sample.size()];
+
+            std::string dropRead = plate;
+            dropRead.erase(rng() % dropRead.size(), 1);
+            std::string replaceRead = plate;
+            const size_t position = rng() % replaceRead.size();
+            do {
+                replaceRead[position] = kSymbols[rng() % 22];
+            } while (replaceRead == plate);
+
+            auto measure = [&](Latency &latency, const std::string &read) {
+                const QString text = QString::fromStdString(read);
+                const auto start = Clock::now();
+                latency.results += watchlist.match(text).size();
+                latency.us.push_back(elapsedUs(start));
+            };
+            measure(exact, plate);
+            measure(confused, confuse(plate, rng));
+            measure(dropped, dropRead);
+            measure(replaced, replaceRead);
+            measure(missing, makePlateText(rng));
+
+            const QString text = QString::fromStdString(plate);
+            const auto start = Clock::now();
+            lookup.results += watchlist.contains(text) ? 1 : 0;
+            lookup.us.push_back(elapsedUs(start));
+        }
+        lookup.print("contains");
+        exact.print("exact");
+        confused.print("confusion");
+        dropped.print("dropped");
+        replaced.print("replaced");
+        missing.print("missing");
+
+        lastPath = path;
+        lastConfig = config;
+    }
+
+    // Перечитывание самого большого списка на фоне непрерывных проверок
+    PlateWatchlist watchlist(lastConfig);
+    QString error;
+    watchlist.load(error);
+    std::atomic<bool> done{false};
+    std::vector<double> duringReload;
+    std::thread checker([&]() {
+        std::mt19937_64 local(7);
+        do {
+            const QString text = QString::fromStdString(makePlateText(local));
+            const auto start = Clock::now();
+            watchlist.match(text);
+            duringReload.push_back(elapsedUs(start));
+        } while (!done.load());
+    });
+    {
+        std::ofstream file(lastPath, std::ios::app);
+        file << makePlateText(rng) << "\n";
+    }
+    const auto reloadStart = Clock::now();
+    const bool reloaded = watchlist.reloadIfChanged(error);
+    const double reloadUs = elapsedUs(reloadStart);
+    done = true;
+    checker.join();
+    std::sort(duringReload.begin(), duringReload.end());
+    std::cout << "reload " << sizes.back() << ": " << (reloaded ? "done" : "not changed") << " in "
+              << reloadUs / 1e6 << " s, " << duringReload.size() << " checks meanwhile, p99 "
+              << duringReload[std::min(duringReload.size() - 1, size_t(0.99 * duringReload.size()))]
+              << " us, max " << duringReload.back() << " us" << std::endl;
+
+    std::filesystem::remove_all(dir);
+    return 0;
+}
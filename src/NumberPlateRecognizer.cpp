@@ -7,29 +7,34 @@
 
 #define DUMP_TO_FILE
 
-NumberPlateRecognizer::NumberPlateRecognizer(QObject *parent)
+// Уже этого изображение перед отправкой не уменьшается: мельче сервер номер не прочтет
+static const int kMinSentWidth = 160;
+
+NumberPlateRecognizer::NumberPlateRecognizer(const StreamConfig &config, PlateDetector *detector,
+                                             YoloPlateDetector *yoloDetector,
+                                             AsyncOCRClient *ocrClient, PlateOcrEngine *ocrEngine,
+                                             QObject *parent)
     : QObject(parent)
+    , config(config)
+    , plateDetector(detector)
+    , yoloDetector(yoloDetector)
+    , capture(config.id, config.url.toStdString(), streamStats, config.nativeMjpeg)
+    , ocrInterval(config.ocrIntervalMs)
+    , burstInterval(config.burstIntervalMs)
+    , motionHold(config.motionHoldMs)
+    , tracker(config.id, config.tracker)
+    , cache(config.cache)
+    , decodedFrames(8, &streamStats.bufferPoolMisses)
+    , ocrClient(ocrClient)
+    , ocrEngine(ocrEngine)
 {
-    std::cout << "Initializing Number Plate Recognizer..." << std::endl;
-
-    // Загрузка каскада для детекции номеров
-    std::string cascadePath = "haarcascade_russian_plate_number.xml";
-    if (!plateCascade.load(cascadePath)) {
-        std::cerr << "Could not load plate cascade from: " << cascadePath << std::endl;
-        std::cerr << "Using contour-based detection only" << std::endl;
+    // Полосы из файла; без них --roi - одна прямоугольная полоса
+    editedLanes = config.lanes;
+    if (editedLanes.empty() && !config.roi.empty()) {
+        editedLanes.push_back(RoiSet::rectLane(config.roi));
     }
-
-    // Инициализация переменных для ROI
-    roiSelectionMode = false;
-    roiSelected = false;
-    selectedROI = cv::Rect();
-
-    // Инициализация OCR клиента
-    ocrClient = new AsyncOCRClient(this);
-    connect(ocrClient, &AsyncOCRClient::plateRecognized, this,
-            &NumberPlateRecognizer::onOCRResultReceived);
-
-    std::cout << "Number Plate Recognizer initialized successfully!" << std::endl;
+    selectedROI = config.roi;
+    std::atomic_store(&roiSet, RoiSet::build(editedLanes));
 }
 
 NumberPlateRecognizer::~NumberPlateRecognizer()
@@ -37,15 +42,19 @@ NumberPlateRecognizer::~NumberPlateRecognizer()
     stopProcessing();
 }
 
-void NumberPlateRecognizer::startProcessing(const QString &url)
+void NumberPlateRecognizer::startProcessing(std::function<void()> onFrameReady,
+                                            std::function<void()> onFinished)
 {
-    stopFlag = false;
-    processIPCamera(url.toStdString());
+    // Таймеры и фон детектора движения полос начинаются заново
+    activeSet.reset();
+    laneStates.clear();
+    capture.start(std::move(onFrameReady), std::move(onFinished));
 }
 
 void NumberPlateRecognizer::stopProcessing()
 {
-    stopFlag = true;
+    capture.stop();
+    reportVehicles(tracker.flush());
 }
 
 void NumberPlateRecognizer::enableROISelection()
@@ -54,124 +63,651 @@ void NumberPlateRecognizer::enableROISelection()
     qDebug() << "ROI selection enabled";
 }
 
+// Без файла полос выбранный прямоугольник заменяет ROI, как раньше; с файлом
+// он добавляется новой полосой, а многоугольники правятся в самом файле
 void NumberPlateRecognizer::saveROI()
 {
-    roiSelected = true;
-    roiSelectionMode = false;
-    qDebug() << "ROI saved:" << selectedROI.width << "x" << selectedROI.height;
-    emit roiUpdated(selectedROI.x, selectedROI.y, selectedROI.width, selectedROI.height);
+    cv::Rect roi;
+    std::vector<LaneRoi> lanes;
+    {
+        std::lock_guard<std::mutex> lock(roiMutex);
+        roiSelectionMode = false;
+        roi = selectedROI;
+        if (config.lanesFile.isEmpty()) {
+            editedLanes.clear();
+        }
+        if (!roi.empty()) {
+            int next = config.lanesFile.isEmpty() ? 0 : 1;
+            for (const LaneRoi &lane : editedLanes) {
+                next = std::max(next, lane.lane + 1);
+            }
+            editedLanes.push_back(RoiSet::rectLane(roi, next));
+        }
+        lanes = editedLanes;
+    }
+    publishLanes(lanes);
+    qDebug() << "ROI saved:" << roi.width << "x" << roi.height;
+    emit roiUpdated(roi.x, roi.y, roi.width, roi.height);
 }
 
 void NumberPlateRecognizer::clearROI()
 {
-    roiSelected = false;
+    {
+        std::lock_guard<std::mutex> lock(roiMutex);
+        editedLanes.clear();
+    }
+    publishLanes(std::vector<LaneRoi>());
     qDebug() << "ROI cleared";
 }
 
-// Детекция области с номером с каскадом Хаара
-cv::Mat NumberPlateRecognizer::detectPlate(cv::Mat image)
+void NumberPlateRecognizer::setLanes(const std::vector<LaneRoi> &lanes)
 {
-    std::vector<cv::Rect> plates;
+    {
+        std::lock_guard<std::mutex> lock(roiMutex);
+        editedLanes = lanes;
+    }
+    publishLanes(lanes);
+}
 
-    plateCascade.detectMultiScale(image, plates, 1.1, 10, 0);
-    if (plates.empty()) {
-        return {};
+// Маски строятся здесь, в потоке окна; шаг камеры получает готовый набор
+void NumberPlateRecognizer::publishLanes(const std::vector<LaneRoi> &lanes)
+{
+    std::atomic_store(&roiSet, RoiSet::build(lanes));
+
+    QString error;
+    if (!config.lanesFile.isEmpty() && !saveLanes(config.lanesFile, lanes, error)) {
+        std::cerr << "[" << config.id << "] " << error.toStdString() << std::endl;
     }
+}
+
+// Просмотр включается, пока подключен хотя бы один зритель (окно GUI или
+// клиент PreviewServer); без зрителей кадры для просмотра не сохраняются
+void NumberPlateRecognizer::attachPreview()
+{
+    previewViewers.fetch_add(1);
+}
 
-    return image(plates[0]);
+void NumberPlateRecognizer::detachPreview()
+{
+    if (previewViewers.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(previewMutex);
+        previewFrame = CapturedFrame();
+        previewPlates.clear();
+    }
 }
 
-// Обработка IP-камеры
-void NumberPlateRecognizer::processIPCamera(const std::string &url)
+// Вызывается из потока окна. Под мьютексом только ссылка на кадр: шаг камеры
+// не ждет ни декодирования, ни отрисовки
+bool NumberPlateRecognizer::previewImage(const cv::Size &target, cv::Mat &image,
+                                         cv::Size &frameSize)
 {
-    std::cout << "Connecting to IP camera: " << url << std::endl;
+    CapturedFrame frame;
+    {
+        std::lock_guard<std::mutex> lock(previewMutex);
+        frame = previewFrame;
+    }
+    if (!frame.image.empty()) {
+        image = frame.image;
+        frameSize = image.size();
+        return true;
+    }
+    if (frame.jpeg.isEmpty() || !MjpegReader::jpegSize(frame.jpeg, frameSize)) {
+        return false;
+    }
 
-    cv::VideoCapture cap(url);
-    if (!cap.isOpened()) {
-        std::cerr << "Error opening IP camera: " << url << std::endl;
+    int scale = 8;
+    while (scale > 1 && (frameSize.width / scale < target.width
+                         || frameSize.height / scale < target.height)) {
+        scale /= 2;
+    }
+    const int flags = scale == 8   ? cv::IMREAD_REDUCED_COLOR_8
+                      : scale == 4 ? cv::IMREAD_REDUCED_COLOR_4
+                      : scale == 2 ? cv::IMREAD_REDUCED_COLOR_2
+                                   : cv::IMREAD_COLOR;
+    return MjpegReader::decode(frame.jpeg, flags, image);
+}
+
+NumberPlateRecognizer::PreviewOverlay NumberPlateRecognizer::previewOverlay()
+{
+    PreviewOverlay overlay;
+    overlay.lanes = std::atomic_load(&roiSet);
+    {
+        std::lock_guard<std::mutex> lock(roiMutex);
+        if (roiSelectionMode && (drawing || (selectedROI.width > 0 && selectedROI.height > 0))) {
+            overlay.selection = selectedROI;
+        }
+    }
+
+    const auto since = std::chrono::steady_clock::now() - std::chrono::seconds(1);
+    std::lock_guard<std::mutex> lock(previewMutex);
+    while (!previewPlates.empty() && previewPlates.front().time < since) {
+        previewPlates.pop_front();
+    }
+    for (const RecentPlate &recent : previewPlates) {
+        overlay.plates.push_back(recent.plate);
+    }
+    return overlay;
+}
+
+// Вызывается из потока зрителя: копия последнего кадра с разметкой ROI
+bool NumberPlateRecognizer::previewSnapshot(cv::Mat &displayFrame)
+{
+    CapturedFrame frame;
+    {
+        std::lock_guard<std::mutex> lock(previewMutex);
+        frame = previewFrame;
+    }
+    displayFrame = frame.image.empty() ? MjpegReader::decode(frame.jpeg) : frame.image.clone();
+    if (displayFrame.empty()) {
+        return false;
+    }
+
+    // Полосы с номерами; прямоугольная полоса без файла - обычный ROI
+    const std::shared_ptr<const RoiSet> set = std::atomic_load(&roiSet);
+    for (const RoiSet::Lane &lane : set->lanes) {
+        if (lane.roi.polygon.empty()) {
+            continue;
+        }
+        cv::polylines(displayFrame, std::vector<std::vector<cv::Point>>{lane.roi.polygon}, true,
+                      cv::Scalar(0, 255, 0), 2);
+        if (lane.roi.lane > 0) {
+            cv::putText(displayFrame, std::to_string(lane.roi.lane),
+                        lane.bounds.tl() + cv::Point(6, 24), cv::FONT_HERSHEY_SIMPLEX, 0.8,
+                        cv::Scalar(0, 255, 0), 2);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(roiMutex);
+        // Режим выбора ROI - рисуем прямоугольник
+        if (roiSelectionMode && (drawing || (selectedROI.width > 0 && selectedROI.height > 0))) {
+            cv::rectangle(displayFrame, selectedROI, cv::Scalar(0, 255, 255), 2);
+        }
+    }
+    return true;
+}
+
+// Детекция областей с номером: YOLO, если загружен, иначе каскад Хаара
+std::vector<cv::Rect> NumberPlateRecognizer::detectPlate(const cv::Mat &image)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::vector<cv::Rect> plates =
+        yoloDetector ? yoloDetector->detect(image) : plateDetector->detect(image);
+    streamStats.detectTime.record(std::chrono::steady_clock::now() - start);
+    return plates;
+}
+
+bool NumberPlateRecognizer::hasDetector() const
+{
+    return yoloDetector || plateDetector->isLoaded();
+}
+
+// Один шаг обработки: берем самый свежий кадр, готовим и отправляем на распознавание
+bool NumberPlateRecognizer::processLatest()
+{
+    CapturedFrame captured;
+    if (!capture.takeLatest(captured)) {
+        return false;
+    }
+
+    processFrame(captured);
+    return true;
+}
+
+void NumberPlateRecognizer::processFrame(CapturedFrame &captured)
+{
+    // Кадр для просмотра запоминаем только при подключенных зрителях, ссылкой
+    // без копии. Буфер из пула захвата, но пул не заполняет буфер, на который
+    // еще есть ссылки (isSoleOwner), так что кадр не перепишется под зрителем.
+    // Зато пока зритель подключен, этот буфер занят и в пуле на один меньше
+    if (previewViewers.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<std::mutex> lock(previewMutex);
+        previewFrame = captured;
+    }
+
+    // Машины, которых давно не видно
+    reportVehicles(tracker.expire(std::chrono::steady_clock::now()));
+
+    // Размер кадра MJPEG берем из заголовка JPEG, не декодируя
+    cv::Size frameSize = captured.image.size();
+    if (captured.image.empty() && !MjpegReader::jpegSize(captured.jpeg, frameSize)) {
+        frameSize = decodedImage(captured).size();
+    }
+
+    // Режим выбора ROI - только показываем видео
+    if (roiSelectionMode.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    // Набор полос берется один раз на кадр: правка из окна не меняет его
+    // посреди кадра, старый набор живет, пока кадр на него ссылается
+    const std::shared_ptr<const RoiSet> set = std::atomic_load(&roiSet);
+    if (set != activeSet) {
+        syncLanes(set);
+    }
+
+    // Решения по таймеру и движению - по очереди: детектор движения делит
+    // уменьшенную копию кадра между полосами
+    const cv::Rect frameRect(cv::Point(), frameSize);
+    triggeredLanes.clear();
+    for (size_t i = 0; i < set->lanes.size(); ++i) {
+        const RoiSet::Lane &lane = set->lanes[i];
+        const cv::Rect area = lane.bounds.empty() ? frameRect : lane.bounds & frameRect;
+        if (!area.empty() && shouldSubmit(captured, area, lane, *laneStates[i])) {
+            triggeredLanes.push_back(i);
+        }
+    }
+
+    if (triggeredLanes.empty()) {
+        streamStats.framesSkipped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    streamStats.framesTriggered.fetch_add(1, std::memory_order_relaxed);
+
+    // Одна полоса - в этом потоке; весь кадр MJPEG так и уходит без декодирования
+    if (triggeredLanes.size() == 1) {
+        const size_t i = triggeredLanes.front();
+        submitForRecognition(captured, set->lanes[i], *laneStates[i], frameSize);
+        return;
+    }
+
+    // Несколько полос - параллельно в потоках OpenCV. Кадр декодируется до
+    // параллельной части: дальше полосы его только читают
+    if (decodedImage(captured).empty()) {
+        streamStats.requestsFailed.fetch_add(1, std::memory_order_relaxed);
         return;
     }
+    cv::parallel_for_(cv::Range(0, static_cast<int>(triggeredLanes.size())),
+                      [&](const cv::Range &range) {
+                          for (int k = range.start; k < range.end; ++k) {
+                              const size_t i = triggeredLanes[k];
+                              submitForRecognition(captured, set->lanes[i], *laneStates[i],
+                                                   frameSize);
+                          }
+                      });
+}
 
-    std::cout << "Successfully connected to IP camera!" << std::endl;
+// Состояния переносятся по номеру полосы: добавленная или удаленная полоса
+// не сбрасывает таймеры и фон детектора движения остальных. Полоса с другим
+// прямоугольником начинает заново
+void NumberPlateRecognizer::syncLanes(const std::shared_ptr<const RoiSet> &set)
+{
+    std::vector<std::unique_ptr<LaneState>> states;
+    for (const RoiSet::Lane &lane : set->lanes) {
+        auto it = std::find_if(laneStates.begin(), laneStates.end(),
+                               [&lane](const std::unique_ptr<LaneState> &state) {
+                                   return state && state->lane == lane.roi.lane
+                                          && state->bounds == lane.bounds;
+                               });
+        if (it != laneStates.end()) {
+            states.push_back(std::move(*it));
+            continue;
+        }
+        states.push_back(std::unique_ptr<LaneState>(
+            new LaneState(lane, config.motion, &streamStats.bufferPoolMisses)));
+        states.back()->lastOcrTime = std::chrono::steady_clock::now();
+    }
+    laneStates.swap(states);
+    activeSet = set;
+}
 
-    cv::Mat frame;
+// Декодированный кадр; кадр MJPEG декодируется при первом обращении, так что
+// выброшенные и пропущенные по таймеру кадры не декодируются вовсе
+const cv::Mat &NumberPlateRecognizer::decodedImage(CapturedFrame &captured)
+{
+    if (captured.image.empty() && !captured.jpeg.isEmpty()) {
+        auto start = std::chrono::steady_clock::now();
+        captured.image = decodedFrames.acquire([&captured](cv::Mat &image) {
+            return MjpegReader::decode(captured.jpeg, cv::IMREAD_COLOR, image);
+        });
+        streamStats.decodeTime.record(std::chrono::steady_clock::now() - start);
+    }
+    return captured.image;
+}
 
-    // Настройки размера окна
-    const std::string WINDOW_NAME = "Number Plate Recognition";
-    const int TARGET_WIDTH = 1280;
-    const int TARGET_HEIGHT = 720;
+// ROI для детектора движения. Ему нужна серая копия шириной MotionConfig::width,
+// поэтому кадр MJPEG декодируется сразу уменьшенным в 2-8 раз и в оттенках
+// серого: это в разы дешевле полного декодирования
+cv::Mat NumberPlateRecognizer::motionArea(CapturedFrame &captured, const cv::Rect &roi)
+{
+    int scale = 8;
+    while (scale > 1 && roi.width / scale < config.motion.width) {
+        scale /= 2;
+    }
+    if (scale == 1 || !captured.image.empty() || captured.jpeg.isEmpty()) {
+        const cv::Mat &image = decodedImage(captured);
+        return image.empty() ? cv::Mat() : image(roi);
+    }
 
-    // Создаем resizeable окно
-    cv::namedWindow(WINDOW_NAME, cv::WINDOW_NORMAL);
-    cv::resizeWindow(WINDOW_NAME, TARGET_WIDTH, TARGET_HEIGHT);
-    cv::setMouseCallback(WINDOW_NAME, onMouse, this);
+    // Полосы одного кадра с тем же масштабом берут уже декодированную копию
+    if (reducedFrameId != captured.frameId || reducedScale != scale) {
+        const int flags = scale == 8   ? cv::IMREAD_REDUCED_GRAYSCALE_8
+                          : scale == 4 ? cv::IMREAD_REDUCED_GRAYSCALE_4
+                                       : cv::IMREAD_REDUCED_GRAYSCALE_2;
+        auto start = std::chrono::steady_clock::now();
+        if (!MjpegReader::decode(captured.jpeg, flags, reducedFrame)) {
+            reducedFrame.release();
+        }
+        streamStats.decodeTime.record(std::chrono::steady_clock::now() - start);
+        reducedFrameId = captured.frameId;
+        reducedScale = scale;
+    }
 
-    // Таймер для ограничения частоты запросов
-    auto last_ocr_time = std::chrono::steady_clock::now();
-    const std::chrono::milliseconds ocr_interval(300); // 1 секунда
+    cv::Rect scaled(roi.x / scale, roi.y / scale, roi.width / scale, roi.height / scale);
+    scaled &= cv::Rect(0, 0, reducedFrame.cols, reducedFrame.rows);
+    return scaled.empty() ? cv::Mat() : reducedFrame(scaled);
+}
 
-    int frameNum = 0;
-    while (!stopFlag) {
-        cap >> frame;
-        if (frame.empty()) {
-            std::cerr << "Failed to grab frame from IP camera" << std::endl;
-            break;
+// Решает, отправлять ли полосу кадра: по таймеру или по движению в ней.
+// Движение ищется в описанном прямоугольнике полосы, без маски
+bool NumberPlateRecognizer::shouldSubmit(CapturedFrame &captured, const cv::Rect &area,
+                                         const RoiSet::Lane &lane, LaneState &state)
+{
+    auto current_time = std::chrono::steady_clock::now();
+    auto time_since_last_ocr = current_time - state.lastOcrTime;
+
+    std::chrono::milliseconds interval = ocrInterval;
+    if (config.trigger == OcrTrigger::Motion) {
+        // Статичная сцена - не отправляем ничего; пока есть движение - серия кадров
+        MotionDetector &motion = state.motionDetector;
+        if (motion.isActive(motion.update(motionArea(captured, area)))) {
+            state.lastMotionTime = current_time;
+        } else if (current_time - state.lastMotionTime > motionHold) {
+            return false;
         }
+        interval = burstInterval;
+    }
+    if (lane.roi.intervalMs > 0) {
+        interval = std::chrono::milliseconds(lane.roi.intervalMs);
+    }
+
+    const double scale = streamQuality.current().intervalScale;
+    interval = std::chrono::duration_cast<std::chrono::milliseconds>(interval * scale);
+    if (time_since_last_ocr < interval) {
+        return false;
+    }
 
-        ++frameNum;
-        // Создаем копию для отрисовки
-        cv::Mat displayFrame = frame.clone();
-        // Получаем текущий ROI (если не выбран - используем весь кадр)
-        cv::Rect currentROI = roiSelected ? selectedROI : cv::Rect(0, 0, frame.cols, frame.rows);
-
-        // Рисуем интерфейс в зависимости от режима
-        if (roiSelectionMode) {
-            // Режим выбора ROI - только показываем видео и рисуем прямоугольник
-            if (drawing || (selectedROI.width > 0 && selectedROI.height > 0)) {
-                cv::rectangle(displayFrame, selectedROI, cv::Scalar(0, 255, 255), 2);
+    state.lastOcrTime = current_time;
+    return true;
+}
+
+// Изображение полосы: ROI кадра без копии, а у многоугольника - копия
+// описанного прямоугольника с черным фоном снаружи, чтобы детектор и сервер
+// не видели соседние полосы. Копии берутся из пула полосы: запросы в очереди
+// клиента держат на них ссылки
+cv::Mat NumberPlateRecognizer::laneImage(CapturedFrame &captured, const RoiSet::Lane &lane,
+                                         LaneState &state, const cv::Rect &area)
+{
+    const cv::Mat &image = decodedImage(captured);
+    if (image.empty() || lane.mask.empty()) {
+        return image.empty() ? cv::Mat() : image(area);
+    }
+
+    const cv::Mat mask = lane.mask(area - lane.bounds.tl());
+    return state.maskedAreas.acquire([&](cv::Mat &masked) {
+        masked.create(area.size(), image.type());
+        masked.setTo(cv::Scalar::all(0));
+        image(area).copyTo(masked, mask);
+        return true;
+    });
+}
+
+// Полный кадр или ROI на сервер. Весь кадр MJPEG уходит в исходных байтах
+// камеры - без декодирования и повторного сжатия
+void NumberPlateRecognizer::submitArea(CapturedFrame &captured, const RoiSet::Lane &lane,
+                                       LaneState &state, const cv::Rect &roi,
+                                       const cv::Size &frameSize, bool audit)
+{
+    if (!captured.jpeg.isEmpty() && lane.mask.empty() && roi == cv::Rect(cv::Point(), frameSize)) {
+        submitEncoded(captured, roi, lane.roi.lane, audit);
+        return;
+    }
+    const cv::Mat area = laneImage(captured, lane, state, roi);
+    if (area.empty()) {
+        streamStats.requestsFailed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    submitImage(captured, area, OcrRequestKind::FullFrame, roi, lane.roi.lane, audit);
+}
+
+// Вызывается параллельно для полос одного кадра: общие детекторы, трекер,
+// кэш, клиент и таблица оценки полноты защищены своими блокировками
+void NumberPlateRecognizer::submitForRecognition(CapturedFrame &captured,
+                                                 const RoiSet::Lane &lane, LaneState &state,
+                                                 const cv::Size &frameSize)
+{
+    const cv::Rect frameRect(cv::Point(), frameSize);
+    const cv::Rect roi = lane.bounds.empty() ? frameRect : lane.bounds & frameRect;
+    GateMode mode = hasDetector() ? config.gateMode : GateMode::Off;
+
+    // Локальный CRNN читает только вырезки, номер на кадре ищет детектор
+    if (ocrEngine && hasDetector() && mode == GateMode::Off) {
+        mode = GateMode::On;
+    }
+
+    if (mode == GateMode::Off) {
+        submitArea(captured, lane, state, roi, frameSize, false);
+        return;
+    }
+
+    // Детектору и вырезкам нужен кадр в полном разрешении
+    cv::Mat roiArea = laneImage(captured, lane, state, roi);
+    if (roiArea.empty()) {
+        streamStats.requestsFailed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // Локальный детектор: на сервер уходят только вырезки с номерами
+    auto cropStart = std::chrono::steady_clock::now();
+    std::vector<cv::Rect> plates = detectPlate(roiArea);
+    streamStats.gateCandidates.fetch_add(plates.size(), std::memory_order_relaxed);
+    if (plates.empty()) {
+        streamStats.gateRejected.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (mode == GateMode::Audit) {
+        // Регистрируем кадр до отправки, ответы приходят из другого потока
+        {
+            std::lock_guard<std::mutex> lock(auditMutex);
+            GateAudit &audit = audits[std::make_pair(captured.frameId, lane.roi.lane)];
+            audit.candidates = static_cast<int>(plates.size());
+            audit.pendingCrops = static_cast<int>(plates.size());
+
+            // Ответы на потерянные запросы не придут - не даем таблице расти
+            while (audits.size() > 256) {
+                audits.erase(audits.begin());
             }
-        } else {
-            // Обычный режим - отправляем кадры на распознавание
-            auto current_time = std::chrono::steady_clock::now();
-            auto time_since_last_ocr = current_time - last_ocr_time;
-
-            if (time_since_last_ocr >= ocr_interval) {
-                cv::Mat roiArea = frame(currentROI);
-                if (!roiArea.empty()) {
-                    ocrClient->submitFrameForRecognition(roiArea);
-                    last_ocr_time = current_time;
-                }
+        }
+    }
+
+    const double padding = plateDetector->detectorConfig().padding;
+    std::vector<cv::Mat> &crops = state.crops;
+    std::vector<cv::Rect> &boxes = state.boxes;
+    std::vector<uint64_t> &hashes = state.hashes;
+    std::vector<OcrResult> &cached = state.cached;
+    for (const cv::Rect &plate : plates) {
+        cv::Rect padded = PlateDetector::padRect(plate, padding, roiArea.size());
+
+        // Номер машины, уже уверенно прочитанный, повторно не читаем
+        // (в режиме оценки полноты нужны все ответы)
+        if (mode != GateMode::Audit && tracker.isSettled(padded + roi.tl(), captured.captureTime)) {
+            streamStats.cropsSettled.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        crops.push_back(roiArea(padded));
+        boxes.push_back(padded + roi.tl());
+    }
+
+    if (config.deskew && !crops.empty()) {
+        auto start = std::chrono::steady_clock::now();
+        for (cv::Mat &crop : crops) {
+            const double angle = state.deskew.estimateAngle(crop);
+            if (std::abs(angle) < PlateDeskew::kMinAngle) {
+                continue;
             }
+            cv::Mat corrected;
+            state.deskewed.acquire([&](cv::Mat &buffer) {
+                corrected = bufferArea(buffer, crop.size(), crop.type());
+                PlateDeskew::rotate(crop, angle, corrected);
+                return true;
+            });
+            crop = corrected;
+        }
+        streamStats.deskewTime.record(std::chrono::steady_clock::now() - start);
+    }
+
+    // Вырезки, похожие на недавно прочитанные, берут номер из кэша
+    // (в режиме оценки полноты нужны все ответы)
+    hashes.assign(crops.size(), 0);
+    if (cache.isEnabled() && mode != GateMode::Audit) {
+        answerFromCache(captured, state);
+    }
+    streamStats.cropTime.record(std::chrono::steady_clock::now() - cropStart);
+
+    for (const OcrResult &result : cached) {
+        onOCRResultReceived(result);
+    }
+    if (mode == GateMode::Audit) {
+        submitArea(captured, lane, state, roi, frameSize, true);
+    }
+    if (ocrEngine) {
+        recognizeNative(captured, state, mode == GateMode::Audit);
+    } else {
+        for (size_t i = 0; i < crops.size(); ++i) {
+            submitImage(captured, crops[i], OcrRequestKind::PlateCrop, boxes[i], state.lane,
+                        mode == GateMode::Audit, hashes[i]);
         }
+    }
 
-        // Показываем результат
-        cv::imshow(WINDOW_NAME, displayFrame);
+    // Вырезки ссылаются на кадр: без них он раньше вернется в пул
+    crops.clear();
+    boxes.clear();
+    hashes.clear();
+    cached.clear();
+}
 
-        cv::waitKey(1);
+// Ответы кэша для совпавших вырезок полосы; остальные остаются в списках
+// вместе со своими хешами, чтобы ответ сервера попал в кэш
+void NumberPlateRecognizer::answerFromCache(const CapturedFrame &captured, LaneState &state)
+{
+    std::vector<cv::Mat> &crops = state.crops;
+    std::vector<cv::Rect> &boxes = state.boxes;
+    std::vector<uint64_t> &hashes = state.hashes;
+    const auto now = std::chrono::steady_clock::now();
+    size_t kept = 0;
+    for (size_t i = 0; i < crops.size(); ++i) {
+        const uint64_t hash = cache.hash(crops[i]);
+        streamStats.cacheLookups.fetch_add(1, std::memory_order_relaxed);
+
+        OcrResult result;
+        if (cache.lookup(hash, state.lane, boxes[i], now, result.plate, result.confidence)) {
+            streamStats.cacheHits.fetch_add(1, std::memory_order_relaxed);
+            result.request =
+                makeRequest(captured, OcrRequestKind::PlateCrop, boxes[i], state.lane, false);
+            result.request.crop = crops[i];
+            result.completedTime = now;
+            state.cached.push_back(result);
+            continue;
+        }
+        crops[kept] = crops[i];
+        boxes[kept] = boxes[i];
+        hashes[kept] = hash;
+        ++kept;
     }
+    crops.resize(kept);
+    boxes.resize(kept);
+    hashes.resize(kept);
+}
+
+OcrRequest NumberPlateRecognizer::makeRequest(const CapturedFrame &captured, OcrRequestKind kind,
+                                              const cv::Rect &box, int lane,
+                                              bool audit) const
+{
+    OcrRequest request;
+    request.streamId = config.id;
+    request.frameId = captured.frameId;
+    request.kind = kind;
+    request.box = box;
+    request.lane = lane;
+    request.audit = audit;
+    request.captureTime = captured.captureTime;
+    return request;
+}
 
-    cap.release();
-    cv::destroyAllWindows();
+// Все вырезки полосы - одним батчем в локальный CRNN, результаты сразу в этом потоке
+void NumberPlateRecognizer::recognizeNative(const CapturedFrame &captured,
+                                            const LaneState &state, bool audit)
+{
+    const std::vector<cv::Mat> &crops = state.crops;
+    const std::vector<cv::Rect> &boxes = state.boxes;
+    const std::vector<uint64_t> &hashes = state.hashes;
+    if (crops.empty()) {
+        return;
+    }
 
-    // Вывод итогов
-    std::cout << "\n=== Detection Summary ===" << std::endl;
+    streamStats.framesSubmitted.fetch_add(crops.size(), std::memory_order_relaxed);
+    streamStats.captureToOcr.record(std::chrono::steady_clock::now() - captured.captureTime);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<PlateText> texts = ocrEngine->recognize(crops);
+    auto completedTime = std::chrono::steady_clock::now();
+    streamStats.ocrTime.record(completedTime - start);
+
+    for (size_t i = 0; i < crops.size(); ++i) {
+        OcrResult result;
+        result.request =
+            makeRequest(captured, OcrRequestKind::PlateCrop, boxes[i], state.lane, audit);
+        result.request.crop = crops[i];
+        result.request.cropHash = hashes[i];
+        result.plate = QString::fromStdString(texts[i].text);
+        result.confidence = texts[i].confidence;
+        result.completedTime = completedTime;
+        onOCRResultReceived(result);
+    }
 }
 
-// Специальные методы для разных протоколов
-void NumberPlateRecognizer::processRTSP(const std::string &rtspUrl)
+void NumberPlateRecognizer::submitImage(const CapturedFrame &captured, const cv::Mat &image,
+                                        OcrRequestKind kind, const cv::Rect &box, int lane,
+                                        bool audit, uint64_t cropHash)
 {
-    std::cout << "Connecting to RTSP stream..." << std::endl;
-    processIPCamera(rtspUrl);
+    OcrRequest request = makeRequest(captured, kind, box, lane, audit);
+    if (kind == OcrRequestKind::PlateCrop) {
+        request.crop = image;
+        request.cropHash = cropHash;
+    }
+    const QualityLevel &level = streamQuality.current();
+    request.jpegQuality = level.jpegQuality;
+
+    // JPEG кодируется в этом потоке, дальше только постановка в очередь клиента
+    auto start = std::chrono::steady_clock::now();
+    cv::Mat sent = image;
+    const int width = std::max(kMinSentWidth, static_cast<int>(image.cols * level.imageScale));
+    if (width < image.cols) {
+        // Сервер перегружен: ROI уходит уменьшенным, вырезки номеров - не уже kMinSentWidth
+        const int height = std::max(1, image.rows * width / image.cols);
+        cv::resize(image, sent, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+    }
+    size_t bytes = ocrClient->submitFrameForRecognition(request, sent);
+    streamStats.encodeTime.record(std::chrono::steady_clock::now() - start);
+    streamStats.framesSubmitted.fetch_add(1, std::memory_order_relaxed);
+    streamStats.bytesSubmitted.fetch_add(bytes, std::memory_order_relaxed);
+    streamStats.captureToOcr.record(std::chrono::steady_clock::now() - captured.captureTime);
 }
 
-void NumberPlateRecognizer::processHTTP(const std::string &httpUrl)
+void NumberPlateRecognizer::submitEncoded(const CapturedFrame &captured, const cv::Rect &box,
+                                          int lane, bool audit)
 {
-    std::cout << "Connecting to HTTP stream..." << std::endl;
-    processIPCamera(httpUrl);
+    OcrRequest request = makeRequest(captured, OcrRequestKind::FullFrame, box, lane, audit);
+    size_t bytes = ocrClient->submitEncodedForRecognition(request, captured.jpeg);
+    streamStats.framesSubmitted.fetch_add(1, std::memory_order_relaxed);
+    streamStats.bytesSubmitted.fetch_add(bytes, std::memory_order_relaxed);
+    streamStats.captureToOcr.record(std::chrono::steady_clock::now() - captured.captureTime);
 }
 
 void NumberPlateRecognizer::handleMouse(int event, int x, int y, int flags)
 {
+    std::lock_guard<std::mutex> lock(roiMutex);
+
     // Обрабатываем события мыши только в режиме выбора ROI
     if (!roiSelectionMode)
         return;
@@ -204,81 +740,173 @@ void NumberPlateRecognizer::handleMouse(int event, int x, int y, int flags)
     }
 }
 
-void NumberPlateRecognizer::onMouse(int event, int x, int y, int flags, void *userdata)
+void NumberPlateRecognizer::onOCRResultReceived(const OcrResult &result)
 {
-    NumberPlateRecognizer *recognizer = static_cast<NumberPlateRecognizer *>(userdata);
-    recognizer->handleMouse(event, x, y, flags);
-}
+    const QString &plateText = result.plate;
+    const double confidence = result.confidence;
+
+    if (result.status != OcrStatus::Ok) {
+        if (result.status == OcrStatus::Coalesced) {
+            streamStats.requestsCoalesced.fetch_add(1, std::memory_order_relaxed);
+        } else if (result.status == OcrStatus::TimedOut) {
+            streamStats.requestsTimedOut.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            streamStats.requestsFailed.fetch_add(1, std::memory_order_relaxed);
+        }
 
-void NumberPlateRecognizer::onOCRResultReceived(const QString &plateText, double confidence)
-{
-    if (!plateText.isEmpty()) {
-        std::cout << "=== Detected plate: " << plateText.toStdString()
-                  << " (confidence: " << confidence << ") ===" << std::endl;
+        // Кадр без полного набора ответов в оценку полноты не попадает
+        if (result.request.audit) {
+            std::lock_guard<std::mutex> lock(auditMutex);
+            audits.erase(std::make_pair(result.request.frameId, result.request.lane));
+        }
+        return;
     }
 
-    // Можно также emit-ить сигнал для MainWindow
-    emit plateDetected(plateText, confidence);
-}
+    streamStats.resultsReceived.fetch_add(1, std::memory_order_relaxed);
+    streamStats.captureToResult.record(result.latency());
+    if (result.networkTime().count() > 0) {
+        streamStats.networkTime.record(result.networkTime());
+    }
+    if (result.serverTime.count() > 0) {
+        streamStats.serverTime.record(result.serverTime);
+    }
 
-// Коррекция перекоса
-std::pair<double, cv::Mat> NumberPlateRecognizer::correct_skew(const cv::Mat &image, double delta,
-                                                               int limit)
-{
-    // Функция для вычисления скора
-    auto determine_score = [](const cv::Mat &arr, double angle) -> std::pair<cv::Mat, double> {
-        cv::Point2f center(arr.cols / 2.0f, arr.rows / 2.0f);
-        cv::Mat rotation_matrix = cv::getRotationMatrix2D(center, angle, 1.0);
+    if (result.request.audit) {
+        {
+            std::lock_guard<std::mutex> lock(auditMutex);
+            auto it = audits.find(std::make_pair(result.request.frameId, result.request.lane));
+            if (it != audits.end()) {
+                GateAudit &audit = it->second;
+                if (result.request.kind == OcrRequestKind::FullFrame) {
+                    audit.fullDone = true;
+                    audit.fullText = plateText;
+                } else {
+                    audit.pendingCrops--;
+                    audit.cropTexts << plateText;
+                }
+            }
+        }
+        finishAudit(result.request.frameId, result.request.lane);
 
-        cv::Mat data;
-        cv::warpAffine(arr, data, rotation_matrix, arr.size(), cv::INTER_NEAREST,
-                       cv::BORDER_CONSTANT, cv::Scalar(0));
+        // Полный кадр нужен только для оценки, дальше идут результаты по вырезкам
+        if (result.request.kind == OcrRequestKind::FullFrame) {
+            return;
+        }
+    }
 
-        // Вычисляем гистограмму (сумма по строкам)
-        cv::Mat histogram;
-        cv::reduce(data, histogram, 1, cv::REDUCE_SUM, CV_64F);
+    if (plateText.isEmpty()) {
+        return;
+    }
+    streamStats.platesRecognized.fetch_add(1, std::memory_order_relaxed);
 
-        // Вычисляем score
-        double score = 0.0;
-        for (int i = 1; i < histogram.rows; i++) {
-            double diff = histogram.at<double>(i) - histogram.at<double>(i - 1);
-            score += diff * diff;
+    if (previewViewers.load(std::memory_order_relaxed) > 0) {
+        PreviewPlate plate;
+        if (result.request.kind == OcrRequestKind::PlateCrop) {
+            plate.box = result.request.box;
+        }
+        plate.text = plateText;
+        std::lock_guard<std::mutex> lock(previewMutex);
+        if (previewPlates.size() >= 16) {
+            previewPlates.pop_front();
         }
+        previewPlates.push_back({plate, result.completedTime});
+    }
+
+    if (watchlist) {
+        checkWatchlist(plateText, result.request.lane, result.request.captureTime);
+    }
 
-        return std::make_pair(histogram, score);
-    };
+    // Ответ кэша обратно не кладем: срок жизни считается от ответа сервера
+    if (result.request.cropHash != 0) {
+        cache.store(result.request.cropHash, result.request.lane, result.request.box, plateText,
+                    confidence, result.completedTime);
+    }
 
-    // Конвертируем в grayscale и бинаризуем
-#if 0
-    cv::Mat gray;
-    cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
-    cv::Mat thresh;
-    cv::threshold(gray, thresh, 0, 255, cv::THRESH_BINARY_INV | cv::THRESH_OTSU);
-#endif
+    // Отдельные прочтения собираются по машинам, наружу идет итог по машине
+    PlateObservation observation;
+    observation.text = plateText;
+    observation.confidence = confidence;
+    observation.box = result.request.box;
+    observation.lane = result.request.lane;
+    observation.frameId = result.request.frameId;
+    observation.time = result.request.captureTime;
+    observation.crop = result.request.crop;
+    reportVehicles(tracker.add(observation));
+}
 
-    // Перебираем углы и вычисляем скоре
-    std::vector<double> scores;
-    std::vector<double> angles;
+void NumberPlateRecognizer::reportVehicles(const std::vector<VehicleEvent> &events)
+{
+    for (const VehicleEvent &event : events) {
+        streamStats.vehiclesReported.fetch_add(1, std::memory_order_relaxed);
+        auto seenMs =
+            std::chrono::duration_cast<std::chrono::milliseconds>(event.lastSeen - event.firstSeen)
+                .count();
+        std::cout << "[" << config.id << "] === Detected plate: " << event.plate.toStdString()
+                  << " (confidence: " << event.confidence << ", " << event.observations
+                  << " readings over " << seenMs << " ms, best frame " << event.bestFrameId
+                  << (event.lane > 0 ? ", lane " + std::to_string(event.lane) : std::string())
+                  << ") ===" << std::endl;
+
+        emit plateDetected(config.id, event.plate, event.confidence);
+        emit vehicleDetected(event);
+    }
+}
 
-    for (double angle = -limit; angle <= limit + delta; angle += delta) {
-        auto [histogram, score] = determine_score(image, angle);
-        scores.push_back(score);
-        angles.push_back(angle);
+void NumberPlateRecognizer::checkWatchlist(const QString &plate, int lane,
+                                           std::chrono::steady_clock::time_point time)
+{
+    const auto started = std::chrono::steady_clock::now();
+    const std::vector<WatchlistHit> hits = watchlist->match(plate);
+    streamStats.watchlistTime.record(std::chrono::steady_clock::now() - started);
+    if (hits.empty()) {
+        return;
     }
 
-    // Находим угол с максимальным скором
-    auto max_iter = std::max_element(scores.begin(), scores.end());
-    int best_index = std::distance(scores.begin(), max_iter);
-    double best_angle = angles[best_index];
+    const WatchlistHit &hit = hits.front();
+    {
+        const std::chrono::milliseconds gap(config.tracker.maxGapMs);
+        std::lock_guard<std::mutex> lock(watchlistMutex);
+        if (watchlistAlerts.size() > 1024) {
+            for (auto it = watchlistAlerts.begin(); it != watchlistAlerts.end();) {
+                it = time - it->second > gap ? watchlistAlerts.erase(it) : std::next(it);
+            }
+        }
+        auto inserted = watchlistAlerts.emplace(hit.plate, time);
+        const bool repeated = !inserted.second && time - inserted.first->second <= gap;
+        inserted.first->second = std::max(inserted.first->second, time);
+        if (repeated) {
+            return;
+        }
+    }
 
-    // Применяем поворот к оригинальному изображению
-    cv::Point2f center(image.cols / 2.0f, image.rows / 2.0f);
-    cv::Mat M = cv::getRotationMatrix2D(center, best_angle, 1.0);
+    streamStats.watchlistHits.fetch_add(1, std::memory_order_relaxed);
+    std::cout << "[" << config.id << "] !!! Watchlist " << hit.list.toStdString() << ": "
+              << hit.plate.toStdString() << " read as " << plate.toStdString() << " (distance "
+              << hit.distance << (lane > 0 ? ", lane " + std::to_string(lane) : std::string())
+              << ")" << std::endl;
+    emit watchlistHit(config.id, plate, hit);
+}
 
-    cv::Mat corrected;
-    cv::warpAffine(image, corrected, M, image.size(), cv::INTER_CUBIC, cv::BORDER_REPLICATE);
+void NumberPlateRecognizer::finishAudit(uint64_t frameId, int lane)
+{
+    std::lock_guard<std::mutex> lock(auditMutex);
+    auto it = audits.find(std::make_pair(frameId, lane));
+    if (it == audits.end() || !it->second.fullDone || it->second.pendingCrops > 0) {
+        return;
+    }
 
-    return std::make_pair(best_angle, corrected);
+    const GateAudit &audit = it->second;
+    streamStats.auditFrames.fetch_add(1, std::memory_order_relaxed);
+    if (!audit.fullText.isEmpty()) {
+        streamStats.auditPositives.fetch_add(1, std::memory_order_relaxed);
+        if (audit.candidates > 0) {
+            streamStats.auditDetectionHits.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (audit.cropTexts.contains(audit.fullText)) {
+            streamStats.auditTextHits.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    audits.erase(it);
 }
 
 cv::Mat NumberPlateRecognizer::enlarge_img(const cv::Mat &image, int scale_percent)
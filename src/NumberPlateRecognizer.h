@@ -4,58 +4,242 @@
 
 #include <QThread>
 
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <regex>
 #include <vector>
 
 #include "async_ocr_client.h"
-
+#include "buffer_pool.h"
+#include "frame_capture.h"
+#include "lane_roi.h"
+#include "latency_controller.h"
+#include "motion_detector.h"
+#include "plate_deskew.h"
+#include "plate_detector.h"
+#include "plate_ocr_engine.h"
+#include "plate_result_cache.h"
+#include "plate_tracker.h"
+#include "plate_watchlist.h"
+#include "stream_config.h"
+#include "stream_stats.h"
+#include "yolo_plate_detector.h"
+
+// Обработчик одной камеры. Кадры захватываются в отдельном потоке FrameCapture,
+// а обрабатываются шагами processLatest() на общем пуле потоков StreamEngine;
+// одна камера в каждый момент обслуживается не более чем одним рабочим потоком.
 class NumberPlateRecognizer : public QObject
 {
     Q_OBJECT
 
 public:
-    explicit NumberPlateRecognizer(QObject *parent = nullptr);
+    // ocrEngine не nullptr - вырезки номеров читаются в процессе, без сервера
+    // yoloDetector не nullptr - номера ищет YOLO, каскад Хаара остается запасным
+    NumberPlateRecognizer(const StreamConfig &config, PlateDetector *detector,
+                          YoloPlateDetector *yoloDetector, AsyncOCRClient *ocrClient,
+                          PlateOcrEngine *ocrEngine = nullptr, QObject *parent = nullptr);
     ~NumberPlateRecognizer();
 
-    void startProcessing(const QString &url);
+    int streamId() const { return config.id; }
+    const StreamConfig &streamConfig() const { return config; }
+    StreamStats &stats() { return streamStats; }
+    StreamQuality &quality() { return streamQuality; }
+
+    // Колбэки вызываются из потока захвата
+    void startProcessing(std::function<void()> onFrameReady, std::function<void()> onFinished);
     void stopProcessing();
+    bool processLatest();
+    bool hasPendingFrame() const { return capture.hasFrames(); }
     void enableROISelection();
     void saveROI();
     void clearROI();
 
-    cv::Mat detectPlate(cv::Mat image);
-
-    void processIPCamera(const std::string &url);
-    void processRTSP(const std::string &rtspUrl);
-    void processHTTP(const std::string &httpUrl);
-
+    // Новый набор полос: подменяется целиком, шаг камеры подхватит его со
+    // следующего кадра; с --lanes сохраняется в файл
+    void setLanes(const std::vector<LaneRoi> &lanes);
+
+    // Списки номеров для проверки прочтений; общие для всех камер
+    void setWatchlist(const PlateWatchlist *list) { watchlist = list; }
+
+    // Разметка поверх кадра для окна просмотра, в координатах кадра
+    struct PreviewPlate
+    {
+        cv::Rect box; // вырезка номера; пусто - номер найден сервером на полном кадре
+        QString text;
+    };
+    struct PreviewOverlay
+    {
+        std::shared_ptr<const RoiSet> lanes;
+        cv::Rect selection; // рисуемый ROI в режиме выбора
+        std::vector<PreviewPlate> plates; // прочтения за последнюю секунду
+    };
+
+    void attachPreview();
+    void detachPreview();
+    bool previewSnapshot(cv::Mat &displayFrame);
+    // Последний кадр не меньше target (MJPEG декодируется сразу уменьшенным в
+    // 2-8 раз в image, несжатый кадр отдается ссылкой) и исходный размер кадра
+    bool previewImage(const cv::Size &target, cv::Mat &image, cv::Size &frameSize);
+    PreviewOverlay previewOverlay();
+
+    // Все кандидаты номеров в координатах image
+    std::vector<cv::Rect> detectPlate(const cv::Mat &image);
+    bool hasDetector() const;
+
+    // Увеличение на scale_percent процентов (INTER_AREA)
+    static cv::Mat enlarge_img(const cv::Mat &image, int scale_percent);
+
+    // Мышь окна просмотра в координатах кадра; event - cv::EVENT_*
     void handleMouse(int event, int x, int y, int flags);
-    static void onMouse(int event, int x, int y, int flags, void *userdata);
+
+    void onOCRResultReceived(const OcrResult &result);
 
 signals:
     void finished();
     void error(const QString &error);
     void roiUpdated(int x, int y, int width, int height);
-    void plateDetected(const QString &plate, double confidence);
+    // Одно событие на машину, когда она пропала из кадра
+    void plateDetected(int streamId, const QString &plate, double confidence);
+    void vehicleDetected(const VehicleEvent &event);
+    // Прочтение совпало с номером из списка; одна тревога на машину
+    void watchlistHit(int streamId, const QString &plate, const WatchlistHit &hit);
 
 private:
-    void onOCRResultReceived(const QString &plateText, double confidence);
-    std::pair<double, cv::Mat> correct_skew(const cv::Mat &image, double delta = 1.0,
-                                            int limit = 5);
-    cv::Mat enlarge_img(const cv::Mat &image, int scale_percent);
-
-    cv::CascadeClassifier plateCascade;
-
-    std::atomic<bool> stopFlag{false};
-
-    // Переменные для рисования прямоугольника
+    // Состояние полосы между кадрами. Полосы одного кадра обрабатываются
+    // параллельно, поэтому таймер, детектор движения, выравнивание и списки
+    // вырезок у каждой полосы свои
+    struct LaneState
+    {
+        LaneState(const RoiSet::Lane &lane, const MotionConfig &motion,
+                  std::atomic<uint64_t> *poolMisses)
+            : lane(lane.roi.lane)
+            , bounds(lane.bounds)
+            , motionDetector(motion)
+            , maskedAreas(4, poolMisses)
+            , deskewed(16, poolMisses)
+        {
+        }
+
+        int lane;
+        cv::Rect bounds;
+        std::chrono::steady_clock::time_point lastOcrTime;
+        std::chrono::steady_clock::time_point lastMotionTime;
+        MotionDetector motionDetector;
+        PlateDeskew deskew;
+        BufferPool<cv::Mat> maskedAreas; // описанный прямоугольник с маской многоугольника
+        // Выровненные вырезки: пока запросы в очереди клиента держат вырезку,
+        // ее буфер занят; буфер только растет, вырезка - его ROI
+        BufferPool<cv::Mat> deskewed;
+        std::vector<cv::Mat> crops;
+        std::vector<cv::Rect> boxes;
+        std::vector<uint64_t> hashes;
+        std::vector<OcrResult> cached;
+    };
+
+    void processFrame(CapturedFrame &captured);
+    void syncLanes(const std::shared_ptr<const RoiSet> &set);
+    void publishLanes(const std::vector<LaneRoi> &lanes);
+    bool shouldSubmit(CapturedFrame &captured, const cv::Rect &area, const RoiSet::Lane &lane,
+                      LaneState &state);
+    void submitForRecognition(CapturedFrame &captured, const RoiSet::Lane &lane,
+                              LaneState &state, const cv::Size &frameSize);
+    void submitArea(CapturedFrame &captured, const RoiSet::Lane &lane, LaneState &state,
+                    const cv::Rect &roi, const cv::Size &frameSize, bool audit);
+    void submitImage(const CapturedFrame &captured, const cv::Mat &image, OcrRequestKind kind,
+                     const cv::Rect &box, int lane, bool audit = false, uint64_t cropHash = 0);
+    void submitEncoded(const CapturedFrame &captured, const cv::Rect &box, int lane, bool audit);
+    const cv::Mat &decodedImage(CapturedFrame &captured);
+    cv::Mat laneImage(CapturedFrame &captured, const RoiSet::Lane &lane, LaneState &state,
+                      const cv::Rect &area);
+    cv::Mat motionArea(CapturedFrame &captured, const cv::Rect &roi);
+    void recognizeNative(const CapturedFrame &captured, const LaneState &state, bool audit);
+    void answerFromCache(const CapturedFrame &captured, LaneState &state);
+    OcrRequest makeRequest(const CapturedFrame &captured, OcrRequestKind kind,
+                           const cv::Rect &box, int lane, bool audit) const;
+    void finishAudit(uint64_t frameId, int lane);
+    void reportVehicles(const std::vector<VehicleEvent> &events);
+    void checkWatchlist(const QString &plate, int lane,
+                        std::chrono::steady_clock::time_point time);
+
+    StreamConfig config;
+    StreamStats streamStats;
+    StreamQuality streamQuality; // ступень качества от LatencyController
+    PlateDetector *plateDetector;
+    YoloPlateDetector *yoloDetector;
+
+    FrameCapture capture;
+
+    // Частота запросов по таймеру и запуск по движению (у полосы может быть своя)
+    std::chrono::milliseconds ocrInterval;
+    std::chrono::milliseconds burstInterval;
+    std::chrono::milliseconds motionHold;
+
+    // Прочтения одной машины -> одно событие
+    PlateTracker tracker;
+
+    // Ответы по похожим вырезкам (стоящие машины) без запроса к серверу
+    PlateResultCache cache;
+
+    // Проверка по спискам; машина читается много раз, пока видна, поэтому
+    // повторная тревога по тому же номеру из списка - не раньше, чем через
+    // разрыв трека после последнего прочтения
+    const PlateWatchlist *watchlist = nullptr;
+    std::mutex watchlistMutex;
+    std::map<QString, std::chrono::steady_clock::time_point> watchlistAlerts;
+
+    // Декодированные кадры MJPEG и уменьшенная копия для детектора движения
+    // (одна на кадр для всех полос); используются только в шаге камеры
+    BufferPool<cv::Mat> decodedFrames;
+    cv::Mat reducedFrame;
+    uint64_t reducedFrameId = 0;
+    int reducedScale = 0;
+
+    // Полосы: окно публикует набор через std::atomic_store, шаг камеры берет
+    // его std::atomic_load без общей с окном блокировки. Состояния полос
+    // принадлежат шагу камеры и пересобираются, когда набор сменился
+    std::shared_ptr<const RoiSet> roiSet;
+    std::shared_ptr<const RoiSet> activeSet;
+    std::vector<std::unique_ptr<LaneState>> laneStates;
+    std::vector<size_t> triggeredLanes;
+
+    // Переменные для рисования прямоугольника и правки полос (только окно)
+    std::mutex roiMutex;
+    std::vector<LaneRoi> editedLanes;
     cv::Rect selectedROI;
-    bool roiSelectionMode = false;
-    bool roiSelected = false;
+    std::atomic<bool> roiSelectionMode{false};
     bool drawing = false;
     cv::Point startPoint;
     cv::Point endPoint;
 
+    // Кадры в режиме GateMode::Audit, ждущие ответов сервера
+    struct GateAudit
+    {
+        int candidates = 0;
+        int pendingCrops = 0;
+        bool fullDone = false;
+        QString fullText;
+        QStringList cropTexts;
+    };
+    std::mutex auditMutex;
+    std::map<std::pair<uint64_t, int>, GateAudit> audits; // кадр и полоса
+
+    // Последний кадр для зрителей
+    std::atomic<int> previewViewers{0};
+    std::mutex previewMutex;
+    CapturedFrame previewFrame; // кадр MJPEG декодирует зритель
+    struct RecentPlate
+    {
+        PreviewPlate plate;
+        std::chrono::steady_clock::time_point time;
+    };
+    std::deque<RecentPlate> previewPlates;
+
     AsyncOCRClient *ocrClient;
+    PlateOcrEngine *ocrEngine;
 };
@@ -1,61 +1,567 @@
 #include "async_ocr_client.h"
 #include <QBuffer>
 #include <QDebug>
+#include <QHttpMultiPart>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QTimer>
+#include <QUrl>
 
-AsyncOCRClient::AsyncOCRClient(QObject *parent)
+#include <algorithm>
+
+AsyncOCRClient::AsyncOCRClient(const OcrClientConfig &config, QObject *parent)
     : QObject(parent)
+    , config(config)
+    , encodePool(std::max(1, config.encodeBuffers), &encodeMisses)
 {
-    manager = new QNetworkAccessManager();
+    qRegisterMetaType<OcrResult>("OcrResult");
+
+    // Родитель обязателен: менеджер должен переезжать в поток клиента вместе с ним
+    manager = new QNetworkAccessManager(this);
     connect(manager, &QNetworkAccessManager::finished, this, &AsyncOCRClient::onReplyFinished);
+
+    batchTimer = new QTimer(this);
+    batchTimer->setSingleShot(true);
+    connect(batchTimer, &QTimer::timeout, this, &AsyncOCRClient::flushBatch);
+
+    if (config.backends.isEmpty()) {
+        Backend backend;
+        backend.recognizeUrl = config.serviceUrl;
+        const QUrl service(config.serviceUrl);
+        backend.batchUrl = config.batchUrl.isEmpty()
+                               ? service.resolved(QUrl("recognize_batch")).toString()
+                               : config.batchUrl;
+        backend.healthUrl = service.resolved(QUrl("/health")).toString();
+        backends.push_back(std::move(backend));
+    }
+    for (const QString &base : config.backends) {
+        QString root = base;
+        while (root.endsWith('/')) {
+            root.chop(1);
+        }
+        Backend backend;
+        backend.recognizeUrl = root + "/recognize";
+        backend.batchUrl = root + "/recognize_batch";
+        backend.healthUrl = root + "/health";
+        backends.push_back(std::move(backend));
+    }
+    for (Backend &backend : backends) {
+        backend.stats = std::make_unique<OcrBackendStats>();
+        backend.stats->url = backend.recognizeUrl.toStdString();
+    }
+
+    healthTimer = new QTimer(this);
+    connect(healthTimer, &QTimer::timeout, this, &AsyncOCRClient::checkHealth);
+
+    // Таймер и канал запускаются уже в потоке клиента: вызовы переедут туда вместе с ним
+    if (config.healthIntervalMs > 0) {
+        QMetaObject::invokeMethod(
+            this, [this]() { healthTimer->start(this->config.healthIntervalMs); },
+            Qt::QueuedConnection);
+    }
+
+    if (!config.local.socketPath.isEmpty()) {
+        local = new ShmOcrChannel(config.local, config.timeoutMs, this);
+        connect(local, &ShmOcrChannel::finished, this, &AsyncOCRClient::onLocalFinished);
+        QMetaObject::invokeMethod(local, &ShmOcrChannel::open, Qt::QueuedConnection);
+    }
 }
 
-void AsyncOCRClient::submitFrameForRecognition(const cv::Mat &frame)
+size_t AsyncOCRClient::submitFrameForRecognition(const OcrRequest &request, const cv::Mat &frame)
 {
     if (frame.empty()) {
-        emit plateRecognized("", 0.0);
-        return;
+        emitStatus(request, OcrStatus::Failed);
+        return 0;
     }
 
-    try {
-        // Конвертируем cv::Mat в JPEG
-        std::vector<uchar> buffer;
-        cv::imencode(".jpg", frame, buffer, {cv::IMWRITE_JPEG_QUALITY, 70});
-
-        QByteArray imageData(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+    // Локальному каналу JPEG не нужен: кадр ляжет в общую память как есть.
+    // Mat - ссылка, изображение не меняется после отправки
+    if (local && local->isReady()) {
+        OcrImage image{request, QByteArray(), frame};
+        QMetaObject::invokeMethod(
+            this, [this, image]() { enqueueImage(image); }, Qt::QueuedConnection);
+        return frame.total() * frame.elemSize();
+    }
 
-        QNetworkRequest request(serviceUrl);
-        request.setHeader(QNetworkRequest::ContentTypeHeader, "application/octet-stream");
-        manager->post(request, imageData);
+    try {
+        // Конвертируем cv::Mat в JPEG в вызывающем потоке, в буфер из пула
+        const QByteArray jpeg = encodeJpeg(frame, request.jpegQuality, encodePool);
+        return submitEncodedForRecognition(request, jpeg);
     } catch (const cv::Exception &e) {
         qDebug() << "OpenCV exception:" << e.what();
-        emit plateRecognized("", 0.0);
+        emitStatus(request, OcrStatus::Failed);
     } catch (const std::exception &e) {
         qDebug() << "std exception:" << e.what();
-        emit plateRecognized("", 0.0);
+        emitStatus(request, OcrStatus::Failed);
     }
+    return 0;
 }
 
-void AsyncOCRClient::onReplyFinished(QNetworkReply *reply)
+size_t AsyncOCRClient::submitEncodedForRecognition(const OcrRequest &request,
+                                                   const QByteArray &jpeg)
+{
+    if (jpeg.isEmpty()) {
+        emitStatus(request, OcrStatus::Failed);
+        return 0;
+    }
+
+    // Сетевой запрос отправляем из потока клиента
+    OcrImage image{request, jpeg, cv::Mat()};
+    QMetaObject::invokeMethod(
+        this, [this, image]() { enqueueImage(image); }, Qt::QueuedConnection);
+    return jpeg.size();
+}
+
+void AsyncOCRClient::enqueueImage(const OcrImage &image)
+{
+    StreamWindow &window = windows[image.request.streamId];
+    if (window.inFlight < config.maxInFlightPerStream && window.queued.empty()) {
+        postImage(image);
+        return;
+    }
+
+    // Окно заполнено: в очереди остается только самый свежий кадр
+    if (!window.queued.empty() && window.queued.front().request.frameId != image.request.frameId) {
+        for (const OcrImage &stale : window.queued) {
+            emitStatus(stale.request, OcrStatus::Coalesced);
+        }
+        window.queued.clear();
+    }
+    window.queued.push_back(image);
+}
+
+void AsyncOCRClient::postImage(const OcrImage &image)
+{
+    const OcrRequest &request = image.request;
+    if (deadline(request) <= std::chrono::steady_clock::now()) {
+        emitStatus(request, OcrStatus::TimedOut);
+        return;
+    }
+    windows[request.streamId].inFlight++;
+
+    // Пакетный режим: копим вырезки всех камер и шлем одним запросом
+    if (config.batchWindowMs > 0) {
+        batch.push_back(image);
+        if (static_cast<int>(batch.size()) >= config.maxBatchSize) {
+            flushBatch();
+        } else if (!batchTimer->isActive()) {
+            batchTimer->start(config.batchWindowMs);
+        }
+        return;
+    }
+
+    if (local && local->send({image}).empty()) {
+        return;
+    }
+    postHttp(image);
+}
+
+void AsyncOCRClient::postHttp(const OcrImage &image)
 {
-    QString plateText = "";
-    double confidence = 0.0;
+    // Несжатое изображение предназначалось каналу, который успел пропасть
+    const QByteArray imageData =
+        image.jpeg.isEmpty() ? encodeJpeg(image.image, image.request.jpegQuality, encodePool)
+                             : image.jpeg;
 
+    QNetworkReply *reply = sendSingle(image.request, imageData, pickBackend());
+    if (config.hedgeAfterMs > 0 && backends.size() > 1) {
+        QTimer::singleShot(config.hedgeAfterMs, reply, [this, reply]() { hedge(reply); });
+    }
+}
+
+QNetworkReply *AsyncOCRClient::sendSingle(const OcrRequest &request, const QByteArray &imageData,
+                                          int backend)
+{
+    QNetworkReply *reply =
+        manager->post(singleRequest(backends[backend].recognizeUrl, request.kind), imageData);
+
+    InFlight flight;
+    flight.request = request;
+    flight.request.sentTime = std::chrono::steady_clock::now();
+    flight.imageData = imageData;
+    flight.backend = backend;
+    pendingRequests.insert(reply, flight);
+
+    OcrBackendStats &stats = *backends[backend].stats;
+    stats.requests.fetch_add(1, std::memory_order_relaxed);
+    stats.outstanding.fetch_add(1, std::memory_order_relaxed);
+    armDeadline(reply, deadline(request));
+    return reply;
+}
+
+// Ответа долго нет - тот же запрос уходит на другой исправный сервер
+void AsyncOCRClient::hedge(QNetworkReply *reply)
+{
+    auto it = pendingRequests.constFind(reply);
+    if (it == pendingRequests.constEnd() || it.value().twin) {
+        return;
+    }
+    const int backend = pickBackend(it.value().backend);
+    if (backend < 0 || !backends[backend].stats->healthy.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    const OcrRequest request = it.value().request;
+    const QByteArray imageData = it.value().imageData;
+    QNetworkReply *twin = sendSingle(request, imageData, backend);
+    pendingRequests[reply].twin = twin;
+    pendingRequests[twin].twin = reply;
+    backends[backend].stats->hedges.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Исправный сервер с наименьшим числом запросов без ответа; при равенстве - по
+// кругу. Исправных нет - выбираем из всех, чтобы не терять запросы совсем
+int AsyncOCRClient::pickBackend(int exclude)
+{
+    const int count = static_cast<int>(backends.size());
+    int best = -1;
+    bool bestHealthy = false;
+    int bestLoad = 0;
+    for (int k = 0; k < count; ++k) {
+        const int i = (nextBackend + k) % count;
+        if (i == exclude) {
+            continue;
+        }
+        const OcrBackendStats &stats = *backends[i].stats;
+        const bool healthy = stats.healthy.load(std::memory_order_relaxed);
+        const int load = stats.outstanding.load(std::memory_order_relaxed);
+        if (best < 0 || (healthy && !bestHealthy) || (healthy == bestHealthy && load < bestLoad)) {
+            best = i;
+            bestHealthy = healthy;
+            bestLoad = load;
+        }
+    }
+    nextBackend = (nextBackend + 1) % count;
+    return best;
+}
+
+void AsyncOCRClient::recordBackend(int index, OcrStatus status,
+                                   std::chrono::steady_clock::duration latency)
+{
+    Backend &backend = backends[index];
+    OcrBackendStats &stats = *backend.stats;
+    stats.outstanding.fetch_sub(1, std::memory_order_relaxed);
+
+    if (status == OcrStatus::Ok) {
+        stats.latency.record(latency);
+        backend.failures = 0;
+        return;
+    }
+    if (status == OcrStatus::TimedOut) {
+        stats.timeouts.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // Ошибки подряд - сервер выходит из пула до удачной проверки /health
+    stats.failures.fetch_add(1, std::memory_order_relaxed);
+    if (++backend.failures >= config.maxFailures && stats.healthy.exchange(false)) {
+        stats.ejections.fetch_add(1, std::memory_order_relaxed);
+        qDebug() << "OCR backend ejected after" << backend.failures
+                 << "failures:" << backend.recognizeUrl;
+    }
+}
+
+void AsyncOCRClient::checkHealth()
+{
+    for (int i = 0; i < static_cast<int>(backends.size()); ++i) {
+        QNetworkReply *reply = manager->get(QNetworkRequest(backends[i].healthUrl));
+        healthChecks.insert(reply, i);
+        const int timeoutMs = std::max(1, config.healthIntervalMs / 2);
+        QTimer::singleShot(timeoutMs, reply, [reply]() { reply->abort(); });
+    }
+}
+
+void AsyncOCRClient::onHealthFinished(QNetworkReply *reply)
+{
+    Backend &backend = backends[healthChecks.take(reply)];
+    OcrBackendStats &stats = *backend.stats;
     if (reply->error() == QNetworkReply::NoError) {
-        QJsonDocument response = QJsonDocument::fromJson(reply->readAll());
-        QJsonArray plates = response.object()["plates"].toArray();
+        backend.failures = 0;
+        if (!stats.healthy.exchange(true)) {
+            qDebug() << "OCR backend is back:" << backend.recognizeUrl;
+        }
+    } else if (stats.healthy.exchange(false)) {
+        stats.ejections.fetch_add(1, std::memory_order_relaxed);
+        qDebug() << "OCR backend ejected, health check failed:" << backend.recognizeUrl
+                 << reply->errorString();
+    }
+}
+
+// Пакет уходит multipart-запросом на /recognize_batch. Имя части - номер
+// запроса в пакете, имя файла - вид изображения (crop или frame)
+void AsyncOCRClient::flushBatch()
+{
+    batchTimer->stop();
+    std::vector<OcrImage> images;
+    images.swap(batch);
 
-        if (!plates.isEmpty()) {
-            QJsonObject plateObj = plates[0].toObject();
-            plateText = plateObj["text"].toString();
-            confidence = plateObj["confidence"].toDouble();
+    auto now = std::chrono::steady_clock::now();
+    std::vector<OcrImage> live;
+    for (OcrImage &image : images) {
+        if (deadline(image.request) <= now) {
+            OcrResult expired;
+            expired.request = image.request;
+            expired.status = OcrStatus::TimedOut;
+            expired.completedTime = now;
+            finishRequest(expired);
+        } else {
+            live.push_back(std::move(image));
         }
-    } else {
-        qDebug() << "OCR request failed:" << reply->errorString();
     }
 
-    emit plateRecognized(plateText, confidence);
+    // Сначала локальный канал, по HTTP - то, что в него не поместилось
+    if (local) {
+        live = local->send(std::move(live));
+    }
+    if (live.empty()) {
+        return;
+    }
+
+    auto earliest = std::chrono::steady_clock::time_point::max();
+    std::vector<OcrRequest> requests;
+    QHttpMultiPart *multiPart = new QHttpMultiPart(QHttpMultiPart::FormDataType);
+
+    for (const OcrImage &image : live) {
+        multiPart->append(batchPart(static_cast<int>(requests.size()), image, encodePool));
+
+        requests.push_back(image.request);
+        earliest = std::min(earliest, deadline(image.request));
+    }
+
+    if (requests.empty()) {
+        delete multiPart;
+        return;
+    }
+
+    const int backend = pickBackend();
+    QNetworkReply *reply =
+        manager->post(QNetworkRequest(backends[backend].batchUrl), multiPart);
+    multiPart->setParent(reply);
+    const auto sentTime = std::chrono::steady_clock::now();
+    for (OcrRequest &request : requests) {
+        request.sentTime = sentTime;
+    }
+    pendingBatches.insert(reply, {requests, backend});
+    backends[backend].stats->requests.fetch_add(1, std::memory_order_relaxed);
+    backends[backend].stats->outstanding.fetch_add(1, std::memory_order_relaxed);
+    armDeadline(reply, earliest);
+}
+
+void AsyncOCRClient::armDeadline(QNetworkReply *reply,
+                                 std::chrono::steady_clock::time_point until)
+{
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        until - std::chrono::steady_clock::now());
+
+    // Таймер привязан к ответу и умирает вместе с ним
+    QTimer::singleShot(std::max<int>(0, static_cast<int>(remaining.count())), reply, [reply]() {
+        reply->setProperty("timedOut", true);
+        reply->abort();
+    });
+}
+
+void AsyncOCRClient::drainQueue(StreamWindow &window)
+{
+    while (window.inFlight < config.maxInFlightPerStream && !window.queued.empty()) {
+        OcrImage next = std::move(window.queued.front());
+        window.queued.erase(window.queued.begin());
+        postImage(next);
+    }
+}
+
+void AsyncOCRClient::emitStatus(const OcrRequest &request, OcrStatus status)
+{
+    OcrResult result;
+    result.request = request;
+    result.status = status;
+    result.completedTime = std::chrono::steady_clock::now();
+    emit plateRecognized(result);
+}
+
+// Ответ на запрос, занимавший место в окне камеры
+void AsyncOCRClient::finishRequest(const OcrResult &result)
+{
+    emit plateRecognized(result);
+
+    // Освободилось место в окне камеры - отправляем ожидающий кадр
+    StreamWindow &window = windows[result.request.streamId];
+    window.inFlight--;
+    drainQueue(window);
+}
+
+std::chrono::steady_clock::time_point AsyncOCRClient::deadline(const OcrRequest &request) const
+{
+    return request.captureTime + std::chrono::milliseconds(config.timeoutMs);
+}
+
+OcrStatus AsyncOCRClient::replyStatus(QNetworkReply *reply)
+{
+    if (reply->error() == QNetworkReply::NoError) {
+        return OcrStatus::Ok;
+    }
+    if (reply->property("timedOut").toBool()) {
+        return OcrStatus::TimedOut;
+    }
+    qDebug() << "OCR request failed:" << reply->errorString();
+    return OcrStatus::Failed;
+}
+
+QNetworkRequest AsyncOCRClient::singleRequest(const QString &recognizeUrl, OcrRequestKind kind)
+{
+    // Для готовых вырезок номера сервер пропускает свой детектор
+    QNetworkRequest request(kind == OcrRequestKind::PlateCrop ? recognizeUrl + "?crop=1"
+                                                              : recognizeUrl);
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/octet-stream");
+    return request;
+}
+
+// Часть пакета: имя - номер изображения в пакете, по нему сервер вернет ответ
+QHttpPart AsyncOCRClient::batchPart(int id, const OcrImage &image, BufferPool<QByteArray> &pool)
+{
+    const QString kind = image.request.kind == OcrRequestKind::PlateCrop ? "crop" : "frame";
+    QHttpPart part;
+    part.setHeader(QNetworkRequest::ContentDispositionHeader,
+                   QString("form-data; name=\"%1\"; filename=\"%2\"")
+                       .arg(QString::number(id), kind));
+    part.setHeader(QNetworkRequest::ContentTypeHeader, "image/jpeg");
+    part.setBody(image.jpeg.isEmpty() ? encodeJpeg(image.image, image.request.jpegQuality, pool)
+                                      : image.jpeg);
+    return part;
+}
+
+// Server-Timing: inference;dur=12.3 - время распознавания на сервере, мс
+std::chrono::steady_clock::duration AsyncOCRClient::parseServerTiming(const QByteArray &header)
+{
+    const int at = header.indexOf("dur=");
+    if (at < 0) {
+        return std::chrono::steady_clock::duration(0);
+    }
+    QByteArray value = header.mid(at + 4);
+    const int end = value.indexOf(';');
+    if (end >= 0) {
+        value = value.left(end);
+    }
+    bool ok = false;
+    const double ms = value.trimmed().toDouble(&ok);
+    if (!ok || ms < 0.0) {
+        return std::chrono::steady_clock::duration(0);
+    }
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double, std::milli>(ms));
+}
+
+static void readFirstPlate(const QJsonArray &plates, OcrResult &result)
+{
+    if (!plates.isEmpty()) {
+        QJsonObject plateObj = plates[0].toObject();
+        result.plate = plateObj["text"].toString();
+        result.confidence = plateObj["confidence"].toDouble();
+    }
+}
+
+void AsyncOCRClient::parseReply(const QByteArray &body, OcrResult &result)
+{
+    readFirstPlate(QJsonDocument::fromJson(body).object()["plates"].toArray(), result);
+}
+
+QHash<QString, QJsonArray> AsyncOCRClient::parseBatchReply(const QByteArray &body)
+{
+    QHash<QString, QJsonArray> platesById;
+    for (const QJsonValue &value : QJsonDocument::fromJson(body).object()["results"].toArray()) {
+        QJsonObject item = value.toObject();
+        platesById.insert(item["id"].toString(), item["plates"].toArray());
+    }
+    return platesById;
+}
+
+void AsyncOCRClient::onReplyFinished(QNetworkReply *reply)
+{
     reply->deleteLater();
+    if (healthChecks.contains(reply)) {
+        onHealthFinished(reply);
+        return;
+    }
+    if (pendingBatches.contains(reply)) {
+        onBatchFinished(reply);
+        return;
+    }
+
+    // Отмененный дубль уже снят с учета
+    auto it = pendingRequests.find(reply);
+    if (it == pendingRequests.end()) {
+        return;
+    }
+    const InFlight flight = it.value();
+    pendingRequests.erase(it);
+
+    OcrResult result;
+    result.request = flight.request;
+    result.completedTime = std::chrono::steady_clock::now();
+    result.status = replyStatus(reply);
+    result.serverTime = parseServerTiming(reply->rawHeader("Server-Timing"));
+    recordBackend(flight.backend, result.status, result.networkTime());
+
+    if (flight.twin) {
+        if (result.status != OcrStatus::Ok) {
+            // Ответ даст второй экземпляр
+            pendingRequests[flight.twin].twin = nullptr;
+            return;
+        }
+        // Первый удачный ответ побеждает, второй экземпляр отменяем
+        const InFlight loser = pendingRequests.take(flight.twin);
+        backends[loser.backend].stats->outstanding.fetch_sub(1, std::memory_order_relaxed);
+        flight.twin->abort();
+    }
+
+    if (result.status == OcrStatus::Ok) {
+        parseReply(reply->readAll(), result);
+    }
+
+    finishRequest(result);
+}
+
+void AsyncOCRClient::onLocalFinished(const OcrResult &result, const QJsonArray &plates)
+{
+    OcrResult finished = result;
+    if (finished.status == OcrStatus::Ok) {
+        readFirstPlate(plates, finished);
+    }
+    finishRequest(finished);
+}
+
+void AsyncOCRClient::onBatchFinished(QNetworkReply *reply)
+{
+    const InFlightBatch flight = pendingBatches.take(reply);
+    const std::vector<OcrRequest> &requests = flight.requests;
+    const OcrStatus status = replyStatus(reply);
+
+    // Ответ: {"results": [{"id": "0", "plates": [...]}, ...]} в порядке запроса
+    QHash<QString, QJsonArray> platesById;
+    if (status == OcrStatus::Ok) {
+        platesById = parseBatchReply(reply->readAll());
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    const auto serverTime = parseServerTiming(reply->rawHeader("Server-Timing"));
+    recordBackend(flight.backend, status,
+                  requests.empty() ? std::chrono::steady_clock::duration(0)
+                                   : now - requests.front().sentTime);
+    for (size_t i = 0; i < requests.size(); ++i) {
+        OcrResult result;
+        result.request = requests[i];
+        result.completedTime = now;
+        result.status = status;
+        result.serverTime = serverTime;
+
+        if (status == OcrStatus::Ok) {
+            auto it = platesById.constFind(QString::number(i));
+            if (it == platesById.constEnd()) {
+                result.status = OcrStatus::Failed;
+            } else {
+                readFirstPlate(it.value(), result);
+            }
+        }
+        finishRequest(result);
+    }
 }
@@ -1,25 +1,177 @@
 #pragma once
 
+#include <QHash>
+#include <QHttpPart>
 #include <QImage>
+#include <QJsonArray>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QObject>
+#include <QTimer>
 #include <opencv2/opencv.hpp>
 
+#include <memory>
+#include <vector>
+
+#include "buffer_pool.h"
+#include "ocr_types.h"
+#include "shm_ocr_channel.h"
+#include "stream_stats.h"
+
+struct OcrClientConfig
+{
+    QString serviceUrl = "http://127.0.0.1:5000/recognize";
+    int maxInFlightPerStream = 2; // запросов одной камеры одновременно в сети
+    int timeoutMs = 2000;         // срок ответа, считается от захвата кадра
+
+    // Пакетная отправка: 0 - каждое изображение отдельным запросом.
+    // Пустой batchUrl - recognize_batch рядом с serviceUrl (тот же сервер)
+    QString batchUrl;
+    int batchWindowMs = 0; // сколько ждать остальные изображения пакета
+    int maxBatchSize = 16; // пакет уходит сразу, как только набран
+
+    // Пул серверов: базовые адреса (http://host:port), запросы идут на их
+    // /recognize и /recognize_batch. Пусто - один сервер serviceUrl/batchUrl
+    QStringList backends;
+    int healthIntervalMs = 2000; // опрос /health каждого сервера
+    int maxFailures = 3;         // ошибок подряд до исключения сервера из пула
+    int hedgeAfterMs = 0;        // нет ответа за это время - дубль на другой сервер; 0 - выкл.
+
+    // Локальный канал через общую память вместо HTTP (сервер на той же машине)
+    ShmChannelConfig local;
+
+    int encodeBuffers = 64; // буферов JPEG в пуле: запросы в сети и в очередях всех камер
+};
+
+// Клиент OCR-сервера. Живет в отдельном потоке с циклом событий,
+// submitFrameForRecognition() можно вызывать из любого потока.
+//
+// У каждой камеры ограниченное окно запросов в сети. Если окно заполнено,
+// запросы кадра ждут в очереди из одного кадра: более свежий кадр вытесняет
+// ожидающий, и тот возвращается со статусом Coalesced. Запросы, не
+// уложившиеся в срок, отменяются. На каждый принятый запрос приходит ровно
+// один plateRecognized.
+//
+// В пакетном режиме изображения всех камер копятся не дольше batchWindowMs
+// (или до maxBatchSize) и уходят одним запросом на batchUrl, где сервер
+// распознает их одним батчем.
+//
+// Запросы распределяются по пулу серверов: на исправный сервер с наименьшим
+// числом запросов без ответа. Сервер, не ответивший на /health или
+// ошибившийся maxFailures раз подряд, исключается до следующей удачной
+// проверки; если исправных нет, запросы идут на все. Одиночный запрос без
+// ответа дольше hedgeAfterMs дублируется на другой сервер, побеждает первый
+// ответ - это срезает хвост задержек, когда один сервер подвис на GC или батче.
+//
+// С локальным каналом (ShmOcrChannel) изображения не сжимаются вовсе и уходят
+// серверу через общую память; HTTP остается запасным путем, пока канала нет
+// или в нем не хватает слотов.
 class AsyncOCRClient : public QObject
 {
     Q_OBJECT
 public:
-    explicit AsyncOCRClient(QObject *parent = nullptr);
-    void submitFrameForRecognition(const cv::Mat &frame);
+    explicit AsyncOCRClient(const OcrClientConfig &config = OcrClientConfig(),
+                            QObject *parent = nullptr);
+
+    // Возвращает размер отправленного изображения в байтах
+    size_t submitFrameForRecognition(const OcrRequest &request, const cv::Mat &frame);
+
+    // Уже сжатый JPEG (кадр MJPEG-камеры) отправляется как есть
+    size_t submitEncodedForRecognition(const OcrRequest &request, const QByteArray &jpeg);
+
+    // Счетчики серверов пула; набор постоянен, читать можно из любого потока
+    int backendCount() const { return static_cast<int>(backends.size()); }
+    const OcrBackendStats &backendStats(int index) const { return *backends[index].stats; }
+
+    // JPEG, сжатые мимо пула (все буферы были заняты)
+    uint64_t encodePoolMisses() const { return encodeMisses.load(std::memory_order_relaxed); }
+
+    // Сборка запросов и разбор ответов сервера; открыты для kernel_bench
+    static QNetworkRequest singleRequest(const QString &recognizeUrl, OcrRequestKind kind);
+    static QHttpPart batchPart(int id, const OcrImage &image, BufferPool<QByteArray> &pool);
+    // {"plates": [...]} -> первый номер в result
+    static void parseReply(const QByteArray &body, OcrResult &result);
+    // {"results": [{"id": "0", "plates": [...]}, ...]} -> номера по id
+    static QHash<QString, QJsonArray> parseBatchReply(const QByteArray &body);
+    // Server-Timing: inference;dur=12.3 - время распознавания на сервере
+    static std::chrono::steady_clock::duration parseServerTiming(const QByteArray &header);
 
 signals:
-    void plateRecognized(const QString &plate, double confidence);
+    void plateRecognized(const OcrResult &result);
 
 private slots:
     void onReplyFinished(QNetworkReply *reply);
+    void flushBatch();
 
 private:
+    struct Backend
+    {
+        QString recognizeUrl;
+        QString batchUrl;
+        QString healthUrl;
+        int failures = 0; // ошибок подряд
+        std::unique_ptr<OcrBackendStats> stats;
+    };
+
+    // Одиночный запрос в сети
+    struct InFlight
+    {
+        OcrRequest request;
+        QByteArray imageData; // для дубля
+        int backend = 0;
+        QNetworkReply *twin = nullptr; // второй экземпляр того же запроса
+    };
+
+    struct InFlightBatch
+    {
+        std::vector<OcrRequest> requests;
+        int backend = 0;
+    };
+
+    // Окно одной камеры, используется только в потоке клиента
+    struct StreamWindow
+    {
+        int inFlight = 0;
+        std::vector<OcrImage> queued; // запросы одного кадра
+    };
+
+    void enqueueImage(const OcrImage &image);
+    void postImage(const OcrImage &image);
+    void postHttp(const OcrImage &image);
+    QNetworkReply *sendSingle(const OcrRequest &request, const QByteArray &imageData,
+                              int backend);
+    void hedge(QNetworkReply *reply);
+    int pickBackend(int exclude = -1);
+    void recordBackend(int backend, OcrStatus status, std::chrono::steady_clock::duration latency);
+    void checkHealth();
+    void onHealthFinished(QNetworkReply *reply);
+    void onLocalFinished(const OcrResult &result, const QJsonArray &plates);
+    void armDeadline(QNetworkReply *reply, std::chrono::steady_clock::time_point until);
+    void drainQueue(StreamWindow &window);
+    void emitStatus(const OcrRequest &request, OcrStatus status);
+    void finishRequest(const OcrResult &result);
+    void onBatchFinished(QNetworkReply *reply);
+    OcrStatus replyStatus(QNetworkReply *reply);
+    std::chrono::steady_clock::time_point deadline(const OcrRequest &request) const;
+
+    OcrClientConfig config;
+
+    // Сжатые изображения возвращаются в пул, когда Qt отпустит тело запроса
+    std::atomic<uint64_t> encodeMisses{0};
+    BufferPool<QByteArray> encodePool;
+
     QNetworkAccessManager *manager;
-    QString serviceUrl = "http://127.0.0.1:5000/recognize";
+    QHash<QNetworkReply *, InFlight> pendingRequests;
+    QHash<int, StreamWindow> windows;
+
+    QTimer *batchTimer;
+    std::vector<OcrImage> batch;
+    QHash<QNetworkReply *, InFlightBatch> pendingBatches;
+
+    std::vector<Backend> backends;
+    int nextBackend = 0; // с кого начинать выбор при равной загрузке
+    QTimer *healthTimer;
+    QHash<QNetworkReply *, int> healthChecks;
+
+    ShmOcrChannel *local = nullptr;
 };
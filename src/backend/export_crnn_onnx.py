@@ -0,0 +1,39 @@
+"""Экспорт CRNN из ANPR-System в ONNX для локального распознавания (PlateOcrEngine, --ocr native).
+
+Квантованные FX-веса (crnn_ocr_model_int8_fx.pth) в ONNX не переносятся,
+поэтому экспортируется FP32-чекпойнт из ocr_train.ipynb (crnn_ocr_model_best.pth).
+
+    python3 export_crnn_onnx.py --weights crnn_ocr_model_best.pth --output crnn_ocr.onnx
+"""
+import argparse
+import os
+import sys
+
+import torch
+
+current_dir = os.getcwd()
+sys.path.append(os.path.join(current_dir, "ANPR-System"))
+from inference import Config, CRNN
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--weights', default='crnn_ocr_model_best.pth')
+    parser.add_argument('--output', default='crnn_ocr.onnx')
+    parser.add_argument('--opset', type=int, default=13)
+    args = parser.parse_args()
+
+    model = CRNN(len(Config.OCR_ALPHABET) + 1).eval()
+    model.load_state_dict(torch.load(args.weights, map_location='cpu'))
+
+    # Вход (batch, 1, 32, 128), выход log_softmax (32, batch, классы); батч переменный
+    dummy = torch.randn(1, 1, Config.OCR_IMG_HEIGHT, Config.OCR_IMG_WIDTH)
+    torch.onnx.export(model, dummy, args.output,
+                      input_names=['image'], output_names=['logits'],
+                      dynamic_axes={'image': {0: 'batch'}, 'logits': {1: 'batch'}},
+                      opset_version=args.opset)
+    print(f"Saved {args.output}, alphabet: {Config.OCR_ALPHABET}")
+
+
+if __name__ == '__main__':
+    main()
@@ -7,6 +7,11 @@ import time
 import threading
 import sys
 import os
+import json
+import mmap
+import argparse
+import socketserver
+from concurrent.futures import ThreadPoolExecutor
 import torch
 
 current_dir = os.getcwd()
@@ -40,7 +45,80 @@ logger.info("initialized successfully!")
 request_counter = 0
 counter_lock = threading.Lock()
 
-def process_image(image_data, current_request):
+@torch.no_grad()
+def recognize_crops_batch(crops):
+    """Распознает список вырезок номеров одним прогоном CRNN"""
+    if not crops:
+        return []
+    tensors = []
+    for crop in crops:
+        plate = pipeline._preprocess_plate(crop)
+        if plate.size == 0:
+            plate = crop
+        tensors.append(recognizer.transform(plate))
+    preds = recognizer.model(torch.stack(tensors).to(recognizer.device))  # (T, batch, classes)
+    # Уверенность - средняя вероятность лучшего символа по шагам CTC
+    best = preds.exp().max(dim=2).values
+    results = []
+    for i in range(len(crops)):
+        text = recognizer._decode(preds[:, i:i + 1, :])
+        confidence = float(best[:, i].mean()) if text else 0.0
+        results.append({'text': text, 'confidence': confidence})
+    return results
+
+
+def recognize_crop(img):
+    """Распознает уже вырезанный клиентом номер, минуя детектор"""
+    return recognize_crops_batch([img])
+
+
+@torch.no_grad()
+def detect_batch(frames):
+    """Детектор на списке кадров одним вызовом (без трекинга: кадры разных камер)"""
+    detections = detector.model.predict(frames, verbose=False, device=detector.device)
+    results = []
+    for det in detections:
+        boxes = []
+        for x1, y1, x2, y2, conf, _ in det.boxes.data.cpu().numpy():
+            if conf >= Config.DETECTION_CONFIDENCE_THRESHOLD:
+                boxes.append([int(x1), int(y1), int(x2), int(y2)])
+        results.append(boxes)
+    return results
+
+
+def recognize_items(items):
+    """Список (is_crop, img) -> список номеров для каждого изображения.
+    Вырезки идут в CRNN как есть, на кадрах номера сначала ищет детектор;
+    все вырезки распознаются одним батчем"""
+    crops, owners = [], []
+    frames = []
+    for i, (is_crop, img) in enumerate(items):
+        if img is None:
+            continue
+        if is_crop:
+            crops.append(img)
+            owners.append(i)
+        else:
+            frames.append((i, img))
+
+    if frames:
+        detections = detect_batch([img for _, img in frames])
+        for (i, img), boxes in zip(frames, detections):
+            for x1, y1, x2, y2 in boxes:
+                roi = img[y1:y2, x1:x2]
+                if roi.size > 0:
+                    crops.append(roi)
+                    owners.append(i)
+
+    texts = recognize_crops_batch(crops)
+
+    plates = [[] for _ in items]
+    for owner, res in zip(owners, texts):
+        plates[owner].append({'text': res['text'].strip(), 'confidence': res['confidence']})
+    return plates
+
+
+def process_image(image_data, current_request, is_crop=False):
     """Обрабатывает изображение и возвращает распознанный текст"""
     try:
         nparr = np.frombuffer(image_data, np.uint8)
@@ -50,8 +128,11 @@ def process_image(image_data, current_request):
             return {"error": "Failed to decode image"}
         
         # Распознаем текст
-        detections = detector.track(img) # для нескольких кадров
-        results = pipeline.process_frame(img, detections)
+        if is_crop:
+            results = recognize_crop(img)
+        else:
+            detections = detector.track(img) # для нескольких кадров
+            results = pipeline.process_frame(img, detections)
         print("result:", results);
         
         # Форматируем результаты
@@ -73,6 +154,11 @@ def process_image(image_data, current_request):
         logger.error(f"Error processing image: {str(e)}")
         return {"error": str(e)}
 
+def with_server_timing(response, seconds):
+    """Время распознавания для клиента: он отделяет его от времени сети"""
+    response.headers['Server-Timing'] = f'inference;dur={seconds * 1000:.1f}'
+    return response
+
 @app.route('/recognize', methods=['POST'])
 def recognize_plate():
     start_time = time.time()
@@ -95,21 +181,154 @@ def recognize_plate():
         t2 = time.time()
         logger.info(f"[Request #{current_request}]: Receive: {(t2-t1):.3f}s")
 
-        # Обрабатываем изображение
-        result = process_image(image_data, request_counter)
+        # Обрабатываем изображение (crop=1 - клиент прислал вырезку номера)
+        is_crop = request.args.get('crop') == '1'
+        result = process_image(image_data, request_counter, is_crop)
         t3 = time.time()
         logger.info(f"[Request #{current_request}]: Process: {(t3-t2):.3f}s")
                 
         if 'error' in result:
             return jsonify(result), 500
         else:
-            return jsonify(result)
+            return with_server_timing(jsonify(result), t3 - t2)
             
     except Exception as e:
         processing_time = (datetime.now() - start_time).total_seconds()
         logger.error(f"[Request #{current_request}]: Error after {processing_time:.3f}s: {str(e)}")
         return jsonify({'error': 'Internal server error'}), 500
 
+@app.route('/recognize_batch', methods=['POST'])
+def recognize_batch():
+    """Пакет изображений multipart/form-data: имя части - id запроса,
+    имя файла - crop (вырезка номера) или frame (кадр, номер ищет детектор).
+    Все вырезки распознаются одним батчем, ответы идут в порядке частей."""
+    global request_counter
+
+    with counter_lock:
+        request_counter += 1
+        current_request = request_counter
+
+    t1 = time.time()
+    items = []
+    for request_id, storage in request.files.items(multi=True):
+        nparr = np.frombuffer(storage.read(), np.uint8)
+        img = cv2.imdecode(nparr, cv2.IMREAD_COLOR)
+        items.append((request_id, storage.filename == 'crop', img))
+
+    if not items:
+        logger.warning(f"[Batch #{current_request}]: Empty request")
+        return jsonify({'error': 'No image data provided'}), 400
+
+    try:
+        plates = recognize_items([(is_crop, img) for _, is_crop, img in items])
+
+        results = []
+        for (request_id, _, img), found in zip(items, plates):
+            item = {'id': request_id, 'plates': found}
+            if img is None:
+                item['error'] = 'Failed to decode image'
+            results.append(item)
+
+        t2 = time.time()
+        logger.info(f"[Batch #{current_request}]: {len(items)} images, "
+                    f"{sum(len(found) for found in plates)} plates, Process: {(t2-t1):.3f}s")
+        return with_server_timing(jsonify({'results': results}), t2 - t1)
+
+    except Exception as e:
+        logger.error(f"[Batch #{current_request}]: Error: {str(e)}")
+        return jsonify({'error': 'Internal server error'}), 500
+
+# Локальный канал для клиента на этой же машине (ShmOcrChannel): изображения
+# лежат в общей памяти клиента, по Unix-сокету идут только строки JSON.
+#   -> {"shm": "/lpr_ocr_1_0", "slots": 16, "slot_size": 8388608}   <- {"ok": true}
+#   -> {"items": [{"id": 5, "slot": 2, "kind": "crop", "width": 160, "height": 48, "channels": 3},
+#                 {"id": 6, "slot": 3, "kind": "frame", "jpeg": 51234}]}
+#   <- {"results": [{"id": 5, "slot": 2, "plates": [...]}, ...], "dur": 12.3}
+# Слот клиент снова использует только после ответа, поэтому несжатые
+# изображения читаются прямо из общей памяти, без копии.
+def slot_image(mm, slot_size, item):
+    offset = item['slot'] * slot_size
+    if 'jpeg' in item:
+        data = np.frombuffer(mm, np.uint8, item['jpeg'], offset)
+        return cv2.imdecode(data, cv2.IMREAD_COLOR)
+    shape = (item['height'], item['width'], item['channels'])
+    if shape[0] * shape[1] * shape[2] > slot_size:
+        return None
+    img = np.ndarray(shape, np.uint8, buffer=mm, offset=offset)
+    if shape[2] == 1:
+        img = cv2.cvtColor(img, cv2.COLOR_GRAY2BGR)
+    return img
+
+
+class LocalOcrHandler(socketserver.StreamRequestHandler):
+    def attach(self):
+        hello = json.loads(self.rfile.readline())
+        slot_size = int(hello['slot_size'])
+        # Сегмент создал клиент; открываем файл сами, а не через SharedMemory,
+        # чтобы трекер ресурсов Python не удалил его при выходе сервера
+        fd = os.open(os.path.join('/dev/shm', hello['shm'].lstrip('/')), os.O_RDWR)
+        try:
+            mm = mmap.mmap(fd, int(hello['slots']) * slot_size)
+        finally:
+            os.close(fd)
+        return hello['shm'], mm, slot_size
+
+    def handle(self):
+        try:
+            name, mm, slot_size = self.attach()
+        except (OSError, ValueError, KeyError) as e:
+            logger.error(f"[Local]: Client rejected: {e}")
+            self.wfile.write((json.dumps({'error': str(e)}) + '\n').encode())
+            return
+        self.wfile.write(b'{"ok": true}\n')
+        logger.info(f"[Local]: Client attached: {name}")
+
+        write_lock = threading.Lock()
+
+        def process(message):
+            t1 = time.time()
+            items = message.get('items', [])
+            try:
+                images = [slot_image(mm, slot_size, item) for item in items]
+                plates = recognize_items([(item.get('kind') == 'crop', img)
+                                          for item, img in zip(items, images)])
+                results = []
+                for item, img, found in zip(items, images, plates):
+                    result = {'id': item['id'], 'slot': item['slot'], 'plates': found}
+                    if img is None:
+                        result['error'] = 'Failed to decode image'
+                    results.append(result)
+            except Exception as e:
+                logger.error(f"[Local]: Error: {str(e)}")
+                results = [{'id': item['id'], 'slot': item['slot'], 'error': str(e)}
+                           for item in items]
+            reply = json.dumps({'results': results, 'dur': (time.time() - t1) * 1000})
+            with write_lock:
+                self.wfile.write((reply + '\n').encode())
+
+        # Сообщения распознаются параллельно, как запросы HTTP в waitress
+        try:
+            with ThreadPoolExecutor(max_workers=8) as executor:
+                for line in self.rfile:
+                    if line.strip():
+                        executor.submit(process, json.loads(line))
+        finally:
+            logger.info(f"[Local]: Client detached: {name}")
+            try:
+                mm.close()
+            except BufferError:
+                pass  # на слоты еще ссылаются массивы, память освободит сборщик
+
+
+def serve_local(path):
+    if os.path.exists(path):
+        os.unlink(path)
+    server = socketserver.ThreadingUnixStreamServer(path, LocalOcrHandler)
+    server.daemon_threads = True
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    return server
+
+
 @app.route('/health', methods=['GET'])
 def health_check():
     """Проверка статуса сервера"""
@@ -128,12 +347,27 @@ def get_stats():
     })
 
 if __name__ == '__main__':
-    logger.info("Starting OCR Server on http://127.0.0.1:5000")
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--host', default='127.0.0.1')
+    parser.add_argument('--port', type=int, default=5000,
+                        help="несколько процессов на разных портах - пул для --ocr-backends")
+    parser.add_argument('--threads', type=int, default=8)
+    parser.add_argument('--local-socket', default='/tmp/lpr_ocr.sock',
+                        help="Unix-сокет локального канала через общую память ('' - выключен)")
+    args = parser.parse_args()
+
+    address = f"http://{args.host}:{args.port}"
+    logger.info(f"Starting OCR Server on {address}")
     logger.info("Available endpoints:")
-    logger.info("  POST /recognize - recognize text in image")
+    logger.info("  POST /recognize - recognize text in image (?crop=1 for plate crops)")
+    logger.info("  POST /recognize_batch - multipart batch of crops/frames, one inference")
     logger.info("  GET  /health    - health check")
     logger.info("  GET  /stats     - server statistics")
 
+    if args.local_socket:
+        serve_local(args.local_socket)
+        logger.info(f"  local shared-memory channel on {args.local_socket}")
+
     from waitress import serve
-    logger.info("Starting production server on http://127.0.0.1:5000")
-    serve(app, host='127.0.0.1', port=5000, threads=8)
+    logger.info(f"Starting production server on {address}")
+    serve(app, host=args.host, port=args.port, threads=args.threads)
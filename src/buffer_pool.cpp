@@ -0,0 +1,17 @@
+#include "buffer_pool.h"
+
+#include <cstring>
+
+QByteArray encodeJpeg(const cv::Mat &image, int quality, BufferPool<QByteArray> &pool)
+{
+    thread_local std::vector<uchar> encoded;
+    if (!cv::imencode(".jpg", image, encoded, {cv::IMWRITE_JPEG_QUALITY, quality})) {
+        return QByteArray();
+    }
+
+    return pool.acquire([](QByteArray &bytes) {
+        bytes.resize(static_cast<int>(encoded.size()));
+        std::memcpy(bytes.data(), encoded.data(), encoded.size());
+        return true;
+    });
+}
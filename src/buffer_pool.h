@@ -0,0 +1,104 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <QByteArray>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Буфер свободен, когда ссылка на его данные осталась только в пуле. Счетчики
+// ссылок cv::Mat и QByteArray атомарные, их хватает вместо своего учета
+inline bool isSoleOwner(const cv::Mat &mat)
+{
+    return !mat.u || CV_XADD(&mat.u->refcount, 0) == 1;
+}
+
+inline bool isSoleOwner(const QByteArray &bytes)
+{
+    return bytes.isNull() || bytes.isDetached();
+}
+
+// Пул переиспользуемых буферов кадров (cv::Mat) и сжатых изображений
+// (QByteArray) без блокировок. Буфер заполняется на месте и отдается наружу
+// разделяемой ссылкой, как обычный Mat или QByteArray: он возвращается в пул
+// сам, когда последний потребитель (кольцо кадров, вырезки в запросах, сетевой
+// запрос Qt) отпустит свою копию. Размер и тип буфера сохраняются, поэтому
+// после первых кадров повторное заполнение того же размера память не выделяет.
+//
+// Слот захватывается флагом (compare_exchange) только на время заполнения,
+// так что брать буферы могут несколько потоков. Свободных нет - буфер
+// выделяется мимо пула и учитывается в misses.
+template <typename T>
+class BufferPool
+{
+public:
+    explicit BufferPool(size_t capacity, std::atomic<uint64_t> *misses = nullptr)
+        : buffers(capacity)
+        , claimed(new std::atomic<bool>[capacity])
+        , misses(misses)
+    {
+        for (size_t i = 0; i < capacity; ++i) {
+            claimed[i] = false;
+        }
+    }
+
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+
+    // fill(T &) заполняет буфер и возвращает false, если заполнить не удалось
+    // (тогда возвращается пустой T)
+    template <typename F>
+    T acquire(F &&fill)
+    {
+        // Поиск всегда с начала: заняты в основном первые буферы, память
+        // остальных не выделяется, пока они не понадобятся
+        for (size_t i = 0; i < buffers.size(); ++i) {
+            bool expected = false;
+            if (!claimed[i].compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                continue;
+            }
+            if (!isSoleOwner(buffers[i])) {
+                claimed[i].store(false, std::memory_order_release);
+                continue;
+            }
+            T shared = fill(buffers[i]) ? buffers[i] : T();
+            claimed[i].store(false, std::memory_order_release);
+            return shared;
+        }
+
+        if (misses) {
+            misses->fetch_add(1, std::memory_order_relaxed);
+        }
+        T fresh;
+        return fill(fresh) ? fresh : T();
+    }
+
+    size_t capacity() const { return buffers.size(); }
+
+private:
+    std::vector<T> buffers;
+    std::unique_ptr<std::atomic<bool>[]> claimed;
+    std::atomic<uint64_t> *misses;
+};
+
+// Область size в начале буфера, который только растет: изображения разного
+// размера (вырезки, полосы) пишутся в него на месте, и после самого большого
+// из них память больше не выделяется. Область - ROI, ссылка на весь буфер
+inline cv::Mat bufferArea(cv::Mat &buffer, const cv::Size &size, int type)
+{
+    if (buffer.type() != type || buffer.cols < size.width || buffer.rows < size.height) {
+        buffer.create(std::max(buffer.rows, size.height), std::max(buffer.cols, size.width),
+                      type);
+    }
+    return buffer(cv::Rect(cv::Point(), size));
+}
+
+// JPEG в буфер пула: imencode пишет в рабочий вектор потока, который тоже
+// не перевыделяется, а результат копируется в свободный QByteArray пула.
+// Дальше этот QByteArray уходит в QNetworkAccessManager::post без копии
+QByteArray encodeJpeg(const cv::Mat &image, int quality, BufferPool<QByteArray> &pool);
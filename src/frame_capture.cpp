@@ -0,0 +1,139 @@
+#include "frame_capture.h"
+
+#include <iostream>
+
+namespace {
+// Сверх ячеек кольца: кадр в обработке, кадр просмотра и кадры, на вырезки
+// которых еще ждут ответа
+const size_t kSpareBuffers = 8;
+} // namespace
+
+FrameCapture::FrameCapture(int streamId, const std::string &url, StreamStats &stats,
+                           bool nativeMjpeg)
+    : streamId(streamId)
+    , url(url)
+    , stats(stats)
+    , nativeMjpeg(nativeMjpeg)
+    , frames(LatestFrameRing<CapturedFrame>::kSlots + kSpareBuffers, &stats.bufferPoolMisses)
+    , jpegs(LatestFrameRing<CapturedFrame>::kSlots + kSpareBuffers, &stats.bufferPoolMisses)
+{
+}
+
+FrameCapture::~FrameCapture()
+{
+    stop();
+}
+
+void FrameCapture::start(std::function<void()> onFrameReady, std::function<void()> onFinished)
+{
+    stop();
+
+    this->onFrameReady = std::move(onFrameReady);
+    this->onFinished = std::move(onFinished);
+    stopFlag = false;
+    thread = std::thread(&FrameCapture::run, this);
+}
+
+void FrameCapture::stop()
+{
+    stopFlag = true;
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+bool FrameCapture::takeLatest(CapturedFrame &frame)
+{
+    return ring.takeLatest(frame);
+}
+
+void FrameCapture::run()
+{
+    std::cout << "[" << streamId << "] Connecting to IP camera: " << url << std::endl;
+
+    // MJPEG по HTTP читаем сами: кадры остаются сжатыми, пока не понадобятся
+    if (nativeMjpeg && url.compare(0, 7, "http://") == 0) {
+        MjpegReader reader(stopFlag);
+        if (reader.open(url)) {
+            std::cout << "[" << streamId << "] Successfully connected to MJPEG stream!"
+                      << std::endl;
+            runMjpeg(reader);
+            if (!stopFlag && onFinished) {
+                onFinished();
+            }
+            return;
+        }
+        if (stopFlag) {
+            return;
+        }
+    }
+
+    runVideoCapture();
+    if (!stopFlag && onFinished) {
+        onFinished();
+    }
+}
+
+void FrameCapture::runMjpeg(MjpegReader &reader)
+{
+    while (!stopFlag) {
+        CapturedFrame captured;
+        auto readStart = std::chrono::steady_clock::now();
+        captured.jpeg = jpegs.acquire([&reader](QByteArray &jpeg) { return reader.read(jpeg); });
+        if (captured.jpeg.isEmpty()) {
+            if (!stopFlag) {
+                std::cerr << "[" << streamId << "] Failed to read frame from MJPEG stream"
+                          << std::endl;
+            }
+            break;
+        }
+        deliver(std::move(captured), readStart);
+    }
+    reader.close();
+}
+
+void FrameCapture::runVideoCapture()
+{
+    cv::VideoCapture cap(url);
+    if (!cap.isOpened()) {
+        std::cerr << "[" << streamId << "] Error opening IP camera: " << url << std::endl;
+        return;
+    }
+
+    // Не копим кадры во внутреннем буфере бэкенда, если он это поддерживает
+    cap.set(cv::CAP_PROP_BUFFERSIZE, 1);
+
+    std::cout << "[" << streamId << "] Successfully connected to IP camera!" << std::endl;
+
+    while (!stopFlag) {
+        CapturedFrame captured;
+        auto readStart = std::chrono::steady_clock::now();
+        captured.image = frames.acquire(
+            [&cap](cv::Mat &image) { return cap.read(image) && !image.empty(); });
+        if (captured.image.empty()) {
+            std::cerr << "[" << streamId << "] Failed to grab frame from IP camera" << std::endl;
+            break;
+        }
+        deliver(std::move(captured), readStart);
+    }
+
+    cap.release();
+}
+
+void FrameCapture::deliver(CapturedFrame &&captured,
+                           std::chrono::steady_clock::time_point readStart)
+{
+    captured.captureTime = std::chrono::steady_clock::now();
+    stats.readTime.record(captured.captureTime - readStart);
+    captured.frameId = ++nextFrameId;
+    stats.framesCaptured.fetch_add(1, std::memory_order_relaxed);
+
+    // Обработка не успевает - предыдущий кадр, который так и не забрали, вытесняется
+    if (ring.push(std::move(captured))) {
+        stats.framesDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (onFrameReady) {
+        onFrameReady();
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <QByteArray>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include "buffer_pool.h"
+#include "frame_ring.h"
+#include "mjpeg_reader.h"
+#include "stream_stats.h"
+
+// Кадр с номером и моментом захвата. Из MJPEG по HTTP приходят сжатые байты
+// (jpeg), а image пуст, пока обработке не понадобится декодированный кадр
+struct CapturedFrame
+{
+    cv::Mat image;
+    QByteArray jpeg;
+    uint64_t frameId = 0;
+    std::chrono::steady_clock::time_point captureTime;
+};
+
+// Отдельный поток захвата одной камеры. Кадры складываются в LatestFrameRing,
+// поэтому задержки обработки не тормозят чтение потока камеры. Кадры и байты
+// JPEG читаются в буферы пула: в установившемся режиме захват память не выделяет.
+class FrameCapture
+{
+public:
+    // nativeMjpeg - http:// читать своим разборщиком MJPEG без декодирования
+    FrameCapture(int streamId, const std::string &url, StreamStats &stats,
+                 bool nativeMjpeg = true);
+    ~FrameCapture();
+
+    // onFrameReady и onFinished вызываются из потока захвата
+    void start(std::function<void()> onFrameReady, std::function<void()> onFinished);
+    void stop();
+
+    bool takeLatest(CapturedFrame &frame);
+    bool hasFrames() const { return !ring.empty(); }
+
+private:
+    void run();
+    void runMjpeg(MjpegReader &reader);
+    void runVideoCapture();
+    void deliver(CapturedFrame &&captured, std::chrono::steady_clock::time_point readStart);
+
+    int streamId;
+    std::string url;
+    StreamStats &stats;
+    bool nativeMjpeg;
+
+    LatestFrameRing<CapturedFrame> ring;
+    uint64_t nextFrameId = 0;
+
+    // Кадр занят, пока на него ссылаются кольцо, шаг камеры, просмотр и
+    // вырезки в запросах OCR
+    BufferPool<cv::Mat> frames;
+    BufferPool<QByteArray> jpegs;
+
+    std::thread thread;
+    std::atomic<bool> stopFlag{false};
+    std::function<void()> onFrameReady;
+    std::function<void()> onFinished;
+};
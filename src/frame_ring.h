@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Последний кадр между одним писателем и одним читателем без блокировок:
+// три ячейки по кругу (тройная буферизация). Писатель заполняет свою ячейку
+// и обменивает ее с общей; если общую еще не забрали, лежавший там кадр
+// вытесняется. Читатель обменивает общую ячейку со своей, только когда в ней
+// новый кадр. Поэтому читатель всегда получает последний захваченный кадр,
+// сколько бы ни длился шаг обработки, а вытесненные кадры - потерянные.
+template <typename T>
+class LatestFrameRing
+{
+public:
+    // Ячеек, которые могут держать кадры одновременно (для размера пула)
+    static constexpr size_t kSlots = 3;
+
+    // Только поток-писатель. true - вытеснен непрочитанный кадр
+    bool push(T &&item)
+    {
+        items[back] = std::move(item);
+        const unsigned previous = shared.exchange(back | kFresh, std::memory_order_acq_rel);
+        back = previous & kIndexMask;
+        if (previous & kFresh) {
+            items[back] = T();
+            return true;
+        }
+        return false;
+    }
+
+    // Только поток-читатель
+    bool takeLatest(T &item)
+    {
+        if (!(shared.load(std::memory_order_relaxed) & kFresh)) {
+            return false;
+        }
+        front = shared.exchange(front, std::memory_order_acq_rel) & kIndexMask;
+        item = std::move(items[front]);
+        items[front] = T();
+        return true;
+    }
+
+    bool empty() const { return !(shared.load(std::memory_order_acquire) & kFresh); }
+
+private:
+    static constexpr unsigned kIndexMask = 3;
+    static constexpr unsigned kFresh = 4; // в общей ячейке кадр, который еще не забрали
+
+    std::array<T, kSlots> items;
+    alignas(64) unsigned back = 0;  // ячейка писателя
+    alignas(64) unsigned front = 2; // ячейка читателя
+    alignas(64) std::atomic<unsigned> shared{1};
+};
@@ -0,0 +1,136 @@
+#include "lane_roi.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+#include <set>
+
+// Четыре вершины на сторонах описанного прямоугольника - маска не нужна
+static bool isRectangle(const std::vector<cv::Point> &polygon, const cv::Rect &bounds)
+{
+    if (polygon.size() != 4) {
+        return false;
+    }
+    const int right = bounds.x + bounds.width - 1;
+    const int bottom = bounds.y + bounds.height - 1;
+    for (const cv::Point &point : polygon) {
+        if ((point.x != bounds.x && point.x != right)
+            || (point.y != bounds.y && point.y != bottom)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<const RoiSet> RoiSet::build(const std::vector<LaneRoi> &lanes)
+{
+    auto set = std::make_shared<RoiSet>();
+    for (const LaneRoi &roi : lanes) {
+        Lane lane;
+        lane.roi = roi;
+        if (!roi.polygon.empty()) {
+            lane.bounds = cv::boundingRect(roi.polygon);
+            if (!isRectangle(roi.polygon, lane.bounds)) {
+                std::vector<cv::Point> shifted;
+                for (const cv::Point &point : roi.polygon) {
+                    shifted.push_back(point - lane.bounds.tl());
+                }
+                lane.mask = cv::Mat::zeros(lane.bounds.size(), CV_8U);
+                cv::fillPoly(lane.mask, std::vector<std::vector<cv::Point>>{shifted},
+                             cv::Scalar(255));
+            }
+        }
+        set->lanes.push_back(lane);
+    }
+    if (set->lanes.empty()) {
+        set->lanes.push_back(Lane());
+    }
+    return set;
+}
+
+LaneRoi RoiSet::rectLane(const cv::Rect &rect, int lane)
+{
+    LaneRoi roi;
+    roi.lane = lane;
+    if (!rect.empty()) {
+        const cv::Point br(rect.x + rect.width - 1, rect.y + rect.height - 1);
+        roi.polygon = {rect.tl(), cv::Point(br.x, rect.y), br, cv::Point(rect.x, br.y)};
+    }
+    return roi;
+}
+
+bool loadLanes(const QString &path, std::vector<LaneRoi> &lanes, QString &error)
+{
+    lanes.clear();
+    QFile file(path);
+    if (!file.exists()) {
+        return true;
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = QString("Cannot open lanes file %1").arg(path);
+        return false;
+    }
+
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (!document.isObject()) {
+        error = QString("Invalid lanes file %1: %2").arg(path, parseError.errorString());
+        return false;
+    }
+
+    std::set<int> ids;
+    for (const QJsonValue &value : document.object().value("lanes").toArray()) {
+        const QJsonObject object = value.toObject();
+        LaneRoi lane;
+        lane.lane = object.value("lane").toInt(static_cast<int>(lanes.size()) + 1);
+        lane.intervalMs = object.value("interval").toInt(0);
+        for (const QJsonValue &vertex : object.value("polygon").toArray()) {
+            const QJsonArray xy = vertex.toArray();
+            if (xy.size() != 2 || xy[0].toInt(-1) < 0 || xy[1].toInt(-1) < 0) {
+                error = QString("Invalid vertex in lane %1 of %2").arg(lane.lane).arg(path);
+                return false;
+            }
+            lane.polygon.emplace_back(xy[0].toInt(), xy[1].toInt());
+        }
+        if (lane.polygon.size() < 3 || lane.intervalMs < 0 || !ids.insert(lane.lane).second) {
+            error = QString("Invalid lane %1 in %2").arg(lane.lane).arg(path);
+            return false;
+        }
+        lanes.push_back(lane);
+    }
+    return true;
+}
+
+bool saveLanes(const QString &path, const std::vector<LaneRoi> &lanes, QString &error)
+{
+    QJsonArray array;
+    for (const LaneRoi &lane : lanes) {
+        QJsonArray polygon;
+        for (const cv::Point &point : lane.polygon) {
+            polygon.append(QJsonArray{point.x, point.y});
+        }
+        QJsonObject object;
+        object["lane"] = lane.lane;
+        object["polygon"] = polygon;
+        if (lane.intervalMs > 0) {
+            object["interval"] = lane.intervalMs;
+        }
+        array.append(object);
+    }
+
+    // Файл подменяется целиком: прерванная запись не оставит полфайла
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        error = QString("Cannot write lanes file %1").arg(path);
+        return false;
+    }
+    file.write(QJsonDocument(QJsonObject{{"lanes", array}}).toJson());
+    if (!file.commit()) {
+        error = QString("Cannot write lanes file %1").arg(path);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <QString>
+
+#include <memory>
+#include <vector>
+
+// Полоса движения: многоугольник в координатах кадра со своим номером и
+// частотой отправки
+struct LaneRoi
+{
+    int lane = 0;                   // номер полосы в событиях; 0 - ROI без файла полос
+    std::vector<cv::Point> polygon; // не меньше трех вершин
+    int intervalMs = 0;             // вместо --interval / --burst камеры; 0 - как у камеры
+};
+
+// Неизменяемый набор полос камеры с заранее построенными масками. Публикуется
+// целиком через shared_ptr (RCU): окно собирает новый набор и подменяет
+// указатель, шаг камеры берет указатель один раз на кадр и дорабатывает кадр
+// со старым набором. Пустой набор - одна полоса на весь кадр.
+struct RoiSet
+{
+    struct Lane
+    {
+        LaneRoi roi;
+        cv::Rect bounds; // описанный прямоугольник; пустой - весь кадр
+        cv::Mat mask;    // CV_8U размером bounds; пустая - многоугольник и есть прямоугольник
+    };
+
+    std::vector<Lane> lanes;
+
+    static std::shared_ptr<const RoiSet> build(const std::vector<LaneRoi> &lanes);
+
+    // Одна прямоугольная полоса (--roi и ROI, выбранный в окне); пустой - весь кадр
+    static LaneRoi rectLane(const cv::Rect &rect, int lane = 0);
+};
+
+// Файл полос камеры:
+//   {"lanes": [{"lane": 1, "polygon": [[x, y], [x, y], [x, y], ...], "interval": 200}]}
+// Нет файла - полос нет (файл появится при сохранении ROI из окна).
+bool loadLanes(const QString &path, std::vector<LaneRoi> &lanes, QString &error);
+bool saveLanes(const QString &path, const std::vector<LaneRoi> &lanes, QString &error);
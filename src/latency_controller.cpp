@@ -0,0 +1,207 @@
+#include "latency_controller.h"
+
+#include <QThread>
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "NumberPlateRecognizer.h"
+
+namespace {
+const uint64_t kMinSamples = 5; // меньше ответов за период - задержку не оцениваем
+const int kCalmPeriods = 3;     // спокойных периодов подряд до шага вверх
+
+// Квантиль гистограммы с линейной интерполяцией внутри корзины (как
+// histogram_quantile в Prometheus): границы корзин слишком грубые для цели
+uint64_t quantileOf(const uint64_t *buckets, uint64_t total, double q)
+{
+    if (total == 0) {
+        return 0;
+    }
+    const double rank = q * total;
+    uint64_t seen = 0;
+    for (int b = 0; b < kLatencyBuckets - 1; ++b) {
+        if (seen + buckets[b] >= rank && buckets[b] > 0) {
+            const double lower = b > 0 ? kLatencyBoundsUs[b - 1] : 0.0;
+            const double upper = kLatencyBoundsUs[b];
+            return static_cast<uint64_t>(lower + (upper - lower) * (rank - seen) / buckets[b]);
+        }
+        seen += buckets[b];
+    }
+    return kLatencyBoundsUs[kLatencyBuckets - 2];
+}
+} // namespace
+
+LatencyController::LatencyController(const LatencyControlConfig &config,
+                                     const std::vector<NumberPlateRecognizer *> &streams,
+                                     QObject *parent)
+    : QObject(parent)
+    , config(config)
+    , streams(streams)
+    , states(streams.size())
+{
+    connect(&timer, &QTimer::timeout, this, &LatencyController::update);
+}
+
+void LatencyController::start()
+{
+    if (!isEnabled()) {
+        return;
+    }
+
+    // Отсчет с текущих счетчиков: прошлые запуски на решения не влияют
+    for (size_t i = 0; i < streams.size(); ++i) {
+        StreamStats &stats = streams[i]->stats();
+        StreamState &state = states[i];
+        for (int b = 0; b < kLatencyBuckets; ++b) {
+            state.buckets[b] = stats.captureToResult.buckets[b].load(std::memory_order_relaxed);
+        }
+        state.submitted = stats.framesSubmitted.load(std::memory_order_relaxed);
+        state.lost = stats.requestsCoalesced.load(std::memory_order_relaxed)
+                     + stats.requestsTimedOut.load(std::memory_order_relaxed);
+        state.calmPeriods = 0;
+    }
+    sampleCpu();
+    timer.start(std::max(100, config.periodMs));
+}
+
+void LatencyController::stop()
+{
+    timer.stop();
+}
+
+// Процессорное время процесса за период в долях всех ядер
+double LatencyController::sampleCpu()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    const double cpuSeconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+                              + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    const auto now = std::chrono::steady_clock::now();
+    const double wallSeconds = std::chrono::duration<double>(now - lastCpuTime).count();
+
+    double load = 0.0;
+    if (lastCpuTime != std::chrono::steady_clock::time_point() && wallSeconds > 0.0) {
+        load = (cpuSeconds - lastCpuSeconds) / wallSeconds
+               / std::max(1, QThread::idealThreadCount());
+    }
+    lastCpuSeconds = cpuSeconds;
+    lastCpuTime = now;
+    cpu.store(load, std::memory_order_relaxed);
+    return load;
+}
+
+void LatencyController::update()
+{
+    const double load = sampleCpu();
+    const bool overloaded = config.cpuLimit > 0.0 && load > config.cpuLimit;
+    const uint64_t targetUs = static_cast<uint64_t>(config.targetMs) * 1000;
+
+    bool degraded = false;
+    std::vector<uint64_t> sentInPeriod(streams.size(), 0);
+    for (size_t i = 0; i < streams.size(); ++i) {
+        StreamStats &stats = streams[i]->stats();
+        StreamQuality &quality = streams[i]->quality();
+        StreamState &state = states[i];
+
+        // Гистограмма за период - разность с прошлым снимком
+        uint64_t window[kLatencyBuckets];
+        uint64_t samples = 0;
+        for (int b = 0; b < kLatencyBuckets; ++b) {
+            const uint64_t total = stats.captureToResult.buckets[b].load(std::memory_order_relaxed);
+            window[b] = total - state.buckets[b];
+            state.buckets[b] = total;
+            samples += window[b];
+        }
+        const uint64_t latencyUs = quantileOf(window, samples, config.quantile);
+
+        const uint64_t submitted = stats.framesSubmitted.load(std::memory_order_relaxed);
+        const uint64_t lost = stats.requestsCoalesced.load(std::memory_order_relaxed)
+                              + stats.requestsTimedOut.load(std::memory_order_relaxed);
+        const uint64_t sent = submitted - state.submitted;
+        const uint64_t dropped = lost - state.lost;
+        state.submitted = submitted;
+        state.lost = lost;
+        sentInPeriod[i] = sent;
+
+        // Больше десятой части запросов не дошли до сервера - очередь переполнена
+        const bool queueFull = dropped * 10 > sent;
+        const bool measured = samples >= kMinSamples;
+        if (measured) {
+            quality.quantileUs.store(latencyUs, std::memory_order_relaxed);
+        }
+
+        const int level = quality.level.load(std::memory_order_relaxed);
+        std::ostringstream reason;
+        reason << std::fixed << std::setprecision(1) << "p" << config.quantile * 100 << " "
+               << latencyUs / 1000.0 << " ms (target " << config.targetMs << " ms), lost "
+               << dropped << " of " << sent;
+        if (measured && latencyUs > 2 * targetUs) {
+            setLevel(static_cast<int>(i), level + 2, reason.str().c_str());
+            degraded = true;
+        } else if ((measured && latencyUs > targetUs) || queueFull) {
+            setLevel(static_cast<int>(i), level + 1, reason.str().c_str());
+            degraded = true;
+        } else if (measured && latencyUs * 10 < targetUs * 6 && dropped == 0 && !overloaded) {
+            if (++state.calmPeriods >= kCalmPeriods) {
+                setLevel(static_cast<int>(i), level - 1, reason.str().c_str());
+            }
+        } else {
+            state.calmPeriods = 0;
+        }
+    }
+
+    if (!overloaded || degraded) {
+        return;
+    }
+
+    // Процессор занят: дешевле становится самая дорогая камера, при равенстве -
+    // та, что отправила больше запросов
+    int victim = -1;
+    for (size_t i = 0; i < streams.size(); ++i) {
+        const int level = streams[i]->quality().level.load(std::memory_order_relaxed);
+        if (level >= kQualityLevelCount - 1) {
+            continue;
+        }
+        if (victim < 0) {
+            victim = static_cast<int>(i);
+            continue;
+        }
+        const int victimLevel = streams[victim]->quality().level.load(std::memory_order_relaxed);
+        if (level < victimLevel || (level == victimLevel && sentInPeriod[i] > sentInPeriod[victim])) {
+            victim = static_cast<int>(i);
+        }
+    }
+    if (victim >= 0) {
+        std::ostringstream reason;
+        reason << std::fixed << std::setprecision(1) << "cpu " << load * 100 << "% (limit "
+               << config.cpuLimit * 100 << "%)";
+        setLevel(victim, streams[victim]->quality().level.load(std::memory_order_relaxed) + 1,
+                 reason.str().c_str());
+    }
+}
+
+void LatencyController::setLevel(int index, int level, const char *reason)
+{
+    StreamQuality &quality = streams[index]->quality();
+    const int previous = quality.level.load(std::memory_order_relaxed);
+    level = std::max(0, std::min(kQualityLevelCount - 1, level));
+    states[index].calmPeriods = 0;
+    if (level == previous) {
+        return;
+    }
+
+    quality.level.store(level, std::memory_order_relaxed);
+    (level > previous ? quality.degrades : quality.upgrades)
+        .fetch_add(1, std::memory_order_relaxed);
+
+    const QualityLevel &knobs = kQualityLevels[level];
+    std::cout << "[" << streams[index]->streamId() << "] latency control: " << reason
+              << ", level " << previous << " -> " << level << " (jpeg " << knobs.jpegQuality
+              << ", interval x" << knobs.intervalScale << ", image x" << knobs.imageScale << ")"
+              << std::endl;
+}
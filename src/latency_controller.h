@@ -0,0 +1,105 @@
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "stream_stats.h"
+
+class NumberPlateRecognizer;
+
+struct LatencyControlConfig
+{
+    int targetMs = 0;         // цель по квантилю задержки от захвата до ответа; 0 - регулятор выключен
+    double quantile = 0.95;
+    int periodMs = 1000;      // как часто пересматривать ступени
+    double cpuLimit = 0.85;   // доля всех ядер, занятая процессом, выше которой камеры разгружаются
+};
+
+// Ступени качества: чем больше номер, тем дешевле запрос для сервера, сети и
+// процессора (реже, меньше, сильнее сжат)
+struct QualityLevel
+{
+    int jpegQuality;
+    double intervalScale; // множитель --interval и --burst
+    double imageScale;    // уменьшение изображения перед отправкой
+};
+
+static constexpr QualityLevel kQualityLevels[] = {
+    {90, 0.5, 1.0}, // сервер свободен: чаще и четче
+    {80, 0.75, 1.0},
+    {70, 1.0, 1.0}, // как без регулятора
+    {60, 1.5, 1.0},
+    {50, 2.0, 0.75},
+    {40, 3.0, 0.5},
+    {40, 5.0, 0.5},
+};
+static constexpr int kQualityLevelCount = sizeof(kQualityLevels) / sizeof(QualityLevel);
+static constexpr int kQualityNominal = 2;
+
+// Ручки одной камеры: пишет регулятор (поток движка), читает шаг камеры в пуле
+struct StreamQuality
+{
+    std::atomic<int> level{kQualityNominal};
+    std::atomic<uint64_t> quantileUs{0}; // задержка за последний период, по которой решали
+    std::atomic<uint64_t> degrades{0};
+    std::atomic<uint64_t> upgrades{0};
+
+    const QualityLevel &current() const
+    {
+        return kQualityLevels[level.load(std::memory_order_relaxed)];
+    }
+};
+
+// Регулятор задержки. Раз в periodMs смотрит у каждой камеры квантиль задержки
+// от захвата до ответа за прошедший период и долю запросов, вытесненных или
+// отмененных в очереди клиента, и переводит камеру на ступень дешевле или
+// дороже. Вниз - сразу (на две ступени при двукратном превышении), вверх -
+// только после трех спокойных периодов подряд, чтобы не раскачиваться.
+// Общая нагрузка процессора разгружает по одной камере за период, начиная с
+// камеры на самой дорогой ступени: много камер деградируют поровну, а не одна
+// до предела.
+class LatencyController : public QObject
+{
+    Q_OBJECT
+
+public:
+    LatencyController(const LatencyControlConfig &config,
+                      const std::vector<NumberPlateRecognizer *> &streams,
+                      QObject *parent = nullptr);
+
+    bool isEnabled() const { return config.targetMs > 0; }
+    const LatencyControlConfig &controlConfig() const { return config; }
+
+    void start();
+    void stop();
+
+    // Доля всех ядер, занятая процессом за последний период
+    double cpuLoad() const { return cpu.load(std::memory_order_relaxed); }
+
+private:
+    struct StreamState
+    {
+        uint64_t buckets[kLatencyBuckets] = {};
+        uint64_t submitted = 0;
+        uint64_t lost = 0; // вытеснены в очереди клиента или не уложились в срок
+        int calmPeriods = 0;
+    };
+
+    void update();
+    double sampleCpu();
+    void setLevel(int index, int level, const char *reason);
+
+    LatencyControlConfig config;
+    std::vector<NumberPlateRecognizer *> streams;
+    std::vector<StreamState> states;
+
+    QTimer timer;
+    std::atomic<double> cpu{0.0};
+    double lastCpuSeconds = 0.0;
+    std::chrono::steady_clock::time_point lastCpuTime;
+};
@@ -1,6 +1,71 @@
 #include "main_window.h"
+#include "metrics_server.h"
+#include "offline_runner.h"
+#include "preview_server.h"
+#include "stream_config.h"
 #include <QApplication>
+#include <QCoreApplication>
+#include <QSocketNotifier>
+#include <csignal>
 #include <iostream>
+#include <memory>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// SIGINT/SIGTERM передаются в цикл событий через пару сокетов:
+// в обработчике сигнала можно только записать байт
+static int signalFds[2] = {-1, -1};
+
+static void onTerminationSignal(int)
+{
+    char byte = 1;
+    ssize_t written = ::write(signalFds[0], &byte, sizeof(byte));
+    (void)written;
+}
+
+// Без окна: QCoreApplication, движок стартует сразу, кадры для показа
+// не копируются, пока к PreviewServer никто не подключен
+static int runHeadless(int argc, char *argv[], const EngineConfig &config)
+{
+    QCoreApplication app(argc, argv);
+
+    StreamEngine engine(config);
+    std::unique_ptr<PreviewServer> preview;
+    if (config.previewPort > 0) {
+        preview.reset(new PreviewServer(&engine, config.previewFps));
+        if (!preview->listen(config.previewHost, static_cast<quint16>(config.previewPort))) {
+            return 1;
+        }
+    }
+
+    std::unique_ptr<MetricsServer> metrics;
+    if (config.metricsPort > 0) {
+        metrics.reset(new MetricsServer(&engine));
+        if (!metrics->listen(config.metricsHost, static_cast<quint16>(config.metricsPort))) {
+            return 1;
+        }
+    }
+
+    QObject::connect(&engine, &StreamEngine::finished, &app, &QCoreApplication::quit);
+
+    std::unique_ptr<QSocketNotifier> signalNotifier;
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, signalFds) == 0) {
+        signalNotifier.reset(new QSocketNotifier(signalFds[1], QSocketNotifier::Read));
+        QObject::connect(signalNotifier.get(), &QSocketNotifier::activated, &app, [&]() {
+            char byte;
+            ssize_t received = ::read(signalFds[1], &byte, sizeof(byte));
+            (void)received;
+            std::cout << "Stopping..." << std::endl;
+            engine.stop();
+            app.quit();
+        });
+        std::signal(SIGINT, onTerminationSignal);
+        std::signal(SIGTERM, onTerminationSignal);
+    }
+
+    engine.start();
+    return app.exec();
+}
 
 int main(int argc, char *argv[])
 {
@@ -20,20 +85,66 @@ int main(int argc, char *argv[])
     std::cout << "3. MJPEG: http://ip:port/mjpeg" << std::endl;
     std::cout << "==================================" << std::endl;
 
-    QString url;
     // Проверяем аргументы командной строки
     if (argc < 2) {
         // Если аргументов нет
-        std::cout << "Enter camera URL";
+        std::cout << "Usage: " << argv[0]
+                  << " [--config file.json] [--headless] [--preview-port N] [--threads N] [--stats ms]"
+                  << " <url> [--roi x,y,w,h | --lanes lanes.json] [--interval ms] [<url> ...]" << std::endl;
+        std::cout << "       " << argv[0]
+                  << " --offline <video | frames dir> [--roi x,y,w,h] [--gate on]"
+                  << " [--output results.csv]" << std::endl;
+        exit(1);
+    }
+
+    QStringList args;
+    for (int i = 1; i < argc; ++i) {
+        args << QString::fromLocal8Bit(argv[i]);
+    }
+
+    EngineConfig config;
+    QString error;
+    if (!parseEngineArgs(args, config, error)) {
+        std::cerr << error.toStdString() << std::endl;
         exit(1);
     }
 
-    url = argv[1]; // Первый аргумент - URL
-    std::cout << "Using URL from command line: " << url.toStdString() << std::endl;
+    for (const StreamConfig &stream : config.streams) {
+        std::cout << "Using URL from command line: [" << stream.id << "] "
+                  << stream.url.toStdString() << std::endl;
+    }
+
+    if (config.offline) {
+        QCoreApplication app(argc, argv);
+        OfflineRunner runner(config);
+        QObject::connect(&runner, &OfflineRunner::finished, &app, &QCoreApplication::quit);
+        if (!runner.start()) {
+            return 1;
+        }
+        return app.exec();
+    }
+
+    if (config.headless) {
+        return runHeadless(argc, argv, config);
+    }
 
     QApplication app(argc, argv);
 
-    MainWindow window(url);
+    StreamEngine engine(config);
+
+    // В режиме с окном тот же просмотр можно открыть и по сети
+    std::unique_ptr<PreviewServer> preview;
+    if (config.previewPort > 0) {
+        preview.reset(new PreviewServer(&engine, config.previewFps));
+        preview->listen(config.previewHost, static_cast<quint16>(config.previewPort));
+    }
+    std::unique_ptr<MetricsServer> metrics;
+    if (config.metricsPort > 0) {
+        metrics.reset(new MetricsServer(&engine));
+        metrics->listen(config.metricsHost, static_cast<quint16>(config.metricsPort));
+    }
+
+    MainWindow window(&engine, config.previewFps);
     window.show();
 
     return app.exec();
@@ -1,38 +1,48 @@
 #include "main_window.h"
 #include <QMessageBox>
 
-MainWindow::MainWindow(const QString &url, QWidget *parent)
+MainWindow::MainWindow(StreamEngine *engine, int previewFps, QWidget *parent)
     : QMainWindow(parent)
-    , m_url(url)
+    , engine(engine)
 {
     // Создаем UI
     QWidget *centralWidget = new QWidget(this);
     QVBoxLayout *layout = new QVBoxLayout(centralWidget);
 
+    streamSelector = new QComboBox(this);
+    for (int i = 0; i < engine->streamCount(); ++i) {
+        const StreamConfig &config = engine->stream(i)->streamConfig();
+        streamSelector->addItem(QString("[%1] %2").arg(config.id).arg(config.url));
+    }
+
     btnStart = new QPushButton("Start Processing", this);
     btnROI = new QPushButton("Select ROI", this);
     btnSaveROI = new QPushButton("Save ROI", this);
     btnClearROI = new QPushButton("Clear ROI", this);
     btnStop = new QPushButton("Stop", this);
     statusLabel = new QLabel("Status: Ready", this);
+    throughputLabel = new QLabel(this);
+    preview = new PreviewWidget(previewFps, this);
 
+    layout->addWidget(preview, 1);
+    layout->addWidget(streamSelector);
     layout->addWidget(btnStart);
     layout->addWidget(btnROI);
     layout->addWidget(btnSaveROI);
     layout->addWidget(btnClearROI);
     layout->addWidget(btnStop);
     layout->addWidget(statusLabel);
+    layout->addWidget(throughputLabel);
 
     setCentralWidget(centralWidget);
 
-    // Создаем распознаватель
-    recognizer = new NumberPlateRecognizer();
-    connect(recognizer, &NumberPlateRecognizer::finished, this, &MainWindow::onRecognizerFinished);
-    connect(recognizer, &NumberPlateRecognizer::error, this, &MainWindow::onRecognizerError);
-    connect(recognizer, &NumberPlateRecognizer::roiUpdated, this, &MainWindow::onROIUpdated);
-
-    recognizer->moveToThread(&workerThread);
-    workerThread.start();
+    connect(engine, &StreamEngine::finished, this, &MainWindow::onRecognizerFinished);
+    connect(engine, &StreamEngine::throughputUpdated, throughputLabel, &QLabel::setText);
+    for (int i = 0; i < engine->streamCount(); ++i) {
+        NumberPlateRecognizer *recognizer = engine->stream(i);
+        connect(recognizer, &NumberPlateRecognizer::error, this, &MainWindow::onRecognizerError);
+        connect(recognizer, &NumberPlateRecognizer::roiUpdated, this, &MainWindow::onROIUpdated);
+    }
 
     // Подключаем сигналы и слоты
     connect(btnStart, &QPushButton::clicked, this, &MainWindow::onStartClicked);
@@ -40,44 +50,73 @@ MainWindow::MainWindow(const QString &url, QWidget *parent)
     connect(btnSaveROI, &QPushButton::clicked, this, &MainWindow::onSaveROIClicked);
     connect(btnClearROI, &QPushButton::clicked, this, &MainWindow::onClearROIClicked);
     connect(btnStop, &QPushButton::clicked, this, &MainWindow::onStopClicked);
+    connect(streamSelector, QOverload<int>::of(&QComboBox::currentIndexChanged), this,
+            &MainWindow::onStreamSelected);
 }
 
 MainWindow::~MainWindow()
 {
-    workerThread.quit();
-    workerThread.wait();
-    recognizer->deleteLater();
+    preview->setRecognizer(nullptr);
+    engine->stop();
+}
+
+NumberPlateRecognizer *MainWindow::currentRecognizer() const
+{
+    if (currentStream < 0 || currentStream >= engine->streamCount()) {
+        return nullptr;
+    }
+    return engine->stream(currentStream);
 }
 
 void MainWindow::onStartClicked()
 {
-    recognizer->startProcessing(m_url);
+    processing = true;
+    onStreamSelected(streamSelector->currentIndex());
+
+    engine->start();
+
     statusLabel->setText("Status: Processing...");
     btnStart->setEnabled(false);
     btnStop->setEnabled(true);
 }
 
+void MainWindow::onStreamSelected(int index)
+{
+    currentStream = index;
+
+    // Просмотр показывает только выбранную камеру и только во время обработки
+    preview->setRecognizer(processing ? currentRecognizer() : nullptr);
+}
+
 void MainWindow::onROIClicked()
 {
-    recognizer->enableROISelection();
-    statusLabel->setText("Status: ROI Selection Mode - draw rectangle on video");
+    if (NumberPlateRecognizer *recognizer = currentRecognizer()) {
+        recognizer->enableROISelection();
+        statusLabel->setText("Status: ROI Selection Mode - draw rectangle on video");
+    }
 }
 
 void MainWindow::onSaveROIClicked()
 {
-    recognizer->saveROI();
-    statusLabel->setText("Status: ROI Saved");
+    if (NumberPlateRecognizer *recognizer = currentRecognizer()) {
+        recognizer->saveROI();
+        statusLabel->setText("Status: ROI Saved");
+    }
 }
 
 void MainWindow::onClearROIClicked()
 {
-    recognizer->clearROI();
-    statusLabel->setText("Status: ROI Cleared");
+    if (NumberPlateRecognizer *recognizer = currentRecognizer()) {
+        recognizer->clearROI();
+        statusLabel->setText("Status: ROI Cleared");
+    }
 }
 
 void MainWindow::onStopClicked()
 {
-    recognizer->stopProcessing();
+    processing = false;
+    preview->setRecognizer(nullptr);
+    engine->stop();
     statusLabel->setText("Status: Stopped");
     btnStart->setEnabled(true);
     btnStop->setEnabled(false);
@@ -85,6 +124,8 @@ void MainWindow::onStopClicked()
 
 void MainWindow::onRecognizerFinished()
 {
+    processing = false;
+    preview->setRecognizer(nullptr);
     statusLabel->setText("Status: Finished");
     btnStart->setEnabled(true);
     btnStop->setEnabled(false);
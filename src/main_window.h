@@ -1,6 +1,8 @@
 #pragma once
 
-#include "NumberPlateRecognizer.h"
+#include "preview_widget.h"
+#include "stream_engine.h"
+#include <QComboBox>
 #include <QLabel>
 #include <QMainWindow>
 #include <QPushButton>
@@ -11,7 +13,8 @@ class MainWindow : public QMainWindow
     Q_OBJECT
 
 public:
-    MainWindow(const QString &url, QWidget *parent = nullptr);
+    // previewFps - частота кадров просмотра камеры в окне
+    MainWindow(StreamEngine *engine, int previewFps, QWidget *parent = nullptr);
     ~MainWindow();
 
 private slots:
@@ -20,21 +23,25 @@ private slots:
     void onSaveROIClicked();
     void onClearROIClicked();
     void onStopClicked();
+    void onStreamSelected(int index);
     void onRecognizerFinished();
     void onRecognizerError(const QString &error);
 
 private:
     void onROIUpdated(int x, int y, int width, int height);
+    NumberPlateRecognizer *currentRecognizer() const;
 
-    QThread workerThread;
-    NumberPlateRecognizer *recognizer;
+    StreamEngine *engine;
+    int currentStream = -1;
+    bool processing = false;
 
+    QComboBox *streamSelector;
     QPushButton *btnStart;
     QPushButton *btnROI;
     QPushButton *btnSaveROI;
     QPushButton *btnClearROI;
     QPushButton *btnStop;
     QLabel *statusLabel;
-
-    QString m_url;
+    QLabel *throughputLabel;
+    PreviewWidget *preview;
 };
@@ -0,0 +1,280 @@
+#include "metrics_server.h"
+
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTcpSocket>
+#include <QUrl>
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+MetricsServer::MetricsServer(StreamEngine *engine, QObject *parent)
+    : QObject(parent)
+    , engine(engine)
+{
+    connect(&server, &QTcpServer::newConnection, this, &MetricsServer::onNewConnection);
+}
+
+bool MetricsServer::listen(const QString &host, quint16 port)
+{
+    if (!server.listen(QHostAddress(host), port)) {
+        std::cerr << "Metrics server: cannot listen on " << host.toStdString() << ":" << port
+                  << ": " << server.errorString().toStdString() << std::endl;
+        return false;
+    }
+    std::cout << "Metrics: http://" << host.toStdString() << ":" << port << "/metrics"
+              << std::endl;
+    return true;
+}
+
+void MetricsServer::onNewConnection()
+{
+    while (QTcpSocket *socket = server.nextPendingConnection()) {
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+            if (!socket->canReadLine()) {
+                return;
+            }
+            const QList<QByteArray> request = socket->readLine().trimmed().split(' ');
+            const QUrl url(request.size() >= 2 ? QString::fromUtf8(request[1]) : QString());
+            auto reply = [socket](const QByteArray &type, const QByteArray &body) {
+                socket->write("HTTP/1.0 200 OK\r\nContent-Type: " + type + "\r\nContent-Length: "
+                              + QByteArray::number(body.size()) + "\r\n\r\n" + body);
+            };
+            PlateEventStore *events = engine->events();
+            if (url.path() == "/metrics") {
+                reply("text/plain; version=0.0.4", format(engine));
+            } else if (events && url.path() == "/events") {
+                reply("application/json", formatEvents(*events, QUrlQuery(url)));
+            } else if (events && url.path() == "/events/crop") {
+                const QUrlQuery query(url);
+                PlateEventRecord record;
+                bool segmentOk = false;
+                bool offsetOk = false;
+                bool sizeOk = false;
+                record.segment = query.queryItemValue("segment").toUInt(&segmentOk);
+                record.cropOffset = query.queryItemValue("offset").toULongLong(&offsetOk);
+                record.cropSize = query.queryItemValue("size").toUInt(&sizeOk);
+                // Границы проверяет хранилище: читается только записанное в сегмент
+                const QByteArray jpeg = segmentOk && offsetOk && sizeOk ? events->crop(record)
+                                                                        : QByteArray();
+                if (jpeg.isEmpty()) {
+                    socket->write("HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+                } else {
+                    reply("image/jpeg", jpeg);
+                }
+            } else {
+                socket->write("HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+            }
+            socket->disconnectFromHost();
+        });
+    }
+}
+
+QByteArray MetricsServer::format(StreamEngine *engine)
+{
+    std::ostringstream out;
+    out << std::setprecision(10);
+
+    auto histogram = [&](const char *name, const std::string &labels, const LatencyStat &stat) {
+        uint64_t cumulative = 0;
+        for (int b = 0; b < kLatencyBuckets; ++b) {
+            cumulative += stat.buckets[b].load(std::memory_order_relaxed);
+            out << name << "_bucket{" << labels << ",le=\"";
+            if (b < kLatencyBuckets - 1) {
+                out << kLatencyBoundsUs[b] / 1e6;
+            } else {
+                out << "+Inf";
+            }
+            out << "\"} " << cumulative << "\n";
+        }
+        out << name << "_sum{" << labels << "} " << stat.sumUs.load(std::memory_order_relaxed) / 1e6
+            << "\n";
+        out << name << "_count{" << labels << "} " << stat.count.load(std::memory_order_relaxed)
+            << "\n";
+    };
+
+    out << "# HELP lpr_stage_latency_seconds Pipeline stage latency per stream.\n"
+        << "# TYPE lpr_stage_latency_seconds histogram\n";
+    for (int i = 0; i < engine->streamCount(); ++i) {
+        const int id = engine->stream(i)->streamId();
+        engine->stream(i)->stats().forEachStage([&](const char *stage, const LatencyStat &stat) {
+            histogram("lpr_stage_latency_seconds",
+                      "stream=\"" + std::to_string(id) + "\",stage=\"" + stage + "\"", stat);
+        });
+    }
+
+    auto counter = [&](const char *name, const char *help,
+                       std::atomic<uint64_t> StreamStats::*field) {
+        out << "# HELP " << name << " " << help << "\n# TYPE " << name << " counter\n";
+        for (int i = 0; i < engine->streamCount(); ++i) {
+            out << name << "{stream=\"" << engine->stream(i)->streamId() << "\"} "
+                << (engine->stream(i)->stats().*field).load(std::memory_order_relaxed) << "\n";
+        }
+    };
+    counter("lpr_frames_captured_total", "Frames read from the camera.",
+            &StreamStats::framesCaptured);
+    counter("lpr_frames_dropped_total", "Frames dropped before processing.",
+            &StreamStats::framesDropped);
+    counter("lpr_frames_skipped_total", "Processed frames not sent to OCR by the trigger.",
+            &StreamStats::framesSkipped);
+    counter("lpr_ocr_requests_total", "Images sent to OCR.", &StreamStats::framesSubmitted);
+    counter("lpr_ocr_bytes_total", "JPEG bytes sent to the OCR server.",
+            &StreamStats::bytesSubmitted);
+    counter("lpr_ocr_results_total", "OCR results received.", &StreamStats::resultsReceived);
+    counter("lpr_ocr_coalesced_total", "OCR requests replaced by a newer frame.",
+            &StreamStats::requestsCoalesced);
+    counter("lpr_ocr_timed_out_total", "OCR requests past their deadline.",
+            &StreamStats::requestsTimedOut);
+    counter("lpr_ocr_failed_total", "OCR requests failed.", &StreamStats::requestsFailed);
+    counter("lpr_plates_recognized_total", "Non-empty plate readings.",
+            &StreamStats::platesRecognized);
+    counter("lpr_vehicles_total", "Vehicle events after aggregation.",
+            &StreamStats::vehiclesReported);
+    counter("lpr_ocr_cache_lookups_total", "Plate crops looked up in the result cache.",
+            &StreamStats::cacheLookups);
+    counter("lpr_ocr_cache_hits_total", "Plate crops answered from the result cache.",
+            &StreamStats::cacheHits);
+    counter("lpr_watchlist_hits_total", "Readings matched to a watchlist plate, once per vehicle.",
+            &StreamStats::watchlistHits);
+    counter("lpr_buffer_pool_misses_total", "Frames and JPEGs allocated outside the buffer pool.",
+            &StreamStats::bufferPoolMisses);
+
+    // Регулятор задержки: текущая ступень и ее ручки по камерам
+    const LatencyController *control = engine->latencyControl();
+    if (control->isEnabled()) {
+        auto qualityGauge = [&](const char *name, const char *help, auto value) {
+            out << "# HELP " << name << " " << help << "\n# TYPE " << name << " gauge\n";
+            for (int i = 0; i < engine->streamCount(); ++i) {
+                out << name << "{stream=\"" << engine->stream(i)->streamId() << "\"} "
+                    << value(engine->stream(i)->quality()) << "\n";
+            }
+        };
+        qualityGauge("lpr_control_level", "Quality level, 0 is the most expensive.",
+                     [](const StreamQuality &q) { return q.level.load(); });
+        qualityGauge("lpr_control_jpeg_quality", "JPEG quality of images sent to OCR.",
+                     [](const StreamQuality &q) { return q.current().jpegQuality; });
+        qualityGauge("lpr_control_interval_scale", "Multiplier of the OCR submit interval.",
+                     [](const StreamQuality &q) { return q.current().intervalScale; });
+        qualityGauge("lpr_control_image_scale", "Scale of images sent to OCR.",
+                     [](const StreamQuality &q) { return q.current().imageScale; });
+        qualityGauge("lpr_control_latency_seconds",
+                     "End-to-end latency quantile the last decision was based on.",
+                     [](const StreamQuality &q) { return q.quantileUs.load() / 1e6; });
+        out << "# HELP lpr_control_adjustments_total Quality level changes.\n"
+            << "# TYPE lpr_control_adjustments_total counter\n";
+        for (int i = 0; i < engine->streamCount(); ++i) {
+            const StreamQuality &quality = engine->stream(i)->quality();
+            const std::string id = std::to_string(engine->stream(i)->streamId());
+            out << "lpr_control_adjustments_total{stream=\"" << id << "\",direction=\"down\"} "
+                << quality.degrades.load() << "\n"
+                << "lpr_control_adjustments_total{stream=\"" << id << "\",direction=\"up\"} "
+                << quality.upgrades.load() << "\n";
+        }
+        out << "# HELP lpr_process_cpu_ratio Share of all cores used by the process.\n"
+            << "# TYPE lpr_process_cpu_ratio gauge\nlpr_process_cpu_ratio " << control->cpuLoad()
+            << "\n";
+    }
+
+    // Серверы OCR пула
+    const AsyncOCRClient *ocr = engine->ocr();
+    auto backendLabel = [&](int i) { return "backend=\"" + ocr->backendStats(i).url + "\""; };
+    out << "# HELP lpr_ocr_backend_latency_seconds OCR server request latency.\n"
+        << "# TYPE lpr_ocr_backend_latency_seconds histogram\n";
+    for (int i = 0; i < ocr->backendCount(); ++i) {
+        histogram("lpr_ocr_backend_latency_seconds", backendLabel(i),
+                  ocr->backendStats(i).latency);
+    }
+    auto backendGauge = [&](const char *name, const char *help, auto value) {
+        out << "# HELP " << name << " " << help << "\n# TYPE " << name << " gauge\n";
+        for (int i = 0; i < ocr->backendCount(); ++i) {
+            out << name << "{" << backendLabel(i) << "} " << value(ocr->backendStats(i)) << "\n";
+        }
+    };
+    backendGauge("lpr_ocr_backend_up", "OCR server is in the pool.",
+                 [](const OcrBackendStats &b) { return b.healthy.load() ? 1 : 0; });
+    backendGauge("lpr_ocr_backend_outstanding", "OCR server requests awaiting reply.",
+                 [](const OcrBackendStats &b) { return b.outstanding.load(); });
+    auto backendCounter = [&](const char *name, const char *help,
+                              std::atomic<uint64_t> OcrBackendStats::*field) {
+        out << "# HELP " << name << " " << help << "\n# TYPE " << name << " counter\n";
+        for (int i = 0; i < ocr->backendCount(); ++i) {
+            out << name << "{" << backendLabel(i) << "} "
+                << (ocr->backendStats(i).*field).load(std::memory_order_relaxed) << "\n";
+        }
+    };
+    backendCounter("lpr_ocr_backend_requests_total", "HTTP requests sent to the OCR server.",
+                   &OcrBackendStats::requests);
+    backendCounter("lpr_ocr_backend_failures_total", "OCR server errors.",
+                   &OcrBackendStats::failures);
+    backendCounter("lpr_ocr_backend_timeouts_total", "OCR server requests past deadline.",
+                   &OcrBackendStats::timeouts);
+    backendCounter("lpr_ocr_backend_hedges_total", "Duplicate requests sent to the OCR server.",
+                   &OcrBackendStats::hedges);
+    backendCounter("lpr_ocr_backend_ejections_total", "Times the OCR server left the pool.",
+                   &OcrBackendStats::ejections);
+
+    out << "# HELP lpr_ocr_encode_pool_misses_total JPEGs encoded outside the buffer pool.\n"
+        << "# TYPE lpr_ocr_encode_pool_misses_total counter\n"
+        << "lpr_ocr_encode_pool_misses_total " << ocr->encodePoolMisses() << "\n";
+
+    if (const PlateWatchlist *watchlist = engine->plateWatchlist()) {
+        out << "# HELP lpr_watchlist_plates Plates in the loaded watchlists.\n"
+            << "# TYPE lpr_watchlist_plates gauge\n"
+            << "lpr_watchlist_plates " << watchlist->size() << "\n";
+    }
+
+    if (const PlateEventStore *events = engine->events()) {
+        out << "# HELP lpr_events_written_total Vehicle events written to the event store.\n"
+            << "# TYPE lpr_events_written_total counter\n"
+            << "lpr_events_written_total " << events->storedEvents() << "\n"
+            << "# HELP lpr_events_dropped_total Vehicle events dropped on a full store queue.\n"
+            << "# TYPE lpr_events_dropped_total counter\n"
+            << "lpr_events_dropped_total " << events->droppedEvents() << "\n";
+    }
+
+    return QByteArray::fromStdString(out.str());
+}
+
+QByteArray MetricsServer::formatEvents(const PlateEventStore &store, const QUrlQuery &query)
+{
+    PlateQuery find;
+    find.plate = query.queryItemValue("plate", QUrl::FullyDecoded);
+    const QString match = query.queryItemValue("match");
+    find.match = match == "prefix"     ? PlateMatch::Prefix
+                 : match == "contains" ? PlateMatch::Contains
+                                       : PlateMatch::Exact;
+    const int days = query.hasQueryItem("days") ? query.queryItemValue("days").toInt() : 30;
+    if (days > 0) {
+        find.fromMs = QDateTime::currentMSecsSinceEpoch() - static_cast<qint64>(days) * 86400000;
+    }
+    if (query.hasQueryItem("camera")) {
+        find.streamId = query.queryItemValue("camera").toInt();
+    }
+    const int limit = query.queryItemValue("limit").toInt();
+    find.limit = limit > 0 ? static_cast<size_t>(limit) : 100;
+
+    QJsonArray array;
+    for (const PlateEventRecord &record : store.find(find)) {
+        QJsonObject event;
+        event["plate"] = QString::fromStdString(record.plateText());
+        event["camera"] = record.streamId;
+        event["lane"] = record.lane;
+        event["time"] = QDateTime::fromMSecsSinceEpoch(record.seenMs).toString(Qt::ISODateWithMs);
+        event["first_seen"] =
+            QDateTime::fromMSecsSinceEpoch(record.firstSeenMs).toString(Qt::ISODateWithMs);
+        event["confidence"] = record.confidence;
+        event["observations"] = record.observations;
+        if (record.cropSize > 0) {
+            event["crop"] = QString("/events/crop?segment=%1&offset=%2&size=%3")
+                                .arg(record.segment)
+                                .arg(record.cropOffset)
+                                .arg(record.cropSize);
+        }
+        array.append(event);
+    }
+    return QJsonDocument(array).toJson(QJsonDocument::Compact);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QByteArray>
+#include <QObject>
+#include <QTcpServer>
+#include <QUrlQuery>
+
+#include "stream_engine.h"
+
+// Метрики конвейера для Prometheus: GET /metrics в текстовом формате.
+// Гистограммы этапов (lpr_stage_latency_seconds) и счетчики кадров и
+// запросов по камерам читаются прямо из StreamStats, без блокировок.
+// С хранилищем событий (--events-dir) там же поиск по номерам:
+//   GET /events?plate=A123BC77&match=exact|prefix|contains&days=30&camera=0&limit=100
+//   GET /events/crop?segment=N&offset=N&size=N - JPEG вырезки из ответа /events
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MetricsServer(StreamEngine *engine, QObject *parent = nullptr);
+
+    // host - адрес интерфейса: 127.0.0.1 - только локально, 0.0.0.0 - все
+    bool listen(const QString &host, quint16 port);
+
+    static QByteArray format(StreamEngine *engine);
+    static QByteArray formatEvents(const PlateEventStore &store, const QUrlQuery &query);
+
+private slots:
+    void onNewConnection();
+
+private:
+    StreamEngine *engine;
+    QTcpServer server;
+};
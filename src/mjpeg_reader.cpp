@@ -0,0 +1,298 @@
+#include "mjpeg_reader.h"
+
+#include <QTcpSocket>
+#include <QUrl>
+
+#include <strings.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+const int kConnectTimeoutMs = 5000;
+const int kReadTimeoutMs = 10000;
+const int kPollMs = 200;                  // шаг ожидания, чтобы вовремя заметить stopFlag
+const int kMaxHeaderBytes = 64 * 1024;
+const int kMaxFrameBytes = 16 * 1024 * 1024; // часть больше - поток не тот, за который себя выдает
+
+// Content-Length из первых end байт data; разбирается на месте, без копий строк
+int contentLength(const QByteArray &data, int end)
+{
+    static const char kName[] = "content-length:";
+    const int nameLength = sizeof(kName) - 1;
+    const char *text = data.constData();
+    for (int pos = 0; pos < end;) {
+        while (pos < end && (text[pos] == ' ' || text[pos] == '\t')) {
+            ++pos;
+        }
+        if (end - pos > nameLength && strncasecmp(text + pos, kName, nameLength) == 0) {
+            char *stop = nullptr;
+            const long length = std::strtol(text + pos + nameLength, &stop, 10);
+            return stop != text + pos + nameLength && length >= 0 ? static_cast<int>(length) : -1;
+        }
+        const char *newline =
+            static_cast<const char *>(std::memchr(text + pos, '\n', end - pos));
+        if (!newline) {
+            break;
+        }
+        pos = static_cast<int>(newline - text) + 1;
+    }
+    return -1;
+}
+} // namespace
+
+MjpegReader::MjpegReader(const std::atomic<bool> &stopFlag)
+    : stopFlag(stopFlag)
+{
+}
+
+MjpegReader::~MjpegReader()
+{
+    close();
+}
+
+bool MjpegReader::open(const std::string &url)
+{
+    close();
+
+    QUrl parsed(QString::fromStdString(url));
+    if (parsed.scheme() != "http" || parsed.host().isEmpty()) {
+        return false;
+    }
+
+    socket = std::make_unique<QTcpSocket>();
+    socket->connectToHost(parsed.host(), parsed.port(80));
+    if (!socket->waitForConnected(kConnectTimeoutMs)) {
+        close();
+        return false;
+    }
+
+    QString path = parsed.path().isEmpty() ? QString("/") : parsed.path();
+    if (!parsed.query().isEmpty()) {
+        path += "?" + parsed.query();
+    }
+    QByteArray request = "GET " + path.toUtf8() + " HTTP/1.0\r\nHost: " + parsed.host().toUtf8()
+                         + "\r\nUser-Agent: lpr\r\n";
+    if (!parsed.userInfo().isEmpty()) {
+        request += "Authorization: Basic " + parsed.userInfo().toUtf8().toBase64() + "\r\n";
+    }
+    request += "\r\n";
+    socket->write(request);
+    socket->waitForBytesWritten(kConnectTimeoutMs);
+
+    QByteArray headers;
+    if (!readHeaders(headers)) {
+        close();
+        return false;
+    }
+
+    // Только 200 с multipart; все остальное (RTSP-шлюзы, одиночный JPEG,
+    // редиректы) отдаем cv::VideoCapture
+    const QByteArray statusLine = headers.left(headers.indexOf("\r\n"));
+    const QList<QByteArray> status = statusLine.split(' ');
+    if (status.size() < 2 || status[1] != "200"
+        || !headers.toLower().contains("multipart/x-mixed-replace")) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MjpegReader::close()
+{
+    if (socket) {
+        socket->abort();
+        socket.reset();
+    }
+    buffer.clear();
+}
+
+// Дочитывает из сокета прямо в конец буфера; ждет небольшими шагами,
+// проверяя stopFlag. Емкость буфера сохраняется между кадрами
+bool MjpegReader::fill()
+{
+    int waitedMs = 0;
+    while (!stopFlag) {
+        if (socket->bytesAvailable() > 0 || socket->waitForReadyRead(kPollMs)) {
+            const int size = buffer.size();
+            const qint64 available = socket->bytesAvailable();
+            buffer.resize(size + static_cast<int>(available));
+            const qint64 got = socket->read(buffer.data() + size, available);
+            buffer.resize(size + static_cast<int>(std::max<qint64>(0, got)));
+            return true;
+        }
+        if (socket->state() != QAbstractSocket::ConnectedState) {
+            return false;
+        }
+        waitedMs += kPollMs;
+        if (waitedMs >= kReadTimeoutMs) {
+            return false;
+        }
+    }
+    return false;
+}
+
+// Ждет конца заголовков (пустой строки); end - их длина в начале буфера
+bool MjpegReader::waitHeaders(int &end)
+{
+    while ((end = buffer.indexOf("\r\n\r\n")) < 0) {
+        if (buffer.size() > kMaxHeaderBytes || !fill()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Заголовки ответа до пустой строки; из буфера они удаляются
+bool MjpegReader::readHeaders(QByteArray &headers)
+{
+    int end;
+    if (!waitHeaders(end)) {
+        return false;
+    }
+    headers = buffer.left(end);
+    buffer.remove(0, end + 4);
+    return true;
+}
+
+bool MjpegReader::read(QByteArray &jpeg)
+{
+    if (!socket) {
+        return false;
+    }
+
+    for (;;) {
+        // Перевод строки после прошлой части перед разделителем
+        for (;;) {
+            int skip = 0;
+            while (skip < buffer.size() && (buffer[skip] == '\r' || buffer[skip] == '\n')) {
+                ++skip;
+            }
+            buffer.remove(0, skip);
+            if (!buffer.isEmpty()) {
+                break;
+            }
+            if (!fill()) {
+                return false;
+            }
+        }
+
+        // Разделитель и заголовки части; сам разделитель не сверяем - камеры
+        // и mjpeg_streamer.py пишут его по-разному
+        int headersEnd;
+        if (!waitHeaders(headersEnd)) {
+            return false;
+        }
+        const int length = contentLength(buffer, headersEnd);
+        buffer.remove(0, headersEnd + 4);
+
+        if (length > kMaxFrameBytes) {
+            return false;
+        }
+        if (length >= 0) {
+            while (buffer.size() < length) {
+                if (!fill()) {
+                    return false;
+                }
+            }
+            jpeg.resize(length);
+            std::memcpy(jpeg.data(), buffer.constData(), length);
+            buffer.remove(0, length);
+        } else {
+            // Без Content-Length кадр кончается маркером EOI. Внутри сжатых
+            // данных он встретиться не может (0xFF там экранируется)
+            int end;
+            int from = 0;
+            while ((end = buffer.indexOf("\xFF\xD9", from)) < 0) {
+                if (buffer.size() > kMaxFrameBytes) {
+                    return false;
+                }
+                from = std::max(0, buffer.size() - 1);
+                if (!fill()) {
+                    return false;
+                }
+            }
+            jpeg.resize(end + 2);
+            std::memcpy(jpeg.data(), buffer.constData(), end + 2);
+            buffer.remove(0, end + 2);
+        }
+
+        // Части не с JPEG (текстовые метаданные некоторых камер) пропускаем
+        if (jpeg.startsWith("\xFF\xD8")) {
+            return true;
+        }
+    }
+}
+
+bool MjpegReader::jpegSize(const QByteArray &jpeg, cv::Size &size)
+{
+    const auto *data = reinterpret_cast<const uchar *>(jpeg.constData());
+    const int n = jpeg.size();
+    if (n < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+        return false;
+    }
+
+    int pos = 2;
+    while (pos + 4 <= n) {
+        if (data[pos] != 0xFF) {
+            return false;
+        }
+        const uchar marker = data[pos + 1];
+        if (marker == 0xFF) { // заполнитель
+            ++pos;
+            continue;
+        }
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8)) { // маркеры без длины
+            pos += 2;
+            continue;
+        }
+        if (marker == 0xD9 || marker == 0xDA) { // дошли до данных, а SOF не было
+            return false;
+        }
+
+        // SOF0..SOF15, кроме DHT (C4), JPG (C8) и DAC (CC): высота и ширина
+        const bool sof = marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8
+                         && marker != 0xCC;
+        if (sof) {
+            if (pos + 9 > n) {
+                return false;
+            }
+            size.height = (data[pos + 5] << 8) | data[pos + 6];
+            size.width = (data[pos + 7] << 8) | data[pos + 8];
+            return size.width > 0 && size.height > 0;
+        }
+        pos += 2 + ((data[pos + 2] << 8) | data[pos + 3]);
+    }
+    return false;
+}
+
+bool MjpegReader::decode(const QByteArray &jpeg, int flags, cv::Mat &into)
+{
+    if (jpeg.isEmpty()) {
+        return false;
+    }
+    try {
+        cv::Mat raw(1, jpeg.size(), CV_8UC1, const_cast<char *>(jpeg.constData()));
+        cv::imdecode(raw, flags, &into);
+        return !into.empty();
+    } catch (const cv::Exception &e) {
+        std::cerr << "JPEG decode failed: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+cv::Mat MjpegReader::decode(const QByteArray &jpeg, int flags)
+{
+    if (jpeg.isEmpty()) {
+        return cv::Mat();
+    }
+    try {
+        cv::Mat raw(1, jpeg.size(), CV_8UC1, const_cast<char *>(jpeg.constData()));
+        return cv::imdecode(raw, flags);
+    } catch (const cv::Exception &e) {
+        std::cerr << "JPEG decode failed: " << e.what() << std::endl;
+        return cv::Mat();
+    }
+}
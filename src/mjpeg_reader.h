@@ -0,0 +1,51 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <QByteArray>
+#include <QString>
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+class QTcpSocket;
+
+// Чтение HTTP-потока multipart/x-mixed-replace (MJPEG камеры, mjpeg_streamer.py)
+// без cv::VideoCapture: кадры выдаются сжатыми байтами JPEG как есть, а
+// декодирует их уже обработка - только те, что ей нужны, и только в нужном
+// размере. Работает блокирующе в потоке захвата, ожидание прерывается stopFlag.
+class MjpegReader
+{
+public:
+    explicit MjpegReader(const std::atomic<bool> &stopFlag);
+    ~MjpegReader();
+
+    // false - не http://, не ответил или отдает не multipart (тогда поток
+    // читается через cv::VideoCapture)
+    bool open(const std::string &url);
+
+    // Очередная часть потока; false - соединение закрыто, ошибка или остановка.
+    // Байты пишутся в jpeg на месте: буфер из пула с нужной емкостью не перевыделяется
+    bool read(QByteArray &jpeg);
+
+    void close();
+
+    // Размер кадра из заголовка JPEG (маркер SOF) без декодирования
+    static bool jpegSize(const QByteArray &jpeg, cv::Size &size);
+
+    // Декодирование байтов JPEG; flags - cv::IMREAD_*, в том числе REDUCED_*
+    static cv::Mat decode(const QByteArray &jpeg, int flags = cv::IMREAD_COLOR);
+
+    // То же в готовый кадр: кадр того же размера и типа не перевыделяется
+    static bool decode(const QByteArray &jpeg, int flags, cv::Mat &into);
+
+private:
+    bool fill();
+    bool waitHeaders(int &end);
+    bool readHeaders(QByteArray &headers);
+
+    const std::atomic<bool> &stopFlag;
+    std::unique_ptr<QTcpSocket> socket;
+    QByteArray buffer;
+};
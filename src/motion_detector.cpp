@@ -0,0 +1,44 @@
+#include "motion_detector.h"
+
+#include <algorithm>
+
+MotionDetector::MotionDetector(const MotionConfig &config)
+    : config(config)
+{
+}
+
+void MotionDetector::reset()
+{
+    background.release();
+}
+
+double MotionDetector::update(const cv::Mat &roi)
+{
+    if (roi.empty()) {
+        return 0.0;
+    }
+
+    // Сначала уменьшаем, потом переводим в серый - так дешевле
+    const int width = std::max(1, std::min(config.width, roi.cols));
+    const int height = std::max(1, cvRound(roi.rows * double(width) / roi.cols));
+    cv::resize(roi, small, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+    if (small.channels() == 3) {
+        cv::cvtColor(small, gray, cv::COLOR_BGR2GRAY);
+    } else {
+        small.copyTo(gray);
+    }
+
+    // ROI поменялся или первый кадр - начинаем фон заново
+    if (background.size() != gray.size()) {
+        gray.copyTo(background);
+        return 0.0;
+    }
+
+    cv::absdiff(gray, background, diff);
+    cv::threshold(diff, diff, config.pixelThreshold, 255, cv::THRESH_BINARY);
+    const double activity = double(cv::countNonZero(diff)) / diff.total();
+
+    cv::addWeighted(gray, config.learningRate, background, 1.0 - config.learningRate, 0.0,
+                    background);
+    return activity;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+struct MotionConfig
+{
+    int width = 160;              // ширина уменьшенной серой копии ROI
+    int pixelThreshold = 25;      // разница яркости, считающаяся изменением
+    double activeFraction = 0.01; // доля изменившихся пикселей для срабатывания
+    double learningRate = 0.05;   // скорость обновления фона
+};
+
+// Дешевый детектор активности внутри ROI: разность с медленно обновляемым
+// фоном на маленькой серой копии. Все операции 8-битные и идут через
+// векторизованные функции OpenCV, буферы переиспользуются между кадрами.
+class MotionDetector
+{
+public:
+    explicit MotionDetector(const MotionConfig &config = MotionConfig());
+
+    // Доля изменившихся пикселей 0..1; первый кадр только задает фон
+    double update(const cv::Mat &roi);
+    bool isActive(double activity) const { return activity >= config.activeFraction; }
+    void reset();
+
+private:
+    MotionConfig config;
+
+    cv::Mat small;
+    cv::Mat gray;
+    cv::Mat background;
+    cv::Mat diff;
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Пул копий объекта, который нельзя делить между потоками (каскад Хаара,
+// сеть cv::dnn с рабочими буферами): поток берет копию на время вызова и
+// возвращает ее. Свободных нет - create() делает еще одну, поэтому пул
+// растет до числа одновременных пользователей и дальше не меняется.
+template <typename T>
+class ObjectPool
+{
+public:
+    // create() -> std::unique_ptr<T>, вызывается без блокировки пула
+    template <typename Create>
+    std::unique_ptr<T> acquire(Create &&create)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!idle.empty()) {
+                std::unique_ptr<T> object = std::move(idle.back());
+                idle.pop_back();
+                return object;
+            }
+        }
+        return create();
+    }
+
+    void release(std::unique_ptr<T> object)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.push_back(std::move(object));
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<std::unique_ptr<T>> idle;
+};
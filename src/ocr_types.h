@@ -0,0 +1,76 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+#include <QByteArray>
+#include <QMetaType>
+#include <QString>
+
+#include <chrono>
+#include <cstdint>
+
+enum class OcrRequestKind
+{
+    FullFrame, // весь ROI, номер ищет сервер
+    PlateCrop  // вырезанный локальным детектором номер
+};
+
+// Что именно отправлено на распознавание
+struct OcrRequest
+{
+    int streamId = -1;
+    uint64_t frameId = 0;
+    OcrRequestKind kind = OcrRequestKind::FullFrame;
+    cv::Rect box;       // область в координатах кадра
+    int lane = 0;       // полоса (LaneRoi), в которой найдена область
+    bool audit = false; // контрольный запрос для оценки полноты детектора
+    cv::Mat crop;       // вырезка номера для сборки по машинам (ссылка, без копии)
+    uint64_t cropHash = 0; // перцептивный хеш вырезки для кэша ответов; 0 - не считался
+    int jpegQuality = 70;  // если изображение сжимается перед отправкой
+    std::chrono::steady_clock::time_point captureTime; // от него считаются срок и задержка
+    std::chrono::steady_clock::time_point sentTime;    // ушел в сеть (ставит клиент)
+};
+
+// Изображение в очереди клиента: уже сжатое (jpeg) или несжатое (image) для
+// локального канала, который кладет его в общую память как есть
+struct OcrImage
+{
+    OcrRequest request;
+    QByteArray jpeg;
+    cv::Mat image;
+};
+
+enum class OcrStatus
+{
+    Ok,        // сервер ответил (номер может быть пустым)
+    Failed,    // ошибка сети или сервера
+    TimedOut,  // не уложились в срок, запрос отменен
+    Coalesced  // не отправлялся: вытеснен более свежим кадром той же камеры
+};
+
+struct OcrResult
+{
+    OcrRequest request;
+    OcrStatus status = OcrStatus::Ok;
+    QString plate;
+    double confidence = 0.0;
+    std::chrono::steady_clock::time_point completedTime;
+    std::chrono::steady_clock::duration serverTime{0}; // распознавание на сервере, если он сообщил
+
+    // Задержка от захвата кадра до ответа
+    std::chrono::steady_clock::duration latency() const
+    {
+        return completedTime - request.captureTime;
+    }
+
+    // Запрос в сети от отправки до ответа; 0, если запрос не отправлялся
+    std::chrono::steady_clock::duration networkTime() const
+    {
+        if (request.sentTime == std::chrono::steady_clock::time_point()) {
+            return std::chrono::steady_clock::duration(0);
+        }
+        return completedTime - request.sentTime;
+    }
+};
+
+Q_DECLARE_METATYPE(OcrResult)
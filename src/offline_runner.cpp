@@ -0,0 +1,379 @@
+#include "offline_runner.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <climits>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+// Кусок не короче: переход на ключевой кадр в начале куска стоит до одной GOP
+static const int kMinChunkFrames = 100;
+
+OfflineRunner::OfflineRunner(const EngineConfig &config, QObject *parent)
+    : QObject(parent)
+    , config(config)
+    , input(config.streams.front())
+{
+    std::string cascadePath = "haarcascade_russian_plate_number.xml";
+    plateDetector.load(cascadePath, config.detector);
+    if (config.detectorBackend == DetectorBackend::Yolo) {
+        useYolo = yoloDetector.load(config.yolo);
+        if (!useYolo) {
+            std::cerr << "YOLO plate detector disabled, using Haar cascade" << std::endl;
+        }
+    }
+    const bool detectorReady = useYolo || plateDetector.isLoaded();
+    useGate = detectorReady && input.gateMode != GateMode::Off;
+
+    if (config.ocrBackend == OcrBackend::Native) {
+        if (!detectorReady) {
+            std::cerr << "Native OCR needs the plate detector, using OCR server" << std::endl;
+        } else if (ocrEngine.load(config.nativeOcr)) {
+            useNative = true;
+            useGate = true;
+        } else {
+            std::cerr << "Native OCR disabled, using OCR server" << std::endl;
+        }
+    }
+
+    // Каждый кадр должен дождаться ответа: сроки для архива не нужны
+    if (!useNative) {
+        OcrClientConfig ocrConfig = config.ocr;
+        ocrConfig.timeoutMs = std::max(ocrConfig.timeoutMs, 60000);
+        ocrClient = new AsyncOCRClient(ocrConfig);
+        ocrClient->moveToThread(&networkThread);
+        connect(&networkThread, &QThread::finished, ocrClient, &QObject::deleteLater);
+        connect(ocrClient, &AsyncOCRClient::plateRecognized, this, &OfflineRunner::onOcrResult);
+        networkThread.start();
+    }
+
+    int threads = config.workerThreads > 0 ? config.workerThreads : QThread::idealThreadCount();
+    pool.setMaxThreadCount(std::max(1, threads));
+}
+
+OfflineRunner::~OfflineRunner()
+{
+    pool.waitForDone();
+    networkThread.quit();
+    networkThread.wait();
+}
+
+bool OfflineRunner::openInput()
+{
+    const QString path = input.url;
+    if (QFileInfo(path).isDir()) {
+        // Имена frame_000000.jpg из video2frames.py сортируются по порядку кадров
+        cv::glob((path + "/*.jpg").toStdString(), frameFiles, false);
+        std::vector<cv::String> png;
+        cv::glob((path + "/*.png").toStdString(), png, false);
+        frameFiles.insert(frameFiles.end(), png.begin(), png.end());
+        std::sort(frameFiles.begin(), frameFiles.end());
+        totalFrames = static_cast<int>(frameFiles.size());
+        sourceFps = config.offlineFps;
+        return totalFrames > 0;
+    }
+
+    cv::VideoCapture probe(path.toStdString());
+    if (!probe.isOpened()) {
+        return false;
+    }
+    totalFrames = std::max(0, static_cast<int>(probe.get(cv::CAP_PROP_FRAME_COUNT)));
+    sourceFps = probe.get(cv::CAP_PROP_FPS);
+    return true;
+}
+
+bool OfflineRunner::start()
+{
+    if (!openInput()) {
+        std::cerr << "Error opening offline input: " << input.url.toStdString() << std::endl;
+        return false;
+    }
+
+    // Кусков в несколько раз больше потоков, чтобы потоки не простаивали в конце
+    const int threads = pool.maxThreadCount();
+    if (totalFrames > 0) {
+        const int chunkFrames = std::max(kMinChunkFrames, totalFrames / (threads * 4));
+        for (int begin = 0; begin < totalFrames; begin += chunkFrames) {
+            chunks.push_back({begin, std::min(totalFrames, begin + chunkFrames)});
+        }
+        // Число кадров в заголовке видео бывает неточным
+        if (frameFiles.empty()) {
+            chunks.back().end = INT_MAX;
+        }
+    } else {
+        chunks.push_back({0, INT_MAX});
+    }
+
+    std::cout << "Offline: " << input.url.toStdString() << ", "
+              << (totalFrames > 0 ? std::to_string(totalFrames) : std::string("unknown"))
+              << " frames, " << chunks.size() << " chunks, " << threads << " threads, "
+              << (useGate ? "plate detector" : "full frames") << ", "
+              << (useNative ? "native OCR" : "OCR server") << std::endl;
+
+    // Параллельность уже по кускам, внутренние потоки OpenCV только мешают
+    if (threads > 1) {
+        cv::setNumThreads(1);
+    }
+
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        ocrSlots.emplace_back(new QSemaphore(std::max(1, config.ocr.maxInFlightPerStream)));
+    }
+    chunksLeft = static_cast<int>(chunks.size());
+    startTime = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        const int chunkIndex = static_cast<int>(i);
+        QtConcurrent::run(&pool, [this, chunkIndex]() { processChunk(chunkIndex); });
+    }
+    return true;
+}
+
+void OfflineRunner::processChunk(int chunkIndex)
+{
+    const Chunk &chunk = chunks[chunkIndex];
+    PlateDeskew deskew;
+
+    cv::VideoCapture cap;
+    if (frameFiles.empty()) {
+        cap.open(input.url.toStdString());
+        if (chunk.begin > 0) {
+            cap.set(cv::CAP_PROP_POS_FRAMES, chunk.begin);
+        }
+    }
+
+    for (int frameIndex = chunk.begin; frameIndex < chunk.end; ++frameIndex) {
+        auto start = std::chrono::steady_clock::now();
+        cv::Mat frame;
+        double timeMs = 0.0;
+        if (!frameFiles.empty()) {
+            frame = cv::imread(frameFiles[frameIndex]);
+            timeMs = sourceFps > 0.0 ? frameIndex * 1000.0 / sourceFps : 0.0;
+        } else if (cap.isOpened() && cap.read(frame)) {
+            timeMs = cap.get(cv::CAP_PROP_POS_MSEC);
+            if (timeMs <= 0.0 && sourceFps > 0.0) {
+                timeMs = frameIndex * 1000.0 / sourceFps;
+            }
+        } else {
+            break;
+        }
+        stats.decodeTime.record(std::chrono::steady_clock::now() - start);
+
+        if (!frame.empty()) {
+            processFrame(chunkIndex, frameIndex, timeMs, frame, deskew);
+            stats.frames.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (--chunksLeft == 0) {
+        QMetaObject::invokeMethod(this, [this]() { maybeFinish(); }, Qt::QueuedConnection);
+    }
+}
+
+void OfflineRunner::processFrame(int chunkIndex, int frameIndex, double timeMs,
+                                 const cv::Mat &frame, PlateDeskew &deskew)
+{
+    cv::Rect roi = input.roi & cv::Rect(0, 0, frame.cols, frame.rows);
+    if (roi.empty()) {
+        roi = cv::Rect(0, 0, frame.cols, frame.rows);
+    }
+    const cv::Mat area = frame(roi);
+
+    if (!useGate) {
+        submitRemote(chunkIndex, frameIndex, timeMs, area, OcrRequestKind::FullFrame, roi);
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<cv::Rect> plates = useYolo ? yoloDetector.detect(area) : plateDetector.detect(area);
+    stats.detectTime.record(std::chrono::steady_clock::now() - start);
+    if (plates.empty()) {
+        return;
+    }
+    stats.crops.fetch_add(plates.size(), std::memory_order_relaxed);
+
+    const double padding = plateDetector.detectorConfig().padding;
+    std::vector<cv::Mat> crops;
+    std::vector<cv::Rect> boxes;
+    for (const cv::Rect &plate : plates) {
+        cv::Rect padded = PlateDetector::padRect(plate, padding, area.size());
+        crops.push_back(area(padded));
+        boxes.push_back(padded + roi.tl());
+    }
+
+    if (input.deskew) {
+        start = std::chrono::steady_clock::now();
+        for (cv::Mat &crop : crops) {
+            cv::Mat corrected;
+            deskew.apply(crop, corrected);
+            crop = corrected;
+        }
+        stats.deskewTime.record(std::chrono::steady_clock::now() - start);
+    }
+
+    if (!useNative) {
+        for (size_t i = 0; i < crops.size(); ++i) {
+            submitRemote(chunkIndex, frameIndex, timeMs, crops[i], OcrRequestKind::PlateCrop,
+                         boxes[i]);
+        }
+        return;
+    }
+
+    start = std::chrono::steady_clock::now();
+    std::vector<PlateText> texts = ocrEngine.recognize(crops);
+    stats.ocrTime.record(std::chrono::steady_clock::now() - start);
+    stats.ocrRequests.fetch_add(crops.size(), std::memory_order_relaxed);
+    for (size_t i = 0; i < texts.size(); ++i) {
+        addDetection(frameIndex, timeMs, QString::fromStdString(texts[i].text),
+                     texts[i].confidence, boxes[i]);
+    }
+}
+
+// Поток куска ждет места в своем окне, поэтому клиент никогда не вытесняет кадры
+void OfflineRunner::submitRemote(int chunkIndex, int frameIndex, double timeMs,
+                                 const cv::Mat &image, OcrRequestKind kind, const cv::Rect &box)
+{
+    ocrSlots[chunkIndex]->acquire();
+    {
+        std::lock_guard<std::mutex> lock(resultsMutex);
+        FrameTime &frame = frameTimes[static_cast<uint64_t>(frameIndex)];
+        frame.timeMs = timeMs;
+        frame.pending++;
+    }
+    outstanding++;
+    stats.ocrRequests.fetch_add(1, std::memory_order_relaxed);
+
+    OcrRequest request;
+    request.streamId = chunkIndex;
+    request.frameId = static_cast<uint64_t>(frameIndex);
+    request.kind = kind;
+    request.box = box;
+    request.captureTime = std::chrono::steady_clock::now();
+    ocrClient->submitFrameForRecognition(request, image);
+}
+
+void OfflineRunner::addDetection(int frameIndex, double timeMs, const QString &plate,
+                                 double confidence, const cv::Rect &box)
+{
+    if (plate.isEmpty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(resultsMutex);
+    detections.push_back({frameIndex, timeMs, plate, confidence, box});
+}
+
+void OfflineRunner::onOcrResult(const OcrResult &result)
+{
+    const int chunkIndex = result.request.streamId;
+    stats.ocrTime.record(result.latency());
+
+    // Ответ на последний запрос кадра - время кадра больше не нужно
+    double timeMs = 0.0;
+    {
+        std::lock_guard<std::mutex> lock(resultsMutex);
+        const auto it = frameTimes.find(result.request.frameId);
+        if (it != frameTimes.end()) {
+            timeMs = it->second.timeMs;
+            if (--it->second.pending == 0) {
+                frameTimes.erase(it);
+            }
+        }
+    }
+
+    if (result.status != OcrStatus::Ok) {
+        stats.ocrFailed.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        addDetection(static_cast<int>(result.request.frameId), timeMs, result.plate,
+                     result.confidence, result.request.box);
+    }
+
+    outstanding--;
+    ocrSlots[chunkIndex]->release();
+    maybeFinish();
+}
+
+void OfflineRunner::maybeFinish()
+{
+    if (done || chunksLeft > 0 || outstanding > 0) {
+        return;
+    }
+    done = true;
+
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    writeResults();
+    report(seconds);
+    emit finished();
+}
+
+// CSV по порядку кадров, внутри кадра - слева направо
+bool OfflineRunner::writeResults()
+{
+    std::sort(detections.begin(), detections.end(), [](const Detection &a, const Detection &b) {
+        return a.frame != b.frame ? a.frame < b.frame : a.box.x < b.box.x;
+    });
+
+    QFile file(config.offlineOutput);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        std::cerr << "Cannot write results: " << config.offlineOutput.toStdString() << std::endl;
+        return false;
+    }
+
+    QTextStream out(&file);
+    out << "frame,time_ms,plate,confidence,x,y,width,height\n";
+    for (const Detection &d : detections) {
+        out << d.frame << "," << QString::number(d.timeMs, 'f', 1) << "," << d.plate << ","
+            << QString::number(d.confidence, 'f', 3) << "," << d.box.x << "," << d.box.y << ","
+            << d.box.width << "," << d.box.height << "\n";
+    }
+    return true;
+}
+
+// Для этапов - кадров в секунду на один поток (по суммарному времени этапа)
+// и общая скорость по настенному времени
+void OfflineRunner::report(double seconds) const
+{
+    const uint64_t frames = stats.frames.load();
+    auto perThread = [](uint64_t items, const LatencyStat &stat) {
+        const uint64_t us = stat.sumUs.load();
+        return us > 0 ? items * 1e6 / us : 0.0;
+    };
+    auto averageMs = [](const LatencyStat &stat) {
+        const uint64_t count = stat.count.load();
+        return count > 0 ? stat.sumUs.load() / 1000.0 / count : 0.0;
+    };
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    out << "\n=== Offline (" << seconds << " s, " << pool.maxThreadCount() << " threads) ===\n";
+    out << "frames " << frames << ", " << (seconds > 0.0 ? frames / seconds : 0.0)
+        << " fps overall\n";
+    out << "    decode: " << averageMs(stats.decodeTime) << " ms/frame, "
+        << perThread(stats.decodeTime.count.load(), stats.decodeTime) << " fps per thread\n";
+    if (useGate) {
+        out << "    detect: " << averageMs(stats.detectTime) << " ms/frame, "
+            << perThread(stats.detectTime.count.load(), stats.detectTime)
+            << " fps per thread, plates found " << stats.crops.load() << "\n";
+    }
+    if (input.deskew && stats.deskewTime.count.load() > 0) {
+        out << "    deskew: " << averageMs(stats.deskewTime) << " ms/frame, "
+            << perThread(stats.deskewTime.count.load(), stats.deskewTime)
+            << " fps per thread\n";
+    }
+    if (useNative) {
+        out << "    ocr (native): " << stats.ocrRequests.load() << " plates, "
+            << averageMs(stats.ocrTime) << " ms/frame, "
+            << perThread(stats.ocrRequests.load(), stats.ocrTime) << " plates/s per thread\n";
+    } else {
+        out << "    ocr (server): " << stats.ocrRequests.load() << " requests, "
+            << (seconds > 0.0 ? stats.ocrRequests.load() / seconds : 0.0)
+            << " req/s, avg latency " << averageMs(stats.ocrTime) << " ms, failed "
+            << stats.ocrFailed.load() << "\n";
+    }
+    out << "results: " << detections.size() << " plates -> "
+        << config.offlineOutput.toStdString();
+    std::cout << out.str() << std::endl;
+}
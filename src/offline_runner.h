@@ -0,0 +1,125 @@
+#pragma once
+
+#include <QObject>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "async_ocr_client.h"
+#include "plate_deskew.h"
+#include "plate_detector.h"
+#include "plate_ocr_engine.h"
+#include "stream_config.h"
+#include "stream_stats.h"
+#include "yolo_plate_detector.h"
+
+// Счетчики пакетной обработки, пишутся всеми рабочими потоками
+struct OfflineStats
+{
+    std::atomic<uint64_t> frames{0};
+    std::atomic<uint64_t> crops{0};
+    std::atomic<uint64_t> ocrRequests{0};
+    std::atomic<uint64_t> ocrFailed{0};
+
+    LatencyStat decodeTime; // чтение и декодирование одного кадра
+    LatencyStat detectTime;
+    LatencyStat deskewTime;
+    LatencyStat ocrTime;    // локальный CRNN: батч кадра; сервер: от отправки до ответа
+};
+
+// Пакетная обработка записанного видео или каталога кадров (video2frames.py)
+// со скоростью, которую позволяет железо. Вход режется на куски по номерам
+// кадров; каждый кусок - отдельная задача пула со своим cv::VideoCapture,
+// который встает на начало куска (бэкенд FFmpeg переходит на ближайший
+// предшествующий ключевой кадр и декодирует вперед). Детектор, выравнивание
+// и OCR те же, что у камер. Результаты сортируются по кадрам и пишутся в CSV
+// с временем кадра; по каждому этапу печатается пропускная способность.
+class OfflineRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit OfflineRunner(const EngineConfig &config, QObject *parent = nullptr);
+    ~OfflineRunner();
+
+    // false - вход не открылся
+    bool start();
+
+signals:
+    void finished();
+
+private:
+    struct Chunk
+    {
+        int begin = 0;
+        int end = 0; // не включая; INT_MAX - до конца файла
+    };
+
+    struct Detection
+    {
+        int frame = 0;
+        double timeMs = 0.0;
+        QString plate;
+        double confidence = 0.0;
+        cv::Rect box;
+    };
+
+    bool openInput();
+    void processChunk(int chunkIndex);
+    void processFrame(int chunkIndex, int frameIndex, double timeMs, const cv::Mat &frame,
+                      PlateDeskew &deskew);
+    void submitRemote(int chunkIndex, int frameIndex, double timeMs, const cv::Mat &image,
+                      OcrRequestKind kind, const cv::Rect &box);
+    void addDetection(int frameIndex, double timeMs, const QString &plate, double confidence,
+                      const cv::Rect &box);
+    void onOcrResult(const OcrResult &result);
+    void maybeFinish();
+    bool writeResults();
+    void report(double seconds) const;
+
+    EngineConfig config;
+    StreamConfig input;
+
+    PlateDetector plateDetector;
+    YoloPlateDetector yoloDetector;
+    PlateOcrEngine ocrEngine;
+    bool useYolo = false;
+    bool useGate = false;
+    bool useNative = false;
+
+    QThread networkThread;
+    AsyncOCRClient *ocrClient = nullptr;
+
+    // Вход: либо список файлов кадров, либо видео
+    std::vector<cv::String> frameFiles;
+    int totalFrames = 0; // 0 - неизвестно, читаем до конца одним куском
+    double sourceFps = 0.0;
+
+    QThreadPool pool;
+    std::vector<Chunk> chunks;
+    // Окно запросов к серверу у каждого куска свое: кусок ждет, а не теряет кадры
+    std::vector<std::unique_ptr<QSemaphore>> ocrSlots;
+    std::atomic<int> chunksLeft{0};
+    std::atomic<int> outstanding{0}; // запросы к серверу без ответа
+    bool done = false;
+
+    std::mutex resultsMutex;
+    std::vector<Detection> detections;
+    // Кадр -> время и число запросов без ответа; запись живет, пока ждем ответы
+    struct FrameTime
+    {
+        double timeMs = 0.0;
+        int pending = 0;
+    };
+    std::map<uint64_t, FrameTime> frameTimes;
+
+    OfflineStats stats;
+    std::chrono::steady_clock::time_point startTime;
+};
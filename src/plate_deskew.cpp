@@ -0,0 +1,142 @@
+#include "plate_deskew.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "buffer_pool.h"
+
+PlateDeskew::PlateDeskew(const DeskewConfig &config)
+    : config(config)
+{
+}
+
+// Бинаризация и суммы по полосам столбцов: дальше каждый угол стоит
+// (число полос x высота) сложений вместо поворота всей вырезки
+void PlateDeskew::prepare(const cv::Mat &plate)
+{
+    // Вырезки разного размера пишутся в области растущих буферов (bufferArea)
+    cv::Mat gray = plate;
+    if (plate.channels() == 3) {
+        gray = bufferArea(grayBuffer, plate.size(), CV_8UC1);
+        cv::cvtColor(plate, gray, cv::COLOR_BGR2GRAY);
+    }
+
+    // Символы темные на светлом: после инверсии профиль считает "чернила"
+    cv::Mat binary = bufferArea(binaryBuffer, gray.size(), CV_8UC1);
+    cv::threshold(gray, binary, 0, 255, cv::THRESH_BINARY_INV | cv::THRESH_OTSU);
+
+    const int blocks = std::max(1, binary.cols / std::max(1, config.blockWidth));
+    cv::Mat blockMeans = bufferArea(meansBuffer, cv::Size(blocks, binary.rows), CV_8UC1);
+    cv::resize(binary, blockMeans, blockMeans.size(), 0, 0, cv::INTER_AREA);
+    cv::Mat blockRows8 = bufferArea(rows8Buffer, cv::Size(binary.rows, blocks), CV_8UC1);
+    cv::transpose(blockMeans, blockRows8);
+    blockRows = bufferArea(rowsBuffer, blockRows8.size(), CV_32F);
+    blockRows8.convertTo(blockRows, CV_32F);
+
+    blockOffsets.resize(blocks);
+    const double blockStep = double(binary.cols) / blocks;
+    for (int k = 0; k < blocks; ++k) {
+        blockOffsets[k] = static_cast<float>((k + 0.5) * blockStep - binary.cols / 2.0);
+    }
+
+    const double maxTan = std::tan(std::abs(config.limit) * CV_PI / 180.0);
+    profilePadding = static_cast<int>(std::ceil(binary.cols / 2.0 * maxTan)) + 2;
+    profile.resize(binary.rows + 2 * profilePadding + 1);
+}
+
+// Профиль строк после поворота на angle: строка пикселя (x, y) становится
+// y - (x - cx) * tan(angle). Дробный сдвиг делится между соседними строками
+double PlateDeskew::score(double angle)
+{
+    const float slope = static_cast<float>(-std::tan(angle * CV_PI / 180.0));
+    const int rows = blockRows.cols;
+    std::fill(profile.begin(), profile.end(), 0.0f);
+
+    for (int k = 0; k < blockRows.rows; ++k) {
+        const float shift = profilePadding + blockOffsets[k] * slope;
+        const int base = static_cast<int>(std::floor(shift));
+        const float upper = shift - base;
+        const float lower = 1.0f - upper;
+
+        // Два отдельных прохода без зависимостей между итерациями - векторизуются
+        const float *src = blockRows.ptr<float>(k);
+        float *dst = profile.data() + base;
+        for (int y = 0; y < rows; ++y) {
+            dst[y] += lower * src[y];
+        }
+        dst += 1;
+        for (int y = 0; y < rows; ++y) {
+            dst[y] += upper * src[y];
+        }
+    }
+
+    double sum = 0.0;
+    for (size_t i = 1; i < profile.size(); ++i) {
+        const float diff = profile[i] - profile[i - 1];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+double PlateDeskew::estimateAngle(const cv::Mat &plate)
+{
+    if (plate.empty()) {
+        return 0.0;
+    }
+    prepare(plate);
+
+    const double limit = std::abs(config.limit);
+    double step = std::max(0.01, config.coarseStep);
+    double bestAngle = 0.0;
+    double bestScore = score(0.0);
+
+    for (double angle = -limit; angle <= limit + 1e-9; angle += step) {
+        double s = score(angle);
+        if (s > bestScore) {
+            bestScore = s;
+            bestAngle = angle;
+        }
+    }
+
+    // Уточняем вокруг лучшего угла с шагом в 4 раза мельче
+    for (int level = 0; level < config.refineLevels; ++level) {
+        const double center = bestAngle;
+        step /= 4.0;
+        for (int i = -3; i <= 3; ++i) {
+            const double angle = center + i * step;
+            if (i == 0 || angle < -limit || angle > limit) {
+                continue;
+            }
+            double s = score(angle);
+            if (s > bestScore) {
+                bestScore = s;
+                bestAngle = angle;
+            }
+        }
+    }
+    return bestAngle;
+}
+
+double PlateDeskew::apply(const cv::Mat &plate, cv::Mat &corrected)
+{
+    const double angle = estimateAngle(plate);
+    if (std::abs(angle) < kMinAngle) {
+        corrected = plate;
+        return angle;
+    }
+    rotate(plate, angle, corrected);
+    return angle;
+}
+
+void PlateDeskew::rotate(const cv::Mat &plate, double angle, cv::Mat &corrected)
+{
+    // Матрица cv::getRotationMatrix2D, но в Matx на стеке вместо нового Mat
+    const double radians = angle * CV_PI / 180.0;
+    const double alpha = std::cos(radians);
+    const double beta = std::sin(radians);
+    const double cx = plate.cols / 2.0;
+    const double cy = plate.rows / 2.0;
+    const cv::Matx23d M(alpha, beta, (1.0 - alpha) * cx - beta * cy,
+                        -beta, alpha, beta * cx + (1.0 - alpha) * cy);
+    cv::warpAffine(plate, corrected, M, plate.size(), cv::INTER_CUBIC, cv::BORDER_REPLICATE);
+}
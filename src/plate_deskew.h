@@ -0,0 +1,57 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <vector>
+
+struct DeskewConfig
+{
+    double limit = 5.0;      // наибольший исправляемый наклон, градусы
+    double coarseStep = 1.0; // шаг грубого перебора
+    int refineLevels = 2;    // уточнений, каждое с шагом в 4 раза мельче
+    int blockWidth = 4;      // ширина полосы столбцов с общим сдвигом
+};
+
+// Выравнивание наклона вырезки номера по проекционному профилю строк.
+// Повернутые изображения не строятся: при малых углах поворот по строкам
+// равен сдвигу столбцов, поэтому вырезка один раз сводится к суммам по
+// полосам столбцов, а профиль для каждого угла собирается из этих сумм со
+// сдвигом. Углы перебираются от грубого к точному, лучший - по той же
+// оценке, что и в прежнем correct_skew (сумма квадратов разностей соседних
+// строк профиля). Буферы живут в объекте, поэтому он не потокобезопасен:
+// один экземпляр на камеру.
+class PlateDeskew
+{
+public:
+    explicit PlateDeskew(const DeskewConfig &config = DeskewConfig());
+
+    // Угол в смысле cv::getRotationMatrix2D, на который надо повернуть вырезку
+    double estimateAngle(const cv::Mat &plate);
+
+    // Меньший наклон не стоит интерполяции: вырезка остается как есть
+    static constexpr double kMinAngle = 0.05;
+
+    // Оценивает угол и поворачивает вырезку; возвращает угол
+    double apply(const cv::Mat &plate, cv::Mat &corrected);
+
+    // Поворот на angle в corrected; corrected того же размера и типа (в том
+    // числе ROI буфера побольше) заполняется на месте, без выделения памяти
+    static void rotate(const cv::Mat &plate, double angle, cv::Mat &corrected);
+
+private:
+    void prepare(const cv::Mat &plate);
+    double score(double angle);
+
+    DeskewConfig config;
+
+    // Рабочие буферы, переиспользуются между вызовами и только растут
+    cv::Mat grayBuffer;
+    cv::Mat binaryBuffer;
+    cv::Mat meansBuffer; // строки x полосы
+    cv::Mat rows8Buffer;
+    cv::Mat rowsBuffer;
+    cv::Mat blockRows;   // полосы x строки, область rowsBuffer текущей вырезки
+    std::vector<float> blockOffsets;
+    std::vector<float> profile;
+    int profilePadding = 0;
+};
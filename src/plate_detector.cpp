@@ -0,0 +1,159 @@
+#include "plate_detector.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "buffer_pool.h"
+
+bool PlateDetector::load(const std::string &cascadePath, const PlateDetectorConfig &config)
+{
+    std::unique_ptr<cv::CascadeClassifier> cascade(new cv::CascadeClassifier());
+    if (!cascade->load(cascadePath)) {
+        std::cerr << "Could not load plate cascade from: " << cascadePath << std::endl;
+        return false;
+    }
+
+    this->cascadePath = cascadePath;
+    this->config = config;
+    loaded = true;
+    cascades.release(std::move(cascade));
+    return true;
+}
+
+std::unique_ptr<cv::CascadeClassifier> PlateDetector::acquireCascade()
+{
+    return cascades.acquire([this]() {
+        std::unique_ptr<cv::CascadeClassifier> cascade(new cv::CascadeClassifier());
+        cascade->load(cascadePath);
+        return cascade;
+    });
+}
+
+std::vector<cv::Rect> PlateDetector::detect(const cv::Mat &image)
+{
+    if (image.empty() || !loaded) {
+        return {};
+    }
+
+    // Серая и уменьшенная копии - в буферах потока, которые только растут:
+    // детектор общий для камер, а новый кадр в каждом вызове - это выделение
+    // памяти размером с кадр на каждом шаге камеры
+    thread_local cv::Mat grayBuffer;
+    thread_local cv::Mat smallBuffer;
+
+    // Каскад все равно работает по яркости - переводим в серый один раз на весь кадр
+    cv::Mat gray = image;
+    if (image.channels() == 3) {
+        gray = bufferArea(grayBuffer, image.size(), CV_8UC1);
+        cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+    }
+
+    const double scale = std::min(1.0, std::max(0.1, config.scale));
+    cv::Mat small = gray;
+    if (scale < 1.0) {
+        const cv::Size size(std::max(1, cvRound(gray.cols * scale)),
+                            std::max(1, cvRound(gray.rows * scale)));
+        small = bufferArea(smallBuffer, size, CV_8UC1);
+        cv::resize(gray, small, size, 0, 0, cv::INTER_AREA);
+    }
+
+    std::vector<cv::Rect> tiles = makeTiles(small.size());
+    std::vector<std::vector<cv::Rect>> perTile(tiles.size());
+    if (tiles.size() == 1) {
+        perTile[0] = detectTile(small, tiles[0]);
+    } else {
+        cv::parallel_for_(cv::Range(0, static_cast<int>(tiles.size())),
+                          [&](const cv::Range &range) {
+                              for (int i = range.start; i < range.end; ++i) {
+                                  perTile[i] = detectTile(small, tiles[i]);
+                              }
+                          });
+    }
+
+    // Возвращаемся к координатам исходного изображения
+    std::vector<cv::Rect> plates;
+    const cv::Rect bounds(0, 0, image.cols, image.rows);
+    for (const std::vector<cv::Rect> &found : perTile) {
+        for (const cv::Rect &r : found) {
+            cv::Rect full(cvRound(r.x / scale), cvRound(r.y / scale), cvRound(r.width / scale),
+                          cvRound(r.height / scale));
+            full &= bounds;
+            if (!full.empty()) {
+                plates.push_back(full);
+            }
+        }
+    }
+
+    return mergeOverlapping(std::move(plates));
+}
+
+std::vector<cv::Rect> PlateDetector::detectTile(const cv::Mat &gray, const cv::Rect &tile)
+{
+    std::unique_ptr<cv::CascadeClassifier> cascade = acquireCascade();
+
+    std::vector<cv::Rect> plates;
+    cascade->detectMultiScale(gray(tile), plates, config.scaleFactor, config.minNeighbors, 0);
+    for (cv::Rect &r : plates) {
+        r.x += tile.x;
+        r.y += tile.y;
+    }
+
+    cascades.release(std::move(cascade));
+    return plates;
+}
+
+std::vector<cv::Rect> PlateDetector::makeTiles(const cv::Size &size) const
+{
+    const int tileSize = config.tileSize;
+    const int overlap = std::min(config.tileOverlap, tileSize / 2);
+    if (tileSize <= 0 || (size.width <= tileSize && size.height <= tileSize)) {
+        return {cv::Rect(0, 0, size.width, size.height)};
+    }
+
+    std::vector<cv::Rect> tiles;
+    const int step = tileSize - overlap;
+    for (int y = 0; y < size.height; y += step) {
+        for (int x = 0; x < size.width; x += step) {
+            cv::Rect tile(x, y, tileSize, tileSize);
+            tiles.push_back(tile & cv::Rect(0, 0, size.width, size.height));
+            if (x + tileSize >= size.width) {
+                break;
+            }
+        }
+        if (y + tileSize >= size.height) {
+            break;
+        }
+    }
+    return tiles;
+}
+
+// Один номер может попасть в два перекрывающихся тайла - оставляем больший
+std::vector<cv::Rect> PlateDetector::mergeOverlapping(std::vector<cv::Rect> rects)
+{
+    std::sort(rects.begin(), rects.end(),
+              [](const cv::Rect &a, const cv::Rect &b) { return a.area() > b.area(); });
+
+    std::vector<cv::Rect> merged;
+    for (const cv::Rect &r : rects) {
+        bool duplicate = false;
+        for (const cv::Rect &m : merged) {
+            const int inter = (r & m).area();
+            if (inter > 0.5 * std::min(r.area(), m.area())) {
+                duplicate = true;
+                break;
+            }
+        }
+        if (!duplicate) {
+            merged.push_back(r);
+        }
+    }
+    return merged;
+}
+
+cv::Rect PlateDetector::padRect(const cv::Rect &rect, double padding, const cv::Size &bounds)
+{
+    const int padX = cvRound(rect.width * padding);
+    const int padY = cvRound(rect.height * padding);
+    cv::Rect padded(rect.x - padX, rect.y - padY, rect.width + 2 * padX, rect.height + 2 * padY);
+    return padded & cv::Rect(0, 0, bounds.width, bounds.height);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "object_pool.h"
+
+struct PlateDetectorConfig
+{
+    double scale = 0.5;      // уменьшение ROI перед детекцией
+    double scaleFactor = 1.1;
+    int minNeighbors = 10;
+    int tileSize = 640;      // сторона тайла в пикселях уменьшенного изображения
+    int tileOverlap = 64;    // перекрытие тайлов, больше ширины номера
+    double padding = 0.25;   // поля вокруг найденного номера, доля размера
+};
+
+// Детектор номеров на каскаде Хаара, один на процесс.
+// CascadeClassifier не потокобезопасен, поэтому каждый поток берет свою копию
+// из пула; большие кадры режутся на тайлы и обрабатываются параллельно.
+class PlateDetector
+{
+public:
+    bool load(const std::string &cascadePath,
+              const PlateDetectorConfig &config = PlateDetectorConfig());
+    bool isLoaded() const { return loaded; }
+    const PlateDetectorConfig &detectorConfig() const { return config; }
+
+    // Все кандидаты в координатах image
+    std::vector<cv::Rect> detect(const cv::Mat &image);
+
+    // Прямоугольник с полями, обрезанный по границам изображения
+    static cv::Rect padRect(const cv::Rect &rect, double padding, const cv::Size &bounds);
+
+private:
+    std::vector<cv::Rect> detectTile(const cv::Mat &gray, const cv::Rect &tile);
+    std::vector<cv::Rect> makeTiles(const cv::Size &size) const;
+    static std::vector<cv::Rect> mergeOverlapping(std::vector<cv::Rect> rects);
+
+    std::unique_ptr<cv::CascadeClassifier> acquireCascade();
+
+    std::string cascadePath;
+    PlateDetectorConfig config;
+    bool loaded = false;
+
+    ObjectPool<cv::CascadeClassifier> cascades;
+};
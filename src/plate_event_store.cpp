@@ -0,0 +1,779 @@
+#include "plate_event_store.h"
+
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+#include "plate_watchlist.h"
+
+namespace {
+const uint32_t kBlockEvents = 1024; // записей в блоке индекса времени
+const int kCropQuality = 80;
+// Вырезка номера в JPEG - десятки КБ; больше - запрос с чужими смещениями
+const uint32_t kMaxCropBytes = 4 * 1024 * 1024;
+
+// Заголовок файла .events; записи идут сразу за ним
+struct SegmentHeader
+{
+    char magic[8];
+    uint32_t capacity;
+    uint32_t count; // пишется после самой записи
+    char reserved[48];
+};
+static_assert(sizeof(SegmentHeader) == 64, "SegmentHeader is stored on disk as is");
+
+struct TimeBlock
+{
+    int64_t minMs;
+    int64_t maxMs;
+};
+
+// Файл .index закрытого сегмента: заголовок, блоки времени, словарь номеров
+// по алфавиту, номера записей по номерам словаря, триграммы по возрастанию,
+// номера словаря по триграммам. Все массивы выровнены, читаются через mmap
+struct IndexHeader
+{
+    char magic[8];
+    uint32_t blockCount;
+    uint32_t plateCount;
+    uint32_t postingCount;
+    uint32_t trigramCount;
+    uint32_t trigramPostingCount;
+    uint32_t reserved;
+    int64_t minMs;
+    int64_t maxMs;
+};
+static_assert(sizeof(IndexHeader) == 48, "IndexHeader is stored on disk as is");
+
+struct PlateKey
+{
+    char plate[20]; // как в PlateEventRecord, дополнен нулями
+    uint32_t first; // в массиве записей
+    uint32_t count;
+    uint32_t reserved;
+};
+static_assert(sizeof(PlateKey) == 32, "PlateKey is stored on disk as is");
+
+struct TrigramKey
+{
+    uint32_t trigram; // три байта UTF-8 номера
+    uint32_t first;   // в массиве номеров словаря
+    uint32_t count;
+};
+
+const char kSegmentMagic[8] = {'L', 'P', 'R', 'E', 'V', 'T', '0', '1'};
+const char kIndexMagic[8] = {'L', 'P', 'R', 'I', 'D', 'X', '0', '1'};
+
+const int kPlateBytes = sizeof(PlateEventRecord::plate);
+
+size_t plateLength(const char *plate)
+{
+    return strnlen(plate, kPlateBytes);
+}
+
+uint32_t trigramAt(const char *text, size_t i)
+{
+    return static_cast<uint32_t>(static_cast<unsigned char>(text[i])) << 16
+           | static_cast<uint32_t>(static_cast<unsigned char>(text[i + 1])) << 8
+           | static_cast<unsigned char>(text[i + 2]);
+}
+
+bool matches(const char *plate, const std::string &query, PlateMatch match)
+{
+    const size_t length = plateLength(plate);
+    switch (match) {
+    case PlateMatch::Exact:
+        return length == query.size() && !std::memcmp(plate, query.data(), length);
+    case PlateMatch::Prefix:
+        return length >= query.size() && !std::memcmp(plate, query.data(), query.size());
+    case PlateMatch::Contains:
+        return std::string(plate, length).find(query) != std::string::npos;
+    }
+    return false;
+}
+
+void *mapFile(int fd, size_t bytes, bool writable)
+{
+    void *map = mmap(nullptr, bytes, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED,
+                     fd, 0);
+    return map == MAP_FAILED ? nullptr : map;
+}
+
+// Номера хранятся и ищутся в алфавите CRNN, как в PlateWatchlist: запрос,
+// набранный в русской раскладке, находит те же записи. Строка вне алфавита
+// (или длиннее номера) - просто в верхнем регистре
+std::string storedPlate(const QString &plate)
+{
+    QString normalized;
+    if (!PlateWatchlist::normalize(plate, normalized)) {
+        normalized = plate.toUpper();
+    }
+    return normalized.toStdString();
+}
+} // namespace
+
+std::string PlateEventRecord::plateText() const
+{
+    return std::string(plate, plateLength(plate));
+}
+
+// Сегмент: записи отображены целиком (файл заранее растянут до емкости), у
+// закрытого - еще и файл индекса. Поля текущего сегмента, которые читает
+// поиск (count, blocks, dictionary, minMs/maxMs), меняются под mutex хранилища
+struct PlateEventStore::Segment
+{
+    uint32_t number = 0;
+    QString base; // путь без расширения
+
+    int fd = -1;
+    int cropsFd = -1;
+    void *map = nullptr;
+    size_t mapBytes = 0;
+    SegmentHeader *header = nullptr;
+    PlateEventRecord *records = nullptr;
+
+    uint32_t count = 0;
+    uint64_t cropsBytes = 0; // меняет поток записи под mutex хранилища
+    int64_t minMs = std::numeric_limits<int64_t>::max();
+    int64_t maxMs = std::numeric_limits<int64_t>::min();
+    std::vector<TimeBlock> blocks;
+
+    // Индекс текущего сегмента в памяти
+    std::unordered_map<std::string, std::vector<uint32_t>> dictionary;
+
+    // Индекс закрытого сегмента из файла
+    bool sealed = false;
+    void *indexMap = nullptr;
+    size_t indexBytes = 0;
+    const IndexHeader *index = nullptr;
+    const PlateKey *plates = nullptr;
+    const uint32_t *postings = nullptr;
+    const TrigramKey *trigrams = nullptr;
+    const uint32_t *trigramPostings = nullptr;
+
+    ~Segment()
+    {
+        if (map) {
+            munmap(map, mapBytes);
+        }
+        if (indexMap) {
+            munmap(indexMap, indexBytes);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        if (cropsFd >= 0) {
+            ::close(cropsFd);
+        }
+    }
+
+    // Запись i в индекс текущего сегмента
+    void add(uint32_t i)
+    {
+        const PlateEventRecord &record = records[i];
+        dictionary[record.plateText()].push_back(i);
+        if (i % kBlockEvents == 0) {
+            blocks.push_back({record.seenMs, record.seenMs});
+        }
+        TimeBlock &block = blocks.back();
+        block.minMs = std::min(block.minMs, record.seenMs);
+        block.maxMs = std::max(block.maxMs, record.seenMs);
+        minMs = std::min(minMs, record.seenMs);
+        maxMs = std::max(maxMs, record.seenMs);
+    }
+
+    bool mapIndex()
+    {
+        if (indexMap) {
+            munmap(indexMap, indexBytes);
+            indexMap = nullptr;
+        }
+        QFile file(base + ".index");
+        if (!file.open(QIODevice::ReadOnly)
+            || file.size() < static_cast<qint64>(sizeof(IndexHeader))) {
+            return false;
+        }
+        indexBytes = static_cast<size_t>(file.size());
+        indexMap = mapFile(file.handle(), indexBytes, false);
+        if (!indexMap) {
+            return false;
+        }
+
+        const char *data = static_cast<const char *>(indexMap);
+        index = reinterpret_cast<const IndexHeader *>(data);
+        const size_t expected = sizeof(IndexHeader) + index->blockCount * sizeof(TimeBlock)
+                                + index->plateCount * sizeof(PlateKey)
+                                + index->postingCount * sizeof(uint32_t)
+                                + index->trigramCount * sizeof(TrigramKey)
+                                + index->trigramPostingCount * sizeof(uint32_t);
+        if (std::memcmp(index->magic, kIndexMagic, sizeof(kIndexMagic))
+            || expected != indexBytes) {
+            return false;
+        }
+
+        const TimeBlock *timeBlocks =
+            reinterpret_cast<const TimeBlock *>(data + sizeof(IndexHeader));
+        blocks.assign(timeBlocks, timeBlocks + index->blockCount);
+        plates = reinterpret_cast<const PlateKey *>(timeBlocks + index->blockCount);
+        postings = reinterpret_cast<const uint32_t *>(plates + index->plateCount);
+        trigrams = reinterpret_cast<const TrigramKey *>(postings + index->postingCount);
+        trigramPostings = reinterpret_cast<const uint32_t *>(trigrams + index->trigramCount);
+        minMs = index->minMs;
+        maxMs = index->maxMs;
+        sealed = true;
+        return true;
+    }
+};
+
+PlateEventStore::PlateEventStore(const PlateEventStoreConfig &config)
+    : config(config)
+{
+}
+
+PlateEventStore::~PlateEventStore()
+{
+    close();
+}
+
+bool PlateEventStore::open(QString &error)
+{
+    QDir dir(config.directory);
+    if (!dir.mkpath(".")) {
+        error = QString("Cannot create event store directory %1").arg(config.directory);
+        return false;
+    }
+
+    const QStringList names = dir.entryList(QStringList() << "*.events", QDir::Files, QDir::Name);
+    for (const QString &name : names) {
+        if (!openSegment(name.section('.', 0, 0).toUInt(), false, error)) {
+            return false;
+        }
+    }
+
+    // Сегменты, не закрытые из-за остановки процесса, кроме последнего
+    for (size_t i = 0; i + 1 < segments.size(); ++i) {
+        if (!segments[i]->sealed) {
+            seal(*segments[i]);
+        }
+    }
+    if (segments.empty() || segments.back()->sealed
+        || segments.back()->count >= segments.back()->header->capacity) {
+        if (!segments.empty() && !segments.back()->sealed) {
+            seal(*segments.back());
+        }
+        const uint32_t next = segments.empty() ? 1 : segments.back()->number + 1;
+        if (!openSegment(next, true, error)) {
+            return false;
+        }
+    }
+    dropExpired();
+
+    stopping = false;
+    writer = std::thread(&PlateEventStore::writerLoop, this);
+    return true;
+}
+
+void PlateEventStore::close()
+{
+    if (!writer.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueReady.notify_all();
+    writer.join();
+}
+
+bool PlateEventStore::openSegment(uint32_t number, bool create, QString &error)
+{
+    auto segment = std::make_shared<Segment>();
+    segment->number = number;
+    segment->base = QString("%1/%2").arg(config.directory).arg(number, 8, 10, QChar('0'));
+
+    const QByteArray path = QFile::encodeName(segment->base + ".events");
+    segment->fd = ::open(path.constData(), create ? O_RDWR | O_CREAT | O_EXCL : O_RDWR, 0644);
+    const QByteArray cropsPath = QFile::encodeName(segment->base + ".crops");
+    segment->cropsFd = ::open(cropsPath.constData(), O_RDWR | O_CREAT, 0644);
+    if (segment->fd < 0 || segment->cropsFd < 0) {
+        error = QString("Cannot open event segment %1").arg(segment->base);
+        return false;
+    }
+
+    uint32_t capacity = config.segmentEvents;
+    if (!create) {
+        SegmentHeader header;
+        if (pread(segment->fd, &header, sizeof(header), 0) != sizeof(header)
+            || std::memcmp(header.magic, kSegmentMagic, sizeof(kSegmentMagic))) {
+            error = QString("Invalid event segment %1").arg(segment->base);
+            return false;
+        }
+        capacity = header.capacity;
+    }
+
+    // Файл растягивается до полной емкости сразу: место выделяется по мере
+    // записи, а отображение не надо переделывать
+    segment->mapBytes =
+        sizeof(SegmentHeader) + static_cast<size_t>(capacity) * sizeof(PlateEventRecord);
+    if (create && ftruncate(segment->fd, static_cast<off_t>(segment->mapBytes)) != 0) {
+        error = QString("Cannot allocate event segment %1").arg(segment->base);
+        return false;
+    }
+    segment->map = mapFile(segment->fd, segment->mapBytes, true);
+    if (!segment->map) {
+        error = QString("Cannot map event segment %1").arg(segment->base);
+        return false;
+    }
+    segment->header = static_cast<SegmentHeader *>(segment->map);
+    segment->records = reinterpret_cast<PlateEventRecord *>(segment->header + 1);
+
+    struct stat crops;
+    fstat(segment->cropsFd, &crops);
+    segment->cropsBytes = static_cast<uint64_t>(crops.st_size);
+
+    if (create) {
+        std::memcpy(segment->header->magic, kSegmentMagic, sizeof(kSegmentMagic));
+        segment->header->capacity = capacity;
+        segment->header->count = 0;
+    } else {
+        segment->count = std::min(segment->header->count, capacity);
+        if (!segment->mapIndex()) {
+            // Индекс не успели записать - собираем заново по записям
+            for (uint32_t i = 0; i < segment->count; ++i) {
+                segment->add(i);
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    segments.push_back(segment);
+    return true;
+}
+
+bool PlateEventStore::append(const VehicleEvent &event)
+{
+    // Время событий - по монотонным часам процесса, в хранилище - время Unix
+    const auto steadyNow = std::chrono::steady_clock::now();
+    const auto systemNow = std::chrono::system_clock::now();
+    auto unixMs = [&](std::chrono::steady_clock::time_point time) {
+        const auto wall =
+            systemNow
+            - std::chrono::duration_cast<std::chrono::system_clock::duration>(steadyNow - time);
+        return std::chrono::duration_cast<std::chrono::milliseconds>(wall.time_since_epoch())
+            .count();
+    };
+
+    PlateEventRecord record;
+    record.seenMs = unixMs(event.lastSeen);
+    record.firstSeenMs = unixMs(event.firstSeen);
+    record.confidence = static_cast<float>(event.confidence);
+    record.streamId = static_cast<uint16_t>(std::max(0, event.streamId));
+    record.lane = static_cast<uint16_t>(std::max(0, event.lane));
+    record.observations = static_cast<uint16_t>(std::min(event.observations, 65535));
+    setPlate(record, storedPlate(event.plate));
+    return append(record, config.storeCrops ? event.bestCrop : cv::Mat());
+}
+
+bool PlateEventStore::append(const PlateEventRecord &record, const cv::Mat &crop)
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (queue.size() >= config.queueCapacity) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        queue.push_back(Pending{record, crop});
+    }
+    queueReady.notify_one();
+    return true;
+}
+
+void PlateEventStore::flush()
+{
+    std::unique_lock<std::mutex> lock(queueMutex);
+    queueDrained.wait(lock, [this]() { return (queue.empty() && !writing) || stopping; });
+}
+
+void PlateEventStore::writerLoop()
+{
+    std::deque<Pending> batch;
+    std::unique_lock<std::mutex> lock(queueMutex);
+    for (;;) {
+        queueReady.wait(lock, [this]() { return stopping || !queue.empty(); });
+        if (queue.empty()) {
+            break;
+        }
+        batch.swap(queue);
+        writing = true;
+        lock.unlock();
+
+        for (Pending &pending : batch) {
+            write(pending);
+        }
+        batch.clear();
+
+        lock.lock();
+        writing = false;
+        if (queue.empty()) {
+            queueDrained.notify_all();
+        }
+    }
+    queueDrained.notify_all();
+}
+
+// Только поток записи: текущий сегмент меняет только он
+void PlateEventStore::write(Pending &pending)
+{
+    Segment &segment = *segments.back();
+    if (segment.sealed || segment.count >= segment.header->capacity) {
+        // Следующий сегмент не открылся (нет места, нет прав): события
+        // теряются, пока причину не устранят и процесс не перезапустят
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    PlateEventRecord &record = pending.record;
+    record.segment = segment.number;
+    record.cropOffset = 0;
+    record.cropSize = 0;
+
+    if (!pending.crop.empty()
+        && cv::imencode(".jpg", pending.crop, jpeg, {cv::IMWRITE_JPEG_QUALITY, kCropQuality})
+        && pwrite(segment.cropsFd, jpeg.data(), jpeg.size(),
+                  static_cast<off_t>(segment.cropsBytes))
+               == static_cast<ssize_t>(jpeg.size())) {
+        record.cropOffset = segment.cropsBytes;
+        record.cropSize = static_cast<uint32_t>(jpeg.size());
+    }
+
+    // Запись видна поиску после увеличения count под блокировкой
+    const uint32_t i = segment.count;
+    segment.records[i] = record;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        segment.add(i);
+        segment.count = i + 1;
+        segment.cropsBytes += record.cropSize;
+    }
+    segment.header->count = segment.count;
+    stored.fetch_add(1, std::memory_order_relaxed);
+
+    if (segment.count >= segment.header->capacity) {
+        seal(segment);
+        QString error;
+        if (!openSegment(segment.number + 1, true, error)) {
+            std::cerr << "Event store: " << error.toStdString() << std::endl;
+        }
+        dropExpired();
+    }
+}
+
+// Индекс строится из словаря в памяти без блокировки (его меняет только
+// поток записи), под блокировкой сегмент только переключается на файл
+void PlateEventStore::seal(Segment &segment)
+{
+    std::vector<const std::pair<const std::string, std::vector<uint32_t>> *> entries;
+    entries.reserve(segment.dictionary.size());
+    for (const auto &entry : segment.dictionary) {
+        entries.push_back(&entry);
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const auto *a, const auto *b) { return a->first < b->first; });
+
+    std::vector<PlateKey> plates(entries.size());
+    std::vector<uint32_t> postings;
+    postings.reserve(segment.count);
+    std::vector<std::pair<uint32_t, uint32_t>> trigramPairs; // триграмма, номер словаря
+    for (size_t p = 0; p < entries.size(); ++p) {
+        const std::string &text = entries[p]->first;
+        PlateKey &key = plates[p];
+        std::memset(&key, 0, sizeof(key));
+        std::memcpy(key.plate, text.data(), std::min<size_t>(text.size(), kPlateBytes));
+        key.first = static_cast<uint32_t>(postings.size());
+        key.count = static_cast<uint32_t>(entries[p]->second.size());
+        postings.insert(postings.end(), entries[p]->second.begin(), entries[p]->second.end());
+        for (size_t i = 0; i + 3 <= text.size(); ++i) {
+            trigramPairs.emplace_back(trigramAt(text.data(), i), static_cast<uint32_t>(p));
+        }
+    }
+    std::sort(trigramPairs.begin(), trigramPairs.end());
+    trigramPairs.erase(std::unique(trigramPairs.begin(), trigramPairs.end()), trigramPairs.end());
+
+    std::vector<TrigramKey> trigrams;
+    std::vector<uint32_t> trigramPostings;
+    trigramPostings.reserve(trigramPairs.size());
+    for (const auto &pair : trigramPairs) {
+        if (trigrams.empty() || trigrams.back().trigram != pair.first) {
+            trigrams.push_back({pair.first, static_cast<uint32_t>(trigramPostings.size()), 0});
+        }
+        trigrams.back().count++;
+        trigramPostings.push_back(pair.second);
+    }
+
+    IndexHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kIndexMagic, sizeof(kIndexMagic));
+    header.blockCount = static_cast<uint32_t>(segment.blocks.size());
+    header.plateCount = static_cast<uint32_t>(plates.size());
+    header.postingCount = static_cast<uint32_t>(postings.size());
+    header.trigramCount = static_cast<uint32_t>(trigrams.size());
+    header.trigramPostingCount = static_cast<uint32_t>(trigramPostings.size());
+    header.minMs = segment.minMs;
+    header.maxMs = segment.maxMs;
+
+    QSaveFile file(segment.base + ".index");
+    bool ok = file.open(QIODevice::WriteOnly);
+    auto writeArray = [&](const void *data, size_t bytes) {
+        ok = ok
+             && (bytes == 0
+                 || file.write(static_cast<const char *>(data), static_cast<qint64>(bytes))
+                        == static_cast<qint64>(bytes));
+    };
+    writeArray(&header, sizeof(header));
+    writeArray(segment.blocks.data(), segment.blocks.size() * sizeof(TimeBlock));
+    writeArray(plates.data(), plates.size() * sizeof(PlateKey));
+    writeArray(postings.data(), postings.size() * sizeof(uint32_t));
+    writeArray(trigrams.data(), trigrams.size() * sizeof(TrigramKey));
+    writeArray(trigramPostings.data(), trigramPostings.size() * sizeof(uint32_t));
+    ok = ok && file.commit();
+
+    std::unordered_map<std::string, std::vector<uint32_t>> released;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!ok || !segment.mapIndex()) {
+        // Без файла индекса сегмент так и ищется по словарю в памяти
+        std::cerr << "Event store: cannot write index " << segment.base.toStdString()
+                  << std::endl;
+        return;
+    }
+    released.swap(segment.dictionary);
+}
+
+// Сегменты, все события которых старше срока хранения. Файлы удаляются
+// сразу, отображения живут, пока их держит идущий поиск
+void PlateEventStore::dropExpired()
+{
+    if (config.retentionDays <= 0) {
+        return;
+    }
+    const int64_t nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                              std::chrono::system_clock::now().time_since_epoch())
+                              .count();
+    const int64_t oldestMs = nowMs - static_cast<int64_t>(config.retentionDays) * 24 * 3600 * 1000;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    while (segments.size() > 1 && segments.front()->sealed
+           && segments.front()->maxMs < oldestMs) {
+        const QString base = segments.front()->base;
+        QFile::remove(base + ".events");
+        QFile::remove(base + ".crops");
+        QFile::remove(base + ".index");
+        segments.erase(segments.begin());
+    }
+}
+
+size_t PlateEventStore::segmentCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return segments.size();
+}
+
+void PlateEventStore::setPlate(PlateEventRecord &record, const std::string &plate)
+{
+    // Длинный номер обрезается по границе символа UTF-8
+    size_t length = plate.size();
+    if (length > static_cast<size_t>(kPlateBytes)) {
+        length = kPlateBytes;
+        while (length > 0 && (static_cast<unsigned char>(plate[length]) & 0xC0) == 0x80) {
+            --length;
+        }
+    }
+    std::memset(record.plate, 0, sizeof(record.plate));
+    std::memcpy(record.plate, plate.data(), length);
+}
+
+std::vector<PlateEventRecord> PlateEventStore::find(const PlateQuery &query) const
+{
+    const std::string plate = query.plate.isEmpty() ? std::string() : storedPlate(query.plate);
+    std::vector<std::shared_ptr<Segment>> list;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        list = segments;
+    }
+
+    auto newerFirst = [](const PlateEventRecord &a, const PlateEventRecord &b) {
+        return a.seenMs > b.seenMs;
+    };
+
+    std::vector<PlateEventRecord> found;
+    for (auto it = list.rbegin(); it != list.rend(); ++it) {
+        const Segment &segment = **it;
+
+        // Текущий сегмент дописывается и может закрыться прямо сейчас;
+        // остальные не меняются и читаются без блокировки
+        std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+        if (it == list.rbegin()) {
+            lock.lock();
+        }
+        if (!found.empty() && found.size() >= query.limit
+            && segment.maxMs < found.back().seenMs) {
+            break; // дальше только события старше уже найденных
+        }
+        search(segment, query, plate, found);
+        if (lock.owns_lock()) {
+            lock.unlock();
+        }
+
+        if (found.size() >= query.limit) {
+            std::sort(found.begin(), found.end(), newerFirst);
+            found.resize(query.limit);
+        }
+    }
+    std::sort(found.begin(), found.end(), newerFirst);
+    return found;
+}
+
+void PlateEventStore::search(const Segment &segment, const PlateQuery &query,
+                             const std::string &plate, std::vector<PlateEventRecord> &found) const
+{
+    if (segment.count == 0 || segment.maxMs < query.fromMs || segment.minMs > query.toMs) {
+        return;
+    }
+
+    auto take = [&](uint32_t i) {
+        const PlateEventRecord &record = segment.records[i];
+        if (record.seenMs >= query.fromMs && record.seenMs <= query.toMs
+            && (query.streamId < 0 || record.streamId == query.streamId)) {
+            found.push_back(record);
+        }
+    };
+
+    // Без номера - по индексу времени: блоки вне периода пропускаются целиком
+    if (plate.empty()) {
+        for (size_t b = segment.blocks.size(); b-- > 0;) {
+            const TimeBlock &block = segment.blocks[b];
+            if (block.maxMs < query.fromMs || block.minMs > query.toMs) {
+                continue;
+            }
+            const uint32_t first = static_cast<uint32_t>(b * kBlockEvents);
+            const uint32_t last = std::min(segment.count, first + kBlockEvents);
+            for (uint32_t i = last; i-- > first;) {
+                take(i);
+            }
+            if (found.size() >= query.limit * 2) {
+                return; // блоки идут от новых к старым, остальные не нужны
+            }
+        }
+        return;
+    }
+
+    if (!segment.sealed) {
+        for (const auto &entry : segment.dictionary) {
+            if (matches(entry.first.c_str(), plate, query.match)) {
+                for (uint32_t i : entry.second) {
+                    take(i);
+                }
+            }
+        }
+        return;
+    }
+
+    const PlateKey *platesEnd = segment.plates + segment.index->plateCount;
+    auto takePlate = [&](const PlateKey &key) {
+        for (uint32_t p = key.first; p < key.first + key.count; ++p) {
+            take(segment.postings[p]);
+        }
+    };
+
+    if (query.match != PlateMatch::Contains) {
+        // Словарь по алфавиту: точный номер и префикс - двоичным поиском
+        PlateKey probe;
+        std::memset(&probe, 0, sizeof(probe));
+        std::memcpy(probe.plate, plate.data(), std::min<size_t>(plate.size(), kPlateBytes));
+        const size_t compared = query.match == PlateMatch::Exact ? kPlateBytes : plate.size();
+        const PlateKey *key = std::lower_bound(
+            segment.plates, platesEnd, probe, [](const PlateKey &a, const PlateKey &b) {
+                return std::memcmp(a.plate, b.plate, kPlateBytes) < 0;
+            });
+        for (; key != platesEnd && !std::memcmp(key->plate, probe.plate, compared); ++key) {
+            takePlate(*key);
+        }
+        return;
+    }
+
+    // Фрагмент короче триграммы - перебор словаря (он много меньше записей)
+    if (plate.size() < 3) {
+        for (const PlateKey *key = segment.plates; key != platesEnd; ++key) {
+            if (matches(key->plate, plate, PlateMatch::Contains)) {
+                takePlate(*key);
+            }
+        }
+        return;
+    }
+
+    // Кандидаты - номера с самой редкой триграммой фрагмента, проверяются целиком
+    const TrigramKey *trigramsEnd = segment.trigrams + segment.index->trigramCount;
+    const TrigramKey *rarest = nullptr;
+    for (size_t i = 0; i + 3 <= plate.size(); ++i) {
+        const uint32_t trigram = trigramAt(plate.data(), i);
+        const TrigramKey *key = std::lower_bound(
+            segment.trigrams, trigramsEnd, trigram,
+            [](const TrigramKey &a, uint32_t value) { return a.trigram < value; });
+        if (key == trigramsEnd || key->trigram != trigram) {
+            return;
+        }
+        if (!rarest || key->count < rarest->count) {
+            rarest = key;
+        }
+    }
+    for (uint32_t t = rarest->first; t < rarest->first + rarest->count; ++t) {
+        const PlateKey &key = segment.plates[segment.trigramPostings[t]];
+        if (matches(key.plate, plate, PlateMatch::Contains)) {
+            takePlate(key);
+        }
+    }
+}
+
+QByteArray PlateEventStore::crop(const PlateEventRecord &record) const
+{
+    // Смещение и размер могут прийти из запроса: читаем только то, что
+    // действительно записано в .crops этого сегмента
+    if (record.cropSize == 0 || record.cropSize > kMaxCropBytes) {
+        return QByteArray();
+    }
+
+    std::shared_ptr<Segment> segment;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &candidate : segments) {
+            if (candidate->number == record.segment
+                && record.cropOffset <= candidate->cropsBytes
+                && record.cropSize <= candidate->cropsBytes - record.cropOffset) {
+                segment = candidate;
+                break;
+            }
+        }
+    }
+    if (!segment) {
+        return QByteArray();
+    }
+
+    QByteArray bytes(static_cast<int>(record.cropSize), Qt::Uninitialized);
+    if (pread(segment->cropsFd, bytes.data(), record.cropSize,
+              static_cast<off_t>(record.cropOffset))
+        != static_cast<ssize_t>(record.cropSize)
+        || !bytes.startsWith("\xFF\xD8")) {
+        return QByteArray();
+    }
+    return bytes;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <QByteArray>
+#include <QString>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "plate_tracker.h"
+
+struct PlateEventStoreConfig
+{
+    QString directory;                // пусто - события не сохраняются
+    uint32_t segmentEvents = 1 << 20; // записей в сегменте до перехода к следующему
+    int retentionDays = 30; // сегменты старше удаляются при смене сегмента; 0 - хранить все
+    bool storeCrops = true; // JPEG лучшей вырезки машины рядом с записью
+    size_t queueCapacity = 65536; // событий в очереди записи; дальше новые отбрасываются
+};
+
+// Запись о машине фиксированного размера; сегмент - массив таких записей
+// после заголовка, поэтому читается прямо из отображенного файла
+struct PlateEventRecord
+{
+    int64_t seenMs = 0;      // последнее прочтение, мс от эпохи Unix
+    int64_t firstSeenMs = 0;
+    uint64_t cropOffset = 0; // JPEG вырезки в файле .crops того же сегмента
+    uint32_t cropSize = 0;   // 0 - вырезки нет
+    uint32_t segment = 0;
+    float confidence = 0.0f;
+    uint16_t streamId = 0;
+    uint16_t lane = 0;
+    uint16_t observations = 0;
+    uint16_t reserved = 0;
+    char plate[20] = {};     // UTF-8, без завершающего нуля при полной длине
+
+    std::string plateText() const;
+};
+
+static_assert(sizeof(PlateEventRecord) == 64, "PlateEventRecord is stored on disk as is");
+
+enum class PlateMatch
+{
+    Exact,
+    Prefix,  // номер начинается с plate
+    Contains // plate - фрагмент номера (начало не прочиталось или закрыто)
+};
+
+struct PlateQuery
+{
+    // Пусто - все события за период. Номер приводится к алфавиту CRNN так же,
+    // как при записи (PlateWatchlist::normalize): кириллица - латиницей
+    QString plate;
+    PlateMatch match = PlateMatch::Exact;
+    int64_t fromMs = 0;
+    int64_t toMs = std::numeric_limits<int64_t>::max();
+    int streamId = -1; // -1 - все камеры
+    size_t limit = 1000;
+};
+
+// Хранилище событий по машинам (VehicleEvent) для поиска "где и когда был
+// номер" по всем камерам. Сегменты только дописываются: файл .events -
+// заголовок и записи PlateEventRecord, файл .crops - JPEG вырезок подряд.
+// Заполненный сегмент закрывается, и рядом пишется .index: словарь номеров
+// по алфавиту со списками записей, триграммы номеров для поиска по
+// фрагменту и минимум/максимум времени по блокам записей. Закрытые сегменты
+// читаются через mmap без блокировок, для текущего тот же индекс ведется в
+// памяти по мере записи.
+//
+// append только ставит событие в очередь (короткая блокировка без ввода-
+// вывода) и при полной очереди событие отбрасывает; JPEG, запись и закрытие
+// сегментов - в своем потоке хранилища.
+class PlateEventStore
+{
+public:
+    explicit PlateEventStore(const PlateEventStoreConfig &config);
+    ~PlateEventStore();
+
+    PlateEventStore(const PlateEventStore &) = delete;
+    PlateEventStore &operator=(const PlateEventStore &) = delete;
+
+    // Открывает каталог (дописывает последний сегмент) и запускает поток записи
+    bool open(QString &error);
+    void close();
+
+    bool append(const VehicleEvent &event);
+    bool append(const PlateEventRecord &record, const cv::Mat &crop = cv::Mat());
+
+    // Ждет, пока очередь будет записана
+    void flush();
+
+    // Новые события первыми, не больше query.limit
+    std::vector<PlateEventRecord> find(const PlateQuery &query) const;
+    // JPEG вырезки по segment, cropOffset и cropSize записи; пусто, если такой
+    // области нет в .crops сегмента или она больше разумного размера вырезки
+    QByteArray crop(const PlateEventRecord &record) const;
+
+    uint64_t storedEvents() const { return stored.load(std::memory_order_relaxed); }
+    uint64_t droppedEvents() const { return dropped.load(std::memory_order_relaxed); }
+    size_t segmentCount() const;
+
+    static void setPlate(PlateEventRecord &record, const std::string &plate);
+
+private:
+    struct Segment;
+    struct Pending
+    {
+        PlateEventRecord record;
+        cv::Mat crop;
+    };
+
+    void writerLoop();
+    void write(Pending &pending);
+    bool openSegment(uint32_t number, bool create, QString &error);
+    void seal(Segment &segment);
+    void dropExpired();
+    void search(const Segment &segment, const PlateQuery &query, const std::string &plate,
+                std::vector<PlateEventRecord> &found) const;
+
+    PlateEventStoreConfig config;
+
+    // Сегменты по возрастанию номера, последний - текущий. Указатели держат
+    // отображения, пока по ним идет поиск, даже если сегмент уже удален
+    mutable std::mutex mutex;
+    std::vector<std::shared_ptr<Segment>> segments;
+
+    std::mutex queueMutex;
+    std::condition_variable queueReady;
+    std::condition_variable queueDrained;
+    std::deque<Pending> queue;
+    bool writing = false;
+    bool stopping = false;
+    std::thread writer;
+
+    std::vector<uchar> jpeg; // рабочий буфер потока записи
+
+    std::atomic<uint64_t> stored{0};
+    std::atomic<uint64_t> dropped{0};
+};
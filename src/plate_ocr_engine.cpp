@@ -0,0 +1,122 @@
+#include "plate_ocr_engine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+bool PlateOcrEngine::load(const PlateOcrConfig &config)
+{
+    this->config = config;
+
+    std::unique_ptr<cv::dnn::Net> net;
+    try {
+        net = readNet();
+    } catch (const cv::Exception &e) {
+        std::cerr << "Could not load OCR model from: " << config.modelPath << " (" << e.what()
+                  << ")" << std::endl;
+        return false;
+    }
+    if (!net || net->empty()) {
+        std::cerr << "Could not load OCR model from: " << config.modelPath << std::endl;
+        return false;
+    }
+
+    loaded = true;
+    nets.release(std::move(net));
+    return true;
+}
+
+std::unique_ptr<cv::dnn::Net> PlateOcrEngine::readNet() const
+{
+    std::unique_ptr<cv::dnn::Net> net(new cv::dnn::Net(cv::dnn::readNetFromONNX(config.modelPath)));
+    net->setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+    net->setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+    return net;
+}
+
+std::vector<PlateText> PlateOcrEngine::recognize(const std::vector<cv::Mat> &plates)
+{
+    std::vector<PlateText> results(plates.size());
+    if (plates.empty() || !loaded) {
+        return results;
+    }
+
+    std::unique_ptr<cv::dnn::Net> net = nets.acquire([this]() { return readNet(); });
+    const size_t batchSize = static_cast<size_t>(std::max(1, config.maxBatchSize));
+    try {
+        for (size_t begin = 0; begin < plates.size(); begin += batchSize) {
+            recognizeBatch(*net, plates, begin, std::min(plates.size(), begin + batchSize),
+                           results);
+        }
+    } catch (const cv::Exception &e) {
+        std::cerr << "OCR inference failed: " << e.what() << std::endl;
+    }
+    nets.release(std::move(net));
+    return results;
+}
+
+void PlateOcrEngine::recognizeBatch(cv::dnn::Net &net, const std::vector<cv::Mat> &plates,
+                                    size_t begin, size_t end, std::vector<PlateText> &results)
+{
+    // Та же подготовка, что transform в CRNNRecognizer: серый, 32x128,
+    // нормализация (x/255 - 0.5) / 0.5. Коррекция перспективы из
+    // _preprocess_plate здесь не делается - вырезки уже с полями от детектора
+    const cv::Size inputSize(config.inputWidth, config.inputHeight);
+    std::vector<cv::Mat> inputs;
+    inputs.reserve(end - begin);
+    for (size_t i = begin; i < end; ++i) {
+        const cv::Mat &plate = plates[i];
+        cv::Mat gray;
+        if (plate.empty()) {
+            gray = cv::Mat::zeros(inputSize, CV_8UC1);
+        } else if (plate.channels() == 3) {
+            cv::cvtColor(plate, gray, cv::COLOR_BGR2GRAY);
+        } else {
+            gray = plate;
+        }
+
+        cv::Mat resized;
+        cv::resize(gray, resized, inputSize, 0, 0, cv::INTER_AREA);
+        inputs.push_back(resized);
+    }
+
+    cv::Mat blob = cv::dnn::blobFromImages(inputs, 1.0 / 127.5, inputSize, cv::Scalar(127.5),
+                                           false, false, CV_32F);
+    net.setInput(blob);
+
+    // Выход log_softmax размером (шаги CTC, батч, классы)
+    cv::Mat logits = net.forward();
+    for (size_t i = begin; i < end; ++i) {
+        results[i] = decode(logits, static_cast<int>(i - begin));
+    }
+}
+
+// Жадный CTC: лучший класс на каждом шаге, повторы схлопываются, пустой символ выкидывается
+PlateText PlateOcrEngine::decode(const cv::Mat &logits, int batchIndex) const
+{
+    PlateText result;
+    if (logits.dims != 3) {
+        return result;
+    }
+
+    const int steps = logits.size[0];
+    const int classes = logits.size[2];
+    double probabilitySum = 0.0;
+    int lastClass = 0;
+
+    for (int t = 0; t < steps; ++t) {
+        const float *row = logits.ptr<float>(t, batchIndex);
+        const int best = static_cast<int>(std::max_element(row, row + classes) - row);
+        probabilitySum += std::exp(row[best]);
+
+        if (best != 0 && best != lastClass && best <= static_cast<int>(config.alphabet.size())) {
+            result.text += config.alphabet[best - 1];
+        }
+        lastClass = best;
+    }
+
+    if (!result.text.empty() && steps > 0) {
+        result.confidence = probabilitySum / steps;
+    }
+    return result;
+}
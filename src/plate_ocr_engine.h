@@ -0,0 +1,52 @@
+#pragma once
+
+#include <opencv2/dnn.hpp>
+#include <opencv2/opencv.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "object_pool.h"
+
+struct PlateOcrConfig
+{
+    std::string modelPath = "crnn_ocr.onnx"; // экспорт src/backend/export_crnn_onnx.py
+    int inputWidth = 128;
+    int inputHeight = 32;
+    int maxBatchSize = 16;
+    std::string alphabet = "0123456789ABCEHKMOPTXY"; // класс 0 - пустой символ CTC
+};
+
+struct PlateText
+{
+    std::string text;
+    double confidence = 0.0; // средняя вероятность лучшего класса по шагам CTC
+};
+
+// CRNN из ANPR-System/inference.py, выполняемый в процессе через cv::dnn.
+// Вход - вырезки номеров; они переводятся в серый 32x128, собираются в батч
+// и декодируются жадным CTC. cv::dnn::Net не потокобезопасен, поэтому,
+// как и каскады в PlateDetector, каждый поток берет свою копию сети из пула.
+class PlateOcrEngine
+{
+public:
+    bool load(const PlateOcrConfig &config = PlateOcrConfig());
+    bool isLoaded() const { return loaded; }
+    const PlateOcrConfig &ocrConfig() const { return config; }
+
+    // Результаты в порядке plates; большие списки режутся на батчи по maxBatchSize
+    std::vector<PlateText> recognize(const std::vector<cv::Mat> &plates);
+
+private:
+    void recognizeBatch(cv::dnn::Net &net, const std::vector<cv::Mat> &plates, size_t begin,
+                        size_t end, std::vector<PlateText> &results);
+    PlateText decode(const cv::Mat &logits, int batchIndex) const;
+
+    std::unique_ptr<cv::dnn::Net> readNet() const;
+
+    PlateOcrConfig config;
+    bool loaded = false;
+
+    ObjectPool<cv::dnn::Net> nets;
+};
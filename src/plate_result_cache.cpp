@@ -0,0 +1,130 @@
+#include "plate_result_cache.h"
+
+#include <algorithm>
+#include <bitset>
+#include <iterator>
+
+PlateResultCache::PlateResultCache(const PlateCacheConfig &config)
+    : config(config)
+{
+}
+
+int PlateResultCache::distance(uint64_t a, uint64_t b)
+{
+    return static_cast<int>(std::bitset<64>(a ^ b).count());
+}
+
+double PlateResultCache::overlap(const cv::Rect &a, const cv::Rect &b)
+{
+    const double common = (a & b).area();
+    const double total = a.area() + b.area() - common;
+    return total > 0.0 ? common / total : 0.0;
+}
+
+bool PlateResultCache::sameCrop(const Entry &entry, uint64_t hash, int lane,
+                                const cv::Rect &box) const
+{
+    return entry.lane == lane && distance(hash, entry.hash) <= config.maxDistance
+           && overlap(box, entry.box) >= config.minOverlap;
+}
+
+// Уменьшение до 32x32, DCT и знаки 8x8 низших частот относительно их медианы
+// (постоянная составляющая в медиану не входит - она только про яркость)
+uint64_t PlateResultCache::hash(const cv::Mat &image)
+{
+    if (image.empty()) {
+        return 0;
+    }
+
+    // Полосы камеры хешируют свои вырезки параллельно - буферы у каждого потока свои
+    thread_local cv::Mat small;
+    thread_local cv::Mat gray;
+    thread_local cv::Mat smallFloat;
+    thread_local cv::Mat spectrum;
+    cv::resize(image, small, cv::Size(32, 32), 0, 0, cv::INTER_AREA);
+    if (small.channels() == 3) {
+        cv::cvtColor(small, gray, cv::COLOR_BGR2GRAY);
+    } else {
+        small.copyTo(gray);
+    }
+    gray.convertTo(smallFloat, CV_32F);
+    cv::dct(smallFloat, spectrum);
+
+    float coefficients[64];
+    for (int y = 0; y < 8; ++y) {
+        const float *row = spectrum.ptr<float>(y);
+        std::copy(row, row + 8, coefficients + y * 8);
+    }
+    float sorted[63];
+    std::copy(coefficients + 1, coefficients + 64, sorted);
+    std::nth_element(sorted, sorted + 31, sorted + 63);
+    const float median = sorted[31];
+
+    uint64_t bits = 0;
+    for (int i = 0; i < 64; ++i) {
+        bits = (bits << 1) | (coefficients[i] > median ? 1u : 0u);
+    }
+    return bits;
+}
+
+bool PlateResultCache::lookup(uint64_t hash, int lane, const cv::Rect &box,
+                              std::chrono::steady_clock::time_point now, QString &plate,
+                              double &confidence)
+{
+    const std::chrono::milliseconds ttl(config.ttlMs);
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto best = entries.end();
+    int bestDistance = config.maxDistance + 1;
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (now - it->stored > ttl) {
+            it = entries.erase(it);
+            continue;
+        }
+        const int d = distance(hash, it->hash);
+        if (d < bestDistance && sameCrop(*it, hash, lane, box)) {
+            bestDistance = d;
+            best = it;
+        }
+        ++it;
+    }
+    if (best == entries.end()) {
+        return false;
+    }
+    // Пора сверить с сервером: эта вырезка идет на распознавание, а
+    // следующие до его ответа еще берут номер из записи
+    if (now >= best->refreshAt) {
+        best->refreshAt = now + std::chrono::milliseconds(config.refreshMs);
+        return false;
+    }
+
+    plate = best->plate;
+    confidence = best->confidence;
+    entries.splice(entries.begin(), entries, best);
+    return true;
+}
+
+void PlateResultCache::store(uint64_t hash, int lane, const cv::Rect &box,
+                             const QString &plate, double confidence,
+                             std::chrono::steady_clock::time_point now)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Записи, с которыми совпала бы эта вырезка, заменяются свежим ответом:
+    // иначе после смены машины на том же месте старый номер жил бы до конца ttl
+    for (auto it = entries.begin(); it != entries.end();) {
+        it = sameCrop(*it, hash, lane, box) ? entries.erase(it) : std::next(it);
+    }
+    Entry entry;
+    entry.hash = hash;
+    entry.lane = lane;
+    entry.box = box;
+    entry.plate = plate;
+    entry.confidence = confidence;
+    entry.stored = now;
+    entry.refreshAt = now + std::chrono::milliseconds(config.refreshMs);
+    entries.push_front(entry);
+    while (static_cast<int>(entries.size()) > config.maxEntries) {
+        entries.pop_back();
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <QString>
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <mutex>
+
+struct PlateCacheConfig
+{
+    int ttlMs = 0;          // сколько ответ считается свежим; 0 - кэш выключен
+    int refreshMs = 2000;   // раз в столько совпавшая вырезка все равно идет на сервер
+    int maxDistance = 4;    // отличающихся бит хеша из 64, чтобы вырезки считались одной
+    double minOverlap = 0.5; // IoU рамок вырезок на кадре, ниже - другая машина
+    int maxEntries = 256;
+};
+
+// Кэш ответов OCR по вырезкам одной камеры. Ключ - перцептивный хеш вырезки
+// (pHash: знаки низких частот DCT уменьшенной серой копии), поэтому шум
+// сжатия, блики и сдвиг на пару пикселей его почти не меняют. Вырезка берет
+// готовый номер без запроса к серверу, только если она в той же полосе, ее
+// рамка на кадре перекрывается с сохраненной (IoU не меньше minOverlap) и хеш
+// отличается не больше чем на maxDistance бит - это стоящие у шлагбаума и
+// припаркованные машины. Вырезки номеров похожи между собой (белое поле,
+// знаки на тех же местах), поэтому одного хеша мало: следующая машина в
+// очереди могла бы получить номер предыдущей. По той же причине раз в
+// refreshMs совпавшая вырезка все равно уходит на сервер, и его ответ
+// заменяет запись. Ответ живет ttlMs с момента получения, вытеснение по
+// давности использования (LRU).
+class PlateResultCache
+{
+public:
+    explicit PlateResultCache(const PlateCacheConfig &config = PlateCacheConfig());
+
+    bool isEnabled() const { return config.ttlMs > 0 && config.maxEntries > 0; }
+
+    // 64-битный pHash; resize, cvtColor и dct векторизованы в OpenCV.
+    // Можно вызывать из нескольких потоков
+    static uint64_t hash(const cv::Mat &image);
+
+    // Вызовы из шага камеры и из потока результатов
+    bool lookup(uint64_t hash, int lane, const cv::Rect &box,
+                std::chrono::steady_clock::time_point now, QString &plate, double &confidence);
+    void store(uint64_t hash, int lane, const cv::Rect &box, const QString &plate,
+               double confidence, std::chrono::steady_clock::time_point now);
+
+    static int distance(uint64_t a, uint64_t b);
+    static double overlap(const cv::Rect &a, const cv::Rect &b);
+
+private:
+    struct Entry
+    {
+        uint64_t hash = 0;
+        int lane = 0;
+        cv::Rect box;
+        QString plate;
+        double confidence = 0.0;
+        std::chrono::steady_clock::time_point stored;
+        std::chrono::steady_clock::time_point refreshAt; // следующая сверка с сервером
+    };
+
+    bool sameCrop(const Entry &entry, uint64_t hash, int lane, const cv::Rect &box) const;
+
+    PlateCacheConfig config;
+
+    std::mutex mutex;
+    std::list<Entry> entries; // в начале - последние использованные
+};
@@ -0,0 +1,217 @@
+#include "plate_tracker.h"
+
+#include <QHash>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+PlateTracker::PlateTracker(int streamId, const PlateTrackerConfig &config)
+    : streamId(streamId)
+    , config(config)
+{
+    qRegisterMetaType<VehicleEvent>("VehicleEvent");
+}
+
+int PlateTracker::editDistance(const QString &a, const QString &b)
+{
+    std::vector<int> prev(b.size() + 1), cur(b.size() + 1);
+    for (int j = 0; j <= b.size(); ++j) {
+        prev[j] = j;
+    }
+    for (int i = 1; i <= a.size(); ++i) {
+        cur[0] = i;
+        for (int j = 1; j <= b.size(); ++j) {
+            const int substitution = prev[j - 1] + (a[i - 1] == b[j - 1] ? 0 : 1);
+            cur[j] = std::min({prev[j] + 1, cur[j - 1] + 1, substitution});
+        }
+        std::swap(prev, cur);
+    }
+    return prev[b.size()];
+}
+
+// Пустая рамка (ее нет у полного кадра) с любой рамкой считается рядом
+bool PlateTracker::isNear(const Track &track, const cv::Rect &box) const
+{
+    if (track.lastBox.empty() || box.empty()) {
+        return true;
+    }
+    const double dx = (box.x + box.width / 2.0) - (track.lastBox.x + track.lastBox.width / 2.0);
+    const double dy = (box.y + box.height / 2.0) - (track.lastBox.y + track.lastBox.height / 2.0);
+    const double limit = config.maxDistance * std::max(box.width, track.lastBox.width);
+    return std::hypot(dx, dy) <= limit;
+}
+
+// Сначала выбирается длина номера (по сумме уверенностей), затем каждый символ
+// голосованием прочтений этой длины. Уверенность итога - средний по позициям
+// вес победившего символа на одно прочтение трека: одно прочтение с 0.6 дает
+// 0.6, десять согласных с 0.9 - 0.9, разногласия ее снижают
+void PlateTracker::vote(Track &track) const
+{
+    std::map<int, double> lengthWeights;
+    for (const PlateObservation &observation : track.observations) {
+        lengthWeights[observation.text.size()] += observation.confidence;
+    }
+    int length = 0;
+    double lengthWeight = -1.0;
+    for (const auto &entry : lengthWeights) {
+        if (entry.second > lengthWeight) {
+            length = entry.first;
+            lengthWeight = entry.second;
+        }
+    }
+
+    QString consensus;
+    double support = 0.0;
+    for (int i = 0; i < length; ++i) {
+        QHash<QChar, double> weights;
+        for (const PlateObservation &observation : track.observations) {
+            if (observation.text.size() == length) {
+                weights[observation.text[i]] += observation.confidence;
+            }
+        }
+        QChar best;
+        double bestWeight = -1.0;
+        for (auto it = weights.begin(); it != weights.end(); ++it) {
+            if (it.value() > bestWeight) {
+                best = it.key();
+                bestWeight = it.value();
+            }
+        }
+        consensus += best;
+        support += bestWeight;
+    }
+
+    track.consensus = consensus;
+    track.consensusConfidence =
+        length > 0 ? support / length / static_cast<double>(track.observations.size()) : 0.0;
+}
+
+VehicleEvent PlateTracker::close(const Track &track) const
+{
+    VehicleEvent event;
+    event.streamId = streamId;
+    event.plate = track.consensus;
+    event.confidence = track.consensusConfidence;
+    event.observations = track.totalObservations;
+    event.bestFrameId = track.best.frameId;
+    event.bestBox = track.best.box;
+    event.lane = track.best.lane;
+    event.bestCrop = track.best.crop;
+    event.firstSeen = track.firstSeen;
+    event.lastSeen = track.lastSeen;
+    return event;
+}
+
+void PlateTracker::expireLocked(std::chrono::steady_clock::time_point now,
+                                std::vector<VehicleEvent> &events)
+{
+    const std::chrono::milliseconds maxGap(config.maxGapMs);
+    const std::chrono::milliseconds maxTrack(config.maxTrackMs);
+    for (auto it = tracks.begin(); it != tracks.end();) {
+        if (now - it->lastSeen > maxGap || now - it->firstSeen > maxTrack) {
+            events.push_back(close(*it));
+            it = tracks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+std::vector<VehicleEvent> PlateTracker::add(const PlateObservation &observation)
+{
+    std::vector<VehicleEvent> events;
+    std::lock_guard<std::mutex> lock(mutex);
+    expireLocked(std::chrono::steady_clock::now(), events);
+
+    if (observation.text.isEmpty()) {
+        return events;
+    }
+
+    // Ближайший по тексту трек рядом с вырезкой
+    Track *track = nullptr;
+    int bestDistance = config.maxEditDistance + 1;
+    for (Track &candidate : tracks) {
+        if (!isNear(candidate, observation.box)) {
+            continue;
+        }
+        const int distance = editDistance(observation.text, candidate.consensus);
+        if (distance < bestDistance) {
+            bestDistance = distance;
+            track = &candidate;
+        }
+    }
+    if (!track) {
+        tracks.emplace_back();
+        track = &tracks.back();
+        track->firstSeen = observation.time;
+        track->lastSeen = observation.time;
+    }
+
+    // Картинки в голосовании не нужны, хранится только лучшая
+    PlateObservation stored = observation;
+    stored.crop.release();
+    track->observations.push_back(stored);
+    if (static_cast<int>(track->observations.size()) > std::max(1, config.maxObservations)) {
+        track->observations.erase(track->observations.begin());
+    }
+    track->totalObservations++;
+
+    // Ответы приходят не по порядку кадров
+    track->firstSeen = std::min(track->firstSeen, observation.time);
+    if (observation.time >= track->lastSeen) {
+        track->lastSeen = observation.time;
+        track->lastBox = observation.box;
+    }
+
+    vote(*track);
+
+    // Лучшая вырезка - самая уверенная среди прочтений, совпавших с итогом
+    const bool matches = observation.text == track->consensus;
+    const bool bestMatches = track->best.text == track->consensus;
+    if (track->best.text.isEmpty() || (matches && !bestMatches)
+        || (matches == bestMatches && observation.confidence > track->best.confidence)) {
+        track->best = observation;
+        track->best.crop = observation.crop.clone();
+    }
+    return events;
+}
+
+std::vector<VehicleEvent> PlateTracker::expire(std::chrono::steady_clock::time_point now)
+{
+    std::vector<VehicleEvent> events;
+    std::lock_guard<std::mutex> lock(mutex);
+    expireLocked(now, events);
+    return events;
+}
+
+std::vector<VehicleEvent> PlateTracker::flush()
+{
+    std::vector<VehicleEvent> events;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const Track &track : tracks) {
+        events.push_back(close(track));
+    }
+    tracks.clear();
+    return events;
+}
+
+bool PlateTracker::isSettled(const cv::Rect &box, std::chrono::steady_clock::time_point time)
+{
+    if (config.settleObservations <= 0) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Track &track : tracks) {
+        if (track.totalObservations >= config.settleObservations
+            && track.consensusConfidence >= config.settleConfidence && isNear(track, box)) {
+            if (time >= track.lastSeen) {
+                track.lastSeen = time;
+                track.lastBox = box;
+            }
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+#include <QMetaType>
+#include <QString>
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct PlateTrackerConfig
+{
+    int maxGapMs = 2500;        // трек закрывается, если номер столько не виден (больше срока OCR)
+    int maxTrackMs = 60000;     // стоящая машина отчитывается не реже раза в минуту
+    double maxDistance = 1.5;   // сдвиг центра вырезки, в ширинах вырезки
+    int maxEditDistance = 2;    // отличие прочтения от текущего итога трека
+    int settleObservations = 0; // после стольких согласных прочтений OCR по треку не нужен; 0 - всегда OCR
+    double settleConfidence = 0.8;
+    int maxObservations = 32;   // прочтений в голосовании, старые вытесняются
+};
+
+// Одно прочтение номера
+struct PlateObservation
+{
+    QString text;
+    double confidence = 0.0;
+    cv::Rect box; // в координатах кадра
+    int lane = 0;
+    uint64_t frameId = 0;
+    std::chrono::steady_clock::time_point time; // время захвата кадра
+    cv::Mat crop; // может быть пустой (полный кадр на сервер)
+};
+
+// Итог по одной машине
+struct VehicleEvent
+{
+    int streamId = -1;
+    QString plate;
+    double confidence = 0.0;
+    int observations = 0;
+    uint64_t bestFrameId = 0;
+    int lane = 0; // полоса лучшего прочтения
+    cv::Rect bestBox;
+    cv::Mat bestCrop;
+    std::chrono::steady_clock::time_point firstSeen;
+    std::chrono::steady_clock::time_point lastSeen;
+};
+
+Q_DECLARE_METATYPE(VehicleEvent)
+
+// Сборка прочтений одной камеры в машины. Прочтение присоединяется к
+// открытому треку, если вырезка рядом с последней вырезкой трека и текст
+// отличается от итога трека не больше чем на maxEditDistance правок. Итог
+// трека - посимвольное голосование с весами-уверенностями среди прочтений
+// самой популярной длины. Закрытые треки отдает expire(). Потокобезопасен.
+class PlateTracker
+{
+public:
+    explicit PlateTracker(int streamId, const PlateTrackerConfig &config = PlateTrackerConfig());
+
+    // Пустые прочтения не учитываются; возвращает закрытые к этому моменту треки
+    std::vector<VehicleEvent> add(const PlateObservation &observation);
+
+    // Треки, которые не обновлялись дольше maxGapMs или живут дольше maxTrackMs
+    std::vector<VehicleEvent> expire(std::chrono::steady_clock::time_point now);
+
+    // Закрыть все треки (остановка камеры)
+    std::vector<VehicleEvent> flush();
+
+    // Вырезка попадает в трек с уверенным итогом: OCR можно не делать.
+    // Трек при этом считается видимым в момент time
+    bool isSettled(const cv::Rect &box, std::chrono::steady_clock::time_point time);
+
+    static int editDistance(const QString &a, const QString &b);
+
+private:
+    struct Track
+    {
+        std::vector<PlateObservation> observations;
+        int totalObservations = 0;
+        QString consensus;
+        double consensusConfidence = 0.0;
+        PlateObservation best; // crop - своя копия
+        cv::Rect lastBox;
+        std::chrono::steady_clock::time_point firstSeen;
+        std::chrono::steady_clock::time_point lastSeen;
+    };
+
+    bool isNear(const Track &track, const cv::Rect &box) const;
+    void vote(Track &track) const;
+    VehicleEvent close(const Track &track) const;
+    void expireLocked(std::chrono::steady_clock::time_point now,
+                      std::vector<VehicleEvent> &events);
+
+    int streamId;
+    PlateTrackerConfig config;
+
+    std::mutex mutex;
+    std::vector<Track> tracks;
+};
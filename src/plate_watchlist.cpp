@@ -0,0 +1,414 @@
+#include "plate_watchlist.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static const char kAlphabet[] = "0123456789ABCEHKMOPTXY"; // как у CRNN, код символа - индекс + 1
+static const int kAlphabetSize = 22;
+static const int kEditCost = 2; // в полуправках
+static const int kConfusionCost = 1;
+
+// Индекс одной версии файлов. Ключи перемешаны, поэтому корзины по старшим
+// битам заполнены ровно, в среднем по 2-4 ключа
+struct PlateWatchlist::Index
+{
+    std::vector<uint64_t> keys;    // по возрастанию; номер в нескольких списках - подряд
+    std::vector<uint16_t> lists;   // список каждого ключа
+    std::vector<uint32_t> buckets; // начало корзины; последний элемент - keys.size()
+    int shift = 63;
+    QStringList listNames;
+};
+
+static inline void prefetch(const void *address)
+{
+#if defined(__GNUC__)
+    __builtin_prefetch(address);
+#else
+    (void)address;
+#endif
+}
+
+static uint8_t asciiCode(char c)
+{
+    if (c >= 'a' && c <= 'z') {
+        c = static_cast<char>(c - 'a' + 'A');
+    }
+    const char *found = c ? std::strchr(kAlphabet, c) : nullptr;
+    return found ? static_cast<uint8_t>(found - kAlphabet + 1) : 0;
+}
+
+// Кириллица, похожая на латиницу номеров, от А (U+0410) до Х (U+0425)
+static uint8_t cyrillicCode(uint32_t codePoint)
+{
+    static const char kLatin[] = "A\0B\0\0E\0\0\0\0K\0MHO\0PCTY\0X";
+    if (codePoint >= 0x430 && codePoint <= 0x44F) {
+        codePoint -= 0x20;
+    }
+    if (codePoint < 0x410 || codePoint > 0x425) {
+        return 0;
+    }
+    return asciiCode(kLatin[codePoint - 0x410]);
+}
+
+PlateWatchlist::PlateWatchlist(const WatchlistConfig &config)
+    : config(config)
+    , maxCost(static_cast<int>(std::lround(config.maxDistance * kEditCost)))
+{
+    qRegisterMetaType<WatchlistHit>("WatchlistHit");
+
+    for (int a = 0; a < 32; ++a) {
+        for (int b = 0; b < 32; ++b) {
+            substitution[a][b] = a == b ? 0 : kEditCost;
+        }
+    }
+    for (const QString &pair : config.confusions.split(',')) {
+        const QByteArray chars = pair.trimmed().toLatin1();
+        const uint8_t a = chars.size() == 2 ? asciiCode(chars[0]) : 0;
+        const uint8_t b = chars.size() == 2 ? asciiCode(chars[1]) : 0;
+        if (a && b && a != b && substitution[a][b] != kConfusionCost) {
+            substitution[a][b] = kConfusionCost;
+            substitution[b][a] = kConfusionCost;
+            confusable[a].push_back(b);
+            confusable[b].push_back(a);
+        }
+    }
+}
+
+bool PlateWatchlist::encode(const char *text, size_t size, uint64_t &packed, int &length)
+{
+    packed = 0;
+    length = 0;
+    for (size_t i = 0; i < size; ++i) {
+        const unsigned char c = static_cast<unsigned char>(text[i]);
+        uint8_t code = 0;
+        if (c == ' ' || c == '-') {
+            continue;
+        } else if (c < 0x80) {
+            code = asciiCode(static_cast<char>(c));
+        } else if ((c & 0xE0) == 0xC0 && i + 1 < size) {
+            const unsigned char next = static_cast<unsigned char>(text[++i]);
+            code = cyrillicCode(((c & 0x1Fu) << 6) | (next & 0x3Fu));
+        }
+        if (code == 0 || length == kMaxLength) {
+            return false;
+        }
+        packed |= static_cast<uint64_t>(code) << (5 * length++);
+    }
+    return length > 0;
+}
+
+QString PlateWatchlist::unpack(uint64_t packed)
+{
+    QString plate;
+    for (; packed; packed >>= 5) {
+        plate += QChar(kAlphabet[(packed & 31) - 1]);
+    }
+    return plate;
+}
+
+// Финальное перемешивание splitmix64: обратимо, разные номера - разные ключи
+uint64_t PlateWatchlist::mix(uint64_t packed)
+{
+    packed ^= packed >> 30;
+    packed *= 0xbf58476d1ce4e5b9ULL;
+    packed ^= packed >> 27;
+    packed *= 0x94d049bb133111ebULL;
+    packed ^= packed >> 31;
+    return packed;
+}
+
+bool PlateWatchlist::normalize(const QString &plate, QString &normalized)
+{
+    const QByteArray utf8 = plate.toUtf8();
+    uint64_t packed;
+    int length;
+    if (!encode(utf8.constData(), utf8.size(), packed, length)) {
+        return false;
+    }
+    normalized = unpack(packed);
+    return true;
+}
+
+bool PlateWatchlist::load(QString &error)
+{
+    std::lock_guard<std::mutex> lock(reloadMutex);
+    return loadFiles(error);
+}
+
+bool PlateWatchlist::reloadIfChanged(QString &error)
+{
+    std::unique_lock<std::mutex> lock(reloadMutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return false;
+    }
+    bool changed = stamps.size() != static_cast<size_t>(config.files.size());
+    for (int i = 0; !changed && i < config.files.size(); ++i) {
+        const QFileInfo info(config.files[i]);
+        changed = stamps[i] != std::make_pair(info.lastModified(), info.size());
+    }
+    return changed && loadFiles(error);
+}
+
+// Строка файла: номер, за ним через ';', ',' или табуляцию имя списка (без
+// него - имя файла). Пробелы и дефисы внутри номера пропускаются, '#' - комментарий
+bool PlateWatchlist::loadFiles(QString &error)
+{
+    std::vector<std::pair<uint64_t, uint16_t>> entries;
+    std::vector<std::pair<QDateTime, qint64>> newStamps;
+    QStringList listNames;
+    QHash<QString, int> listIds;
+    size_t badLines = 0;
+
+    for (const QString &path : config.files) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            error = QString("Cannot open watchlist %1").arg(path);
+            return false;
+        }
+        const QFileInfo info(path);
+        newStamps.emplace_back(info.lastModified(), info.size());
+        const QByteArray data = file.readAll();
+        entries.reserve(entries.size() + data.size() / 10);
+
+        // Имя списка обычно одно на много строк подряд - строка разбирается один раз
+        QByteArray lastName;
+        int lastId = -1;
+        auto listId = [&](const QByteArray &name) {
+            if (lastId >= 0 && name == lastName) {
+                return lastId;
+            }
+            const QString text = name.isEmpty() ? info.completeBaseName()
+                                                 : QString::fromUtf8(name).trimmed();
+            auto it = listIds.find(text);
+            if (it == listIds.end()) {
+                if (listNames.size() > 0xFFFF) {
+                    return -1;
+                }
+                it = listIds.insert(text, listNames.size());
+                listNames << text;
+            }
+            lastName = name;
+            lastId = it.value();
+            return lastId;
+        };
+
+        const char *p = data.constData();
+        const char *end = p + data.size();
+        while (p < end) {
+            const char *eol = static_cast<const char *>(std::memchr(p, '\n', end - p));
+            if (!eol) {
+                eol = end;
+            }
+            const char *lineEnd = eol > p && eol[-1] == '\r' ? eol - 1 : eol;
+            const char *line = p;
+            p = eol + 1;
+            while (line < lineEnd && (*line == ' ' || *line == '\t')) {
+                ++line;
+            }
+            if (line == lineEnd || *line == '#') {
+                continue;
+            }
+
+            const char *separator = line;
+            while (separator < lineEnd && *separator != ';' && *separator != ','
+                   && *separator != '\t') {
+                ++separator;
+            }
+            uint64_t packed;
+            int length;
+            const int id = listId(separator < lineEnd
+                                      ? QByteArray(separator + 1, lineEnd - separator - 1)
+                                      : QByteArray());
+            if (id < 0 || !encode(line, separator - line, packed, length)) {
+                ++badLines;
+                continue;
+            }
+            entries.emplace_back(mix(packed), static_cast<uint16_t>(id));
+        }
+    }
+
+    std::sort(entries.begin(), entries.end());
+    entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+
+    auto next = std::make_shared<Index>();
+    int bits = 1;
+    while (bits < 28 && (size_t(1) << (bits + 2)) <= entries.size()) {
+        ++bits;
+    }
+    next->shift = 64 - bits;
+    next->buckets.assign((size_t(1) << bits) + 1, 0);
+    next->keys.reserve(entries.size());
+    next->lists.reserve(entries.size());
+    for (const auto &entry : entries) {
+        next->buckets[(entry.first >> next->shift) + 1]++;
+        next->keys.push_back(entry.first);
+        next->lists.push_back(entry.second);
+    }
+    for (size_t i = 1; i < next->buckets.size(); ++i) {
+        next->buckets[i] += next->buckets[i - 1];
+    }
+    next->listNames = listNames;
+
+    std::atomic_store(&index, std::shared_ptr<const Index>(std::move(next)));
+    stamps = std::move(newStamps);
+    skipped.store(badLines, std::memory_order_relaxed);
+    return true;
+}
+
+// Все варианты прочтения с ценой не больше maxCost. Правки идут слева
+// направо (from), так что один набор правок обычно получается один раз;
+// повторы отсеиваются по найденным ключам. Символы правятся прямо в
+// упакованном ключе сдвигами
+void PlateWatchlist::expand(uint64_t packed, int length, int from, int cost,
+                            std::vector<Candidate> &out) const
+{
+    out.push_back({packed, 0, 0, cost});
+    const int left = maxCost - cost;
+    if (left <= 0) {
+        return;
+    }
+
+    // Последняя правка бюджета - сразу в список, без рекурсии: это почти все варианты
+    auto next = [&](uint64_t variant, int variantLength, int variantFrom, int step) {
+        if (step == left) {
+            out.push_back({variant, 0, 0, cost + step});
+        } else {
+            expand(variant, variantLength, variantFrom, cost + step, out);
+        }
+    };
+
+    for (int i = from; i < length; ++i) {
+        const int shift = 5 * i;
+        const uint64_t low = packed & ((uint64_t(1) << shift) - 1);
+        const uint64_t high = packed >> (shift + 5);
+        const unsigned original = (packed >> shift) & 31;
+        if (left >= kEditCost) {
+            for (unsigned code = 1; code <= kAlphabetSize; ++code) {
+                if (code != original) {
+                    next(low | uint64_t(code) << shift | high << (shift + 5), length, i + 1,
+                         substitution[original][code]);
+                }
+            }
+        } else {
+            // Остаток бюджета меньше правки - только путаница
+            for (const uint8_t code : confusable[original]) {
+                next(low | uint64_t(code) << shift | high << (shift + 5), length, i + 1,
+                     kConfusionCost);
+            }
+        }
+        // Лишний символ в прочтении
+        if (kEditCost <= left && length > 1) {
+            next(low | high << shift, length - 1, i, kEditCost);
+        }
+    }
+
+    // Пропущенный символ
+    if (kEditCost <= left && length < kMaxLength) {
+        for (int i = from; i <= length; ++i) {
+            const int shift = 5 * i;
+            const uint64_t low = packed & ((uint64_t(1) << shift) - 1);
+            const uint64_t high = packed >> shift;
+            for (unsigned code = 1; code <= kAlphabetSize; ++code) {
+                next(low | uint64_t(code) << shift | high << (shift + 5), length + 1, i + 1,
+                     kEditCost);
+            }
+        }
+    }
+}
+
+std::vector<WatchlistHit> PlateWatchlist::match(const QString &plate) const
+{
+    std::vector<WatchlistHit> hits;
+    const std::shared_ptr<const Index> current = std::atomic_load(&index);
+    const QByteArray utf8 = plate.toUtf8();
+    uint64_t packed;
+    int length;
+    if (!current || current->keys.empty()
+        || !encode(utf8.constData(), utf8.size(), packed, length)) {
+        return hits;
+    }
+
+    thread_local std::vector<Candidate> candidates;
+    candidates.clear();
+    expand(packed, length, 0, 0, candidates);
+
+    // Три прохода вместо одного: сначала запрашиваются все корзины, потом все
+    // первые ключи корзин, и промахи кэша сотен вариантов идут параллельно
+    const Index &idx = *current;
+    for (Candidate &candidate : candidates) {
+        candidate.key = mix(candidate.packed);
+        prefetch(&idx.buckets[candidate.key >> idx.shift]);
+    }
+    for (Candidate &candidate : candidates) {
+        candidate.begin = idx.buckets[candidate.key >> idx.shift];
+        prefetch(&idx.keys[std::min<size_t>(candidate.begin, idx.keys.size() - 1)]);
+    }
+
+    struct Found
+    {
+        uint32_t position;
+        int cost;
+        uint64_t packed;
+    };
+    thread_local std::vector<Found> found;
+    found.clear();
+    for (const Candidate &candidate : candidates) {
+        const uint32_t end = idx.buckets[(candidate.key >> idx.shift) + 1];
+        for (uint32_t i = candidate.begin; i < end && idx.keys[i] <= candidate.key; ++i) {
+            if (idx.keys[i] == candidate.key) {
+                found.push_back({i, candidate.cost, candidate.packed});
+            }
+        }
+    }
+
+    // Каждая запись списка один раз, с наименьшей ценой
+    std::sort(found.begin(), found.end(), [](const Found &a, const Found &b) {
+        return a.position != b.position ? a.position < b.position : a.cost < b.cost;
+    });
+    auto samePosition = [](const Found &a, const Found &b) { return a.position == b.position; };
+    found.erase(std::unique(found.begin(), found.end(), samePosition), found.end());
+    std::stable_sort(found.begin(), found.end(),
+                     [](const Found &a, const Found &b) { return a.cost < b.cost; });
+
+    const size_t count = std::min(found.size(), static_cast<size_t>(std::max(1, config.maxHits)));
+    for (size_t i = 0; i < count; ++i) {
+        WatchlistHit hit;
+        hit.plate = unpack(found[i].packed);
+        hit.list = idx.listNames[idx.lists[found[i].position]];
+        hit.distance = found[i].cost / static_cast<double>(kEditCost);
+        hits.push_back(hit);
+    }
+    return hits;
+}
+
+bool PlateWatchlist::contains(const QString &plate) const
+{
+    const std::shared_ptr<const Index> current = std::atomic_load(&index);
+    const QByteArray utf8 = plate.toUtf8();
+    uint64_t packed;
+    int length;
+    if (!current || !encode(utf8.constData(), utf8.size(), packed, length)) {
+        return false;
+    }
+    const uint64_t key = mix(packed);
+    const size_t bucket = key >> current->shift;
+    return std::binary_search(current->keys.begin() + current->buckets[bucket],
+                              current->keys.begin() + current->buckets[bucket + 1], key);
+}
+
+size_t PlateWatchlist::size() const
+{
+    const std::shared_ptr<const Index> current = std::atomic_load(&index);
+    return current ? current->keys.size() : 0;
+}
+
+int PlateWatchlist::listCount() const
+{
+    const std::shared_ptr<const Index> current = std::atomic_load(&index);
+    return current ? current->listNames.size() : 0;
+}
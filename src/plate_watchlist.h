@@ -0,0 +1,106 @@
+#pragma once
+
+#include <QDateTime>
+#include <QMetaType>
+#include <QString>
+#include <QStringList>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct WatchlistConfig
+{
+    QStringList files;        // списки номеров; пусто - проверки нет
+    double maxDistance = 1.0; // правок до номера из списка (0 - только точное совпадение)
+    // Пары символов, которые CRNN путает; такая замена стоит половину правки
+    QString confusions = "0O,0C,OC,8B,4A,7T,1T,HK,KX";
+    int reloadMs = 5000; // проверка изменений файлов; 0 - не перечитывать
+    int maxHits = 8;
+};
+
+struct WatchlistHit
+{
+    QString plate; // номер из списка
+    QString list;  // имя списка: колонка файла или имя файла
+    double distance = 0.0;
+};
+
+Q_DECLARE_METATYPE(WatchlistHit)
+
+// Проверка прочитанных номеров по спискам (угон, пропуска) на миллионы
+// номеров. Номер в алфавите CRNN (0123456789ABCEHKMOPTXY, кириллица в файлах
+// приводится к латинице) упаковывается по 5 бит на символ в 64-битный ключ и
+// перемешивается обратимой функцией; индекс - отсортированный массив ключей и
+// таблица начала корзин по старшим битам, около 12 байт на номер, поиск
+// ключа - одна-две строки кэша.
+//
+// Нечеткий поиск перебирает соседей прочтения в пределах maxDistance:
+// замены (путаница вида O/0, B/8 - полправки, остальные - правка), пропуски
+// и лишние символы. При расстоянии 1 это около 400 ключей на номер из 9
+// символов; их корзины запрашиваются из памяти заранее, пачкой, поэтому
+// проверка занимает микросекунды и от размера списка почти не зависит.
+//
+// Индекс неизменяем и публикуется целиком через shared_ptr: перечитанные
+// файлы собираются в новый индекс в фоне и подменяют указатель, проверки
+// не ждут и дорабатывают со старым.
+class PlateWatchlist
+{
+public:
+    explicit PlateWatchlist(const WatchlistConfig &config);
+
+    const WatchlistConfig &watchlistConfig() const { return config; }
+
+    // Читает файлы и подменяет индекс; при ошибке остается прежний
+    bool load(QString &error);
+    // load, если у файлов сменились время изменения или размер; false - не менялись
+    // или уже перечитываются в другом потоке
+    bool reloadIfChanged(QString &error);
+
+    // Можно вызывать из любого потока. Сначала ближайшие, не больше maxHits
+    std::vector<WatchlistHit> match(const QString &plate) const;
+    bool contains(const QString &plate) const;
+
+    size_t size() const;
+    int listCount() const;
+    size_t skippedLines() const { return skipped.load(std::memory_order_relaxed); }
+
+    // Номер в алфавите CRNN: верхний регистр, кириллица латиницей, без пробелов и дефисов
+    static bool normalize(const QString &plate, QString &normalized);
+
+    static constexpr int kMaxLength = 12;
+
+private:
+    struct Index;
+    struct Candidate
+    {
+        uint64_t packed;
+        uint64_t key;
+        uint32_t begin;
+        int cost;
+    };
+
+    // Символ i - биты 5i..5i+4, код 1..22; ноль - конец номера
+    static bool encode(const char *text, size_t size, uint64_t &packed, int &length);
+    static QString unpack(uint64_t packed);
+    static uint64_t mix(uint64_t packed);
+
+    bool loadFiles(QString &error);
+
+    void expand(uint64_t packed, int length, int from, int cost,
+                std::vector<Candidate> &out) const;
+
+    WatchlistConfig config;
+    int maxCost; // в полуправках
+    uint8_t substitution[32][32];
+    std::vector<uint8_t> confusable[32]; // коды с заменой за полправки
+
+    std::shared_ptr<const Index> index; // std::atomic_load / std::atomic_store
+
+    // Перечитывание: один поток за раз
+    std::mutex reloadMutex;
+    std::vector<std::pair<QDateTime, qint64>> stamps;
+    std::atomic<size_t> skipped{0};
+};
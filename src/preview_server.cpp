@@ -0,0 +1,158 @@
+#include "preview_server.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+// Клиент, у которого в очереди на отправку столько байт, кадр пропускает
+static const qint64 kMaxPendingBytes = 2 * 1024 * 1024;
+
+PreviewServer::PreviewServer(StreamEngine *engine, int fps, QObject *parent)
+    : QObject(parent)
+    , engine(engine)
+    , fps(std::max(1, fps))
+{
+    connect(&server, &QTcpServer::newConnection, this, &PreviewServer::onNewConnection);
+    connect(&timer, &QTimer::timeout, this, &PreviewServer::onTimer);
+}
+
+PreviewServer::~PreviewServer()
+{
+    timer.stop();
+    for (auto it = clients.begin(); it != clients.end(); ++it) {
+        if (it.value() >= 0) {
+            engine->stream(it.value())->detachPreview();
+        }
+    }
+    clients.clear();
+}
+
+bool PreviewServer::listen(const QString &host, quint16 port)
+{
+    if (!server.listen(QHostAddress(host), port)) {
+        std::cerr << "Preview server: cannot listen on " << host.toStdString() << ":" << port
+                  << ": " << server.errorString().toStdString() << std::endl;
+        return false;
+    }
+    std::cout << "Preview server: http://" << host.toStdString() << ":" << port
+              << "/preview/<camera id>" << std::endl;
+    return true;
+}
+
+int PreviewServer::streamIndex(int streamId) const
+{
+    for (int i = 0; i < engine->streamCount(); ++i) {
+        if (engine->stream(i)->streamId() == streamId) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void PreviewServer::onNewConnection()
+{
+    while (QTcpSocket *socket = server.nextPendingConnection()) {
+        clients.insert(socket, -1);
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() { removeClient(socket); });
+    }
+}
+
+void PreviewServer::onReadyRead(QTcpSocket *socket)
+{
+    // Нужна только строка запроса; заголовки и повторные запросы не читаем
+    if (clients.value(socket, -1) >= 0 || !socket->canReadLine()) {
+        socket->readAll();
+        return;
+    }
+
+    const QList<QByteArray> request = socket->readLine().trimmed().split(' ');
+    const QString path = request.size() >= 2 ? QString::fromLatin1(request[1]) : QString();
+
+    if (path == "/") {
+        QByteArray body;
+        for (int i = 0; i < engine->streamCount(); ++i) {
+            const StreamConfig &config = engine->stream(i)->streamConfig();
+            body += QString("/preview/%1 %2\n").arg(config.id).arg(config.url).toUtf8();
+        }
+        socket->write("HTTP/1.0 200 OK\r\nContent-Type: text/plain\r\nContent-Length: "
+                      + QByteArray::number(body.size()) + "\r\n\r\n" + body);
+        socket->disconnectFromHost();
+        return;
+    }
+
+    bool ok = false;
+    const int index =
+        path.startsWith("/preview/") ? streamIndex(path.mid(9).toInt(&ok)) : -1;
+    if (!ok || index < 0) {
+        socket->write("HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+        socket->disconnectFromHost();
+        return;
+    }
+
+    socket->write("HTTP/1.0 200 OK\r\nCache-Control: no-cache\r\n"
+                  "Content-Type: multipart/x-mixed-replace; boundary=frame\r\n\r\n");
+    clients[socket] = index;
+    engine->stream(index)->attachPreview();
+    if (!timer.isActive()) {
+        timer.start(1000 / fps);
+    }
+}
+
+void PreviewServer::removeClient(QTcpSocket *socket)
+{
+    auto it = clients.find(socket);
+    if (it == clients.end()) {
+        return;
+    }
+    if (it.value() >= 0) {
+        engine->stream(it.value())->detachPreview();
+    }
+    clients.erase(it);
+    socket->deleteLater();
+
+    bool streaming = false;
+    for (int index : clients) {
+        streaming = streaming || index >= 0;
+    }
+    if (!streaming) {
+        timer.stop();
+    }
+}
+
+void PreviewServer::onTimer()
+{
+    // Каждая камера кодируется один раз на всех своих зрителей
+    QHash<int, QByteArray> parts;
+    std::vector<uchar> buffer;
+    for (auto it = clients.begin(); it != clients.end(); ++it) {
+        const int index = it.value();
+        QTcpSocket *socket = it.key();
+        if (index < 0 || socket->bytesToWrite() > kMaxPendingBytes) {
+            continue;
+        }
+
+        if (!parts.contains(index)) {
+            cv::Mat frame;
+            QByteArray part;
+            const auto start = std::chrono::steady_clock::now();
+            if (engine->stream(index)->previewSnapshot(frame)
+                && cv::imencode(".jpg", frame, buffer, {cv::IMWRITE_JPEG_QUALITY, 70})) {
+                part = "--frame\r\nContent-Type: image/jpeg\r\nContent-Length: "
+                       + QByteArray::number(static_cast<int>(buffer.size())) + "\r\n\r\n";
+                part.append(reinterpret_cast<const char *>(buffer.data()),
+                            static_cast<int>(buffer.size()));
+                part += "\r\n";
+                engine->stream(index)->stats().previewTime.record(
+                    std::chrono::steady_clock::now() - start);
+            }
+            parts.insert(index, part);
+        }
+
+        const QByteArray &part = parts[index];
+        if (!part.isEmpty()) {
+            socket->write(part);
+        }
+    }
+}
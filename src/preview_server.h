@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+#include "stream_engine.h"
+
+// Просмотр камер работающего процесса, в том числе headless: MJPEG по HTTP,
+// открывается в браузере или VLC.
+//   GET /             - список камер
+//   GET /preview/<id> - multipart/x-mixed-replace с кадрами камеры id
+// Кадры берутся и кодируются не чаще fps раз в секунду и только для камер,
+// у которых есть зрители; медленным клиентам кадры пропускаются.
+class PreviewServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PreviewServer(StreamEngine *engine, int fps = 5, QObject *parent = nullptr);
+    ~PreviewServer();
+
+    // host - адрес интерфейса: 127.0.0.1 - только локально, 0.0.0.0 - все
+    bool listen(const QString &host, quint16 port);
+
+private slots:
+    void onNewConnection();
+    void onTimer();
+
+private:
+    void onReadyRead(QTcpSocket *socket);
+    void removeClient(QTcpSocket *socket);
+    int streamIndex(int streamId) const;
+
+    StreamEngine *engine;
+    int fps;
+    QTcpServer server;
+    QTimer timer;
+
+    // Сокет -> индекс камеры; -1, пока клиент не прислал запрос
+    QHash<QTcpSocket *, int> clients;
+};
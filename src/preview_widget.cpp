@@ -0,0 +1,216 @@
+#include "preview_widget.h"
+
+#include <opencv2/imgproc.hpp>
+
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPolygonF>
+
+#include <algorithm>
+
+PreviewWidget::PreviewWidget(int fps, QWidget *parent)
+    : QWidget(parent)
+    , fps(std::max(1, fps))
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setMinimumSize(320, 180);
+    connect(&timer, &QTimer::timeout, this, &PreviewWidget::onTimer);
+}
+
+PreviewWidget::~PreviewWidget()
+{
+    setRecognizer(nullptr);
+}
+
+void PreviewWidget::setRecognizer(NumberPlateRecognizer *newRecognizer)
+{
+    if (attached) {
+        recognizer->detachPreview();
+        attached = false;
+    }
+    recognizer = newRecognizer;
+    decoded.release();
+    image = QImage();
+    frameSize = cv::Size();
+    overlay = NumberPlateRecognizer::PreviewOverlay();
+    framePending = false;
+    updateViewer(isVisible());
+    update();
+}
+
+// Зритель подключен, только пока виджет виден: иначе камера не хранит кадры
+// для просмотра, а таймер стоит
+void PreviewWidget::updateViewer(bool shown)
+{
+    const bool visible = shown && recognizer && !window()->isMinimized();
+    if (visible && !attached) {
+        recognizer->attachPreview();
+        attached = true;
+    } else if (!visible && attached) {
+        recognizer->detachPreview();
+        attached = false;
+        decoded.release();
+    }
+    if (visible && !timer.isActive()) {
+        timer.start(1000 / fps);
+    } else if (!visible) {
+        timer.stop();
+    }
+}
+
+void PreviewWidget::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    updateViewer(true);
+}
+
+void PreviewWidget::hideEvent(QHideEvent *event)
+{
+    QWidget::hideEvent(event);
+    updateViewer(false);
+}
+
+void PreviewWidget::onTimer()
+{
+    // Свернутое окно скрытия виджета может и не прислать
+    updateViewer(isVisible());
+    if (!attached) {
+        return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    // Кадр вписывается в виджет с сохранением пропорций; пока размер кадра
+    // неизвестен, декодируем не меньше самого виджета
+    cv::Size fitted(width(), height());
+    if (frameSize.width > 0 && frameSize.height > 0) {
+        const double scale = std::min(static_cast<double>(width()) / frameSize.width,
+                                      static_cast<double>(height()) / frameSize.height);
+        fitted = cv::Size(std::max(1, static_cast<int>(frameSize.width * scale)),
+                          std::max(1, static_cast<int>(frameSize.height * scale)));
+    }
+    if (!recognizer->previewImage(fitted, decoded, frameSize) || decoded.empty()
+        || frameSize.width <= 0 || frameSize.height <= 0) {
+        return;
+    }
+    const double scale = std::min(static_cast<double>(width()) / frameSize.width,
+                                  static_cast<double>(height()) / frameSize.height);
+    fitted = cv::Size(std::max(1, static_cast<int>(frameSize.width * scale)),
+                      std::max(1, static_cast<int>(frameSize.height * scale)));
+    target = QRect((width() - fitted.width) / 2, (height() - fitted.height) / 2, fitted.width,
+                   fitted.height);
+
+    // Уменьшение и перевод в RGB пишут прямо в буфер QImage, без промежуточных кадров
+    if (image.width() != fitted.width || image.height() != fitted.height) {
+        image = QImage(fitted.width, fitted.height, QImage::Format_RGB888);
+    }
+    cv::Mat rgb(image.height(), image.width(), CV_8UC3, image.bits(),
+                static_cast<size_t>(image.bytesPerLine()));
+    if (decoded.size() == fitted) {
+        cv::cvtColor(decoded, rgb, cv::COLOR_BGR2RGB);
+    } else {
+        cv::resize(decoded, rgb, fitted, 0, 0, cv::INTER_AREA);
+        cv::cvtColor(rgb, rgb, cv::COLOR_BGR2RGB);
+    }
+
+    overlay = recognizer->previewOverlay();
+    frameTime = std::chrono::steady_clock::now() - start;
+    framePending = true;
+    update();
+}
+
+void PreviewWidget::paintEvent(QPaintEvent *)
+{
+    const auto start = std::chrono::steady_clock::now();
+    QPainter painter(this);
+    painter.fillRect(rect(), Qt::black);
+    if (image.isNull() || frameSize.width <= 0 || frameSize.height <= 0) {
+        return;
+    }
+    painter.drawImage(target.topLeft(), image);
+
+    // Разметка в координатах кадра камеры
+    const double sx = static_cast<double>(target.width()) / frameSize.width;
+    const double sy = static_cast<double>(target.height()) / frameSize.height;
+    auto map = [&](const cv::Point &point) {
+        return QPointF(target.x() + point.x * sx, target.y() + point.y * sy);
+    };
+    auto mapRect = [&](const cv::Rect &box) {
+        return QRectF(map(box.tl()), QSizeF(box.width * sx, box.height * sy));
+    };
+
+    // Полосы с номерами; прямоугольная полоса без файла - обычный ROI
+    painter.setPen(QPen(Qt::green, 2));
+    for (size_t i = 0; overlay.lanes && i < overlay.lanes->lanes.size(); ++i) {
+        const RoiSet::Lane &lane = overlay.lanes->lanes[i];
+        if (lane.roi.polygon.empty()) {
+            continue;
+        }
+        QPolygonF polygon;
+        for (const cv::Point &point : lane.roi.polygon) {
+            polygon << map(point);
+        }
+        painter.drawPolygon(polygon);
+        if (lane.roi.lane > 0) {
+            painter.drawText(map(lane.bounds.tl()) + QPointF(6, 18),
+                             QString::number(lane.roi.lane));
+        }
+    }
+
+    if (overlay.selection.width > 0 && overlay.selection.height > 0) {
+        painter.setPen(QPen(Qt::yellow, 2));
+        painter.drawRect(mapRect(overlay.selection));
+    }
+
+    // Прочтения за последнюю секунду: у вырезок - рамка, номера с полного кадра - списком
+    painter.setPen(QPen(Qt::cyan, 2));
+    int line = 0;
+    for (const NumberPlateRecognizer::PreviewPlate &plate : overlay.plates) {
+        if (plate.box.width > 0 && plate.box.height > 0) {
+            const QRectF box = mapRect(plate.box);
+            painter.drawRect(box);
+            painter.drawText(box.topLeft() - QPointF(0, 4), plate.text);
+        } else {
+            painter.drawText(QPointF(target.x() + 8, target.y() + 20 * ++line), plate.text);
+        }
+    }
+
+    if (framePending && recognizer) {
+        recognizer->stats().previewTime.record(frameTime + std::chrono::steady_clock::now()
+                                               - start);
+        framePending = false;
+    }
+}
+
+// Выбор ROI мышью: точки виджета переводятся в координаты кадра
+void PreviewWidget::forwardMouse(int event, QMouseEvent *mouseEvent)
+{
+    if (!recognizer || target.width() <= 0 || target.height() <= 0 || frameSize.width <= 0) {
+        return;
+    }
+    const int x = (mouseEvent->pos().x() - target.x()) * frameSize.width / target.width();
+    const int y = (mouseEvent->pos().y() - target.y()) * frameSize.height / target.height();
+    recognizer->handleMouse(event, std::clamp(x, 0, frameSize.width - 1),
+                            std::clamp(y, 0, frameSize.height - 1), 0);
+    overlay.selection = recognizer->previewOverlay().selection;
+    update();
+}
+
+void PreviewWidget::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton) {
+        forwardMouse(cv::EVENT_LBUTTONDOWN, event);
+    }
+}
+
+void PreviewWidget::mouseMoveEvent(QMouseEvent *event)
+{
+    forwardMouse(cv::EVENT_MOUSEMOVE, event);
+}
+
+void PreviewWidget::mouseReleaseEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton) {
+        forwardMouse(cv::EVENT_LBUTTONUP, event);
+    }
+}
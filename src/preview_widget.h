@@ -0,0 +1,61 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+#include <QImage>
+#include <QRect>
+#include <QTimer>
+#include <QWidget>
+
+#include <chrono>
+
+#include "NumberPlateRecognizer.h"
+
+// Просмотр камеры в окне. Кадр берется у NumberPlateRecognizer по таймеру,
+// не чаще fps раз в секунду: MJPEG декодируется сразу уменьшенным, кадр
+// уменьшается до размера виджета и переводится в RGB прямо в буфер QImage,
+// который живет между кадрами. ROI, полосы и прочтения рисует QPainter
+// поверх кадра. Пока виджет не виден (скрыт или окно свернуто), зритель
+// отключен и камера кадры для просмотра не хранит. Время на кадр идет в
+// StreamStats::previewTime камеры.
+class PreviewWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit PreviewWidget(int fps, QWidget *parent = nullptr);
+    ~PreviewWidget();
+
+    // nullptr - ничего не показывать
+    void setRecognizer(NumberPlateRecognizer *recognizer);
+
+    QSize sizeHint() const override { return QSize(960, 540); }
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+
+private:
+    void onTimer();
+    void updateViewer(bool shown);
+    void forwardMouse(int event, QMouseEvent *mouseEvent);
+
+    NumberPlateRecognizer *recognizer = nullptr;
+    bool attached = false;
+    int fps;
+    QTimer timer;
+
+    cv::Mat decoded;      // кадр камеры в размере декодирования
+    QImage image;         // кадр в размере виджета, RGB; пересоздается только при смене размера
+    cv::Size frameSize;   // исходный размер кадра камеры
+    QRect target;         // где кадр в виджете
+    NumberPlateRecognizer::PreviewOverlay overlay;
+
+    // Новый кадр ждет отрисовки: его время записывается вместе с paintEvent
+    bool framePending = false;
+    std::chrono::steady_clock::duration frameTime{0};
+};
@@ -0,0 +1,269 @@
+#include "shm_ocr_channel.h"
+
+#include <QDebug>
+#include <QJsonDocument>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+const int kReconnectMs = 2000;
+std::atomic<int> segmentCounter{0};
+} // namespace
+
+ShmOcrChannel::ShmOcrChannel(const ShmChannelConfig &config, int timeoutMs, QObject *parent)
+    : QObject(parent)
+    , config(config)
+    , timeout(timeoutMs)
+{
+    // Дочерние объекты переезжают в поток клиента вместе с каналом
+    socket = new QLocalSocket(this);
+    connect(socket, &QLocalSocket::connected, this, &ShmOcrChannel::onConnected);
+    connect(socket, &QLocalSocket::readyRead, this, &ShmOcrChannel::onReadyRead);
+    connect(socket, &QLocalSocket::stateChanged, this, &ShmOcrChannel::onStateChanged);
+
+    reconnectTimer = new QTimer(this);
+    reconnectTimer->setSingleShot(true);
+    connect(reconnectTimer, &QTimer::timeout, this, &ShmOcrChannel::open);
+}
+
+ShmOcrChannel::~ShmOcrChannel()
+{
+    disconnect(socket, nullptr, this, nullptr);
+    socket->abort();
+    unmapSegment();
+}
+
+void ShmOcrChannel::open()
+{
+    if (!segment && !mapSegment()) {
+        return;
+    }
+    if (socket->state() == QLocalSocket::UnconnectedState) {
+        socket->connectToServer(config.socketPath);
+    }
+}
+
+// Сегмент создает клиент, сервер подключается к нему по имени из приветствия
+bool ShmOcrChannel::mapSegment()
+{
+    segmentName = QString("/lpr_ocr_%1_%2").arg(getpid()).arg(segmentCounter++);
+    segmentBytes = static_cast<size_t>(std::max(1, config.slotCount)) * config.slotBytes;
+
+    const QByteArray name = segmentName.toUtf8();
+    int fd = shm_open(name.constData(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        qDebug() << "Local OCR channel: shm_open failed:" << strerror(errno);
+        return false;
+    }
+    void *memory = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(segmentBytes)) == 0) {
+        memory = mmap(nullptr, segmentBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        qDebug() << "Local OCR channel: cannot map" << segmentBytes << "bytes:" << strerror(errno);
+        shm_unlink(name.constData());
+        return false;
+    }
+
+    segment = static_cast<uchar *>(memory);
+    resetSlots();
+    return true;
+}
+
+void ShmOcrChannel::unmapSegment()
+{
+    if (!segment) {
+        return;
+    }
+    munmap(segment, segmentBytes);
+    shm_unlink(segmentName.toUtf8().constData());
+    segment = nullptr;
+}
+
+void ShmOcrChannel::resetSlots()
+{
+    freeSlots.clear();
+    for (int slot = std::max(1, config.slotCount) - 1; slot >= 0; --slot) {
+        freeSlots.push_back(slot);
+    }
+}
+
+void ShmOcrChannel::writeLine(const QJsonObject &message)
+{
+    socket->write(QJsonDocument(message).toJson(QJsonDocument::Compact) + "\n");
+}
+
+void ShmOcrChannel::onConnected()
+{
+    QJsonObject hello;
+    hello["shm"] = segmentName;
+    hello["slots"] = std::max(1, config.slotCount);
+    hello["slot_size"] = static_cast<double>(config.slotBytes);
+    writeLine(hello);
+}
+
+void ShmOcrChannel::onStateChanged(QLocalSocket::LocalSocketState state)
+{
+    if (state != QLocalSocket::UnconnectedState) {
+        return;
+    }
+    if (attached) {
+        qDebug() << "Local OCR channel closed:" << socket->errorString();
+    }
+    ready = false;
+    attached = false;
+
+    // Сервера больше нет - слоты свободны, ответов не будет
+    const auto now = std::chrono::steady_clock::now();
+    for (auto &entry : pending) {
+        if (!entry.second.expired) {
+            OcrResult result;
+            result.request = entry.second.request;
+            result.status = OcrStatus::Failed;
+            result.completedTime = now;
+            emit finished(result, QJsonArray());
+        }
+    }
+    pending.clear();
+    resetSlots();
+    reconnectTimer->start(kReconnectMs);
+}
+
+bool ShmOcrChannel::writeSlot(const OcrImage &image, int slot, QJsonObject &item)
+{
+    uchar *target = segment + static_cast<size_t>(slot) * config.slotBytes;
+    if (!image.jpeg.isEmpty()) {
+        if (static_cast<size_t>(image.jpeg.size()) > config.slotBytes) {
+            return false;
+        }
+        std::memcpy(target, image.jpeg.constData(), image.jpeg.size());
+        item["jpeg"] = image.jpeg.size();
+        return true;
+    }
+
+    const cv::Mat &mat = image.image;
+    if (mat.empty() || mat.depth() != CV_8U || (mat.channels() != 1 && mat.channels() != 3)
+        || mat.total() * mat.elemSize() > config.slotBytes) {
+        return false;
+    }
+    // Строки вырезки идут в слот подряд, без отступов исходного кадра
+    cv::Mat view(mat.rows, mat.cols, mat.type(), target);
+    mat.copyTo(view);
+    item["width"] = mat.cols;
+    item["height"] = mat.rows;
+    item["channels"] = mat.channels();
+    return true;
+}
+
+std::vector<OcrImage> ShmOcrChannel::send(std::vector<OcrImage> images)
+{
+    if (!ready) {
+        return images;
+    }
+
+    std::vector<OcrImage> rejected;
+    QJsonArray items;
+    const auto now = std::chrono::steady_clock::now();
+    for (OcrImage &image : images) {
+        QJsonObject item;
+        if (freeSlots.empty() || !writeSlot(image, freeSlots.back(), item)) {
+            rejected.push_back(std::move(image));
+            continue;
+        }
+
+        const int slot = freeSlots.back();
+        freeSlots.pop_back();
+        const uint64_t id = ++nextId;
+        item["id"] = static_cast<double>(id);
+        item["slot"] = slot;
+        item["kind"] = image.request.kind == OcrRequestKind::PlateCrop ? "crop" : "frame";
+        items.append(item);
+
+        Pending &entry = pending[id];
+        entry.request = image.request;
+        entry.request.sentTime = now;
+        entry.slot = slot;
+
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            image.request.captureTime + timeout - now);
+        QTimer::singleShot(std::max<int>(0, static_cast<int>(remaining.count())), this,
+                           [this, id]() { expire(id); });
+    }
+
+    if (!items.isEmpty()) {
+        QJsonObject message;
+        message["items"] = items;
+        writeLine(message);
+    }
+    return rejected;
+}
+
+// Срок вышел: наружу TimedOut, но слот остается занятым до ответа сервера -
+// он может еще читать изображение
+void ShmOcrChannel::expire(uint64_t id)
+{
+    auto it = pending.find(id);
+    if (it == pending.end() || it->second.expired) {
+        return;
+    }
+    it->second.expired = true;
+
+    OcrResult result;
+    result.request = it->second.request;
+    result.status = OcrStatus::TimedOut;
+    result.completedTime = std::chrono::steady_clock::now();
+    emit finished(result, QJsonArray());
+}
+
+void ShmOcrChannel::onReadyRead()
+{
+    while (socket->canReadLine()) {
+        const QJsonObject message = QJsonDocument::fromJson(socket->readLine()).object();
+
+        if (!attached) {
+            if (!message["ok"].toBool()) {
+                qDebug() << "Local OCR channel rejected:" << message["error"].toString();
+                socket->abort();
+                return;
+            }
+            attached = true;
+            ready = true;
+            qDebug() << "Local OCR channel ready:" << config.socketPath << segmentName;
+            continue;
+        }
+        onResults(message);
+    }
+}
+
+// {"results": [{"id": 5, "slot": 2, "plates": [...]}, ...], "dur": 12.3}
+void ShmOcrChannel::onResults(const QJsonObject &message)
+{
+    const auto now = std::chrono::steady_clock::now();
+    const auto serverTime = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double, std::milli>(std::max(0.0, message["dur"].toDouble())));
+
+    for (const QJsonValue &value : message["results"].toArray()) {
+        const QJsonObject item = value.toObject();
+        auto it = pending.find(static_cast<uint64_t>(item["id"].toDouble()));
+        if (it == pending.end()) {
+            continue;
+        }
+        freeSlots.push_back(it->second.slot);
+
+        if (!it->second.expired) {
+            OcrResult result;
+            result.request = it->second.request;
+            result.status = item.contains("error") ? OcrStatus::Failed : OcrStatus::Ok;
+            result.completedTime = now;
+            result.serverTime = serverTime;
+            emit finished(result, item["plates"].toArray());
+        }
+        pending.erase(it);
+    }
+}
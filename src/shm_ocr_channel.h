@@ -0,0 +1,85 @@
+#pragma once
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QLocalSocket>
+#include <QObject>
+#include <QTimer>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <vector>
+
+#include "ocr_types.h"
+
+struct ShmChannelConfig
+{
+    QString socketPath;                 // Unix-сокет ocr_server.py; пусто - канал выключен
+    int slotCount = 16;                 // столько изображений может быть у сервера одновременно
+    size_t slotBytes = 8 * 1024 * 1024; // кадр 1920x1080 BGR помещается без сжатия
+};
+
+// Локальный канал к ocr_server.py на той же машине. Изображения кладутся в
+// слоты фиксированного размера в общей памяти (POSIX shm) без JPEG, сервер
+// читает их как numpy-массивы без копирования. По Unix-сокету ходят только
+// короткие строки JSON: номер слота и размеры туда, номера и время обратно.
+// Живет в потоке AsyncOCRClient; при обрыве переподключается сам, а пока
+// соединения нет, клиент отправляет по HTTP.
+class ShmOcrChannel : public QObject
+{
+    Q_OBJECT
+public:
+    ShmOcrChannel(const ShmChannelConfig &config, int timeoutMs, QObject *parent = nullptr);
+    ~ShmOcrChannel();
+
+    // Можно звать из любого потока: по нему вызывающий решает, сжимать ли кадр
+    bool isReady() const { return ready.load(std::memory_order_relaxed); }
+
+    // Кладет изображения в свободные слоты и отправляет одним сообщением, сервер
+    // распознает их одним батчем. Возвращает не принятые (нет соединения или
+    // слота, не помещается в слот) - их отправляют по HTTP
+    std::vector<OcrImage> send(std::vector<OcrImage> images);
+
+public slots:
+    void open();
+
+signals:
+    // Ровно один на каждое принятое изображение; plates - ответ сервера
+    void finished(const OcrResult &result, const QJsonArray &plates);
+
+private:
+    struct Pending
+    {
+        OcrRequest request;
+        int slot = -1;
+        bool expired = false; // результат уже отдан, ждем только освобождения слота
+    };
+
+    bool mapSegment();
+    void unmapSegment();
+    void resetSlots();
+    bool writeSlot(const OcrImage &image, int slot, QJsonObject &item);
+    void writeLine(const QJsonObject &message);
+    void onConnected();
+    void onReadyRead();
+    void onStateChanged(QLocalSocket::LocalSocketState state);
+    void onResults(const QJsonObject &message);
+    void expire(uint64_t id);
+
+    ShmChannelConfig config;
+    std::chrono::milliseconds timeout;
+
+    QLocalSocket *socket;
+    QTimer *reconnectTimer;
+    std::atomic<bool> ready{false};
+    bool attached = false; // сервер подключил общую память
+
+    QString segmentName;
+    uchar *segment = nullptr;
+    size_t segmentBytes = 0;
+
+    std::vector<int> freeSlots; // стек: заняты в основном первые слоты, остальные страницы не трогаются
+    std::map<uint64_t, Pending> pending;
+    uint64_t nextId = 0;
+};
@@ -0,0 +1,374 @@
+#include "stream_config.h"
+
+#include <QFile>
+#include <QHostAddress>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+// Опции без значения
+static bool isFlag(const QString &arg)
+{
+    return arg == "--headless";
+}
+
+static QString jsonToArg(const QJsonValue &value)
+{
+    if (value.isBool()) {
+        return value.toBool() ? "on" : "off";
+    }
+    if (value.isDouble()) {
+        return QString::number(value.toDouble(), 'g', 12);
+    }
+    if (value.isArray()) {
+        QStringList parts;
+        for (const QJsonValue &item : value.toArray()) {
+            parts << jsonToArg(item);
+        }
+        return parts.join(',');
+    }
+    return value.toString();
+}
+
+static void appendJsonOptions(const QJsonObject &object, QStringList &args)
+{
+    for (auto it = object.begin(); it != object.end(); ++it) {
+        if (it.key() == "streams" || it.key() == "url") {
+            continue;
+        }
+        const QString option = "--" + it.key();
+        if (isFlag(option)) {
+            if (it.value().toBool()) {
+                args << option;
+            }
+        } else {
+            args << option << jsonToArg(it.value());
+        }
+    }
+}
+
+// Файл настроек в те же аргументы, что и командная строка:
+//   {"threads": 4, "ocr-url": "...", "headless": true,
+//    "streams": [{"url": "rtsp://...", "roi": [0, 0, 640, 480], "gate": "on"}]}
+// Ключи - имена опций без "--", true/false у опций камеры - on/off.
+static bool expandConfigFile(const QString &path, QStringList &args, QString &error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = QString("Cannot open config file %1").arg(path);
+        return false;
+    }
+
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (!document.isObject()) {
+        error = QString("Invalid config file %1: %2").arg(path, parseError.errorString());
+        return false;
+    }
+
+    const QJsonObject root = document.object();
+    appendJsonOptions(root, args);
+    for (const QJsonValue &value : root.value("streams").toArray()) {
+        const QJsonObject stream = value.toObject();
+        if (!stream.contains("url")) {
+            error = QString("Camera without url in config file %1").arg(path);
+            return false;
+        }
+        args << stream.value("url").toString();
+        appendJsonOptions(stream, args);
+    }
+    return true;
+}
+
+static bool parseRect(const QString &value, cv::Rect &rect)
+{
+    QStringList parts = value.split(',');
+    if (parts.size() != 4) {
+        return false;
+    }
+
+    int v[4];
+    for (int i = 0; i < 4; ++i) {
+        bool ok = false;
+        v[i] = parts[i].trimmed().toInt(&ok);
+        if (!ok || v[i] < 0) {
+            return false;
+        }
+    }
+
+    rect = cv::Rect(v[0], v[1], v[2], v[3]);
+    return true;
+}
+
+static bool parseGateMode(const QString &value, GateMode &mode)
+{
+    if (value == "off") {
+        mode = GateMode::Off;
+    } else if (value == "on") {
+        mode = GateMode::On;
+    } else if (value == "audit") {
+        mode = GateMode::Audit;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool parseTrigger(const QString &value, OcrTrigger &trigger)
+{
+    if (value == "interval") {
+        trigger = OcrTrigger::Interval;
+    } else if (value == "motion") {
+        trigger = OcrTrigger::Motion;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool parseOcrBackend(const QString &value, OcrBackend &backend)
+{
+    if (value == "remote") {
+        backend = OcrBackend::Remote;
+    } else if (value == "native") {
+        backend = OcrBackend::Native;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool parseDetectorBackend(const QString &value, DetectorBackend &backend)
+{
+    if (value == "haar") {
+        backend = DetectorBackend::Haar;
+    } else if (value == "yolo") {
+        backend = DetectorBackend::Yolo;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parseEngineArgs(const QStringList &commandLine, EngineConfig &config, QString &error)
+{
+    config.streams.clear();
+
+    // Файл настроек раскрывается на месте; опции после него дополняют его
+    QStringList args;
+    for (int i = 0; i < commandLine.size(); ++i) {
+        if (commandLine[i] != "--config") {
+            args << commandLine[i];
+        } else if (i + 1 >= commandLine.size()) {
+            error = "Missing value for --config";
+            return false;
+        } else if (!expandConfigFile(commandLine[++i], args, error)) {
+            return false;
+        }
+    }
+
+    for (int i = 0; i < args.size(); ++i) {
+        const QString &arg = args[i];
+
+        if (isFlag(arg)) {
+            config.headless = true;
+            continue;
+        }
+
+        if (arg.startsWith("--")) {
+            if (i + 1 >= args.size()) {
+                error = QString("Missing value for %1").arg(arg);
+                return false;
+            }
+            const QString value = args[++i];
+            bool ok = true;
+
+            if (arg == "--threads") {
+                config.workerThreads = value.toInt(&ok);
+            } else if (arg == "--stats") {
+                config.statsIntervalMs = value.toInt(&ok);
+            } else if (arg == "--gate-scale") {
+                config.detector.scale = value.toDouble(&ok);
+            } else if (arg == "--gate-padding") {
+                config.detector.padding = value.toDouble(&ok);
+            } else if (arg == "--ocr-url") {
+                config.ocr.serviceUrl = value;
+            } else if (arg == "--max-in-flight") {
+                config.ocr.maxInFlightPerStream = value.toInt(&ok);
+                ok = ok && config.ocr.maxInFlightPerStream > 0;
+            } else if (arg == "--ocr-timeout") {
+                config.ocr.timeoutMs = value.toInt(&ok);
+            } else if (arg == "--ocr") {
+                ok = parseOcrBackend(value, config.ocrBackend);
+            } else if (arg == "--ocr-model") {
+                config.nativeOcr.modelPath = value.toStdString();
+            } else if (arg == "--detector") {
+                ok = parseDetectorBackend(value, config.detectorBackend);
+            } else if (arg == "--yolo-model") {
+                config.yolo.modelPath = value.toStdString();
+            } else if (arg == "--yolo-batch") {
+                config.yolo.maxBatchSize = value.toInt(&ok);
+                ok = ok && config.yolo.maxBatchSize > 0;
+            } else if (arg == "--yolo-window") {
+                config.yolo.batchWindowMs = value.toInt(&ok);
+            } else if (arg == "--ocr-batch-url") {
+                config.ocr.batchUrl = value;
+            } else if (arg == "--batch-window") {
+                config.ocr.batchWindowMs = value.toInt(&ok);
+            } else if (arg == "--batch-size") {
+                config.ocr.maxBatchSize = value.toInt(&ok);
+                ok = ok && config.ocr.maxBatchSize > 0;
+            } else if (arg == "--ocr-backends") {
+                config.ocr.backends = value.split(',');
+                config.ocr.backends.removeAll(QString());
+                ok = !config.ocr.backends.isEmpty();
+            } else if (arg == "--hedge-after") {
+                config.ocr.hedgeAfterMs = value.toInt(&ok);
+                ok = ok && config.ocr.hedgeAfterMs >= 0;
+            } else if (arg == "--health-interval") {
+                config.ocr.healthIntervalMs = value.toInt(&ok);
+                ok = ok && config.ocr.healthIntervalMs >= 0;
+            } else if (arg == "--latency-target") {
+                config.control.targetMs = value.toInt(&ok);
+                ok = ok && config.control.targetMs >= 0;
+            } else if (arg == "--latency-quantile") {
+                config.control.quantile = value.toDouble(&ok);
+                ok = ok && config.control.quantile > 0.0 && config.control.quantile < 1.0;
+            } else if (arg == "--cpu-limit") {
+                config.control.cpuLimit = value.toDouble(&ok);
+                ok = ok && config.control.cpuLimit >= 0.0;
+            } else if (arg == "--ocr-local") {
+                config.ocr.local.socketPath = value;
+            } else if (arg == "--ocr-local-slots") {
+                config.ocr.local.slotCount = value.toInt(&ok);
+                ok = ok && config.ocr.local.slotCount > 0;
+            } else if (arg == "--preview-port") {
+                config.previewPort = value.toInt(&ok);
+                ok = ok && config.previewPort >= 0 && config.previewPort < 65536;
+            } else if (arg == "--preview-host") {
+                config.previewHost = value;
+                ok = QHostAddress().setAddress(value);
+            } else if (arg == "--metrics-port") {
+                config.metricsPort = value.toInt(&ok);
+                ok = ok && config.metricsPort >= 0 && config.metricsPort < 65536;
+            } else if (arg == "--metrics-host") {
+                config.metricsHost = value;
+                ok = QHostAddress().setAddress(value);
+            } else if (arg == "--events-dir") {
+                config.events.directory = value;
+            } else if (arg == "--events-days") {
+                config.events.retentionDays = value.toInt(&ok);
+                ok = ok && config.events.retentionDays >= 0;
+            } else if (arg == "--events-segment") {
+                config.events.segmentEvents = value.toUInt(&ok);
+                ok = ok && config.events.segmentEvents >= 1024;
+            } else if (arg == "--events-crops") {
+                ok = value == "on" || value == "off";
+                config.events.storeCrops = value == "on";
+            } else if (arg == "--watchlist") {
+                config.watchlist.files = value.split(',');
+                config.watchlist.files.removeAll(QString());
+                ok = !config.watchlist.files.isEmpty();
+            } else if (arg == "--watch-distance") {
+                // Два и больше - уже десятки тысяч вариантов на прочтение
+                config.watchlist.maxDistance = value.toDouble(&ok);
+                ok = ok && config.watchlist.maxDistance >= 0.0
+                     && config.watchlist.maxDistance < 2.0;
+            } else if (arg == "--watch-confusions") {
+                config.watchlist.confusions = value;
+            } else if (arg == "--watch-reload") {
+                config.watchlist.reloadMs = value.toInt(&ok);
+                ok = ok && config.watchlist.reloadMs >= 0;
+            } else if (arg == "--preview-fps") {
+                config.previewFps = value.toInt(&ok);
+                ok = ok && config.previewFps > 0;
+            } else if (arg == "--offline") {
+                StreamConfig stream;
+                stream.url = value;
+                config.streams.push_back(stream);
+                config.offline = true;
+            } else if (arg == "--output") {
+                config.offlineOutput = value;
+            } else if (arg == "--frames-fps") {
+                config.offlineFps = value.toDouble(&ok);
+                ok = ok && config.offlineFps > 0.0;
+            } else if (arg == "--roi" || arg == "--lanes" || arg == "--interval" || arg == "--gate"
+                       || arg == "--trigger" || arg == "--burst" || arg == "--motion-hold"
+                       || arg == "--motion-fraction" || arg == "--deskew"
+                       || arg == "--track-gap" || arg == "--track-settle"
+                       || arg == "--mjpeg" || arg == "--cache-ttl" || arg == "--cache-refresh"
+                       || arg == "--cache-distance") {
+                if (config.streams.empty()) {
+                    error = QString("%1 must follow a camera URL").arg(arg);
+                    return false;
+                }
+                StreamConfig &stream = config.streams.back();
+                if (arg == "--roi") {
+                    ok = parseRect(value, stream.roi);
+                } else if (arg == "--lanes") {
+                    stream.lanesFile = value;
+                    if (!loadLanes(value, stream.lanes, error)) {
+                        return false;
+                    }
+                } else if (arg == "--gate") {
+                    ok = parseGateMode(value, stream.gateMode);
+                } else if (arg == "--trigger") {
+                    ok = parseTrigger(value, stream.trigger);
+                } else if (arg == "--burst") {
+                    stream.burstIntervalMs = value.toInt(&ok);
+                } else if (arg == "--motion-hold") {
+                    stream.motionHoldMs = value.toInt(&ok);
+                } else if (arg == "--deskew") {
+                    ok = value == "on" || value == "off";
+                    stream.deskew = value == "on";
+                } else if (arg == "--cache-ttl") {
+                    stream.cache.ttlMs = value.toInt(&ok);
+                    ok = ok && stream.cache.ttlMs >= 0;
+                } else if (arg == "--cache-refresh") {
+                    stream.cache.refreshMs = value.toInt(&ok);
+                    ok = ok && stream.cache.refreshMs > 0;
+                } else if (arg == "--cache-distance") {
+                    stream.cache.maxDistance = value.toInt(&ok);
+                    ok = ok && stream.cache.maxDistance >= 0 && stream.cache.maxDistance < 64;
+                } else if (arg == "--mjpeg") {
+                    ok = value == "native" || value == "opencv";
+                    stream.nativeMjpeg = value == "native";
+                } else if (arg == "--track-gap") {
+                    stream.tracker.maxGapMs = value.toInt(&ok);
+                    ok = ok && stream.tracker.maxGapMs > 0;
+                } else if (arg == "--track-settle") {
+                    stream.tracker.settleObservations = value.toInt(&ok);
+                } else if (arg == "--motion-fraction") {
+                    stream.motion.activeFraction = value.toDouble(&ok);
+                } else {
+                    stream.ocrIntervalMs = value.toInt(&ok);
+                }
+            } else {
+                error = QString("Unknown option: %1").arg(arg);
+                return false;
+            }
+
+            if (!ok) {
+                error = QString("Invalid value for %1: %2").arg(arg, value);
+                return false;
+            }
+            continue;
+        }
+
+        StreamConfig stream;
+        stream.id = static_cast<int>(config.streams.size());
+        stream.url = arg;
+        config.streams.push_back(stream);
+    }
+
+    if (config.streams.empty()) {
+        error = "No camera URLs given";
+        return false;
+    }
+    if (config.offline && config.streams.size() > 1) {
+        error = "--offline takes a single input and no camera URLs";
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+#include <QString>
+#include <QStringList>
+
+#include <vector>
+
+#include "async_ocr_client.h"
+#include "lane_roi.h"
+#include "latency_controller.h"
+#include "motion_detector.h"
+#include "plate_event_store.h"
+#include "plate_detector.h"
+#include "plate_ocr_engine.h"
+#include "plate_result_cache.h"
+#include "plate_tracker.h"
+#include "plate_watchlist.h"
+#include "yolo_plate_detector.h"
+
+// Локальный детектор номеров перед отправкой на OCR
+enum class GateMode
+{
+    Off,  // на сервер уходит весь ROI
+    On,   // на сервер уходят только вырезки номеров
+    Audit // и то и другое, считается полнота детектора относительно полного кадра
+};
+
+// Когда отправлять кадры на распознавание
+enum class OcrTrigger
+{
+    Interval, // не чаще ocrIntervalMs, независимо от сцены
+    Motion    // серия с шагом burstIntervalMs, пока в ROI есть движение
+};
+
+// Чем искать номера на кадре
+enum class DetectorBackend
+{
+    Haar, // каскад Хаара (PlateDetector)
+    Yolo  // YOLOv8n через cv::dnn, кадры камер собираются в батчи; каскад - запасной
+};
+
+// Чем читать вырезки номеров
+enum class OcrBackend
+{
+    Remote, // HTTP-сервер ocr_server.py
+    Native  // CRNN в процессе через cv::dnn (PlateOcrEngine), полные кадры - на сервер
+};
+
+// Настройки одной камеры
+struct StreamConfig
+{
+    int id = 0;
+    QString url;
+    cv::Rect roi;           // пустой прямоугольник - весь кадр
+    // Полосы-многоугольники из файла --lanes; есть полосы - --roi не используется.
+    // ROI, сохраненный в окне, добавляется в файл новой полосой
+    QString lanesFile;
+    std::vector<LaneRoi> lanes;
+    int ocrIntervalMs = 300;
+    GateMode gateMode = GateMode::Off;
+
+    OcrTrigger trigger = OcrTrigger::Interval;
+    int burstIntervalMs = 100;
+    int motionHoldMs = 500; // сколько еще снимать после остановки движения
+    MotionConfig motion;
+
+    bool deskew = false; // выравнивать наклон вырезок перед OCR
+
+    // http:// MJPEG читается своим разборщиком (кадры сжатыми, декодирование по
+    // надобности); false - через cv::VideoCapture, как любой другой поток
+    bool nativeMjpeg = true;
+
+    PlateTrackerConfig tracker; // сборка прочтений в одно событие на машину
+    PlateCacheConfig cache;     // ответы по похожим вырезкам без запроса к серверу
+};
+
+// Настройки движка в целом
+struct EngineConfig
+{
+    std::vector<StreamConfig> streams;
+    int workerThreads = 0;     // 0 - по числу ядер
+    int statsIntervalMs = 5000;
+    PlateDetectorConfig detector;
+    DetectorBackend detectorBackend = DetectorBackend::Haar;
+    YoloDetectorConfig yolo;
+    OcrClientConfig ocr;
+    LatencyControlConfig control; // качество и частота запросов под цель по задержке
+    OcrBackend ocrBackend = OcrBackend::Remote;
+    PlateOcrConfig nativeOcr;
+
+    bool headless = false; // без окна: QCoreApplication, запуск сразу
+    int previewPort = 0;   // порт MJPEG-просмотра (PreviewServer), 0 - выключен
+    QString previewHost = "127.0.0.1"; // адрес PreviewServer: видео камер без авторизации
+    int previewFps = 5;    // кадров в секунду для зрителей: окно и PreviewServer
+    int metricsPort = 0;   // порт /metrics для Prometheus (MetricsServer), 0 - выключен
+    // Адрес MetricsServer: по умолчанию только локальный, /events отдает историю номеров
+    QString metricsHost = "127.0.0.1";
+    PlateEventStoreConfig events; // хранилище событий по машинам для поиска (/events)
+    WatchlistConfig watchlist;    // списки номеров (угон, пропуска) для проверки прочтений
+
+    // Пакетная обработка записи (OfflineRunner): единственный "поток" - файл или каталог кадров
+    bool offline = false;
+    QString offlineOutput = "results.csv";
+    double offlineFps = 1.0; // частота кадров каталога (video2frames.py сохраняет 1 кадр/с)
+};
+
+// Разбор командной строки:
+//   [--config file.json] [--headless] [--preview-port N] [--preview-host addr] [--preview-fps N]
+//   [--output results.csv] [--frames-fps k] [--metrics-port N] [--metrics-host addr]
+//   [--events-dir path] [--events-days N] [--events-segment N] [--events-crops on|off]
+//   [--watchlist file[,file...]] [--watch-distance k] [--watch-confusions 0O,8B,...]
+//   [--watch-reload ms]
+//   [--threads N] [--stats ms] [--gate-scale k] [--gate-padding k]
+//   [--ocr-url url] [--max-in-flight N] [--ocr-timeout ms]
+//   [--ocr-batch-url url] [--batch-window ms] [--batch-size N]
+//   [--ocr-local /tmp/lpr_ocr.sock] [--ocr-local-slots N]
+//   [--ocr-backends http://host:5000,http://host:5001] [--hedge-after ms] [--health-interval ms]
+//   [--latency-target ms] [--latency-quantile k] [--cpu-limit k]
+//   [--ocr remote|native] [--ocr-model path.onnx]
+//   [--detector haar|yolo] [--yolo-model path.onnx] [--yolo-batch N] [--yolo-window ms]
+//   <url> [--roi x,y,w,h] [--lanes lanes.json] [--interval ms] [--gate off|on|audit]
+//         [--trigger interval|motion] [--burst ms] [--motion-hold ms] [--motion-fraction k]
+//         [--deskew on|off] [--track-gap ms] [--track-settle N] [--mjpeg native|opencv]
+//         [--cache-ttl ms] [--cache-refresh ms] [--cache-distance bits]
+//   <url> ...
+// или --offline <видео | каталог кадров> с теми же опциями камеры вместо URL.
+// Опции после URL относятся к этой камере. --config подставляет опции и камеры
+// из JSON-файла на свое место.
+bool parseEngineArgs(const QStringList &commandLine, EngineConfig &config, QString &error);
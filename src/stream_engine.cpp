@@ -0,0 +1,454 @@
+#include "stream_engine.h"
+
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+StreamEngine::StreamEngine(const EngineConfig &config, QObject *parent)
+    : QObject(parent)
+    , config(config)
+{
+    std::cout << "Initializing Number Plate Recognizer..." << std::endl;
+
+    // Загрузка каскада для детекции номеров (один на все камеры)
+    std::string cascadePath = "haarcascade_russian_plate_number.xml";
+    if (!plateDetector.load(cascadePath, config.detector)) {
+        std::cerr << "Plate gate disabled, full ROI will be sent to OCR" << std::endl;
+    }
+
+    // YOLO вместо каскада; если модель не загрузилась, остается каскад
+    YoloPlateDetector *yoloForStreams = nullptr;
+    if (config.detectorBackend == DetectorBackend::Yolo) {
+        if (yoloDetector.load(config.yolo)) {
+            yoloForStreams = &yoloDetector;
+            std::cout << "YOLO plate detector: " << config.yolo.modelPath << std::endl;
+        } else {
+            std::cerr << "YOLO plate detector disabled, using Haar cascade" << std::endl;
+        }
+    }
+    const bool detectorReady = yoloForStreams || plateDetector.isLoaded();
+
+    // Локальный CRNN вместо сервера для вырезок номеров
+    PlateOcrEngine *engineForStreams = nullptr;
+    if (config.ocrBackend == OcrBackend::Native) {
+        if (!detectorReady) {
+            std::cerr << "Native OCR needs the plate detector, using OCR server" << std::endl;
+        } else if (ocrEngine.load(config.nativeOcr)) {
+            engineForStreams = &ocrEngine;
+            std::cout << "Native OCR model: " << config.nativeOcr.modelPath << std::endl;
+        } else {
+            std::cerr << "Native OCR disabled, using OCR server" << std::endl;
+        }
+    }
+
+    // Пул рабочих потоков по числу ядер
+    int threads = config.workerThreads > 0 ? config.workerThreads : QThread::idealThreadCount();
+    pool.setMaxThreadCount(std::max(1, threads));
+    pool.setExpiryTimeout(-1);
+
+    // OCR клиент (один на все камеры) живет в отдельном сетевом потоке
+    ocrClient = new AsyncOCRClient(config.ocr);
+    ocrClient->moveToThread(&networkThread);
+    connect(&networkThread, &QThread::finished, ocrClient, &QObject::deleteLater);
+    connect(ocrClient, &AsyncOCRClient::plateRecognized, this,
+            [this](const OcrResult &result) {
+                int streamId = result.request.streamId;
+                if (streamId >= 0 && streamId < streamCount()) {
+                    streams[streamId]->onOCRResultReceived(result);
+                }
+            });
+    networkThread.start();
+
+    if (!config.events.directory.isEmpty()) {
+        QString error;
+        eventStore.reset(new PlateEventStore(config.events));
+        if (eventStore->open(error)) {
+            std::cout << "Event store: " << config.events.directory.toStdString() << ", "
+                      << eventStore->segmentCount() << " segments, keeping "
+                      << config.events.retentionDays << " days" << std::endl;
+        } else {
+            std::cerr << "Event store disabled: " << error.toStdString() << std::endl;
+            eventStore.reset();
+        }
+    }
+
+    if (!config.watchlist.files.isEmpty()) {
+        QString error;
+        const auto started = std::chrono::steady_clock::now();
+        watchlist.reset(new PlateWatchlist(config.watchlist));
+        if (watchlist->load(error)) {
+            std::cout << "Watchlist: " << watchlist->size() << " plates in "
+                      << watchlist->listCount() << " lists, " << watchlist->skippedLines()
+                      << " lines skipped, distance " << config.watchlist.maxDistance << ", "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::steady_clock::now() - started)
+                             .count()
+                      << " ms" << std::endl;
+            connect(&watchlistTimer, &QTimer::timeout, this, &StreamEngine::reloadWatchlist);
+        } else {
+            std::cerr << "Watchlist disabled: " << error.toStdString() << std::endl;
+            watchlist.reset();
+        }
+    }
+
+    for (const StreamConfig &streamConfig : config.streams) {
+        NumberPlateRecognizer *recognizer =
+            new NumberPlateRecognizer(streamConfig, &plateDetector, yoloForStreams, ocrClient,
+                                      engineForStreams, this);
+        connect(recognizer, &NumberPlateRecognizer::plateDetected, this,
+                &StreamEngine::plateDetected);
+        connect(recognizer, &NumberPlateRecognizer::vehicleDetected, this,
+                &StreamEngine::vehicleDetected);
+        if (eventStore) {
+            // Прямо в потоке, где закрылась машина: append только ставит в очередь
+            PlateEventStore *store = eventStore.get();
+            connect(recognizer, &NumberPlateRecognizer::vehicleDetected, this,
+                    [store](const VehicleEvent &event) { store->append(event); },
+                    Qt::DirectConnection);
+        }
+        if (watchlist) {
+            recognizer->setWatchlist(watchlist.get());
+            connect(recognizer, &NumberPlateRecognizer::watchlistHit, this,
+                    &StreamEngine::watchlistHit);
+        }
+        streams.push_back(recognizer);
+    }
+    scheduled.reset(new std::atomic<bool>[streams.size()]);
+
+    controller = new LatencyController(config.control, streams, this);
+    if (controller->isEnabled()) {
+        std::cout << "Latency control: p" << config.control.quantile * 100 << " target "
+                  << config.control.targetMs << " ms, cpu limit "
+                  << config.control.cpuLimit * 100 << "%" << std::endl;
+    }
+
+    connect(&statsTimer, &QTimer::timeout, this, &StreamEngine::reportThroughput);
+
+    std::cout << "Number Plate Recognizer initialized successfully! Streams: " << streams.size()
+              << ", worker threads: " << pool.maxThreadCount() << std::endl;
+}
+
+StreamEngine::~StreamEngine()
+{
+    stop();
+    networkThread.quit();
+    networkThread.wait();
+}
+
+void StreamEngine::start()
+{
+    if (running) {
+        return;
+    }
+
+    running = true;
+    activeStreams = streamCount();
+
+    lastSnapshots.clear();
+    for (NumberPlateRecognizer *recognizer : streams) {
+        lastSnapshots.push_back(StreamStatsSnapshot::take(recognizer->stats()));
+    }
+    lastSnapshotTime = std::chrono::steady_clock::now();
+    if (config.statsIntervalMs > 0) {
+        statsTimer.start(config.statsIntervalMs);
+    }
+    controller->start();
+    if (watchlist && config.watchlist.reloadMs > 0) {
+        watchlistTimer.start(config.watchlist.reloadMs);
+    }
+
+    for (int i = 0; i < streamCount(); ++i) {
+        scheduled[i] = false;
+        streams[i]->startProcessing([this, i]() { scheduleStream(i); },
+                                    [this, i]() { onStreamFinished(i); });
+    }
+}
+
+void StreamEngine::stop()
+{
+    if (!running) {
+        return;
+    }
+
+    running = false;
+    for (NumberPlateRecognizer *recognizer : streams) {
+        recognizer->stopProcessing();
+    }
+    pool.waitForDone();
+    statsTimer.stop();
+    controller->stop();
+    watchlistTimer.stop();
+    watchlistReload.waitForFinished();
+    if (eventStore) {
+        eventStore->flush(); // последние машины из stopProcessing
+    }
+
+    reportThroughput();
+    reportLatencySummary();
+}
+
+// Вызывается потоком захвата при новом кадре. Если задача камеры уже стоит
+// в очереди, она сама заберет самый свежий кадр
+void StreamEngine::scheduleStream(int index)
+{
+    if (!running || scheduled[index].exchange(true)) {
+        return;
+    }
+    QtConcurrent::run(&pool, [this, index]() { runStreamStep(index); });
+}
+
+// Один кадр одной камеры. Если за время обработки пришли новые кадры,
+// задача ставится в конец очереди пула, чтобы камеры обслуживались по кругу
+void StreamEngine::runStreamStep(int index)
+{
+    streams[index]->processLatest();
+
+    scheduled[index] = false;
+    if (streams[index]->hasPendingFrame()) {
+        scheduleStream(index);
+    }
+}
+
+void StreamEngine::onStreamFinished(int index)
+{
+    std::cout << "[" << streams[index]->streamId() << "] Stream stopped" << std::endl;
+
+    if (--activeStreams == 0) {
+        QMetaObject::invokeMethod(this, [this]() {
+            if (running) {
+                running = false;
+                statsTimer.stop();
+                controller->stop();
+                reportThroughput();
+                reportLatencySummary();
+            }
+            emit finished();
+        }, Qt::QueuedConnection);
+    }
+}
+
+void StreamEngine::reportThroughput()
+{
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - lastSnapshotTime).count();
+    if (seconds <= 0.0 || lastSnapshots.size() != streams.size()) {
+        return;
+    }
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+
+    double totalFps = 0.0;
+    double totalOcr = 0.0;
+    uint64_t totalPlates = 0;
+    uint64_t totalVehicles = 0;
+    uint64_t totalDropped = 0;
+    uint64_t maxLatencyUs = 0;
+    double totalUploadKBps = 0.0;
+    for (size_t i = 0; i < streams.size(); ++i) {
+        StreamStatsSnapshot current = StreamStatsSnapshot::take(streams[i]->stats());
+        const StreamStatsSnapshot &last = lastSnapshots[i];
+
+        double fps = (current.framesCaptured - last.framesCaptured) / seconds;
+        double ocr = (current.framesSubmitted - last.framesSubmitted) / seconds;
+        uint64_t plates = current.platesRecognized - last.platesRecognized;
+        totalFps += fps;
+        totalOcr += ocr;
+        totalPlates += plates;
+
+        uint64_t dropped = current.framesDropped - last.framesDropped;
+        uint64_t latencyCount = current.captureToOcrCount - last.captureToOcrCount;
+        double latencyAvgMs = latencyCount > 0
+                                  ? (current.captureToOcrSumUs - last.captureToOcrSumUs)
+                                        / 1000.0 / latencyCount
+                                  : 0.0;
+        totalDropped += dropped;
+        maxLatencyUs = std::max(maxLatencyUs, current.captureToOcrMaxUs);
+
+        double uploadKBps = (current.bytesSubmitted - last.bytesSubmitted) / 1024.0 / seconds;
+        totalUploadKBps += uploadKBps;
+
+        out << "[" << streams[i]->streamId() << "] capture " << fps << " fps, dropped "
+            << dropped << ", ocr " << ocr << " req/s (" << uploadKBps
+            << " KB/s), capture->ocr avg " << latencyAvgMs << " ms max "
+            << current.captureToOcrMaxUs / 1000.0 << " ms, plates " << plates << "\n";
+
+        uint64_t resultCount = current.captureToResultCount - last.captureToResultCount;
+        double resultAvgMs = resultCount > 0
+                                 ? (current.captureToResultSumUs - last.captureToResultSumUs)
+                                       / 1000.0 / resultCount
+                                 : 0.0;
+        out << "    results: capture->result avg " << resultAvgMs << " ms max "
+            << current.captureToResultMaxUs / 1000.0 << " ms, coalesced "
+            << current.requestsCoalesced - last.requestsCoalesced << ", timed out "
+            << current.requestsTimedOut - last.requestsTimedOut << ", failed "
+            << current.requestsFailed - last.requestsFailed << "\n";
+
+        uint64_t vehicles = current.vehiclesReported - last.vehiclesReported;
+        totalVehicles += vehicles;
+        out << "    vehicles: " << vehicles << " from " << plates << " readings, ocr skipped "
+            << current.cropsSettled - last.cropsSettled << " crops of read vehicles\n";
+
+        const uint64_t lookups = current.cacheLookups - last.cacheLookups;
+        if (lookups > 0) {
+            const uint64_t hits = current.cacheHits - last.cacheHits;
+            out << "    cache: " << hits << " of " << lookups << " crops ("
+                << 100.0 * hits / lookups << "%) answered without OCR\n";
+        }
+
+        if (controller->isEnabled()) {
+            const StreamQuality &quality = streams[i]->quality();
+            const int level = quality.level.load(std::memory_order_relaxed);
+            const QualityLevel &knobs = kQualityLevels[level];
+            out << "    control: level " << level << " (jpeg " << knobs.jpegQuality
+                << ", interval x" << knobs.intervalScale << ", image x" << knobs.imageScale
+                << "), p" << controller->controlConfig().quantile * 100 << " "
+                << quality.quantileUs.load(std::memory_order_relaxed) / 1000.0 << " ms, down "
+                << quality.degrades.load(std::memory_order_relaxed) << " up "
+                << quality.upgrades.load(std::memory_order_relaxed) << "\n";
+        }
+
+        out << "    trigger: triggered " << current.framesTriggered - last.framesTriggered
+            << ", skipped " << current.framesSkipped - last.framesSkipped << "\n";
+
+        // Поиск номеров, выравнивание и локальный OCR считаются отдельно друг от друга
+        auto average = [](uint64_t sumUs, uint64_t count) {
+            return count > 0 ? sumUs / 1000.0 / count : 0.0;
+        };
+        uint64_t detectCount = current.detectCount - last.detectCount;
+        uint64_t deskewCount = current.deskewCount - last.deskewCount;
+        uint64_t ocrCount = current.ocrCount - last.ocrCount;
+        if (detectCount > 0 || ocrCount > 0) {
+            out << "    stages: detect avg "
+                << average(current.detectSumUs - last.detectSumUs, detectCount) << " ms max "
+                << current.detectMaxUs / 1000.0 << " ms, deskew avg "
+                << average(current.deskewSumUs - last.deskewSumUs, deskewCount) << " ms max "
+                << current.deskewMaxUs / 1000.0 << " ms, native ocr avg "
+                << average(current.ocrSumUs - last.ocrSumUs, ocrCount) << " ms max "
+                << current.ocrMaxUs / 1000.0 << " ms\n";
+        }
+
+        // Просмотр идет в потоке окна, рядом с конвейером, а не в нем
+        const uint64_t previewCount = current.previewCount - last.previewCount;
+        if (previewCount > 0) {
+            const uint64_t previewUs = current.previewSumUs - last.previewSumUs;
+            out << "    preview: " << previewCount / seconds << " fps, avg "
+                << average(previewUs, previewCount) << " ms, "
+                << previewUs / 1e4 / seconds << "% of a core\n";
+        }
+
+        const GateMode gateMode = streams[i]->streamConfig().gateMode;
+        if (gateMode != GateMode::Off) {
+            out << "    gate: candidates " << current.gateCandidates - last.gateCandidates
+                << ", empty frames " << current.gateRejected - last.gateRejected;
+        }
+        if (gateMode == GateMode::Audit) {
+            // Полнота считается нарастающим итогом с момента запуска
+            out << ", audit frames " << current.auditFrames << ", with plate "
+                << current.auditPositives;
+            if (current.auditPositives > 0) {
+                out << ", detection recall "
+                    << 100.0 * current.auditDetectionHits / current.auditPositives
+                    << "%, text recall " << 100.0 * current.auditTextHits / current.auditPositives
+                    << "%";
+            }
+        }
+        if (gateMode != GateMode::Off) {
+            out << "\n";
+        }
+        lastSnapshots[i] = current;
+    }
+    lastSnapshotTime = now;
+
+    if (watchlist) {
+        uint64_t hits = 0;
+        for (NumberPlateRecognizer *recognizer : streams) {
+            hits += recognizer->stats().watchlistHits.load(std::memory_order_relaxed);
+        }
+        out << "watchlist: " << watchlist->size() << " plates, " << hits << " hits\n";
+    }
+    if (eventStore) {
+        out << "event store: written " << eventStore->storedEvents() << ", dropped "
+            << eventStore->droppedEvents() << ", segments " << eventStore->segmentCount() << "\n";
+    }
+
+    // Серверы пула: нарастающие итоги с момента запуска
+    for (int i = 0; ocrClient->backendCount() > 1 && i < ocrClient->backendCount(); ++i) {
+        const OcrBackendStats &backend = ocrClient->backendStats(i);
+        out << "ocr backend " << backend.url << ": "
+            << (backend.healthy.load(std::memory_order_relaxed) ? "up" : "down")
+            << ", outstanding " << backend.outstanding.load(std::memory_order_relaxed)
+            << ", requests " << backend.requests.load(std::memory_order_relaxed) << ", failed "
+            << backend.failures.load(std::memory_order_relaxed) << ", timed out "
+            << backend.timeouts.load(std::memory_order_relaxed) << ", hedged "
+            << backend.hedges.load(std::memory_order_relaxed) << ", p95 "
+            << backend.latency.quantileUs(0.95) / 1000.0 << " ms\n";
+    }
+
+    out << "Total: " << streams.size() << " streams, capture " << totalFps << " fps, dropped "
+        << totalDropped << ", ocr " << totalOcr << " req/s (" << totalUploadKBps
+        << " KB/s), capture->ocr max "
+        << maxLatencyUs / 1000.0 << " ms, plates " << totalPlates << ", vehicles "
+        << totalVehicles;
+    if (controller->isEnabled()) {
+        out << ", cpu " << controller->cpuLoad() * 100 << "%";
+    }
+
+    std::cout << "\n=== Throughput (" << seconds << " s) ===\n" << out.str() << std::endl;
+    emit throughputUpdated(QString::fromStdString(out.str()));
+}
+
+// Сборка индекса на миллионы номеров - секунды, поэтому не в потоке окна.
+// Пока идет прошлое перечитывание, новое не начинается
+void StreamEngine::reloadWatchlist()
+{
+    if (!watchlistReload.isFinished()) {
+        return;
+    }
+    PlateWatchlist *list = watchlist.get();
+    watchlistReload = QtConcurrent::run([list]() {
+        QString error;
+        const auto started = std::chrono::steady_clock::now();
+        if (list->reloadIfChanged(error)) {
+            std::cout << "Watchlist reloaded: " << list->size() << " plates in "
+                      << list->listCount() << " lists, " << list->skippedLines()
+                      << " lines skipped, "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::steady_clock::now() - started)
+                             .count()
+                      << " ms" << std::endl;
+        } else if (!error.isEmpty()) {
+            std::cerr << "Watchlist not reloaded: " << error.toStdString() << std::endl;
+        }
+    });
+}
+
+// Итог при остановке: квантили каждого этапа за все время работы (оценки по
+// корзинам гистограммы, как их посчитал бы Prometheus)
+void StreamEngine::reportLatencySummary()
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    out << "\n=== Latency summary (ms: avg / p50 / p95 / p99) ===\n";
+    for (NumberPlateRecognizer *recognizer : streams) {
+        out << "[" << recognizer->streamId() << "]";
+        recognizer->stats().forEachStage([&](const char *stage, const LatencyStat &stat) {
+            const uint64_t count = stat.count.load(std::memory_order_relaxed);
+            if (count == 0) {
+                return;
+            }
+            out << "\n    " << std::left << std::setw(15) << stage << std::right
+                << stat.sumUs.load(std::memory_order_relaxed) / 1000.0 / count << " / "
+                << stat.quantileUs(0.5) / 1000.0 << " / " << stat.quantileUs(0.95) / 1000.0
+                << " / " << stat.quantileUs(0.99) / 1000.0 << "  (" << count << ")";
+        });
+        const StreamStats &stats = recognizer->stats();
+        out << "\n    frames captured " << stats.framesCaptured.load() << ", dropped "
+            << stats.framesDropped.load() << ", sent to OCR " << stats.framesSubmitted.load()
+            << ", vehicles " << stats.vehiclesReported.load() << ", buffer pool misses "
+            << stats.bufferPoolMisses.load() << "\n";
+    }
+    std::cout << out.str() << std::endl;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <QFuture>
+#include <QObject>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "NumberPlateRecognizer.h"
+#include "async_ocr_client.h"
+#include "latency_controller.h"
+#include "plate_detector.h"
+#include "plate_event_store.h"
+#include "plate_ocr_engine.h"
+#include "plate_watchlist.h"
+#include "stream_config.h"
+#include "yolo_plate_detector.h"
+
+// Движок нескольких камер в одном процессе.
+// У каждой камеры свой поток захвата, а подготовка кадров и отправка на OCR
+// идут на общем пуле рабочих потоков. Каскад, OCR-клиент и локальный CRNN
+// общие для всех камер.
+class StreamEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit StreamEngine(const EngineConfig &config, QObject *parent = nullptr);
+    ~StreamEngine();
+
+    void start();
+    void stop();
+    bool isRunning() const { return running; }
+
+    int streamCount() const { return static_cast<int>(streams.size()); }
+    NumberPlateRecognizer *stream(int index) const { return streams[index]; }
+    const AsyncOCRClient *ocr() const { return ocrClient; }
+    const LatencyController *latencyControl() const { return controller; }
+    PlateEventStore *events() const { return eventStore.get(); } // nullptr без --events-dir
+    const PlateWatchlist *plateWatchlist() const { return watchlist.get(); } // или nullptr
+
+signals:
+    void finished();
+    void throughputUpdated(const QString &summary);
+    void plateDetected(int streamId, const QString &plate, double confidence);
+    void vehicleDetected(const VehicleEvent &event);
+    void watchlistHit(int streamId, const QString &plate, const WatchlistHit &hit);
+
+private:
+    void scheduleStream(int index);
+    void runStreamStep(int index);
+    void onStreamFinished(int index);
+    void reportThroughput();
+    void reportLatencySummary();
+    void reloadWatchlist();
+
+    EngineConfig config;
+
+    PlateDetector plateDetector;
+    YoloPlateDetector yoloDetector;
+    PlateOcrEngine ocrEngine;
+    QThread networkThread;
+    AsyncOCRClient *ocrClient;
+
+    QThreadPool pool;
+    std::vector<NumberPlateRecognizer *> streams;
+    std::unique_ptr<std::atomic<bool>[]> scheduled; // задача камеры уже в очереди пула
+    std::atomic<bool> running{false};
+    std::atomic<int> activeStreams{0};
+
+    // Ступени качества камер под цель по задержке
+    LatencyController *controller;
+
+    // События по машинам на диск; пишет свой поток хранилища
+    std::unique_ptr<PlateEventStore> eventStore;
+
+    // Списки номеров: файлы перечитываются по таймеру в фоне, новый индекс
+    // подменяет старый, проверки не останавливаются
+    std::unique_ptr<PlateWatchlist> watchlist;
+    QTimer watchlistTimer;
+    QFuture<void> watchlistReload;
+
+    // Пропускная способность
+    QTimer statsTimer;
+    std::vector<StreamStatsSnapshot> lastSnapshots;
+    std::chrono::steady_clock::time_point lastSnapshotTime;
+};
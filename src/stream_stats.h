@@ -0,0 +1,256 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Верхние границы корзин гистограммы задержек, мкс; последняя корзина - все, что больше
+static constexpr uint64_t kLatencyBoundsUs[] = {100,    250,    500,     1000,    2500,
+                                                5000,   10000,  25000,   50000,   100000,
+                                                250000, 500000, 1000000, 2500000, 5000000};
+static constexpr int kLatencyBuckets = sizeof(kLatencyBoundsUs) / sizeof(uint64_t) + 1;
+
+// Накопитель задержки: сумма, количество, максимум за интервал и гистограмма.
+// Один накопитель на этап камеры, общий для всех пишущих потоков: полосы кадра
+// идут параллельно в потоках cv::parallel_for_ (вырезки, JPEG, выравнивание,
+// кэш), а ответы локального CRNN и кэша пишутся еще и из шага камеры. Поэтому
+// писателей несколько; relaxed-атомиков хватает - поля независимы, а
+// читатель (статистика, /metrics) согласованного снимка не требует.
+struct LatencyStat
+{
+    std::atomic<uint64_t> sumUs{0};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> maxUs{0};
+    std::atomic<uint64_t> buckets[kLatencyBuckets] = {};
+
+    void record(std::chrono::steady_clock::duration latency)
+    {
+        uint64_t us = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+        sumUs.fetch_add(us, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+
+        int bucket = 0;
+        while (bucket < kLatencyBuckets - 1 && us > kLatencyBoundsUs[bucket]) {
+            ++bucket;
+        }
+        buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t prev = maxUs.load(std::memory_order_relaxed);
+        while (us > prev && !maxUs.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Оценка квантиля по гистограмме: верхняя граница корзины, в которую он попал
+    uint64_t quantileUs(double q) const
+    {
+        const uint64_t total = count.load(std::memory_order_relaxed);
+        if (total == 0) {
+            return 0;
+        }
+        const uint64_t rank = static_cast<uint64_t>(q * total + 0.5);
+        uint64_t seen = 0;
+        for (int i = 0; i < kLatencyBuckets - 1; ++i) {
+            seen += buckets[i].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                return kLatencyBoundsUs[i];
+            }
+        }
+        return kLatencyBoundsUs[kLatencyBuckets - 2];
+    }
+};
+
+// Счетчики одной камеры, общие для всех ее потоков. Пишутся из рабочих потоков,
+// читаются таймером статистики.
+struct StreamStats
+{
+    std::atomic<uint64_t> framesCaptured{0};
+    std::atomic<uint64_t> framesDropped{0};
+    std::atomic<uint64_t> framesSubmitted{0};
+    std::atomic<uint64_t> resultsReceived{0};
+    std::atomic<uint64_t> platesRecognized{0};
+    std::atomic<uint64_t> bytesSubmitted{0};
+
+    // Запросы, на которые не пришел ответ сервера
+    std::atomic<uint64_t> requestsCoalesced{0}; // вытеснены более свежим кадром
+    std::atomic<uint64_t> requestsTimedOut{0};
+    std::atomic<uint64_t> requestsFailed{0};
+
+    // Планирование OCR: обработанные кадры, которые отправлены / пропущены
+    std::atomic<uint64_t> framesTriggered{0};
+    std::atomic<uint64_t> framesSkipped{0};
+
+    // Локальный детектор
+    std::atomic<uint64_t> gateCandidates{0}; // найдено номеров
+    std::atomic<uint64_t> gateRejected{0};   // кадров без номеров, не отправлены
+
+    // Контроль полноты детектора относительно распознавания полного кадра
+    std::atomic<uint64_t> auditFrames{0};
+    std::atomic<uint64_t> auditPositives{0};     // сервер нашел номер на полном кадре
+    std::atomic<uint64_t> auditDetectionHits{0}; // и детектор нашел хоть что-то
+    std::atomic<uint64_t> auditTextHits{0};      // и по вырезке прочитан тот же номер
+
+    // Сборка прочтений по машинам
+    std::atomic<uint64_t> vehiclesReported{0};
+    std::atomic<uint64_t> cropsSettled{0}; // вырезки уже прочитанных машин, без OCR
+
+    // Кэш ответов по перцептивному хешу вырезки
+    std::atomic<uint64_t> cacheLookups{0};
+    std::atomic<uint64_t> cacheHits{0};
+
+    // Прочтения, совпавшие с номером из списка (без повторов по той же машине)
+    std::atomic<uint64_t> watchlistHits{0};
+
+    // Кадры и JPEG, для которых не нашлось свободного буфера пула
+    std::atomic<uint64_t> bufferPoolMisses{0};
+
+    // От захвата кадра до отправки на распознавание
+    LatencyStat captureToOcr;
+
+    // От захвата кадра до ответа сервера
+    LatencyStat captureToResult;
+
+    // Время поиска номеров на кадре, выравнивания и локального распознавания вырезок
+    LatencyStat detectTime;
+    LatencyStat deskewTime;
+    LatencyStat ocrTime;
+    LatencyStat watchlistTime; // проверка прочтения по спискам
+
+    // Чтение кадра из камеры (cap.read), подготовка вырезок (ROI, детектор,
+    // выравнивание), JPEG перед отправкой, запрос в сети от отправки до ответа
+    // и из него время распознавания на сервере (заголовок Server-Timing)
+    LatencyStat readTime;
+    LatencyStat decodeTime; // MJPEG: кадры декодируются по надобности, часть - уменьшенными
+    LatencyStat cropTime;
+    LatencyStat encodeTime;
+    LatencyStat networkTime;
+    LatencyStat serverTime;
+
+    // Кадр для зрителей (окно, PreviewServer): декодирование, уменьшение и
+    // отрисовка или JPEG. Не этап конвейера - поток окна, считается отдельно
+    LatencyStat previewTime;
+
+    // Все этапы по порядку конвейера с именами для метрик и сводки
+    template <typename F>
+    void forEachStage(F f) const
+    {
+        f("read", readTime);
+        f("decode", decodeTime);
+        f("crop", cropTime);
+        f("detect", detectTime);
+        f("deskew", deskewTime);
+        f("capture_to_ocr", captureToOcr);
+        f("encode", encodeTime);
+        f("network", networkTime);
+        f("server", serverTime);
+        f("native_ocr", ocrTime);
+        f("watchlist", watchlistTime);
+        f("end_to_end", captureToResult);
+        f("preview", previewTime);
+    }
+};
+
+// Один OCR-сервер пула. Пишет поток OCR-клиента, читают статистика и метрики
+struct OcrBackendStats
+{
+    std::string url;
+    std::atomic<bool> healthy{true};
+    std::atomic<int> outstanding{0}; // HTTP-запросов без ответа
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> failures{0};
+    std::atomic<uint64_t> timeouts{0};
+    std::atomic<uint64_t> hedges{0};    // дублирующие запросы, ушедшие на этот сервер
+    std::atomic<uint64_t> ejections{0}; // исключения из пула по ошибкам и /health
+    LatencyStat latency;                // от отправки до ответа
+};
+
+// Снимок счетчиков для подсчета пропускной способности
+struct StreamStatsSnapshot
+{
+    uint64_t framesCaptured = 0;
+    uint64_t framesDropped = 0;
+    uint64_t framesSubmitted = 0;
+    uint64_t resultsReceived = 0;
+    uint64_t platesRecognized = 0;
+    uint64_t bytesSubmitted = 0;
+    uint64_t requestsCoalesced = 0;
+    uint64_t requestsTimedOut = 0;
+    uint64_t requestsFailed = 0;
+    uint64_t framesTriggered = 0;
+    uint64_t framesSkipped = 0;
+    uint64_t gateCandidates = 0;
+    uint64_t gateRejected = 0;
+    uint64_t auditFrames = 0;
+    uint64_t auditPositives = 0;
+    uint64_t auditDetectionHits = 0;
+    uint64_t auditTextHits = 0;
+    uint64_t vehiclesReported = 0;
+    uint64_t cropsSettled = 0;
+    uint64_t cacheLookups = 0;
+    uint64_t cacheHits = 0;
+    uint64_t captureToOcrSumUs = 0;
+    uint64_t captureToOcrCount = 0;
+    uint64_t captureToResultSumUs = 0;
+    uint64_t captureToResultCount = 0;
+    uint64_t detectSumUs = 0;
+    uint64_t detectCount = 0;
+    uint64_t deskewSumUs = 0;
+    uint64_t deskewCount = 0;
+    uint64_t ocrSumUs = 0;
+    uint64_t ocrCount = 0;
+    uint64_t previewSumUs = 0;
+    uint64_t previewCount = 0;
+
+    // Максимумы сбрасываются при каждом снимке
+    uint64_t captureToOcrMaxUs = 0;
+    uint64_t captureToResultMaxUs = 0;
+    uint64_t detectMaxUs = 0;
+    uint64_t deskewMaxUs = 0;
+    uint64_t ocrMaxUs = 0;
+
+    static StreamStatsSnapshot take(StreamStats &stats)
+    {
+        StreamStatsSnapshot s;
+        s.framesCaptured = stats.framesCaptured.load(std::memory_order_relaxed);
+        s.framesDropped = stats.framesDropped.load(std::memory_order_relaxed);
+        s.framesSubmitted = stats.framesSubmitted.load(std::memory_order_relaxed);
+        s.resultsReceived = stats.resultsReceived.load(std::memory_order_relaxed);
+        s.platesRecognized = stats.platesRecognized.load(std::memory_order_relaxed);
+        s.bytesSubmitted = stats.bytesSubmitted.load(std::memory_order_relaxed);
+        s.requestsCoalesced = stats.requestsCoalesced.load(std::memory_order_relaxed);
+        s.requestsTimedOut = stats.requestsTimedOut.load(std::memory_order_relaxed);
+        s.requestsFailed = stats.requestsFailed.load(std::memory_order_relaxed);
+        s.framesTriggered = stats.framesTriggered.load(std::memory_order_relaxed);
+        s.framesSkipped = stats.framesSkipped.load(std::memory_order_relaxed);
+        s.gateCandidates = stats.gateCandidates.load(std::memory_order_relaxed);
+        s.gateRejected = stats.gateRejected.load(std::memory_order_relaxed);
+        s.auditFrames = stats.auditFrames.load(std::memory_order_relaxed);
+        s.auditPositives = stats.auditPositives.load(std::memory_order_relaxed);
+        s.auditDetectionHits = stats.auditDetectionHits.load(std::memory_order_relaxed);
+        s.auditTextHits = stats.auditTextHits.load(std::memory_order_relaxed);
+        s.vehiclesReported = stats.vehiclesReported.load(std::memory_order_relaxed);
+        s.cropsSettled = stats.cropsSettled.load(std::memory_order_relaxed);
+        s.cacheLookups = stats.cacheLookups.load(std::memory_order_relaxed);
+        s.cacheHits = stats.cacheHits.load(std::memory_order_relaxed);
+        s.captureToOcrSumUs = stats.captureToOcr.sumUs.load(std::memory_order_relaxed);
+        s.captureToOcrCount = stats.captureToOcr.count.load(std::memory_order_relaxed);
+        s.captureToOcrMaxUs = stats.captureToOcr.maxUs.exchange(0, std::memory_order_relaxed);
+        s.captureToResultSumUs = stats.captureToResult.sumUs.load(std::memory_order_relaxed);
+        s.captureToResultCount = stats.captureToResult.count.load(std::memory_order_relaxed);
+        s.captureToResultMaxUs =
+            stats.captureToResult.maxUs.exchange(0, std::memory_order_relaxed);
+        s.detectSumUs = stats.detectTime.sumUs.load(std::memory_order_relaxed);
+        s.detectCount = stats.detectTime.count.load(std::memory_order_relaxed);
+        s.detectMaxUs = stats.detectTime.maxUs.exchange(0, std::memory_order_relaxed);
+        s.deskewSumUs = stats.deskewTime.sumUs.load(std::memory_order_relaxed);
+        s.deskewCount = stats.deskewTime.count.load(std::memory_order_relaxed);
+        s.deskewMaxUs = stats.deskewTime.maxUs.exchange(0, std::memory_order_relaxed);
+        s.ocrSumUs = stats.ocrTime.sumUs.load(std::memory_order_relaxed);
+        s.ocrCount = stats.ocrTime.count.load(std::memory_order_relaxed);
+        s.ocrMaxUs = stats.ocrTime.maxUs.exchange(0, std::memory_order_relaxed);
+        s.previewSumUs = stats.previewTime.sumUs.load(std::memory_order_relaxed);
+        s.previewCount = stats.previewTime.count.load(std::memory_order_relaxed);
+        return s;
+    }
+};
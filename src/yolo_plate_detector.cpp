@@ -0,0 +1,206 @@
+#include "yolo_plate_detector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+bool YoloPlateDetector::load(const YoloDetectorConfig &config)
+{
+    this->config = config;
+
+    std::unique_ptr<Context> context;
+    try {
+        context = createContext();
+    } catch (const cv::Exception &e) {
+        std::cerr << "Could not load YOLO plate detector from: " << config.modelPath << " ("
+                  << e.what() << ")" << std::endl;
+        return false;
+    }
+    if (!context || context->net.empty()) {
+        std::cerr << "Could not load YOLO plate detector from: " << config.modelPath << std::endl;
+        return false;
+    }
+
+    loaded = true;
+    contexts.release(std::move(context));
+    return true;
+}
+
+std::unique_ptr<YoloPlateDetector::Context> YoloPlateDetector::createContext() const
+{
+    std::unique_ptr<Context> context(new Context());
+    context->net = cv::dnn::readNetFromONNX(config.modelPath);
+    context->net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+    context->net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+    context->outputNames = context->net.getUnconnectedOutLayersNames();
+    context->letterboxed.resize(std::max(1, config.maxBatchSize));
+    return context;
+}
+
+std::vector<cv::Rect> YoloPlateDetector::detect(const cv::Mat &image)
+{
+    if (image.empty() || !loaded) {
+        return {};
+    }
+
+    Job job;
+    job.image = &image;
+    const auto window = std::chrono::milliseconds(std::max(0, config.batchWindowMs));
+    const size_t maxBatch = static_cast<size_t>(std::max(1, config.maxBatchSize));
+
+    std::unique_lock<std::mutex> lock(batchMutex);
+    if (pending.empty()) {
+        batchDeadline = std::chrono::steady_clock::now() + window;
+    }
+    pending.push_back(&job);
+    batchChanged.notify_all();
+
+    while (!job.done) {
+        // Кадр уже в чужом батче - ждем результата
+        if (job.taken) {
+            batchChanged.wait(lock);
+            continue;
+        }
+
+        // Батч не набран и окно не истекло - ждем кадры других камер
+        if (pending.size() < maxBatch && std::chrono::steady_clock::now() < batchDeadline) {
+            batchChanged.wait_until(lock, batchDeadline);
+            continue;
+        }
+
+        // Этот поток прогоняет батч из первых кадров очереди. Оставшиеся
+        // кадры свое окно уже отождали и уйдут следующим батчем сразу
+        std::vector<Job *> jobs;
+        while (!pending.empty() && jobs.size() < maxBatch) {
+            Job *next = pending.front();
+            pending.pop_front();
+            next->taken = true;
+            jobs.push_back(next);
+        }
+
+        lock.unlock();
+        runBatch(jobs);
+        lock.lock();
+
+        for (Job *done : jobs) {
+            done->done = true;
+        }
+        batchChanged.notify_all();
+    }
+
+    return std::move(job.boxes);
+}
+
+void YoloPlateDetector::runBatch(const std::vector<Job *> &jobs)
+{
+    std::unique_ptr<Context> context = contexts.acquire([this]() { return createContext(); });
+    try {
+        const cv::Size inputSize(config.inputSize, config.inputSize);
+        if (context->letterboxed.size() < jobs.size()) {
+            context->letterboxed.resize(jobs.size());
+        }
+
+        std::vector<Letterbox> boxes(jobs.size());
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            boxes[i] = letterbox(*jobs[i]->image, context->letterboxed[i]);
+        }
+
+        // Заголовки на буферы контекста, сами данные не копируются
+        std::vector<cv::Mat> inputs(context->letterboxed.begin(),
+                                    context->letterboxed.begin() + jobs.size());
+        cv::dnn::blobFromImages(inputs, context->blob, 1.0 / 255.0, inputSize, cv::Scalar(), true,
+                                false, CV_32F);
+        context->net.setInput(context->blob);
+        context->net.forward(context->outputs, context->outputNames);
+
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            jobs[i]->boxes = parseDetections(context->outputs[0], static_cast<int>(i), boxes[i],
+                                             jobs[i]->image->size());
+        }
+    } catch (const cv::Exception &e) {
+        std::cerr << "YOLO inference failed: " << e.what() << std::endl;
+    }
+    contexts.release(std::move(context));
+}
+
+// Вписываем кадр в квадрат inputSize с сохранением пропорций, поля серые (114),
+// как в ultralytics. Холст переиспользуется, закрашиваются только поля
+YoloPlateDetector::Letterbox YoloPlateDetector::letterbox(const cv::Mat &image,
+                                                         cv::Mat &canvas) const
+{
+    const int size = config.inputSize;
+    canvas.create(size, size, CV_8UC3);
+
+    Letterbox box;
+    box.scale = std::min(double(size) / image.cols, double(size) / image.rows);
+    const int width = std::min(size, std::max(1, cvRound(image.cols * box.scale)));
+    const int height = std::min(size, std::max(1, cvRound(image.rows * box.scale)));
+    box.padX = (size - width) / 2;
+    box.padY = (size - height) / 2;
+
+    const cv::Scalar fill(114, 114, 114);
+    canvas.rowRange(0, box.padY).setTo(fill);
+    canvas.rowRange(box.padY + height, size).setTo(fill);
+    canvas.colRange(0, box.padX).setTo(fill);
+    canvas.colRange(box.padX + width, size).setTo(fill);
+
+    cv::Mat target = canvas(cv::Rect(box.padX, box.padY, width, height));
+    if (image.channels() == 1) {
+        cv::Mat resized;
+        cv::resize(image, resized, target.size(), 0, 0, cv::INTER_LINEAR);
+        cv::cvtColor(resized, target, cv::COLOR_GRAY2BGR);
+    } else {
+        cv::resize(image, target, target.size(), 0, 0, cv::INTER_LINEAR);
+    }
+    return box;
+}
+
+// Выход YOLOv8: (батч, 4 + классы, кандидаты); строки - cx, cy, w, h и оценки классов
+std::vector<cv::Rect> YoloPlateDetector::parseDetections(const cv::Mat &output, int batchIndex,
+                                                         const Letterbox &box,
+                                                         const cv::Size &imageSize) const
+{
+    if (output.dims != 3 || output.size[1] < 5) {
+        return {};
+    }
+
+    const int rows = output.size[1];
+    const int count = output.size[2];
+    const float *data = output.ptr<float>(batchIndex);
+
+    std::vector<cv::Rect> candidates;
+    std::vector<float> scores;
+    for (int j = 0; j < count; ++j) {
+        float score = 0.0f;
+        for (int r = 4; r < rows; ++r) {
+            score = std::max(score, data[r * count + j]);
+        }
+        if (score < config.confThreshold) {
+            continue;
+        }
+
+        // Из координат letterbox обратно в координаты кадра
+        const float cx = data[j];
+        const float cy = data[count + j];
+        const float w = data[2 * count + j];
+        const float h = data[3 * count + j];
+        const double x = (cx - w / 2 - box.padX) / box.scale;
+        const double y = (cy - h / 2 - box.padY) / box.scale;
+        candidates.emplace_back(cvRound(x), cvRound(y), cvRound(w / box.scale),
+                                cvRound(h / box.scale));
+        scores.push_back(score);
+    }
+
+    std::vector<int> keep;
+    cv::dnn::NMSBoxes(candidates, scores, config.confThreshold, config.nmsThreshold, keep);
+
+    std::vector<cv::Rect> plates;
+    const cv::Rect bounds(0, 0, imageSize.width, imageSize.height);
+    for (int index : keep) {
+        cv::Rect plate = candidates[index] & bounds;
+        if (!plate.empty()) {
+            plates.push_back(plate);
+        }
+    }
+    return plates;
+}
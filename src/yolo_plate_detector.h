@@ -0,0 +1,84 @@
+#pragma once
+
+#include <opencv2/dnn.hpp>
+#include <opencv2/opencv.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "object_pool.h"
+
+struct YoloDetectorConfig
+{
+    std::string modelPath = "plate_yolov8n.onnx"; // экспорт best.pt из ANPR-System
+    int inputSize = 640;
+    float confThreshold = 0.5f; // как DETECTION_CONFIDENCE_THRESHOLD в inference.py
+    float nmsThreshold = 0.45f;
+    int maxBatchSize = 8;       // кадров разных камер в одном прогоне сети
+    int batchWindowMs = 3;      // сколько первый кадр ждет остальных
+};
+
+// Детектор номеров YOLOv8n (YOLODetector из inference.py) через cv::dnn.
+// detect() вызывается из рабочих потоков разных камер: кадры, пришедшие
+// в пределах batchWindowMs, собираются в один батч, и его прогоняет тот
+// поток, который первым дождался окна или заполнил батч. Остальные ждут
+// своих результатов. Letterbox и блоб пишутся в буферы, которые живут
+// вместе с копией сети в пуле и не перевыделяются от кадра к кадру.
+class YoloPlateDetector
+{
+public:
+    bool load(const YoloDetectorConfig &config = YoloDetectorConfig());
+    bool isLoaded() const { return loaded; }
+    const YoloDetectorConfig &detectorConfig() const { return config; }
+
+    // Все номера в координатах image после NMS
+    std::vector<cv::Rect> detect(const cv::Mat &image);
+
+private:
+    struct Job
+    {
+        const cv::Mat *image = nullptr;
+        std::vector<cv::Rect> boxes;
+        bool taken = false;
+        bool done = false;
+    };
+
+    // Копия сети со своими буферами
+    struct Context
+    {
+        cv::dnn::Net net;
+        std::vector<cv::String> outputNames;
+        std::vector<cv::Mat> letterboxed;
+        cv::Mat blob;
+        std::vector<cv::Mat> outputs;
+    };
+
+    struct Letterbox
+    {
+        double scale = 1.0;
+        int padX = 0;
+        int padY = 0;
+    };
+
+    void runBatch(const std::vector<Job *> &jobs);
+    Letterbox letterbox(const cv::Mat &image, cv::Mat &canvas) const;
+    std::vector<cv::Rect> parseDetections(const cv::Mat &output, int batchIndex,
+                                          const Letterbox &box, const cv::Size &imageSize) const;
+
+    std::unique_ptr<Context> createContext() const;
+
+    YoloDetectorConfig config;
+    bool loaded = false;
+
+    ObjectPool<Context> contexts; // по копии на одновременный батч
+
+    std::mutex batchMutex;
+    std::condition_variable batchChanged;
+    std::deque<Job *> pending;
+    std::chrono::steady_clock::time_point batchDeadline;
+};